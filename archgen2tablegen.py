@@ -4,6 +4,7 @@ import re
 import os
 import sys
 import argparse
+import hashlib
 from math import log2, ceil
 
 parser = argparse.ArgumentParser(
@@ -12,6 +13,7 @@ parser = argparse.ArgumentParser(
                     epilog='Shout at kayvan if this fails :D')
 parser.add_argument('-b', '--bfu_list', type=str, help='Path to BFU_list.txt')
 parser.add_argument('-p', '--primate_cfg', type=str, help='Path to primate.cfg')
+parser.add_argument('-r', '--rom_cfg', type=str, help='Path to rom.cfg (ROM BFUs from primate-table-offload)', default=None)
 parser.add_argument('--output', type=str, help='Output directory for tablegen files', default='./primate-compiler-gen/')
 parser.add_argument('--FrontendOnly', action='store_true', help='only generates the intrinsics and builtins, not the full schedule', default=False)
 parser.add_argument('--dry-run', action='store_true', help='Prints the output to stdout instead of writing to files', default=False)
@@ -31,8 +33,19 @@ def parse_BFU_list(file_path):
       # just return the number of { in the file
       return len(re.findall(r'{', f.read()))
 
+# returns the number of ROM BFUs archgen instanced for offloaded tables
+def parse_rom_config(file_path):
+  numROMs = 0
+  with open(file_path, 'r') as f:
+    for line in f:
+      toks = line.strip().split("=")
+      if toks[0] == "NUM_ROMS":
+        numROMs = int(toks[1])
+  return numROMs
+
 # returns the number of BFUs and ALUs archgen instanced
 def parse_arch_config(file_path):
+  numLSUs = 1
   with open(file_path, 'r') as f:
     for line in f:
       if(VERBOSE):
@@ -41,10 +54,33 @@ def parse_arch_config(file_path):
       if toks[0] == "NUM_ALUS":
         numALUs = int(toks[1])
       if toks[0] == "NUM_BFUS":
-        numBFUs = int(toks[1]) + 2 # IO and LSU are hidden
+        numBFUs = int(toks[1]) + 1 # IO and the LSUs are hidden
+      if toks[0] == "NUM_LSUS":
+        numLSUs = int(toks[1])
       if toks[0] == "NUM_REGS":
         numRegs = int(toks[1])
-  return numALUs, numBFUs, numRegs
+  return numALUs, numBFUs + numLSUs, numRegs, numLSUs
+
+# capability bits of the ALU_CAPS masks, one per optional itinerary class
+ALU_CAP_ITINS = [("ItinMul", 1), ("ItinShift", 2), ("ItinBitManip", 4), ("ItinCompare", 8)]
+ALU_CAP_ALL = 0xf
+
+# returns the capability mask of every ALU lane, full lanes if archgen wrote none
+def parse_alu_caps(file_path, num_alus: int):
+  caps = []
+  with open(file_path, 'r') as f:
+    for line in f:
+      toks = line.strip().split("=")
+      if toks[0] == "ALU_CAPS":
+        caps = [int(c) for c in toks[1].split()]
+  caps = caps[:num_alus] + [ALU_CAP_ALL] * (num_alus - len(caps))
+  if not any(caps):
+    caps[0] = ALU_CAP_ALL
+  for _, bit in ALU_CAP_ITINS:
+    if not any(c & bit for c in caps):
+      print(f"ALU_CAPS leaves capability {bit} without a lane, giving it to lane 0")
+      caps[0] |= bit
+  return caps
 
 def write_instr_format(num_regs: int):
   # size of instr
@@ -468,7 +504,7 @@ def write_regfile(num_regs: int):
 # num_bfus is number of instanced BFUs
 # will need to be updated to have BFU ordering for now is in order of definition in 
 # bfu_list.txt 
-def write_schedule(num_bfus: int, num_alus: int):
+def write_schedule(num_bfus: int, num_alus: int, alu_caps, num_lsus: int = 1):
   numSlots = max(num_bfus, num_alus)
 
   # BFUs and ALUs are merged starting with the last BFU slot. 
@@ -479,8 +515,9 @@ def write_schedule(num_bfus: int, num_alus: int):
     hasGFU = [True] * (num_alus) + [False] * (num_bfus - num_alus)
     hasBFU = [True] * numSlots
 
+  # one LSU per data memory bank, bank k right below bank k-1
   IOSlot = num_bfus - 1
-  LSUSlot = num_bfus - 2
+  LSUSlots = [num_bfus - 2 - k for k in range(num_lsus)]
 
   if(VERBOSE):
     print(f"hasGFU: {hasGFU}")
@@ -509,6 +546,7 @@ def write_schedule(num_bfus: int, num_alus: int):
   allGFUnitNames = []
   allIOUnitNames = []
   allLSUnitNames = []
+  bankLSUnitNames = {}
   packetOrderUnitNames = []
   for slot, (gfu, bfu) in enumerate(zip(hasGFU, hasBFU)):
     if gfu:
@@ -522,11 +560,14 @@ def write_schedule(num_bfus: int, num_alus: int):
         allIOUnitNames += [IOUnitMergedDef.format(slot)]
         packetOrderUnitNames += [IOUnitMergedDef.format(slot)]
         funcUnitDef += unitDefTemplate.format(IOUnitMergedDef).format(slot)
-      elif slot == LSUSlot:
-        allGFUnitNames += [LSUnitMergedDef.format(slot)]
-        allLSUnitNames += [LSUnitMergedDef.format(slot)]
-        packetOrderUnitNames += [LSUnitMergedDef.format(slot)]
-        funcUnitDef += unitDefTemplate.format(LSUnitMergedDef).format(slot)
+      elif slot in LSUSlots:
+        bank = LSUSlots.index(slot)
+        unit = LSUnitMergedDef + (str(bank) if bank else "")
+        allGFUnitNames += [unit]
+        allLSUnitNames += [unit]
+        bankLSUnitNames[bank] = unit
+        packetOrderUnitNames += [unit]
+        funcUnitDef += unitDefTemplate.format(unit)
       else:
         BFUItinData += BFUItinDataTemplate.format(slot, mergedUnitDef.format(slot))
         allGFUnitNames += [mergedUnitDef.format(slot)]
@@ -542,10 +583,13 @@ def write_schedule(num_bfus: int, num_alus: int):
         allIOUnitNames += [IOUnitDef.format(slot)]
         packetOrderUnitNames += [IOUnitDef.format(slot)]
         funcUnitDef += unitDefTemplate.format(IOUnitDef).format(slot)
-      elif slot == LSUSlot:
-        allLSUnitNames += [LSUnitDef.format(slot)]
-        packetOrderUnitNames += [LSUnitDef.format(slot)]
-        funcUnitDef += unitDefTemplate.format(LSUnitDef).format(slot)
+      elif slot in LSUSlots:
+        bank = LSUSlots.index(slot)
+        unit = LSUnitDef + (str(bank) if bank else "")
+        allLSUnitNames += [unit]
+        bankLSUnitNames[bank] = unit
+        packetOrderUnitNames += [unit]
+        funcUnitDef += unitDefTemplate.format(unit)
       else:
         BFUItinData += BFUItinDataTemplate.format(slot, blueUnitDef.format(slot))
         allBFUnitNames += [blueUnitDef.format(slot)]
@@ -582,6 +626,32 @@ def write_schedule(num_bfus: int, num_alus: int):
   if(VERBOSE):
     print(PipeDefs)
 
+  # the packetizer reserves bank k's LSU with ItinMem<k>, the backend tells
+  # four banks apart
+  bankItinData = []
+  for bank in range(4):
+    unit = bankLSUnitNames.get(bank, bankLSUnitNames[0])
+    bankItinData.append(f"InstrItinData<{'ItinMem' + str(bank) + ',':<19}[InstrStage<1, [{unit}]>]>")
+
+  # lanes are the green units in slot order, each class only issues on the
+  # lanes that have its capability. Multiplies and shifts have their own
+  # SchedWrites, so the scheduler sees the same lanes through a pipe group.
+  capItinData = []
+  capPipeDefs = ""
+  capPipes = {}
+  for itin, bit in ALU_CAP_ITINS:
+    units = [u for lane, u in enumerate(allGFUnitNames) if alu_caps[lane] & bit]
+    capItinData.append(f"InstrItinData<{itin + ',':<19}[InstrStage<1, [{','.join(units)}]>]>")
+    pipes = [u + "Pipe" for u in units]
+    if itin not in ("ItinMul", "ItinShift"):
+      continue
+    if len(pipes) == len(greenPipes):
+      capPipes[itin] = "GreenPipes"
+    elif len(pipes) == 1:
+      capPipes[itin] = pipes[0]
+    else:
+      capPipes[itin] = itin.replace("Itin", "") + "Pipes"
+      capPipeDefs += f"def {capPipes[itin]} : ProcResGroup<[{','.join(pipes)}]>;\n  "
 
   ProcItinTemplate = """
   InsertUnit{0},
@@ -617,10 +687,12 @@ def write_schedule(num_bfus: int, num_alus: int):
       InstrItinData<ItinExtract,       [InstrStage<1, [{",".join(allExtractUnitNames)}]>]>,
       InstrItinData<ItinInsert,        [InstrStage<1, [{",".join(allInsertUnitNames)}]>]>,
       InstrItinData<ItinGreen,         [InstrStage<1, [{",".join(allGFUnitNames)}]>]>,
+      {f",{chr(10)}      ".join(capItinData)},
       {BFUItinData}
       InstrItinData<ItinIO,            [InstrStage<1, [{",".join(allIOUnitNames)}]>]>,
       InstrItinData<ItinBranch,        [InstrStage<1, [BranchUnit]>]>,
-      InstrItinData<ItinMem,           [InstrStage<1, [{",".join(allLSUnitNames)}]>]>
+      InstrItinData<ItinMem,           [InstrStage<1, [{",".join(allLSUnitNames)}]>]>,
+      {f",{chr(10)}      ".join(bankItinData)}
     ];
   }}
 
@@ -668,6 +740,7 @@ def write_schedule(num_bfus: int, num_alus: int):
   ]>;
   def GreenPipes : ProcResGroup<[{",".join(greenPipes)}]>;
   def BluePipes : ProcResGroup<[{",".join(bluePipes)}]>;
+  {capPipeDefs}
 
 
   // Branching
@@ -680,24 +753,24 @@ def write_schedule(num_bfus: int, num_alus: int):
   let Latency = 3 in {{
   def : WriteRes<WriteIALU, [GreenPipes]>;
   def : WriteRes<WriteIALU32, [GreenPipes]>;
-  def : WriteRes<WriteShiftImm, [GreenPipes]>;
-  def : WriteRes<WriteShiftImm32, [GreenPipes]>;
-  def : WriteRes<WriteShiftReg, [GreenPipes]>;
-  def : WriteRes<WriteShiftReg32, [GreenPipes]>;
+  def : WriteRes<WriteShiftImm, [{capPipes['ItinShift']}]>;
+  def : WriteRes<WriteShiftImm32, [{capPipes['ItinShift']}]>;
+  def : WriteRes<WriteShiftReg, [{capPipes['ItinShift']}]>;
+  def : WriteRes<WriteShiftReg32, [{capPipes['ItinShift']}]>;
   }}
 
   // Integer multiplication
   let Latency = 3 in {{
-  def : WriteRes<WriteIMul, [GreenPipes]>;
-  def : WriteRes<WriteIMul32, [GreenPipes]>;
+  def : WriteRes<WriteIMul, [{capPipes['ItinMul']}]>;
+  def : WriteRes<WriteIMul32, [{capPipes['ItinMul']}]>;
   }}
 
   // Integer division
-  def : WriteRes<WriteIDiv, [GreenPipes]> {{
+  def : WriteRes<WriteIDiv, [{capPipes['ItinMul']}]> {{
     let Latency = 16;
     let ReleaseAtCycles = [15];
   }}
-  def : WriteRes<WriteIDiv32,  [GreenPipes]> {{
+  def : WriteRes<WriteIDiv32,  [{capPipes['ItinMul']}]> {{
     let Latency = 16;
     let ReleaseAtCycles = [15];
   }}
@@ -1006,6 +1079,10 @@ def write_bfu_clang_builtins(num_bfus: int):
   TARGET_BUILTIN(__primate_input_done, "v", "nt", "")
   TARGET_BUILTIN(__primate_output, "vv*Ci", "nt", "")
   TARGET_BUILTIN(__primate_output_done, "v", "nt", "")
+  TARGET_BUILTIN(__primate_input_seek, "ii", "nt", "")
+  TARGET_BUILTIN(__primate_output_seek, "ii", "nt", "")
+  TARGET_BUILTIN(__primate_input_len, "i", "nt", "")
+  TARGET_BUILTIN(__primate_drop, "v", "ntr", "")
   {BFU_BUILTINS}
 
   // Zbb extension
@@ -1094,6 +1171,10 @@ def write_bfu_CG(num_bfus: int):
   def inputDone:  PrimateBuiltin<"__primate_input_done", "", "primate_input_done", "IO">;
   def output:     PrimateBuiltin<"__primate_output", "Bi", "primate_output", "IO">;
   def outputDone: PrimateBuiltin<"__primate_output_done", "", "primate_output_done", "IO">;
+  def inputSeek:  PrimateBuiltin<"__primate_input_seek", "", "primate_input_seek", "IO">;
+  def outputSeek: PrimateBuiltin<"__primate_output_seek", "", "primate_output_seek", "IO">;
+  def inputLen:   PrimateBuiltin<"__primate_input_len", "", "primate_input_len", "IO">;
+  def drop:       PrimateBuiltin<"__primate_drop", "", "primate_drop", "IO">;
   {BFU_BUILTINS}
   """
 
@@ -1103,6 +1184,18 @@ def write_bfu_CG(num_bfus: int):
   with open(os.path.join(gen_file_dir, "primate_bfu.td"), "w") as f:
       print(front_end_stuff_template, file=f)
 
+# Same as PrimateAttrs::getConfigFingerprint: the MD5 of the non-empty
+# lines, stripped and sorted. The backend records it in every object and
+# refuses to compile against another primate.cfg. BFU_list.txt, rom.cfg,
+# interconnect.cfg and model.cfg are not part of it.
+def write_config_fingerprint(file_path):
+  with open(file_path, 'r') as f:
+    lines = sorted(line.strip() for line in f.read().split("\n") if line.strip())
+  fingerprint = hashlib.md5("".join(line + "\n" for line in lines).encode()).hexdigest()[:16]
+  with open(os.path.join(gen_file_dir, "PrimateConfigFingerprint.inc"), "w") as f:
+    print(f'static const char PrimateConfigFingerprint[] = "{fingerprint}";', file=f)
+
+
 def main():
   global gen_file_dir 
   global DRY_RUN
@@ -1113,6 +1206,13 @@ def main():
   VERBOSE = args.verbose
   os.makedirs(gen_file_dir, exist_ok=True)
   num_unique_bfus = parse_BFU_list(args.bfu_list) + 2 # IO and LSUs are hidden
+  if args.rom_cfg:
+    # ROM BFUs are numbered after the user BFUs
+    num_roms = parse_rom_config(args.rom_cfg)
+    if num_roms > 0:
+      print(f"ROM BFUs start at BFU_{num_unique_bfus-2}. "
+            f"Compile with -mllvm -primate-rom-bfu-base={num_unique_bfus-2}")
+    num_unique_bfus += num_roms
 
   write_bfu_intrins(num_unique_bfus)
   write_bfu_clang_builtins(num_unique_bfus)
@@ -1121,10 +1221,12 @@ def main():
   write_sched_resources_def(num_unique_bfus)
 
   if not args.FrontendOnly:
-    num_ALUs, num_BFUs, num_regs = parse_arch_config(args.primate_cfg)
-    write_schedule(num_BFUs, num_ALUs)
+    num_ALUs, num_BFUs, num_regs, num_LSUs = parse_arch_config(args.primate_cfg)
+    alu_caps = parse_alu_caps(args.primate_cfg, num_ALUs)
+    write_schedule(num_BFUs, num_ALUs, alu_caps, num_LSUs)
     write_regfile(num_regs)
     write_instr_format(num_regs)
+    write_config_fingerprint(args.primate_cfg)
 
 if __name__ == "__main__":
   main()
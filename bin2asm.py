@@ -1,4 +1,5 @@
 #! /bin/python3
+import hashlib
 import os
 import re
 import sys
@@ -7,9 +8,33 @@ import math
 if len(sys.argv) != 5: 
     print("wrong number of arguments....")
     print("Expected: " + sys.argv[0] + "<file objdump -dr> <file of objdump -t> <primate.cfg> <output binary>")
+    print("Dump with objdump -drl to also get a packet to source line map (<output binary>.lines)")
     exit(-1)
 
+# Same as PrimateAttrs::getConfigFingerprint: the MD5 of the non-empty
+# lines, stripped and sorted.
+def config_fingerprint(text):
+    lines = sorted(line.strip() for line in text.split("\n") if line.strip())
+    return hashlib.md5("".join(line + "\n" for line in lines).encode()).hexdigest()[:16]
+
 config_name = sys.argv[3]
+with open(config_name) as f:
+    config_hash = config_fingerprint(f.read())
+
+# llvm-objdump prints the fingerprint of the primate.cfg the object was
+# compiled for. An image for another configuration would not run.
+with open(sys.argv[1]) as f:
+    for line in f:
+        if line.startswith("primate config "):
+            toks = line.split()
+            if toks[2] != config_hash:
+                print(f"{sys.argv[1]} was compiled for primate config {toks[2]} ({' '.join(toks[3:])}), "
+                      f"{config_name} is {config_hash}")
+                exit(-1)
+            break
+    else:
+        print(f"warning: no primate config in {sys.argv[1]}, cannot check it against {config_name}")
+
 with open(config_name) as f:
     for line in f:
         toks = line.split("=")
@@ -65,9 +90,18 @@ outFile = open(oname, "w+")
 
 symPat = re.compile(r"[0-9a-f]{8} <.*:")
 pktBrk = re.compile(r"[0-9]+ --------$")
+# source lines printed by objdump -l, one per line a packet executes
+srcPat = re.compile(r"; (.+):([0-9]+)$")
 symTable = {}
 
+# packet index in the image -> source lines, written next to the image so
+# packet addresses from hardware traces can be mapped back to the source
+packetLines = []
+currentLines = []
+pendingLines = []
+
 def write_packet(packet):
+    packetLines.append(currentLines)
     for instr in currentPacket[::-1]:
         iToks = instr.split()
         instr_val = ""
@@ -163,7 +197,12 @@ with open(fname) as f:
         line = line.strip()
         if len(line) == 0:
             continue
-        if symPat.match(line):
+        if srcPat.match(line):
+            m = srcPat.match(line)
+            pendingLines.append(m.group(1) + ":" + m.group(2))
+        elif line.startswith(";"):
+            pass
+        elif symPat.match(line):
             pass
         elif pktBrk.match(line):
             pass
@@ -180,9 +219,18 @@ with open(fname) as f:
                 if len(currentPacket) == PACKET_SIZE_IN_INSTRS:
                     write_packet(currentPacket)
                     currentPacket = []
+                    currentLines = []
                 currentPacket.append(rest)
+                currentLines += [l for l in pendingLines if l not in currentLines]
+                pendingLines = []
             except ValueError as e:
                 print("error line " + str(e))
                 print(line)
     assert(len(currentPacket) == PACKET_SIZE_IN_INSTRS)
     write_packet(currentPacket)
+
+if any(packetLines):
+    with open(oname + ".lines", "w") as linesFile:
+        for idx, lines in enumerate(packetLines):
+            linesFile.write(f"{idx} {' '.join(lines)}\n")
+    print("wrote packet to source line map to " + oname + ".lines")
@@ -116,6 +116,12 @@ public:
   bool hasMemtagGlobals() const {
     return Sanitizers.has(SanitizerKind::MemtagGlobals);
   }
+  bool hasPrimateInput() const {
+    return Sanitizers.has(SanitizerKind::PrimateInput);
+  }
+  bool trapsPrimateInput() const {
+    return TrapSanitizers.has(SanitizerKind::PrimateInput);
+  }
   const std::string &getMemtagMode() const {
     assert(!MemtagMode.empty());
     return MemtagMode;
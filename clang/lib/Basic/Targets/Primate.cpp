@@ -175,14 +175,13 @@ void PrimateTargetInfo::getTargetDefines(const LangOptions &Opts,
     Builder.defineMacro("__Primate_muldiv");
   }
 
-  if (ISAInfo->hasExtension("a")) {
-    Builder.defineMacro("__Primate_atomic");
-    Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_1");
-    Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_2");
-    Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4");
-    if (Is64Bit)
-      Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8");
-  }
+  // atomics are native on every Primate core, see setMaxAtomicWidth
+  Builder.defineMacro("__Primate_atomic");
+  Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_1");
+  Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_2");
+  Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4");
+  if (Is64Bit)
+    Builder.defineMacro("__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8");
 
   if (FLen) {
     Builder.defineMacro("__Primate_flen", Twine(FLen));
@@ -145,11 +145,11 @@ public:
     return false;
   }
 
+  // The LSU performs atomic read-modify-writes on every Primate core, with
+  // or without the 'a' extension in -march.
   void setMaxAtomicWidth() override {
     MaxAtomicPromoteWidth = 128;
-
-    if (ISAInfo->hasExtension("a"))
-      MaxAtomicInlineWidth = 32;
+    MaxAtomicInlineWidth = 32;
   }
 };
 class LLVM_LIBRARY_VISIBILITY Primate64TargetInfo : public PrimateTargetInfo {
@@ -177,9 +177,7 @@ public:
 
   void setMaxAtomicWidth() override {
     MaxAtomicPromoteWidth = 128;
-
-    if (ISAInfo->hasExtension("a"))
-      MaxAtomicInlineWidth = 64;
+    MaxAtomicInlineWidth = 64;
   }
 };
 } // namespace targets
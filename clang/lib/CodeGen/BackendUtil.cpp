@@ -80,6 +80,7 @@
 #include "llvm/Transforms/Instrumentation/SanitizerCoverage.h"
 #include "llvm/Transforms/Instrumentation/ThreadSanitizer.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include "llvm/Transforms/Primate/PrimateInputSanitizer.h"
 #include "llvm/Transforms/Scalar/EarlyCSE.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Scalar/JumpThreading.h"
@@ -979,6 +980,20 @@ void EmitAssemblyHelper::RunOptimizationPipeline(
             FPM.addPass(BoundsCheckingPass());
           });
 
+    // Host builds of Primate programs, e.g. for fuzzing. On Primate the
+    // driver passes -primate-input-sanitizer and the target's pipeline runs
+    // the checks among its own passes.
+    if (LangOpts.Sanitize.has(SanitizerKind::PrimateInput) &&
+        !TargetTriple.isPrimate()) {
+      bool Trap = CodeGenOpts.SanitizeTrap.has(SanitizerKind::PrimateInput);
+      PB.registerOptimizerLastEPCallback(
+          [Trap](ModulePassManager &MPM, OptimizationLevel Level) {
+            MPM.addPass(PrimateInputSanitizer(
+                Trap ? PrimateInputSanitizer::Trap
+                     : PrimateInputSanitizer::Report));
+          });
+    }
+
     // Don't add sanitizers if we are here from ThinLTO PostLink. That already
     // done on PreLink stage.
     if (!IsThinLTOPostLink) {
@@ -21333,8 +21333,16 @@ Value *CodeGenFunction::EmitPrimateBuiltinExpr(unsigned BuiltinID,
   SmallVector<Value *, 4> Ops;
   llvm::Type *ResultType = ConvertType(E->getType());
 
-  for (unsigned i = 0, e = E->getNumArgs(); i != e; i++)
-    Ops.push_back(EmitScalarExpr(E->getArg(i)));
+  // A BFU builtin called on a struct value returns a struct of the same type,
+  // see Sema::CheckPrimateBFUBuiltinCall.
+  bool ByValue = E->getType()->isStructureType();
+  for (unsigned i = 0, e = E->getNumArgs(); i != e; i++) {
+    if (ByValue)
+      Ops.push_back(
+          Builder.CreateLoad(EmitAggExprToLValue(E->getArg(i)).getAddress(*this)));
+    else
+      Ops.push_back(EmitScalarExpr(E->getArg(i)));
+  }
 
   Intrinsic::ID ID = Intrinsic::not_intrinsic;
   unsigned NF = 1;
@@ -21468,6 +21476,8 @@ Value *CodeGenFunction::EmitPrimateBuiltinExpr(unsigned BuiltinID,
   }
 
   assert(ID != Intrinsic::not_intrinsic);
+  if (ByValue)
+    IntrinsicTypes = {ResultType, Ops[0]->getType()};
 
   llvm::Function *F = CGM.getIntrinsic(ID, IntrinsicTypes);
   switch(BuiltinID) {
@@ -21477,5 +21487,11 @@ Value *CodeGenFunction::EmitPrimateBuiltinExpr(unsigned BuiltinID,
   default:
   break;
   }
-  return Builder.CreateCall(F, Ops, "");
+  llvm::Value *Call = Builder.CreateCall(F, Ops, "");
+  if (ByValue) {
+    Address Dest = ReturnValue.isNull() ? CreateMemTemp(E->getType())
+                                        : ReturnValue.getValue();
+    Builder.CreateStore(Call, Dest);
+  }
+  return Call;
 }
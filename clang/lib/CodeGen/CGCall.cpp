@@ -2409,6 +2409,13 @@ void CodeGenModule::ConstructAttributeList(StringRef Name,
         FuncAttrs.addAttribute(llvm::Attribute::NoMerge);
     }
 
+    // Primate: operations of a model unit stay calls on the target, see
+    // AddPrimateModelMetadata. What memory they touch is inferred from the
+    // body like for any other function, and host builds of the model inline
+    // them freely.
+    if (getTriple().isPrimate() && getPrimateModel(TargetDecl))
+      FuncAttrs.addAttribute(llvm::Attribute::NoInline);
+
     // 'const', 'pure' and 'noalias' attributed functions are also nounwind.
     if (TargetDecl->hasAttr<ConstAttr>()) {
       FuncAttrs.addMemoryAttr(llvm::MemoryEffects::none());
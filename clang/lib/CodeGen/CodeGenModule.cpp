@@ -22,6 +22,7 @@
 #include "CGOpenCLRuntime.h"
 #include "CGOpenMPRuntime.h"
 #include "CGOpenMPRuntimeGPU.h"
+#include "CGRecordLayout.h"
 #include "CodeGenFunction.h"
 #include "CodeGenPGO.h"
 #include "ConstantEmitter.h"
@@ -221,6 +222,10 @@ createTargetCodeGenInfo(CodeGenModule &CGM) {
   case llvm::Triple::msp430:
     return createMSP430TargetCodeGenInfo(CGM);
 
+  case llvm::Triple::primate32:
+  case llvm::Triple::primate64:
+    return createPrimateTargetCodeGenInfo(CGM);
+
   case llvm::Triple::riscv32:
   case llvm::Triple::riscv64: {
     StringRef ABIStr = Target.getABI();
@@ -4655,6 +4660,10 @@ llvm::Constant *CodeGenModule::GetOrCreateLLVMFunction(
       AddPrimateMetadata(F, D, Attrs);
     }
   }
+  // Member functions of a '#pragma primate model' class are the operations
+  // of that unit.
+  if (const PrimateAttr *PA = getPrimateModel(D))
+    AddPrimateModelMetadata(F, cast<CXXMethodDecl>(D), PA);
 
   // Make sure the result is of the requested type.
   if (!IsIncompleteFunction) {
@@ -7705,6 +7714,14 @@ void CodeGenModule::AddPrimateMetadata(llvm::Function *F, const Decl *D,
         }
         break;
 
+      case PrimateAttr::Reg:
+        // reg annotates types, see AddPrimateRegMetadata.
+        break;
+
+      case PrimateAttr::Model:
+        // model annotates classes, see AddPrimateModelMetadata.
+        break;
+
       default:
         llvm_unreachable("Unhandled Primate option.");
         break;
@@ -7712,3 +7729,156 @@ void CodeGenModule::AddPrimateMetadata(llvm::Function *F, const Decl *D,
     }
   }
 }
+
+// Primate
+// List a struct annotated with '#pragma primate reg' in !primate.reg so that
+// archgen sizes the register fields for it and the backend keeps it in a
+// WIDEREG. Each entry is {poison of the struct type, struct name, names of the
+// source fields stored in each LLVM element, bit-fields}.
+void CodeGenModule::AddPrimateRegMetadata(const RecordDecl *RD,
+                                          llvm::StructType *Ty) {
+  if (Ty->isOpaque() || !PrimateRegTypes.insert(Ty).second)
+    return;
+
+  llvm::LLVMContext &Ctx = getLLVMContext();
+  getModule().getOrInsertNamedMetadata("primate.reg")->addOperand(
+      llvm::MDNode::get(Ctx,
+          {llvm::ConstantAsMetadata::get(llvm::PoisonValue::get(Ty)),
+           llvm::MDString::get(Ctx, RD->getName()),
+           getPrimateFieldNames(RD, Ty),
+           getPrimateBitFields(RD, Ty)}));
+}
+
+// Bit-fields share an LLVM element with their neighbours, so the element
+// list alone hides their boundaries. Describe each one as {name, element,
+// bit offset within the element, width} so archgen can give it a register
+// field of its own and the backend can extract it in one op.
+llvm::MDNode *CodeGenModule::getPrimateBitFields(const RecordDecl *RD,
+                                                 llvm::StructType *Ty) {
+  const CGRecordLayout &Layout = getTypes().getCGRecordLayout(RD);
+  const llvm::StructLayout *SL = getDataLayout().getStructLayout(Ty);
+  llvm::LLVMContext &Ctx = getLLVMContext();
+  auto getI32 = [&](uint64_t V) {
+    return llvm::ConstantAsMetadata::get(
+        llvm::ConstantInt::get(llvm::Type::getInt32Ty(Ctx), V));
+  };
+
+  SmallVector<llvm::Metadata *, 8> BitFields;
+  for (const FieldDecl *FD : RD->fields()) {
+    if (!FD->isBitField() || FD->getBitWidthValue(getContext()) == 0)
+      continue;
+    const CGBitFieldInfo &Info = Layout.getBitFieldInfo(FD);
+    uint64_t StorageOffset = Info.StorageOffset.getQuantity();
+    unsigned Idx = SL->getElementContainingOffset(StorageOffset);
+    uint64_t Offset =
+        Info.Offset + (StorageOffset - SL->getElementOffset(Idx)) * 8;
+    BitFields.push_back(llvm::MDNode::get(Ctx,
+        {llvm::MDString::get(Ctx, FD->getName()), getI32(Idx),
+         getI32(Offset), getI32(Info.Size)}));
+  }
+  return llvm::MDNode::get(Ctx, BitFields);
+}
+
+// Names of the source fields held in each element of Ty, comma separated
+// where bit-fields share a storage unit.
+llvm::MDNode *CodeGenModule::getPrimateFieldNames(const RecordDecl *RD,
+                                                  llvm::StructType *Ty) {
+  const CGRecordLayout &Layout = getTypes().getCGRecordLayout(RD);
+  const llvm::StructLayout *SL = getDataLayout().getStructLayout(Ty);
+  SmallVector<std::string, 8> FieldNames(Ty->getNumElements());
+  auto addName = [&](unsigned Idx, StringRef Name) {
+    if (!FieldNames[Idx].empty())
+      FieldNames[Idx] += ",";
+    FieldNames[Idx] += Name;
+  };
+
+  if (const auto *CRD = dyn_cast<CXXRecordDecl>(RD))
+    for (const CXXBaseSpecifier &Base : CRD->bases()) {
+      const auto *BaseRD = Base.getType()->getAsCXXRecordDecl();
+      if (!Base.isVirtual() && Layout.hasNonVirtualBaseLLVMField(BaseRD))
+        addName(Layout.getNonVirtualBaseLLVMFieldNo(BaseRD),
+                BaseRD->getName());
+    }
+  for (const FieldDecl *FD : RD->fields()) {
+    if (FD->isZeroSize(getContext()) ||
+        (FD->isBitField() && FD->getBitWidthValue(getContext()) == 0))
+      continue;
+    unsigned Idx = FD->isBitField()
+        ? SL->getElementContainingOffset(
+              Layout.getBitFieldInfo(FD).StorageOffset.getQuantity())
+        : Layout.getLLVMFieldNo(FD);
+    addName(Idx, FD->getName());
+  }
+
+  llvm::LLVMContext &Ctx = getLLVMContext();
+  SmallVector<llvm::Metadata *, 8> Names;
+  for (const std::string &Name : FieldNames)
+    Names.push_back(llvm::MDString::get(Ctx, Name));
+  return llvm::MDNode::get(Ctx, Names);
+}
+
+// List a '#pragma primate model' class in !primate.model. Its data members
+// are the unit's private state and every global of the type is one instance
+// of the unit. Each entry is {unit name, poison of the class type, field
+// names}.
+void CodeGenModule::AddPrimateModelMetadata(const RecordDecl *RD,
+                                            llvm::StructType *Ty,
+                                            const PrimateAttr *PA) {
+  if (Ty->isOpaque() || !PrimateModelTypes.insert(Ty).second)
+    return;
+
+  llvm::LLVMContext &Ctx = getLLVMContext();
+  getModule().getOrInsertNamedMetadata("primate.model")->addOperand(
+      llvm::MDNode::get(Ctx,
+          {llvm::MDString::get(Ctx, PA->getSuboption()),
+           llvm::ConstantAsMetadata::get(llvm::PoisonValue::get(Ty)),
+           getPrimateFieldNames(RD, Ty)}));
+}
+
+// A member function of a model class is one operation of the unit. It is
+// called like a blue function taking the instance and its arguments as
+// inputs and returning its results by value. Archgen keeps calls on the same
+// instance in order. The body stays around as the host model of the unit.
+void CodeGenModule::AddPrimateModelMetadata(llvm::Function *F,
+                                            const CXXMethodDecl *MD,
+                                            const PrimateAttr *PA) {
+  unsigned OpIdx = 0;
+  for (const CXXMethodDecl *Other : MD->getParent()->methods()) {
+    if (Other->getCanonicalDecl() == MD->getCanonicalDecl())
+      break;
+    if (getPrimateModel(Other))
+      OpIdx++;
+  }
+
+  uint64_t Latency = 1;
+  if (const Expr *E = PA->getValueArg0())
+    if (std::optional<llvm::APSInt> L = E->getIntegerConstantExpr(getContext()))
+      Latency = L->getZExtValue();
+
+  llvm::LLVMContext &Ctx = F->getContext();
+  llvm::Type *I64 = llvm::Type::getInt64Ty(Ctx);
+  F->setMetadata("primate", llvm::MDNode::get(Ctx,
+      {llvm::MDString::get(Ctx, "blue"),
+       llvm::MDString::get(Ctx, PA->getSuboption()),
+       llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(I64, Latency)),
+       llvm::ConstantAsMetadata::get(
+           llvm::ConstantInt::get(I64, F->arg_size()))}));
+  F->setMetadata("primate.model", llvm::MDNode::get(Ctx,
+      {llvm::MDString::get(Ctx, PA->getSuboption()),
+       llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(I64, OpIdx)),
+       llvm::MDString::get(Ctx, MD->getName())}));
+}
+
+// The model attribute of D's class if D is an operation of a model unit:
+// an ordinary member function, not a constructor, destructor or operator.
+const PrimateAttr *CodeGenModule::getPrimateModel(const Decl *D) {
+  const auto *MD = dyn_cast_or_null<CXXMethodDecl>(D);
+  if (!MD || MD->isStatic() || MD->isImplicit() ||
+      isa<CXXConstructorDecl>(MD) || isa<CXXDestructorDecl>(MD) ||
+      MD->isOverloadedOperator())
+    return nullptr;
+  for (const auto *PA : MD->getParent()->specific_attrs<PrimateAttr>())
+    if (PA->getOption() == PrimateAttr::Model)
+      return PA;
+  return nullptr;
+}
@@ -81,6 +81,7 @@ class CXXDestructorDecl;
 class Module;
 class CoverageSourceInfo;
 class InitSegAttr;
+class PrimateAttr;
 
 namespace CodeGen {
 
@@ -1773,6 +1774,23 @@ private:
   // Primate
   void AddPrimateMetadata(llvm::Function *F, const Decl *D,
       ArrayRef<const Attr *> Attrs);
+
+  void AddPrimateModelMetadata(llvm::Function *F, const CXXMethodDecl *MD,
+                               const PrimateAttr *PA);
+  llvm::MDNode *getPrimateFieldNames(const RecordDecl *RD,
+                                     llvm::StructType *Ty);
+  llvm::MDNode *getPrimateBitFields(const RecordDecl *RD,
+                                    llvm::StructType *Ty);
+
+public:
+  void AddPrimateRegMetadata(const RecordDecl *RD, llvm::StructType *Ty);
+  static const PrimateAttr *getPrimateModel(const Decl *D);
+  void AddPrimateModelMetadata(const RecordDecl *RD, llvm::StructType *Ty,
+                               const PrimateAttr *PA);
+
+private:
+  llvm::SmallPtrSet<llvm::StructType *, 4> PrimateRegTypes;
+  llvm::SmallPtrSet<llvm::StructType *, 4> PrimateModelTypes;
 };
 
 }  // end namespace CodeGen
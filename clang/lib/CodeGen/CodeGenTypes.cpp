@@ -779,6 +779,25 @@ llvm::StructType *CodeGenTypes::ConvertRecordDeclType(const RecordDecl *RD) {
   std::unique_ptr<CGRecordLayout> Layout = ComputeRecordLayout(RD, Ty);
   CGRecordLayouts[Key] = std::move(Layout);
 
+  // Primate
+  // '#pragma primate reg' on the struct or on a member of struct type.
+  for (const auto *PA : RD->specific_attrs<PrimateAttr>()) {
+    if (PA->getOption() == PrimateAttr::Reg)
+      CGM.AddPrimateRegMetadata(RD, Ty);
+    else if (PA->getOption() == PrimateAttr::Model)
+      CGM.AddPrimateModelMetadata(RD, Ty, PA);
+  }
+  for (const FieldDecl *FD : RD->fields()) {
+    const RecordType *RT =
+        FD->getType()->getBaseElementTypeUnsafe()->getAs<RecordType>();
+    if (!RT)
+      continue;
+    for (const auto *PA : FD->specific_attrs<PrimateAttr>())
+      if (PA->getOption() == PrimateAttr::Reg)
+        CGM.AddPrimateRegMetadata(RT->getDecl(),
+                                  ConvertRecordDeclType(RT->getDecl()));
+  }
+
   // If this struct blocked a FunctionType conversion, then recompute whatever
   // was derived from that.
   // FIXME: This is hugely overconservative.
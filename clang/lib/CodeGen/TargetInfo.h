@@ -485,6 +485,9 @@ enum class PPC64_SVR4_ABIKind {
 std::unique_ptr<TargetCodeGenInfo>
 createAIXTargetCodeGenInfo(CodeGenModule &CGM, bool Is64Bit);
 
+std::unique_ptr<TargetCodeGenInfo>
+createPrimateTargetCodeGenInfo(CodeGenModule &CGM);
+
 std::unique_ptr<TargetCodeGenInfo>
 createPPC32TargetCodeGenInfo(CodeGenModule &CGM, bool SoftFloatABI);
 
@@ -0,0 +1,117 @@
+//===- Primate.cpp --------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ABIInfoImpl.h"
+#include "TargetInfo.h"
+#include "clang/AST/Attr.h"
+
+using namespace clang;
+using namespace clang::CodeGen;
+
+//===----------------------------------------------------------------------===//
+// Primate ABI Implementation
+//
+// Structs that fit a WIDEREG register, and '#pragma primate reg' structs,
+// are passed and returned as first class aggregates instead of through sret
+// and byval pointers. A blue function returning a (hit, action, data) triple
+// then yields an SSA value that archgen and the backend can follow field by
+// field, rather than a stack slot only memory disambiguation could see
+// through. Everything else follows the default ABI.
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class PrimateABIInfo : public DefaultABIInfo {
+public:
+  PrimateABIInfo(CodeGen::CodeGenTypes &CGT) : DefaultABIInfo(CGT) {}
+
+  ABIArgInfo classifyReturnType(QualType RetTy) const;
+  ABIArgInfo classifyArgumentType(QualType Ty) const;
+
+  void computeInfo(CGFunctionInfo &FI) const override;
+
+private:
+  bool isRegisterStruct(QualType Ty) const;
+};
+
+} // end anonymous namespace
+
+// Width of the WIDEREG registers structs are held in (MVT::Primate_aggregate).
+static constexpr uint64_t PrimateWideRegBits = 512;
+
+// A struct can sit in a WIDEREG when it is trivially copyable C data that
+// fits one, or is declared as a register with '#pragma primate reg'. Unions
+// and records with flexible array members have no fixed field layout, and
+// C++ records with non-trivial copy or destruction must keep their address.
+bool PrimateABIInfo::isRegisterStruct(QualType Ty) const {
+  const RecordType *RT = Ty->getAs<RecordType>();
+  if (!RT)
+    return false;
+  const RecordDecl *RD = RT->getDecl();
+  if (RD->isUnion() || RD->hasFlexibleArrayMember())
+    return false;
+  if (getRecordArgABI(RT, getCXXABI()) != CGCXXABI::RAA_Default)
+    return false;
+  for (const auto *PA : RD->specific_attrs<PrimateAttr>())
+    if (PA->getOption() == PrimateAttr::Reg)
+      return true;
+  return getContext().getTypeSize(Ty) <= PrimateWideRegBits;
+}
+
+ABIArgInfo PrimateABIInfo::classifyReturnType(QualType RetTy) const {
+  if (isAggregateTypeForABI(RetTy) && isRegisterStruct(RetTy)) {
+    if (isEmptyRecord(getContext(), RetTy, true))
+      return ABIArgInfo::getIgnore();
+    return ABIArgInfo::getDirect(CGT.ConvertType(RetTy), 0, nullptr,
+                                 /*CanBeFlattened=*/false);
+  }
+  return DefaultABIInfo::classifyReturnType(RetTy);
+}
+
+ABIArgInfo PrimateABIInfo::classifyArgumentType(QualType Ty) const {
+  if (isAggregateTypeForABI(Ty) && isRegisterStruct(Ty)) {
+    if (isEmptyRecord(getContext(), Ty, true))
+      return ABIArgInfo::getIgnore();
+    return ABIArgInfo::getDirect(CGT.ConvertType(Ty), 0, nullptr,
+                                 /*CanBeFlattened=*/false);
+  }
+  return DefaultABIInfo::classifyArgumentType(Ty);
+}
+
+void PrimateABIInfo::computeInfo(CGFunctionInfo &FI) const {
+  if (!getCXXABI().classifyReturnType(FI))
+    FI.getReturnInfo() = classifyReturnType(FI.getReturnType());
+  for (auto &I : FI.arguments())
+    I.info = classifyArgumentType(I.type);
+}
+
+namespace {
+
+class PrimateTargetCodeGenInfo : public TargetCodeGenInfo {
+public:
+  PrimateTargetCodeGenInfo(CodeGen::CodeGenTypes &CGT)
+      : TargetCodeGenInfo(std::make_unique<PrimateABIInfo>(CGT)) {}
+
+  // Nothing in the program calls primate_main. Under -flto the link would
+  // internalize it and drop it as dead, so keep it in llvm.used.
+  void setTargetAttributes(const Decl *D, llvm::GlobalValue *GV,
+                           CodeGen::CodeGenModule &CGM) const override {
+    const auto *FD = dyn_cast_or_null<FunctionDecl>(D);
+    if (!FD || !FD->getIdentifier() ||
+        !FD->getIdentifier()->isStr("primate_main") || GV->isDeclaration())
+      return;
+    CGM.addUsedGlobal(GV);
+  }
+};
+
+} // end anonymous namespace
+
+std::unique_ptr<TargetCodeGenInfo>
+CodeGen::createPrimateTargetCodeGenInfo(CodeGenModule &CGM) {
+  return std::make_unique<PrimateTargetCodeGenInfo>(CGM.getTypes());
+}
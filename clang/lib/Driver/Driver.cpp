@@ -360,7 +360,12 @@ phases::ID Driver::getFinalPhase(const DerivedArgList &DAL,
              (PhaseArg = DAL.getLastArg(options::OPT_rewrite_legacy_objc)) ||
              (PhaseArg = DAL.getLastArg(options::OPT__migrate)) ||
              (PhaseArg = DAL.getLastArg(options::OPT__analyze)) ||
-             (PhaseArg = DAL.getLastArg(options::OPT_emit_ast))) {
+             (PhaseArg = DAL.getLastArg(options::OPT_emit_ast)) ||
+             // --primate-archgen runs archgen at the end of the optimizer,
+             // or in the LTO link when there is one
+             (!isUsingLTO() &&
+              (PhaseArg = DAL.getLastArg(options::OPT_primate_archgen,
+                                         options::OPT_primate_archgen_EQ)))) {
     FinalPhase = phases::Compile;
 
   // -S only runs up to the backend.
@@ -5885,10 +5890,17 @@ const char *Driver::GetNamedOutputPath(Compilation &C, const JobAction &JA,
       JA.getType() == types::TY_ModuleFile && SpecifiedModuleOutput)
     return GetModuleOutputPath(C, JA, BaseInput);
 
+  // --primate-archgen without LTO is after archgen's files, not the bitcode
+  // its compile stops at.
+  bool PrimateArchGenOnly =
+      AtTopLevel && isa<CompileJobAction>(JA) && !isUsingLTO() &&
+      C.getArgs().hasArg(options::OPT_primate_archgen,
+                         options::OPT_primate_archgen_EQ);
+
   // Output to a temporary file?
   if ((!AtTopLevel && !isSaveTempsEnabled() &&
        !C.getArgs().hasArg(options::OPT__SLASH_Fo)) ||
-      CCGenDiagnostics) {
+      CCGenDiagnostics || PrimateArchGenOnly) {
     StringRef Name = llvm::sys::path::filename(BaseInput);
     std::pair<StringRef, StringRef> Split = Name.split('.');
     const char *Suffix =
@@ -12,7 +12,14 @@
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/DriverDiagnostic.h"
 #include "clang/Driver/Options.h"
+#include "clang/Driver/SanitizerArgs.h"
+#include "clang/Driver/ToolChain.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Option/ArgList.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Program.h"
 #include "llvm/TargetParser/Host.h"
 #include "llvm/TargetParser/TargetParser.h"
 #include "llvm/TargetParser/PrimateTargetParser.h"
@@ -746,3 +753,199 @@ StringRef Primate::getPrimateArch(const llvm::opt::ArgList &Args,
       return "pr64imafdc";
   }
 }
+
+std::string Primate::getPrimateArchGenDir(const ArgList &Args) {
+  const Arg *A = Args.getLastArg(options::OPT_primate_archgen,
+                                 options::OPT_primate_archgen_EQ);
+  if (!A)
+    return "";
+  if (A->getOption().matches(options::OPT_primate_archgen))
+    return ".";
+  return A->getValue();
+}
+
+std::string Primate::getPrimateConfigFile(const ArgList &Args) {
+  const Arg *A = Args.getLastArg(options::OPT_primate_config_EQ);
+  if (!A)
+    return "";
+  SmallString<128> Path(A->getValue());
+  llvm::sys::path::append(Path, "primate.cfg");
+  return std::string(Path);
+}
+
+// Whether the configuration splits the data memory into banks. Every global
+// then needs its own section, which banks.ld next to primate.cfg places.
+static bool hasPrimateMemBanks(const Driver &D, StringRef Config) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buf =
+      D.getVFS().getBufferForFile(Config);
+  if (!Buf)
+    return false;
+  SmallVector<StringRef, 32> Lines;
+  (*Buf)->getBuffer().split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    auto [Key, Value] = Line.trim().split('=');
+    if (Key == "MEM_BANKS")
+      return !Value.trim().empty();
+  }
+  return false;
+}
+
+// The global sections banks.ld needs, when the config has banks or archgen
+// is about to write one that may.
+static bool needsPrimateDataSections(const Driver &D, const ArgList &Args) {
+  if (!Primate::getPrimateArchGenDir(Args).empty())
+    return true;
+  std::string Config = Primate::getPrimateConfigFile(Args);
+  return !Config.empty() && hasPrimateMemBanks(D, Config);
+}
+
+// The action of the input bounds checks, which the Primate pipeline places
+// itself, empty without -fsanitize=primate-input.
+static std::string getPrimateInputSanitizer(const ToolChain &TC,
+                                            const ArgList &Args) {
+  SanitizerArgs SanArgs = TC.getSanitizerArgs(Args);
+  if (!SanArgs.hasPrimateInput())
+    return "";
+  return SanArgs.trapsPrimateInput() ? "trap" : "drop";
+}
+
+void Primate::addPrimateCompilerArgs(const ToolChain &TC, const ArgList &Args,
+                                     ArgStringList &CmdArgs) {
+  const Driver &D = TC.getDriver();
+  // The whole program Primate passes run at the link, on the merged module.
+  if (D.isUsingLTO()) {
+    CmdArgs.push_back("-mllvm");
+    CmdArgs.push_back("-primate-lto-prelink");
+  }
+
+  std::string ArchGenDir = getPrimateArchGenDir(Args);
+  if (!ArchGenDir.empty()) {
+    CmdArgs.push_back("-mllvm");
+    CmdArgs.push_back(Args.MakeArgString("-primate-archgen-dir=" + ArchGenDir));
+  }
+
+  std::string Config = getPrimateConfigFile(Args);
+  if (!Config.empty()) {
+    // archgen is about to write it
+    if (ArchGenDir.empty() && !D.getVFS().exists(Config))
+      D.Diag(diag::err_drv_no_such_file) << Config;
+    CmdArgs.push_back("-mllvm");
+    CmdArgs.push_back(Args.MakeArgString("-primate-config=" + Config));
+  }
+
+  if (needsPrimateDataSections(D, Args))
+    CmdArgs.push_back("-fdata-sections");
+
+  std::string Sanitizer = getPrimateInputSanitizer(TC, Args);
+  if (!Sanitizer.empty()) {
+    CmdArgs.push_back("-mllvm");
+    CmdArgs.push_back(
+        Args.MakeArgString("-primate-input-sanitizer=" + Sanitizer));
+  }
+}
+
+void Primate::addPrimateLTOArgs(const ToolChain &TC, const ArgList &Args,
+                                ArgStringList &CmdArgs) {
+  CmdArgs.push_back("-plugin-opt=-primate-lto-postlink");
+  // The Primate passes run at the link (e.g. -mllvm -primate-min-mpps=<N>),
+  // so they need the same options.
+  for (const Arg *A : Args.filtered(options::OPT_mllvm))
+    CmdArgs.push_back(
+        Args.MakeArgString(Twine("-plugin-opt=") + A->getValue()));
+
+  std::string ArchGenDir = getPrimateArchGenDir(Args);
+  if (!ArchGenDir.empty())
+    CmdArgs.push_back(
+        Args.MakeArgString("-plugin-opt=-primate-archgen-dir=" + ArchGenDir));
+
+  std::string Config = getPrimateConfigFile(Args);
+  if (!Config.empty())
+    CmdArgs.push_back(
+        Args.MakeArgString("-plugin-opt=-primate-config=" + Config));
+
+  if (needsPrimateDataSections(TC.getDriver(), Args))
+    CmdArgs.push_back("-plugin-opt=-data-sections");
+
+  std::string Sanitizer = getPrimateInputSanitizer(TC, Args);
+  if (!Sanitizer.empty())
+    CmdArgs.push_back(Args.MakeArgString(
+        "-plugin-opt=-primate-input-sanitizer=" + Sanitizer));
+}
+
+void Primate::addPrimateLinkerArgs(const ToolChain &TC, const ArgList &Args,
+                                   ArgStringList &CmdArgs) {
+  std::string Config = getPrimateConfigFile(Args);
+  if (Config.empty() || !hasPrimateMemBanks(TC.getDriver(), Config))
+    return;
+  SmallString<128> Script(llvm::sys::path::parent_path(Config));
+  llvm::sys::path::append(Script, "banks.ld");
+  CmdArgs.push_back("-T");
+  CmdArgs.push_back(Args.MakeArgString(Script));
+}
+
+void Primate::addPrimateImageJobs(Compilation &C, const Tool &T,
+                                  const JobAction &JA, const InputInfo &Output,
+                                  const ArgList &Args) {
+  std::string Config = getPrimateConfigFile(Args);
+  if (Config.empty() || !Output.isFilename())
+    return;
+  const ToolChain &TC = T.getToolChain();
+  const Driver &D = TC.getDriver();
+  const char *Program = Output.getFilename();
+
+  const char *ObjDump = Args.MakeArgString(TC.GetProgramPath("llvm-objdump"));
+  const char *Python = "python3";
+  if (llvm::ErrorOr<std::string> P = llvm::sys::findProgramByName("python3"))
+    Python = Args.MakeArgString(*P);
+
+  // bin2asm.py and elf2meminit.py are installed in share/primate next to
+  // bin/, or found in the program paths. PRIMATE_COMPILER_ROOT points at a
+  // source tree instead.
+  auto getScript = [&](StringRef Name) {
+    SmallString<128> Path;
+    if (std::optional<std::string> Env =
+            llvm::sys::Process::GetEnv("PRIMATE_COMPILER_ROOT"))
+      llvm::sys::path::append(Path, *Env, Name);
+    else
+      llvm::sys::path::append(Path, D.Dir, "..", "share", "primate", Name);
+    if (D.getVFS().exists(Path))
+      return Args.MakeArgString(Path);
+    return Args.MakeArgString(TC.GetProgramPath(Args.MakeArgString(Name)));
+  };
+
+  StringRef Stem = llvm::sys::path::stem(Program);
+  auto addDump = [&](StringRef Suffix, ArrayRef<const char *> Opts) {
+    const char *Dump =
+        C.addTempFile(Args.MakeArgString(D.GetTemporaryPath(Stem, Suffix)));
+    ArgStringList CmdArgs(Opts.begin(), Opts.end());
+    CmdArgs.push_back(Program);
+    auto Cmd = std::make_unique<Command>(JA, T, ResponseFileSupport::None(),
+                                         ObjDump, CmdArgs, Output, Output);
+    Cmd->setRedirectFiles({std::nullopt, std::string(Dump), std::nullopt});
+    C.addCommand(std::move(Cmd));
+    return Dump;
+  };
+  auto addScript = [&](StringRef Name, ArrayRef<const char *> ScriptArgs) {
+    ArgStringList CmdArgs{getScript(Name)};
+    CmdArgs.append(ScriptArgs.begin(), ScriptArgs.end());
+    C.addCommand(std::make_unique<Command>(JA, T, ResponseFileSupport::None(),
+                                           Python, CmdArgs, Output, Output));
+  };
+  const char *ConfigArg = Args.MakeArgString(Config);
+
+  // instruction memory, with the packet to source line map when there is
+  // debug info
+  const char *Disasm = addDump(
+      "dis", {"-drl", Args.MakeArgString("--primate-config=" + Config)});
+  const char *Symbols = addDump("sym", {"-t"});
+  addScript("bin2asm.py",
+            {Disasm, Symbols, ConfigArg,
+             Args.MakeArgString(Twine(Program) + ".bin")});
+
+  // data memory, one file per bank when archgen split it (see banks.ld).
+  // The banks are only known once the compile wrote the config, so the
+  // script picks .rodata and the MEM_BANKS sections out of the whole dump.
+  const char *Data = addDump("data", {"-s"});
+  addScript("elf2meminit.py",
+            {Data, Args.MakeArgString(Twine(Program) + ".mem"), ConfigArg});
+}
@@ -9,7 +9,11 @@
 #ifndef LLVM_CLANG_LIB_DRIVER_TOOLCHAINS_ARCH_PRIMATE_H
 #define LLVM_CLANG_LIB_DRIVER_TOOLCHAINS_ARCH_PRIMATE_H
 
+#include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
+#include "clang/Driver/InputInfo.h"
+#include "clang/Driver/Tool.h"
+#include "clang/Driver/ToolChain.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Option/Option.h"
 #include <string>
@@ -26,6 +30,32 @@ StringRef getPrimateABI(const llvm::opt::ArgList &Args,
                         const llvm::Triple &Triple);
 StringRef getPrimateArch(const llvm::opt::ArgList &Args,
                          const llvm::Triple &Triple);
+
+// The directory of --primate-archgen[=<dir>] ("." without one), empty when
+// archgen is not requested.
+std::string getPrimateArchGenDir(const llvm::opt::ArgList &Args);
+// <dir>/primate.cfg for --primate-config=<dir>, empty without it.
+std::string getPrimateConfigFile(const llvm::opt::ArgList &Args);
+
+// Options of the Primate passes the compile jobs get, and that an LTO link
+// needs again since it runs the whole program passes.
+void addPrimateCompilerArgs(const ToolChain &TC,
+                            const llvm::opt::ArgList &Args,
+                            llvm::opt::ArgStringList &CmdArgs);
+void addPrimateLTOArgs(const ToolChain &TC, const llvm::opt::ArgList &Args,
+                       llvm::opt::ArgStringList &CmdArgs);
+
+// With --primate-config and a config that splits the data memory into banks,
+// the banks.ld linker script placing them.
+void addPrimateLinkerArgs(const ToolChain &TC, const llvm::opt::ArgList &Args,
+                          llvm::opt::ArgStringList &CmdArgs);
+
+// With --primate-config, the jobs after the link that turn the linked
+// program into its instruction memory (<output>.bin, see bin2asm.py) and data
+// memory (<output>.mem, see elf2meminit.py) images.
+void addPrimateImageJobs(Compilation &C, const Tool &T, const JobAction &JA,
+                         const InputInfo &Output,
+                         const llvm::opt::ArgList &Args);
 } // end namespace primate
 } // namespace tools
 } // end namespace driver
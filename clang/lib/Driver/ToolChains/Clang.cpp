@@ -2091,6 +2091,8 @@ void Clang::AddPrimateTargetArgs(const ArgList &Args,
       CmdArgs.push_back(A->getValue());
     StringRef Name = A->getValue();
   }
+
+  Primate::addPrimateCompilerArgs(getToolChain(), Args, CmdArgs);
 }
 
 static void SetRISCVSmallDataLimit(const ToolChain &TC, const ArgList &Args,
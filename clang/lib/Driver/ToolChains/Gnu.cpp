@@ -537,6 +537,8 @@ void tools::gnutools::Linker::ConstructJob(Compilation &C, const JobAction &JA,
 
     addLTOOptions(ToolChain, Args, CmdArgs, Output, *Input,
                   D.getLTOMode() == LTOK_Thin);
+    if (Triple.isPrimate())
+      Primate::addPrimateLTOArgs(ToolChain, Args, CmdArgs);
   }
 
   if (Args.hasArg(options::OPT_Z_Xlinker__no_demangle))
@@ -674,12 +676,16 @@ void tools::gnutools::Linker::ConstructJob(Compilation &C, const JobAction &JA,
     }
   }
 
+  if (Triple.isPrimate())
+    Primate::addPrimateLinkerArgs(ToolChain, Args, CmdArgs);
   Args.AddAllArgs(CmdArgs, options::OPT_T);
 
   const char *Exec = Args.MakeArgString(ToolChain.GetLinkerPath());
   C.addCommand(std::make_unique<Command>(JA, *this,
                                          ResponseFileSupport::AtFileCurCP(),
                                          Exec, CmdArgs, Inputs, Output));
+  if (Triple.isPrimate())
+    Primate::addPrimateImageJobs(C, *this, JA, Output, Args);
 }
 
 void tools::gnutools::Assembler::ConstructJob(Compilation &C,
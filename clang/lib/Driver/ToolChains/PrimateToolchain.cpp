@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "PrimateToolchain.h"
+#include "Arch/Primate.h"
 #include "CommonArgs.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/InputInfo.h"
@@ -181,11 +182,19 @@ void Primate::Linker::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(Args.MakeArgString(ToolChain.GetFilePath(crtbegin)));
   }
 
+  if (D.isUsingLTO()) {
+    assert(!Inputs.empty() && "Must have at least one input.");
+    addLTOOptions(ToolChain, Args, CmdArgs, Output, Inputs[0],
+                  D.getLTOMode() == LTOK_Thin);
+    tools::Primate::addPrimateLTOArgs(ToolChain, Args, CmdArgs);
+  }
+
   AddLinkerInputs(ToolChain, Inputs, Args, CmdArgs, JA);
 
   Args.addAllArgs(CmdArgs, {options::OPT_L, options::OPT_u});
 
   ToolChain.AddFilePathLibArgs(Args, CmdArgs);
+  tools::Primate::addPrimateLinkerArgs(ToolChain, Args, CmdArgs);
   Args.addAllArgs(CmdArgs, {options::OPT_T_Group, options::OPT_s,
                             options::OPT_t, options::OPT_r});
 
@@ -213,5 +222,6 @@ void Primate::Linker::ConstructJob(Compilation &C, const JobAction &JA,
   C.addCommand(std::make_unique<Command>(
       JA, *this, ResponseFileSupport::AtFileCurCP(), Args.MakeArgString(Linker),
       CmdArgs, Inputs, Output));
+  tools::Primate::addPrimateImageJobs(C, *this, JA, Output, Args);
 }
 // Primate tools end.
@@ -0,0 +1,168 @@
+/*===---- primate_host.h - Primate IO for host builds ----------------------===
+ *
+ * Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+ * See https://llvm.org/LICENSE.txt for license information.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ *
+ *===-----------------------------------------------------------------------===
+ */
+
+/* Runs a Primate program on the host, one packet per call, e.g. under a
+ * fuzzer. Compile the program with -include primate_host.h, and define
+ * PRIMATE_HOST_RUNTIME before including it in exactly one file of the
+ * harness to get the definitions:
+ *
+ *   #define PRIMATE_HOST_RUNTIME
+ *   #include <primate_host.h>
+ *
+ *   int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+ *     uint8_t out[2048];
+ *     primate_host_run(data, size, out, sizeof(out));
+ *     return 0;
+ *   }
+ *
+ * With -fsanitize=primate-input a read past the end of the packet calls
+ * __primate_sanitizer_input_overflow, which reports it and aborts.
+ */
+
+#ifndef __PRIMATE_HOST_H
+#define __PRIMATE_HOST_H
+
+#ifdef __Primate
+#error "primate_host.h is for host builds; Primate has the IO builtins."
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+void primate_main(void);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *__primate_input(int __bytes);
+int __primate_input_seek(int __bytes);
+int __primate_input_len(void);
+void __primate_input_done(void);
+void __primate_output(void *__src, int __bytes);
+int __primate_output_seek(int __bytes);
+void __primate_output_done(void);
+void __primate_drop(void) __attribute__((__noreturn__));
+void __primate_sanitizer_input_overflow(int __end, int __len)
+    __attribute__((__noreturn__));
+
+/* Runs primate_main on one packet, which is cut to PRIMATE_HOST_MAX_PACKET
+ * bytes. Returns the number of output bytes copied to out, or -1 when the
+ * packet was dropped. */
+int primate_host_run(const uint8_t *__data, size_t __size, uint8_t *__out,
+                     size_t __out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef PRIMATE_HOST_RUNTIME
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PRIMATE_HOST_MAX_PACKET
+#define PRIMATE_HOST_MAX_PACKET 16384
+#endif
+
+/* Reads run past the packet into zeros, as far as one more packet. */
+static uint8_t __primate_host_in[2 * PRIMATE_HOST_MAX_PACKET];
+static uint8_t __primate_host_out[2 * PRIMATE_HOST_MAX_PACKET];
+static int __primate_host_in_len, __primate_host_in_pos;
+static int __primate_host_out_len, __primate_host_out_pos;
+static jmp_buf __primate_host_drop;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Not inlined, so that the sanitizer still finds the calls. */
+#define __PRIMATE_HOST_IO __attribute__((__noinline__, __used__))
+
+static int __primate_host_clamp(int __pos) {
+  return __pos < 0 ? 0
+         : __pos > PRIMATE_HOST_MAX_PACKET ? PRIMATE_HOST_MAX_PACKET
+                                           : __pos;
+}
+
+__PRIMATE_HOST_IO void *__primate_input(int __bytes) {
+  void *__p = __primate_host_in + __primate_host_clamp(__primate_host_in_pos);
+  __primate_host_in_pos += __bytes;
+  return __p;
+}
+
+__PRIMATE_HOST_IO int __primate_input_seek(int __bytes) {
+  return __primate_host_in_pos += __bytes;
+}
+
+__PRIMATE_HOST_IO int __primate_input_len(void) {
+  return __primate_host_in_len;
+}
+
+__PRIMATE_HOST_IO void __primate_input_done(void) {}
+
+__PRIMATE_HOST_IO void __primate_output(void *__src, int __bytes) {
+  int __pos = __primate_host_clamp(__primate_host_out_pos);
+  if (__bytes < 0)
+    __bytes = 0;
+  if (__bytes > PRIMATE_HOST_MAX_PACKET)
+    __bytes = PRIMATE_HOST_MAX_PACKET;
+  memcpy(__primate_host_out + __pos, __src, (size_t)__bytes);
+  __primate_host_out_pos += __bytes;
+  if (__primate_host_out_pos > __primate_host_out_len)
+    __primate_host_out_len = __primate_host_clamp(__primate_host_out_pos);
+}
+
+__PRIMATE_HOST_IO int __primate_output_seek(int __bytes) {
+  return __primate_host_out_pos += __bytes;
+}
+
+__PRIMATE_HOST_IO void __primate_output_done(void) {}
+
+__PRIMATE_HOST_IO void __primate_drop(void) {
+  longjmp(__primate_host_drop, 1);
+}
+
+__PRIMATE_HOST_IO void __primate_sanitizer_input_overflow(int __end,
+                                                         int __len) {
+  fprintf(stderr,
+          "primate-input: read up to input byte %d of a %d byte packet\n",
+          __end, __len);
+  abort();
+}
+
+#undef __PRIMATE_HOST_IO
+
+#ifdef __cplusplus
+}
+#endif
+
+int primate_host_run(const uint8_t *__data, size_t __size, uint8_t *__out,
+                     size_t __out_size) {
+  if (__size > PRIMATE_HOST_MAX_PACKET)
+    __size = PRIMATE_HOST_MAX_PACKET;
+  memset(__primate_host_in, 0, sizeof(__primate_host_in));
+  memcpy(__primate_host_in, __data, __size);
+  __primate_host_in_len = (int)__size;
+  __primate_host_in_pos = 0;
+  __primate_host_out_len = __primate_host_out_pos = 0;
+  if (setjmp(__primate_host_drop))
+    return -1;
+  primate_main();
+  if ((size_t)__primate_host_out_len < __out_size)
+    __out_size = (size_t)__primate_host_out_len;
+  memcpy(__out, __primate_host_out, __out_size);
+  return (int)__out_size;
+}
+
+#endif /* PRIMATE_HOST_RUNTIME */
+
+#endif /* __PRIMATE_HOST_H */
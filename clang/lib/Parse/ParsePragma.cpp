@@ -779,6 +779,9 @@ bool Parser::HandlePragmaPrimate(PrimatePragma &Pragma) {
     Pragma.ValueArg0 = ParseConstantExpression().get();
     Pragma.ValueArg1 = ParseConstantExpression().get();
   }
+  // model takes an optional latency for its operations
+  if (OptionModel && Tok.isNot(tok::eof))
+    Pragma.ValueArg0 = ParseConstantExpression().get();
 
   // Tokens following an error in an ill-formed constant expression will remain
   // in the token stream and must be removed.
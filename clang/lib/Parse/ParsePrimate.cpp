@@ -27,6 +27,9 @@ using namespace clang;
 //   #pragma primate green output_seek
 //   #pragma primate green extract
 //   #pragma primate green insert
+// and, through the decl-spec, a free struct or class:
+//   #pragma primate model <unit_name> [latency]
+//   #pragma primate reg
 SourceLocation Parser::ParsePragmaPrimateFreeFunction(DeclSpec &DS) {
   // Create attribute list.
   ParsedAttributes Attrs(AttrFactory);
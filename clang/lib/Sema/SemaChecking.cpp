@@ -6138,6 +6138,25 @@ bool Sema::CheckRISCVBuiltinFunctionCall(const TargetInfo &TI,
 //         << Arg->getSourceRange();
 //}
 
+// A BFU builtin reads and writes its operands through pointers to the
+// structs a WIDEREG holds. Called on a struct value instead, it returns the
+// struct of the same type the BFU writes back, as an SSA value.
+bool Sema::CheckPrimateBFUBuiltinCall(CallExpr *TheCall) {
+  if (TheCall->getNumArgs() != 1)
+    return false;
+  Expr *Arg = TheCall->getArg(0);
+  QualType Ty = Arg->getType();
+  if (!Ty->isStructureType() || !Ty.isTriviallyCopyableType(Context))
+    return false;
+  ExprResult Conv = DefaultLvalueConversion(Arg);
+  if (Conv.isInvalid())
+    return true;
+  TheCall->setArg(0, Conv.get());
+  TheCall->setType(Ty.getUnqualifiedType());
+  TheCall->setValueKind(VK_PRValue);
+  return false;
+}
+
 bool Sema::CheckPrimateBuiltinFunctionCall(const TargetInfo &TI,
                                          unsigned BuiltinID,
                                          CallExpr *TheCall) {
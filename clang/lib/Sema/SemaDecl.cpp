@@ -5130,6 +5130,17 @@ static unsigned GetDiagnosticTypeSpecifierID(const DeclSpec &DS) {
     llvm_unreachable("unexpected type specifier");
   }
 }
+
+// '#pragma primate reg' and '#pragma primate model' annotate the struct or
+// class that follows them, the other Primate pragmas annotate functions.
+static bool isPrimateRecordPragma(const ParsedAttr &AL) {
+  if (AL.getKind() != AttributeCommonInfo::AT_Primate || !AL.isArgIdent(1) ||
+      !AL.getArgAsIdent(1))
+    return false;
+  StringRef Option = AL.getArgAsIdent(1)->Ident->getName();
+  return Option == "reg" || Option == "model";
+}
+
 /// ParsedFreeStandingDeclSpec - This method is invoked when a declspec with
 /// no declarator (e.g. "struct foo;") is parsed. It also accepts template
 /// parameters to cope with template friend declarations.
@@ -5382,6 +5393,19 @@ Decl *Sema::ParsedFreeStandingDeclSpec(Scope *S, AccessSpecifier AS,
       DS.getAttributes().begin(), DS.getAttributes().end(),
       [](auto const& v) { return v.getKind() ==
           AttributeCommonInfo::AT_Primate; });
+  // '#pragma primate reg' (or model) in front of a struct definition
+  // annotates the struct. The function pragmas have nothing to apply to.
+  if (Tag && !DS.getAttributes().empty() && AllPrimateAttrs) {
+    ParsedAttributesView RecordAttrs;
+    for (ParsedAttr &AL : DS.getAttributes()) {
+      if (isPrimateRecordPragma(AL))
+        RecordAttrs.addAtEnd(&AL);
+      else
+        Diag(AL.getLoc(), diag::warn_declspec_attribute_ignored)
+            << AL << GetDiagnosticTypeSpecifierID(DS);
+    }
+    ProcessDeclAttributeList(S, Tag, RecordAttrs);
+  }
   if ((!DS.getAttributes().empty() || DeclAttrs.empty()) && !AllPrimateAttrs) {
     DeclSpec::TST TypeSpecType = DS.getTypeSpecType();
     if (TypeSpecType == DeclSpec::TST_class ||
@@ -10458,6 +10482,10 @@ Sema::ActOnFunctionDeclarator(Scope *S, Declarator &D, DeclContext *DC,
     if (!NewFD->isInvalidDecl() && NewFD->isMSVCRTEntryPoint())
       CheckMSVCRTEntryPoint(NewFD);
 
+    if (!NewFD->isInvalidDecl() &&
+        Context.getTargetInfo().getTriple().isPrimate())
+      CheckPrimateMain(NewFD, D.getDeclSpec());
+
     if (!NewFD->isInvalidDecl())
       D.setRedeclaration(CheckFunctionDeclaration(S, NewFD, Previous,
                                                   isMemberSpecialization,
@@ -10590,6 +10618,10 @@ Sema::ActOnFunctionDeclarator(Scope *S, Declarator &D, DeclContext *DC,
     if (!NewFD->isInvalidDecl() && NewFD->isMSVCRTEntryPoint())
       CheckMSVCRTEntryPoint(NewFD);
 
+    if (!NewFD->isInvalidDecl() &&
+        Context.getTargetInfo().getTriple().isPrimate())
+      CheckPrimateMain(NewFD, D.getDeclSpec());
+
     if (!NewFD->isInvalidDecl())
       D.setRedeclaration(CheckFunctionDeclaration(S, NewFD, Previous,
                                                   isMemberSpecialization,
@@ -12296,6 +12328,34 @@ bool Sema::CheckFunctionDeclaration(Scope *S, FunctionDecl *NewFD,
   return Redeclaration;
 }
 
+/// Every packet enters a Primate program through a call to primate_main,
+/// which the hardware makes with no arguments and no use for a result. The
+/// backend and archgen assume that shape, so reject anything else here.
+void Sema::CheckPrimateMain(FunctionDecl *FD, const DeclSpec &DS) {
+  if (!FD->getIdentifier() || !FD->getIdentifier()->isStr("primate_main") ||
+      !FD->getDeclContext()->getRedeclContext()->isFileContext() ||
+      isa<CXXMethodDecl>(FD))
+    return;
+
+  if (!FD->getReturnType()->isVoidType() &&
+      !FD->getReturnType()->isDependentType()) {
+    SourceRange RTRange = FD->getReturnTypeSourceRange();
+    Diag(FD->getTypeSpecStartLoc(), diag::err_primate_main_signature)
+        << 0
+        << (RTRange.isValid() ? FixItHint::CreateReplacement(RTRange, "void")
+                              : FixItHint());
+  }
+  if (FD->getNumParams() || FD->isVariadic()) {
+    SourceRange PRange = FD->getParametersSourceRange();
+    Diag(FD->getLocation(), diag::err_primate_main_signature)
+        << 1
+        << (PRange.isValid() ? FixItHint::CreateRemoval(PRange) : FixItHint());
+  }
+  if (FD->getStorageClass() == SC_Static)
+    Diag(DS.getStorageClassSpecLoc(), diag::err_primate_main_signature)
+        << 2 << FixItHint::CreateRemoval(DS.getStorageClassSpecLoc());
+}
+
 void Sema::CheckMain(FunctionDecl* FD, const DeclSpec& DS) {
   // C++11 [basic.start.main]p3:
   //   A program that [...] declares main to be inline, static or
@@ -9011,6 +9011,45 @@ static void handlePrimateAttr(Sema &S, Decl *D, const ParsedAttr &AL) {
   StringRef Suboption = SuboptionLoc ? SuboptionLoc->Ident->getName() :
       StringRef();
 
+  // reg marks a type as register resident; on a member it marks the type
+  // of that member.
+  if (Option == PrimateAttr::Reg && !isa<RecordDecl>(D)) {
+    const auto *VD = dyn_cast<ValueDecl>(D);
+    if (!VD || !VD->getType()->getBaseElementTypeUnsafe()->isRecordType()) {
+      S.Diag(AL.getLoc(), diag::warn_pragma_primate_reg_not_record);
+      return;
+    }
+  }
+
+  // The last blue argument is how many leading parameters feed the BFU, the
+  // rest are where it writes its results. Check it against the function here
+  // rather than letting archgen read operands that do not exist.
+  const auto *FD = dyn_cast<FunctionDecl>(D);
+  if (Option == PrimateAttr::Blue && FD && ValueArg1 &&
+      !ValueArg1->isValueDependent()) {
+    std::optional<llvm::APSInt> NumIn =
+        ValueArg1->getIntegerConstantExpr(S.Context);
+    unsigned NumParams = FD->getNumParams();
+    if (NumIn && *NumIn > NumParams) {
+      S.Diag(ValueArg1->getExprLoc(), diag::err_pragma_primate_blue_arity)
+          << (unsigned)NumIn->getZExtValue() << FD << NumParams
+          << FixItHint::CreateReplacement(ValueArg1->getSourceRange(),
+                                          std::to_string(NumParams));
+      return;
+    }
+    if (NumIn && !FD->getReturnType()->isVoidType() && *NumIn != NumParams)
+      S.Diag(ValueArg1->getExprLoc(),
+             diag::warn_pragma_primate_blue_value_inputs)
+          << FD << NumParams
+          << FixItHint::CreateReplacement(ValueArg1->getSourceRange(),
+                                          std::to_string(NumParams));
+    else if (NumIn && FD->getReturnType()->isVoidType() && NumParams &&
+             *NumIn == NumParams)
+      S.Diag(ValueArg1->getExprLoc(),
+             diag::warn_pragma_primate_blue_no_outputs)
+          << NumParams << FD;
+  }
+
   PrimateAttr *Attr =
       PrimateAttr::CreateImplicit(S.Context, Option, Suboption, ValueArg0,
                                   ValueArg1, AL);
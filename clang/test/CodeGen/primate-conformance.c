@@ -0,0 +1,21 @@
+// REQUIRES: primate-registered-target
+// RUN: not %clang_cc1 -triple primate32-unknown-elf -debug-info-kind=line-tables-only \
+// RUN:   -emit-obj -o /dev/null %s 2>&1 \
+// RUN:   | FileCheck --implicit-check-not='LLVM ERROR' %s
+
+// Every violation is reported at its line, and clang fails with its error
+// count rather than stopping at the first one.
+
+int walk(int n) {
+  // CHECK-DAG: primate-conformance.c:[[@LINE+1]]:{{[0-9]+}}: error: {{.*}}recursive call to 'walk'; Primate has no call stack, rewrite it as a loop
+  return n ? walk(n - 1) + 1 : 0;
+}
+
+void primate_main(void) {
+  int n = walk(4);
+  // CHECK-DAG: primate-conformance.c:[[@LINE+1]]:{{[0-9]+}}: error: {{.*}}variable sized allocation; Primate needs every stack object to have a constant size
+  volatile char buf[n];
+  buf[0] = 0;
+}
+
+// CHECK: 2 errors generated.
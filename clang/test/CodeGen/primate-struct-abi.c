@@ -0,0 +1,27 @@
+// RUN: %clang_cc1 -triple primate32-unknown-elf -emit-llvm -o - %s \
+// RUN:   | FileCheck %s
+
+// Structs that fit a WIDEREG are passed and returned as aggregates.
+struct Triple { int hit; int action; int data; };
+
+// CHECK-LABEL: define{{.*}} %struct.Triple @lookup(%struct.Triple %{{.*}})
+struct Triple lookup(struct Triple t) { return t; }
+
+// 64 bytes still fit.
+struct Line { int words[16]; };
+
+// CHECK-LABEL: define{{.*}} %struct.Line @line(%struct.Line %{{.*}})
+struct Line line(struct Line l) { return l; }
+
+// Anything larger keeps the default sret and byval pointers.
+struct Table { int words[17]; };
+
+// CHECK-LABEL: define{{.*}} void @table(ptr {{.*}}sret(%struct.Table){{.*}}, ptr {{.*}}byval(%struct.Table)
+struct Table table(struct Table t) { return t; }
+
+// A BFU builtin called on a struct value returns the struct it writes back.
+// CHECK-LABEL: define{{.*}} %struct.Triple @bfu(%struct.Triple %{{.*}})
+// CHECK:       [[IN:%.*]] = load %struct.Triple, ptr
+// CHECK-NEXT:  [[OUT:%.*]] = call %struct.Triple @llvm.primate.BFU.0.{{.*}}(%struct.Triple [[IN]])
+// CHECK-NEXT:  store %struct.Triple [[OUT]]
+struct Triple bfu(struct Triple t) { return __primate_BFU_0(t); }
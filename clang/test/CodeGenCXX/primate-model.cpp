@@ -0,0 +1,38 @@
+// RUN: %clang_cc1 -triple primate32-unknown-elf -emit-llvm -disable-llvm-passes \
+// RUN:   -o - %s | FileCheck %s
+
+// A '#pragma primate model' class is a BFU. Its data members are the unit's
+// state and its ordinary member functions are the unit's operations,
+// numbered in declaration order and called like blue functions.
+#pragma primate model counter 3
+class Counter {
+public:
+  Counter() : count(0) {}
+  unsigned add(unsigned n) { count += n; return count; }
+  static unsigned zero() { return 0; }
+  unsigned get() const { return count; }
+
+private:
+  unsigned count;
+};
+
+unsigned use(unsigned n) {
+  Counter c;
+  c.add(n);
+  return c.get() + Counter::zero();
+}
+
+// Constructors and static member functions are not operations.
+// CHECK-DAG: define linkonce_odr {{.*}}@_ZN7CounterC1Ev({{[^!]*}}{{$}}
+// CHECK-DAG: define linkonce_odr {{.*}}@_ZN7Counter4zeroEv({{[^!]*}}{{$}}
+// CHECK-DAG: define linkonce_odr {{.*}}i32 @_ZN7Counter3addEj({{.*}} !primate ![[ADD:[0-9]+]] !primate.model ![[ADD_OP:[0-9]+]] {
+// CHECK-DAG: define linkonce_odr {{.*}}i32 @_ZNK7Counter3getEv({{.*}} !primate ![[GET:[0-9]+]] !primate.model ![[GET_OP:[0-9]+]] {
+
+// CHECK: !primate.model = !{![[UNIT:[0-9]+]]}
+// CHECK-DAG: ![[UNIT]] = !{!"counter", %class.Counter poison, ![[FIELDS:[0-9]+]]}
+// CHECK-DAG: ![[FIELDS]] = !{!"count"}
+// The latency and the number of arguments, including the instance.
+// CHECK-DAG: ![[ADD]] = !{!"blue", !"counter", i64 3, i64 2}
+// CHECK-DAG: ![[ADD_OP]] = !{!"counter", i64 0, !"add"}
+// CHECK-DAG: ![[GET]] = !{!"blue", !"counter", i64 3, i64 1}
+// CHECK-DAG: ![[GET_OP]] = !{!"counter", i64 1, !"get"}
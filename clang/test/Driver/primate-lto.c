@@ -0,0 +1,23 @@
+// Check that -flto leaves the whole program Primate passes to the link.
+
+// RUN: %clang -### --target=primate32-unknown-elf -flto \
+// RUN:   -mllvm -primate-min-mpps=10 %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=FULL %s
+// FULL: "-cc1" {{.*}} "-mllvm" "-primate-lto-prelink"
+// FULL: "-m" "elf32lprimate"
+// FULL-SAME: "-plugin-opt=-primate-lto-postlink"
+// FULL-SAME: "-plugin-opt=-primate-min-mpps=10"
+
+// RUN: %clang -### --target=primate32-unknown-elf -flto=thin %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=THIN %s
+// THIN: "-cc1" {{.*}} "-mllvm" "-primate-lto-prelink"
+// THIN: "-m" "elf32lprimate"
+// THIN-SAME: "-plugin-opt=thinlto"
+// THIN-SAME: "-plugin-opt=-primate-lto-postlink"
+
+// RUN: %clang -### --target=primate32-unknown-elf %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=NOLTO %s
+// NOLTO-NOT: "-primate-lto-prelink"
+// NOLTO-NOT: "-plugin-opt=-primate-lto-postlink"
+
+int primate_main() { return 0; }
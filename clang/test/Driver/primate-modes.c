@@ -0,0 +1,55 @@
+// Check the Primate driver modes.
+
+// --primate-archgen stops at the optimizer, which runs archgen.
+// RUN: %clang -### --target=primate32-unknown-elf --primate-archgen=%t.arch \
+// RUN:   %s 2>&1 | FileCheck -check-prefix=ARCHGEN %s
+// The bitcode goes to a temporary file, and the globals get sections in case
+// archgen splits the data memory into banks.
+// ARCHGEN: "-cc1" {{.*}} "-emit-llvm-bc"
+// ARCHGEN-SAME: "-mllvm" "-primate-archgen-dir={{.*}}.arch"
+// ARCHGEN-SAME: "-fdata-sections"
+// ARCHGEN-SAME: "-o" "{{.+}}primate-modes-{{[^"]*}}.bc"
+// ARCHGEN-NOT: "-m" "elf32lprimate"
+
+// RUN: %clang -### --target=primate32-unknown-elf --primate-archgen %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=ARCHGEN-CWD %s
+// ARCHGEN-CWD: "-mllvm" "-primate-archgen-dir=."
+
+// With -flto archgen runs in the link, on the merged module.
+// RUN: %clang -### --target=primate32-unknown-elf -flto \
+// RUN:   --primate-archgen=%t.arch %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=ARCHGEN-LTO %s
+// ARCHGEN-LTO: "-cc1" {{.*}} "-mllvm" "-primate-lto-prelink"
+// ARCHGEN-LTO: "-m" "elf32lprimate"
+// ARCHGEN-LTO-SAME: "-plugin-opt=-primate-archgen-dir={{.*}}.arch"
+// ARCHGEN-LTO-SAME: "-plugin-opt=-data-sections"
+
+// --primate-config compiles for the configuration and writes the images.
+// RUN: rm -rf %t.cfg && mkdir -p %t.cfg && touch %t.cfg/primate.cfg
+// RUN: %clang -### --target=primate32-unknown-elf --primate-config=%t.cfg \
+// RUN:   %s -o %t.out 2>&1 | FileCheck -check-prefix=CONFIG %s
+// CONFIG: "-cc1" {{.*}} "-mllvm" "-primate-config={{.*}}.cfg{{/|\\\\}}primate.cfg"
+// CONFIG-NOT: "-fdata-sections"
+// CONFIG: "-m" "elf32lprimate"
+// CONFIG-NOT: banks.ld
+// CONFIG: llvm-objdump" "-drl" "--primate-config={{.*}}primate.cfg" "{{.*}}.out"
+// CONFIG: llvm-objdump" "-t" "{{.*}}.out"
+// CONFIG: "{{.*}}share{{/|\\\\}}primate{{/|\\\\}}bin2asm.py" "{{.*}}.dis" "{{.*}}.sym" "{{.*}}primate.cfg" "{{.*}}.out.bin"
+// CONFIG: llvm-objdump" "-s" "{{.*}}.out"
+// CONFIG: "{{.*}}elf2meminit.py" "{{.*}}.data" "{{.*}}.out.mem" "{{.*}}primate.cfg"
+
+// A config with data memory banks places every global with banks.ld.
+// RUN: rm -rf %t.banks && mkdir -p %t.banks
+// RUN: echo "MEM_BANKS=table:1 counters:0 " > %t.banks/primate.cfg
+// RUN: %clang -### --target=primate32-unknown-elf --primate-config=%t.banks \
+// RUN:   %s -o %t.out 2>&1 | FileCheck -check-prefix=BANKS %s
+// BANKS: "-cc1" {{.*}} "-fdata-sections"
+// BANKS: "-m" "elf32lprimate"
+// BANKS-SAME: "-T" "{{.*}}.banks{{/|\\\\}}banks.ld"
+
+// RUN: not %clang -### --target=primate32-unknown-elf \
+// RUN:   --primate-config=%t.missing %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=CONFIG-MISSING %s
+// CONFIG-MISSING: error: no such file or directory: '{{.*}}missing{{/|\\\\}}primate.cfg'
+
+int primate_main() { return 0; }
@@ -0,0 +1,33 @@
+// Check -fsanitize=primate-input.
+
+// On Primate the target's pipeline places the checks, which drop the packet.
+// RUN: %clang -### --target=primate32-unknown-elf -fsanitize=primate-input \
+// RUN:   %s 2>&1 | FileCheck -check-prefix=DROP %s
+// DROP: "-cc1" {{.*}} "-fsanitize=primate-input"
+// DROP: "-mllvm" "-primate-input-sanitizer=drop"
+
+// RUN: %clang -### --target=primate32-unknown-elf -fsanitize=primate-input \
+// RUN:   -fsanitize-trap=primate-input %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=TRAP %s
+// TRAP: "-mllvm" "-primate-input-sanitizer=trap"
+
+// With -flto the checks are placed in the link.
+// RUN: %clang -### --target=primate32-unknown-elf -flto \
+// RUN:   -fsanitize=primate-input %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=LTO %s
+// LTO: "-m" "elf32lprimate"
+// LTO-SAME: "-plugin-opt=-primate-input-sanitizer=drop"
+
+// Host builds run the checks from the clang pipeline.
+// RUN: %clang -### --target=x86_64-unknown-linux-gnu \
+// RUN:   -fsanitize=primate-input %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=HOST %s
+// HOST: "-cc1" {{.*}} "-fsanitize=primate-input"
+// HOST-NOT: "-primate-input-sanitizer
+
+// RUN: not %clang -### --target=primate32-unknown-elf \
+// RUN:   -fsanitize=primate-input -fsanitize-recover=primate-input %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=RECOVER %s
+// RECOVER: error: unsupported argument 'primate-input' to option '-fsanitize-recover='
+
+void primate_main() {}
@@ -0,0 +1,34 @@
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify -DRET %s
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify -DPARAMS %s
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify -DSTATIC %s
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify=ok %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -fsyntax-only -verify=ok -DSTATIC %s
+// RUN: not %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -fdiagnostics-parseable-fixits -DRET %s 2>&1 | FileCheck --check-prefix=RET %s
+// RUN: not %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -fdiagnostics-parseable-fixits -DPARAMS %s 2>&1 | FileCheck --check-prefix=PARAMS %s
+// RUN: not %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -fdiagnostics-parseable-fixits -DSTATIC %s 2>&1 | FileCheck --check-prefix=STATIC %s
+
+// The hardware calls primate_main once per packet, with no arguments and no
+// use for a result. Other targets leave the name alone.
+
+#if defined(RET)
+// expected-error@+1 {{'primate_main' must return 'void'}}
+int primate_main(void) {
+// RET: fix-it:"{{.*}}":{[[@LINE-1]]:1-[[@LINE-1]]:4}:"void"
+  return 0;
+}
+#elif defined(PARAMS)
+// expected-error@+1 {{'primate_main' must not take parameters}}
+void primate_main(int argc, char **argv) {
+// PARAMS: fix-it:"{{.*}}":{[[@LINE-1]]:19-[[@LINE-1]]:40}:""
+}
+#elif defined(STATIC)
+// expected-error@+1 {{'primate_main' must have external linkage}}
+static void primate_main(void) {
+// STATIC: fix-it:"{{.*}}":{[[@LINE-1]]:1-[[@LINE-1]]:7}:""
+}
+#else
+void primate_main(void) {
+}
+#endif
+
+// ok-no-diagnostics
@@ -0,0 +1,31 @@
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify %s
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify=quiet -Wno-primate-conformance -DNO_ERROR %s
+// RUN: not %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -fdiagnostics-parseable-fixits %s 2>&1 | FileCheck %s
+
+// The last argument of '#pragma primate blue' is how many leading parameters
+// feed the BFU; the rest are where it writes its results.
+
+#pragma primate blue in_out 1 1
+void in_out(int in, int *out);
+
+#pragma primate blue by_val 1 2
+int by_val(int a, int b);
+
+#ifndef NO_ERROR
+// expected-error@+1 {{'#pragma primate blue' declares 3 inputs but 'too_many' only takes 2 parameters}}
+#pragma primate blue too_many 1 3
+void too_many(int a, int *out);
+// CHECK: fix-it:"{{.*}}":{[[@LINE-2]]:33-[[@LINE-2]]:34}:"2"
+#endif
+
+// expected-warning@+1 {{'#pragma primate blue' treats all 2 parameters of 'no_out' as inputs, leaving it no outputs}}
+#pragma primate blue no_out 1 2
+void no_out(int a, int b);
+// CHECK-NOT: fix-it:
+
+// expected-warning@+1 {{'by_value' returns its results by value, so all 2 of its parameters are inputs to the BFU}}
+#pragma primate blue by_value 1 1
+int by_value(int a, int b);
+// CHECK: fix-it:"{{.*}}":{[[@LINE-2]]:33-[[@LINE-2]]:34}:"2"
+
+// quiet-no-diagnostics
@@ -0,0 +1,38 @@
+// RUN: %clang_cc1 -triple primate32-unknown-elf -fsyntax-only -verify %s
+
+// '#pragma primate reg' keeps a struct in a wide register. It goes in front
+// of the struct, or of a member whose type is one.
+
+#pragma primate reg
+struct Hdr { unsigned src; unsigned dst; };
+
+struct Pkt {
+#pragma primate reg
+  Hdr hdr;
+#pragma primate reg
+  Hdr inner[2];
+  // expected-warning@+1 {{'#pragma primate reg' ignored; it applies to a struct or class, or to a member of struct type}}
+#pragma primate reg
+  unsigned len;
+};
+
+// expected-warning@+1 {{'#pragma primate reg' ignored; it applies to a struct or class, or to a member of struct type}}
+#pragma primate reg
+int counter;
+
+// expected-warning@+1 {{'#pragma primate reg' ignored; it applies to a struct or class, or to a member of struct type}}
+#pragma primate reg
+void parse(Pkt &p);
+
+// The function pragmas have nothing to apply to on a struct.
+// expected-warning@+1 {{is ignored, place it after "struct" to apply attribute to type declaration}}
+#pragma primate blue lookup 1 1
+struct Entry { unsigned key; };
+
+// expected-error@+1 {{invalid option 'register'; expected 'blue', 'green', 'reg', or 'model'}}
+#pragma primate register
+struct Flow { unsigned id; };
+
+// expected-error@+1 {{missing option; expected 'blue', 'green', 'reg', or 'model'}}
+#pragma primate
+struct Port { unsigned id; };
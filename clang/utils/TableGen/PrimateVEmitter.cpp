@@ -116,9 +116,13 @@ void PRVEmitter::createBuiltins(raw_ostream &o) {
         StringRef Name = Rec->getValueAsString("Name");
         StringRef PType = Rec->getValueAsString("PType");
         StringRef ITName = Rec->getValueAsString("IntrinName");
+        StringRef BFUName = Rec->getValueAsString("BFUName");
 
         o << "case Primate::BI" << Name << ":\n";
-        o << "return false;\n";
+        if (BFUName == "IO")
+            o << "return false;\n";
+        else
+            o << "return CheckPrimateBFUBuiltinCall(TheCall);\n";
         o << "break;\n";
     }
 }
@@ -1,29 +1,96 @@
 #! /bin/python3
+import hashlib
 import os
 import re
 import sys
 
-if len(sys.argv) != 3: 
+if len(sys.argv) not in (3, 4):
     print("wrong number of arguments....")
-    print("Expected: " + sys.argv[0] + "<.rodata section dump> <output memInit.txt>")
+    print("Expected: " + sys.argv[0] + "<section dump (objdump -s)> <output memInit.txt> [primate.cfg]")
     exit(-1)
 
-out_file = open(sys.argv[2], "w+")
-with open(sys.argv[1]) as f:
-    lines = f.readlines()
-    for line in lines[3:]:
+# Same as PrimateAttrs::getConfigFingerprint: the MD5 of the non-empty
+# lines, stripped and sorted.
+def config_fingerprint(text):
+    lines = sorted(line.strip() for line in text.split("\n") if line.strip())
+    return hashlib.md5("".join(line + "\n" for line in lines).encode()).hexdigest()[:16]
+
+def write_words(lines, out_file):
+    for line in lines:
         line = line.strip()
         toks = line.split()[1:5]
         print(toks)
         mask = 0x0ff
         shift_amt = 24
         for tok in toks:
+            # the ASCII column of a short last line
+            if not re.fullmatch(r"[0-9a-fA-F]{8}", tok):
+                break
             tok_int = int(tok, 16)
             
             print(hex((tok_int & (mask << shift_amt)) >> shift_amt)[2:], file=out_file)
             
             shift_amt -= 8
-out_file.close()
-        
-        
 
+with open(sys.argv[1]) as f:
+    lines = f.readlines()
+
+# llvm-objdump prints the fingerprint of the primate.cfg the object was
+# compiled for. The data layout of another configuration may differ.
+config = [line for line in lines if line.startswith("primate config ")]
+lines = [line for line in lines if not line.startswith("primate config ")]
+config_text = None
+if len(sys.argv) == 4:
+    with open(sys.argv[3]) as f:
+        config_text = f.read()
+    config_hash = config_fingerprint(config_text)
+    if not config:
+        print(f"warning: no primate config in {sys.argv[1]}, cannot check it against {sys.argv[3]}")
+    elif config[0].split()[2] != config_hash:
+        toks = config[0].split()
+        print(f"{sys.argv[1]} was compiled for primate config {toks[2]} ({' '.join(toks[3:])}), "
+              f"{sys.argv[3]} is {config_hash}")
+        exit(-1)
+
+# archgen's banks.ld puts each data memory bank in a .primate.bank<k> section.
+# A dump of the program (objdump -s) gives one init file per bank:
+# <output>_bank<k><ext>, for every bank MEM_BANKS of the config names, also
+# the ones with nothing to initialize. .rodata goes to <output>, the other
+# sections are not data memory.
+banks = {}
+if config_text is not None:
+    for line in config_text.split("\n"):
+        if line.startswith("MEM_BANKS="):
+            for entry in line[len("MEM_BANKS="):].split():
+                banks.setdefault(int(entry.rsplit(":", 1)[1]), [])
+section_header = re.compile(r"Contents of section (\S+):")
+bank_section = re.compile(r"\.primate\.bank(\d+)$")
+rodata_section = re.compile(r"\.rodata(\..*)?$")
+other = []
+section = None
+headers = False
+for line in lines:
+    m = section_header.match(line.strip())
+    if m:
+        headers = True
+        bank = bank_section.match(m.group(1))
+        if bank:
+            section = banks.setdefault(int(bank.group(1)), [])
+        elif rodata_section.match(m.group(1)):
+            section = other
+        else:
+            section = None
+    elif section is not None and line.strip():
+        section.append(line)
+if not headers:
+    other = lines[3:]
+
+if other or not banks:
+    out_file = open(sys.argv[2], "w+")
+    write_words(other, out_file)
+    out_file.close()
+stem, ext = os.path.splitext(sys.argv[2])
+for bank, bank_lines in sorted(banks.items()):
+    out_file = open(f"{stem}_bank{bank}{ext}", "w+")
+    write_words(bank_lines, out_file)
+    out_file.close()
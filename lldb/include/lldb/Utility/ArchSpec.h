@@ -113,6 +113,12 @@ public:
     eLoongArchSubType_loongarch64,
   };
 
+  enum PrimateSubType {
+    ePrimateSubType_unknown,
+    ePrimateSubType_primate32,
+    ePrimateSubType_primate64,
+  };
+
   enum Core {
     eCore_arm_generic,
     eCore_arm_armv4,
@@ -211,6 +217,9 @@ public:
     eCore_riscv32,
     eCore_riscv64,
 
+    eCore_primate32,
+    eCore_primate64,
+
     eCore_loongarch32,
     eCore_loongarch64,
 
@@ -0,0 +1,415 @@
+//===-- ABISysV_primate.cpp -----------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===---------------------------------------------------------------------===//
+
+#include "ABISysV_primate.h"
+
+#include <array>
+#include <limits>
+#include <optional>
+
+#include "llvm/ADT/StringSwitch.h"
+
+#include "lldb/Core/PluginManager.h"
+#include "lldb/Core/Value.h"
+#include "lldb/Core/ValueObjectConstResult.h"
+#include "lldb/Symbol/UnwindPlan.h"
+#include "lldb/Target/Process.h"
+#include "lldb/Target/RegisterContext.h"
+#include "lldb/Target/StackFrame.h"
+#include "lldb/Target/Thread.h"
+#include "lldb/Utility/RegisterValue.h"
+
+#define DEFINE_REG_NAME(reg_num) ConstString(#reg_num).GetCString()
+
+// The ABI is not a source of such information as size, offset, encoding, etc.
+// of a register. Just provides correct dwarf and eh_frame numbers. The h and
+// p views of a register share its dwarf number, so only x0-x31 are listed.
+
+#define DEFINE_GENERIC_REGISTER_STUB(dwarf_num, generic_num)                   \
+  {                                                                            \
+    DEFINE_REG_NAME(dwarf_num), nullptr, 0, 0, eEncodingInvalid,               \
+        eFormatDefault,                                                        \
+        {dwarf_num, dwarf_num, generic_num, LLDB_INVALID_REGNUM, dwarf_num},   \
+        nullptr, nullptr, nullptr,                                             \
+  }
+
+#define DEFINE_REGISTER_STUB(dwarf_num)                                        \
+  DEFINE_GENERIC_REGISTER_STUB(dwarf_num, LLDB_INVALID_REGNUM)
+
+using namespace lldb;
+using namespace lldb_private;
+
+LLDB_PLUGIN_DEFINE_ADV(ABISysV_primate, ABIPrimate)
+
+namespace {
+namespace dwarf {
+enum regnums {
+  x0,
+  x1,
+  x2,
+  x3,
+  x4,
+  x5,
+  x6,
+  x7,
+  x8,
+  x9,
+  x10,
+  x11,
+  x12,
+  x13,
+  x14,
+  x15,
+  x16,
+  x17,
+  x18,
+  x19,
+  x20,
+  x21,
+  x22,
+  x23,
+  x24,
+  x25,
+  x26,
+  x27,
+  x28,
+  x29,
+  x30,
+  x31,
+  pc
+};
+
+static const std::array<RegisterInfo, 33> g_register_infos = {
+    {DEFINE_REGISTER_STUB(x0),
+     DEFINE_GENERIC_REGISTER_STUB(x1, LLDB_REGNUM_GENERIC_RA),
+     DEFINE_GENERIC_REGISTER_STUB(x2, LLDB_REGNUM_GENERIC_SP),
+     DEFINE_REGISTER_STUB(x3),
+     DEFINE_REGISTER_STUB(x4),
+     DEFINE_REGISTER_STUB(x5),
+     DEFINE_REGISTER_STUB(x6),
+     DEFINE_REGISTER_STUB(x7),
+     DEFINE_GENERIC_REGISTER_STUB(x8, LLDB_REGNUM_GENERIC_FP),
+     DEFINE_REGISTER_STUB(x9),
+     DEFINE_GENERIC_REGISTER_STUB(x10, LLDB_REGNUM_GENERIC_ARG1),
+     DEFINE_GENERIC_REGISTER_STUB(x11, LLDB_REGNUM_GENERIC_ARG2),
+     DEFINE_GENERIC_REGISTER_STUB(x12, LLDB_REGNUM_GENERIC_ARG3),
+     DEFINE_GENERIC_REGISTER_STUB(x13, LLDB_REGNUM_GENERIC_ARG4),
+     DEFINE_GENERIC_REGISTER_STUB(x14, LLDB_REGNUM_GENERIC_ARG5),
+     DEFINE_GENERIC_REGISTER_STUB(x15, LLDB_REGNUM_GENERIC_ARG6),
+     DEFINE_GENERIC_REGISTER_STUB(x16, LLDB_REGNUM_GENERIC_ARG7),
+     DEFINE_GENERIC_REGISTER_STUB(x17, LLDB_REGNUM_GENERIC_ARG8),
+     DEFINE_REGISTER_STUB(x18),
+     DEFINE_REGISTER_STUB(x19),
+     DEFINE_REGISTER_STUB(x20),
+     DEFINE_REGISTER_STUB(x21),
+     DEFINE_REGISTER_STUB(x22),
+     DEFINE_REGISTER_STUB(x23),
+     DEFINE_REGISTER_STUB(x24),
+     DEFINE_REGISTER_STUB(x25),
+     DEFINE_REGISTER_STUB(x26),
+     DEFINE_REGISTER_STUB(x27),
+     DEFINE_REGISTER_STUB(x28),
+     DEFINE_REGISTER_STUB(x29),
+     DEFINE_REGISTER_STUB(x30),
+     DEFINE_REGISTER_STUB(x31),
+     DEFINE_GENERIC_REGISTER_STUB(pc, LLDB_REGNUM_GENERIC_PC)}};
+} // namespace dwarf
+} // namespace
+
+const RegisterInfo *ABISysV_primate::GetRegisterInfoArray(uint32_t &count) {
+  count = dwarf::g_register_infos.size();
+  return dwarf::g_register_infos.data();
+}
+
+//------------------------------------------------------------------
+// Static Functions
+//------------------------------------------------------------------
+
+ABISP
+ABISysV_primate::CreateInstance(ProcessSP process_sp, const ArchSpec &arch) {
+  llvm::Triple::ArchType machine = arch.GetTriple().getArch();
+
+  if (llvm::Triple::primate32 != machine && llvm::Triple::primate64 != machine)
+    return ABISP();
+
+  ABISysV_primate *abi = new ABISysV_primate(std::move(process_sp),
+                                             MakeMCRegisterInfo(arch));
+  if (abi)
+    abi->SetIsPrimate64(llvm::Triple::primate64 == machine);
+  return ABISP(abi);
+}
+
+bool ABISysV_primate::PrepareTrivialCall(Thread &thread, addr_t sp,
+                                         addr_t func_addr, addr_t return_addr,
+                                         llvm::ArrayRef<addr_t> args) const {
+  // Expressions are not run on the target: primate_main is the only entry
+  // point the hardware knows about.
+  return false;
+}
+
+// Scalar arguments come in x10-x17 and then in register sized stack slots
+// from sp up, as in the ILP32/LP64 integer calling convention.
+bool ABISysV_primate::GetArgumentValues(Thread &thread,
+                                        ValueList &values) const {
+  RegisterContext *reg_ctx = thread.GetRegisterContext().get();
+  if (!reg_ctx)
+    return false;
+
+  ProcessSP process_sp = thread.GetProcess();
+  if (!process_sp)
+    return false;
+
+  const size_t reg_size = m_is_primate64 ? 8 : 4;
+  addr_t sp = 0;
+  for (uint32_t value_idx = 0; value_idx < values.GetSize(); ++value_idx) {
+    Value *value = values.GetValueAtIndex(value_idx);
+    if (!value)
+      return false;
+
+    CompilerType value_type = value->GetCompilerType();
+    if (!value_type)
+      return false;
+
+    bool is_signed = false;
+    if (!value_type.IsIntegerOrEnumerationType(is_signed) &&
+        !value_type.IsPointerOrReferenceType())
+      return false;
+
+    std::optional<uint64_t> bit_size = value_type.GetBitSize(&thread);
+    if (!bit_size || *bit_size == 0 || *bit_size > reg_size * 8)
+      return false;
+
+    if (value_idx < 8) {
+      const RegisterInfo *reg_info = reg_ctx->GetRegisterInfo(
+          eRegisterKindGeneric, LLDB_REGNUM_GENERIC_ARG1 + value_idx);
+      RegisterValue reg_value;
+      if (!reg_info || !reg_ctx->ReadRegister(reg_info, reg_value))
+        return false;
+      if (is_signed)
+        reg_value.SignExtend(*bit_size);
+      if (!reg_value.GetScalarValue(value->GetScalar()))
+        return false;
+      value->GetScalar().TruncOrExtendTo(*bit_size, is_signed);
+      continue;
+    }
+
+    if (sp == 0) {
+      sp = reg_ctx->GetSP(0);
+      if (sp == 0)
+        return false;
+    }
+    Status error;
+    if (!process_sp->ReadScalarIntegerFromMemory(sp, (*bit_size + 7) / 8,
+                                                 is_signed, value->GetScalar(),
+                                                 error))
+      return false;
+    sp += reg_size;
+  }
+  return true;
+}
+
+Status ABISysV_primate::SetReturnValueObject(StackFrameSP &frame_sp,
+                                             ValueObjectSP &new_value_sp) {
+  Status result;
+  if (!new_value_sp) {
+    result.SetErrorString("Empty value object for return value.");
+    return result;
+  }
+
+  CompilerType compiler_type = new_value_sp->GetCompilerType();
+  if (!compiler_type) {
+    result.SetErrorString("Null clang type for return value.");
+    return result;
+  }
+
+  auto reg_ctx = frame_sp->GetThread()->GetRegisterContext();
+  const uint32_t type_flags = compiler_type.GetTypeInfo();
+  const size_t reg_size = m_is_primate64 ? 8 : 4;
+  if (!(type_flags & (eTypeIsInteger | eTypeIsPointer)) ||
+      compiler_type.GetByteSize(frame_sp.get()).value_or(0) > reg_size) {
+    result.SetErrorString("Only scalars that fit in x10 can be returned.");
+    return result;
+  }
+
+  DataExtractor data;
+  Status data_error;
+  if (!new_value_sp->GetData(data, data_error)) {
+    result.SetErrorStringWithFormat("Couldn't convert return value to raw "
+                                    "data: %s",
+                                    data_error.AsCString());
+    return result;
+  }
+  lldb::offset_t offset = 0;
+  uint64_t raw_value = data.GetMaxU64(&offset, data.GetByteSize());
+  const RegisterInfo *reg_info_a0 =
+      reg_ctx->GetRegisterInfo(eRegisterKindGeneric, LLDB_REGNUM_GENERIC_ARG1);
+  if (!reg_ctx->WriteRegisterFromUnsigned(reg_info_a0, raw_value))
+    result.SetErrorString("Couldn't write value to register x10");
+  return result;
+}
+
+ValueObjectSP
+ABISysV_primate::GetReturnValueObjectImpl(Thread &thread,
+                                          CompilerType &compiler_type) const {
+  ValueObjectSP return_valobj_sp;
+
+  if (!compiler_type)
+    return return_valobj_sp;
+
+  auto reg_ctx = thread.GetRegisterContext();
+  if (!reg_ctx)
+    return return_valobj_sp;
+
+  Value value;
+  value.SetCompilerType(compiler_type);
+
+  const uint32_t type_flags = compiler_type.GetTypeInfo();
+  const size_t byte_size = compiler_type.GetByteSize(&thread).value_or(0);
+  const size_t reg_size = m_is_primate64 ? 8 : 4;
+  if (!(type_flags & (eTypeIsInteger | eTypeIsPointer)) || byte_size == 0 ||
+      byte_size > 2 * reg_size)
+    return return_valobj_sp;
+
+  // Scalars come back in x10, or x10 and x11 when twice the register size.
+  auto reg_info_a0 =
+      reg_ctx->GetRegisterInfo(eRegisterKindGeneric, LLDB_REGNUM_GENERIC_ARG1);
+  auto reg_info_a1 =
+      reg_ctx->GetRegisterInfo(eRegisterKindGeneric, LLDB_REGNUM_GENERIC_ARG2);
+  uint64_t raw_value = reg_ctx->ReadRegisterAsUnsigned(reg_info_a0, 0);
+  if (reg_size == 4) {
+    raw_value &= UINT32_MAX;
+    if (byte_size > reg_size)
+      raw_value |=
+          (reg_ctx->ReadRegisterAsUnsigned(reg_info_a1, 0) & UINT32_MAX) << 32U;
+  } else if (byte_size > reg_size) {
+    return return_valobj_sp;
+  }
+
+  const bool is_signed = (type_flags & eTypeIsSigned) != 0;
+  value.GetScalar() = raw_value;
+  value.GetScalar().TruncOrExtendTo(byte_size * 8, is_signed);
+
+  value.SetValueType(Value::ValueType::Scalar);
+  return_valobj_sp = ValueObjectConstResult::Create(
+      thread.GetStackFrameAtIndex(0).get(), value, ConstString(""));
+  return return_valobj_sp;
+}
+
+bool ABISysV_primate::CreateFunctionEntryUnwindPlan(UnwindPlan &unwind_plan) {
+  unwind_plan.Clear();
+  unwind_plan.SetRegisterKind(eRegisterKindGeneric);
+
+  uint32_t pc_reg_num = LLDB_REGNUM_GENERIC_PC;
+  uint32_t sp_reg_num = LLDB_REGNUM_GENERIC_SP;
+  uint32_t ra_reg_num = LLDB_REGNUM_GENERIC_RA;
+
+  UnwindPlan::RowSP row(new UnwindPlan::Row);
+
+  // Define CFA as the stack pointer
+  row->GetCFAValue().SetIsRegisterPlusOffset(sp_reg_num, 0);
+
+  // Previous frame's pc is in ra
+  row->SetRegisterLocationToRegister(pc_reg_num, ra_reg_num, true);
+  unwind_plan.AppendRow(row);
+  unwind_plan.SetSourceName("primate function-entry unwind plan");
+  unwind_plan.SetSourcedFromCompiler(eLazyBoolNo);
+
+  return true;
+}
+
+bool ABISysV_primate::CreateDefaultUnwindPlan(UnwindPlan &unwind_plan) {
+  unwind_plan.Clear();
+  unwind_plan.SetRegisterKind(eRegisterKindGeneric);
+
+  uint32_t pc_reg_num = LLDB_REGNUM_GENERIC_PC;
+  uint32_t fp_reg_num = LLDB_REGNUM_GENERIC_FP;
+
+  UnwindPlan::RowSP row(new UnwindPlan::Row);
+
+  // Define the CFA as the current frame pointer value.
+  row->GetCFAValue().SetIsRegisterPlusOffset(fp_reg_num, 0);
+  row->SetOffset(0);
+
+  int reg_size = m_is_primate64 ? 8 : 4;
+
+  // Assume the ra reg (return pc) and caller's frame pointer
+  // have been spilled to stack already.
+  row->SetRegisterLocationToAtCFAPlusOffset(fp_reg_num, reg_size * -2, true);
+  row->SetRegisterLocationToAtCFAPlusOffset(pc_reg_num, reg_size * -1, true);
+
+  unwind_plan.AppendRow(row);
+  unwind_plan.SetSourceName("primate default unwind plan");
+  unwind_plan.SetSourcedFromCompiler(eLazyBoolNo);
+  unwind_plan.SetUnwindPlanValidAtAllInstructions(eLazyBoolNo);
+  return true;
+}
+
+bool ABISysV_primate::RegisterIsVolatile(const RegisterInfo *reg_info) {
+  return !RegisterIsCalleeSaved(reg_info);
+}
+
+// CSR_ILP32_LP64 in PrimateCallingConv.td, plus sp.
+bool ABISysV_primate::RegisterIsCalleeSaved(const RegisterInfo *reg_info) {
+  if (!reg_info)
+    return false;
+
+  // the h and p views of a callee saved x register are saved with it
+  std::string name = reg_info->name;
+  if (name.size() > 1 && (name[0] == 'h' || name[0] == 'p'))
+    name[0] = 'x';
+
+  return llvm::StringSwitch<bool>(name)
+      .Cases("x1", "x2", "x3", "x4", "x8", "x9", true)
+      .Cases("x18", "x19", "x20", "x21", "x22", "x23", true)
+      .Cases("x24", "x25", "x26", "x27", true)
+      .Default(false);
+}
+
+void ABISysV_primate::Initialize() {
+  PluginManager::RegisterPlugin(
+      GetPluginNameStatic(), "System V ABI for Primate targets", CreateInstance);
+}
+
+void ABISysV_primate::Terminate() {
+  PluginManager::UnregisterPlugin(CreateInstance);
+}
+
+static uint32_t GetGenericNum(llvm::StringRef name) {
+  return llvm::StringSwitch<uint32_t>(name)
+      .Case("pc", LLDB_REGNUM_GENERIC_PC)
+      .Case("x1", LLDB_REGNUM_GENERIC_RA)
+      .Case("x2", LLDB_REGNUM_GENERIC_SP)
+      .Case("x8", LLDB_REGNUM_GENERIC_FP)
+      .Case("x10", LLDB_REGNUM_GENERIC_ARG1)
+      .Case("x11", LLDB_REGNUM_GENERIC_ARG2)
+      .Case("x12", LLDB_REGNUM_GENERIC_ARG3)
+      .Case("x13", LLDB_REGNUM_GENERIC_ARG4)
+      .Case("x14", LLDB_REGNUM_GENERIC_ARG5)
+      .Case("x15", LLDB_REGNUM_GENERIC_ARG6)
+      .Case("x16", LLDB_REGNUM_GENERIC_ARG7)
+      .Case("x17", LLDB_REGNUM_GENERIC_ARG8)
+      .Default(LLDB_INVALID_REGNUM);
+}
+
+void ABISysV_primate::AugmentRegisterInfo(
+    std::vector<lldb_private::DynamicRegisterInfo::Register> &regs) {
+  lldb_private::RegInfoBasedABI::AugmentRegisterInfo(regs);
+
+  for (auto it : llvm::enumerate(regs)) {
+    // Set alt name for certain registers for convenience
+    if (it.value().name == "x1")
+      it.value().alt_name.SetCString("ra");
+    else if (it.value().name == "x2")
+      it.value().alt_name.SetCString("sp");
+    else if (it.value().name == "x8")
+      it.value().alt_name.SetCString("fp");
+
+    // Set generic regnum so lldb knows what the PC, etc is
+    it.value().regnum_generic = GetGenericNum(it.value().name.GetStringRef());
+  }
+}
@@ -0,0 +1,96 @@
+//===-- ArchitecturePrimate.cpp -------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Plugins/Architecture/Primate/ArchitecturePrimate.h"
+#include "lldb/Core/Address.h"
+#include "lldb/Core/Module.h"
+#include "lldb/Core/PluginManager.h"
+#include "lldb/Symbol/CompileUnit.h"
+#include "lldb/Symbol/LineTable.h"
+#include "lldb/Symbol/SymbolContext.h"
+#include "lldb/Target/SectionLoadList.h"
+#include "lldb/Target/Target.h"
+#include "lldb/Utility/ArchSpec.h"
+#include "lldb/Utility/LLDBLog.h"
+#include "lldb/Utility/Log.h"
+
+using namespace lldb_private;
+using namespace lldb;
+
+LLDB_PLUGIN_DEFINE(ArchitecturePrimate)
+
+void ArchitecturePrimate::Initialize() {
+  PluginManager::RegisterPlugin(GetPluginNameStatic(),
+                                "Primate-specific algorithms",
+                                &ArchitecturePrimate::Create);
+}
+
+void ArchitecturePrimate::Terminate() {
+  PluginManager::UnregisterPlugin(&ArchitecturePrimate::Create);
+}
+
+std::unique_ptr<Architecture>
+ArchitecturePrimate::Create(const ArchSpec &arch) {
+  if (arch.GetMachine() != llvm::Triple::primate32 &&
+      arch.GetMachine() != llvm::Triple::primate64)
+    return nullptr;
+  return std::unique_ptr<Architecture>(new ArchitecturePrimate());
+}
+
+lldb::addr_t ArchitecturePrimate::GetBreakableLoadAddress(lldb::addr_t addr,
+                                                          Target &target) const {
+  Log *log = GetLog(LLDBLog::Breakpoints);
+
+  Address resolved_addr;
+  SectionLoadList &section_load_list = target.GetSectionLoadList();
+  if (section_load_list.IsEmpty())
+    target.ResolveFileAddress(addr, resolved_addr);
+  else
+    target.ResolveLoadAddress(addr, resolved_addr);
+
+  ModuleSP module_sp(resolved_addr.GetModule());
+  if (!module_sp)
+    return addr;
+  SymbolContext sc;
+  module_sp->ResolveSymbolContextForAddress(resolved_addr,
+                                            eSymbolContextCompUnit, sc);
+  LineTable *line_table = sc.comp_unit ? sc.comp_unit->GetLineTable() : nullptr;
+  if (!line_table)
+    return addr;
+
+  // Walk back over the slot rows of the packet, staying inside the run of
+  // contiguous rows the address was found in.
+  LineEntry entry;
+  uint32_t idx;
+  if (!line_table->FindLineEntryByAddress(resolved_addr, entry, &idx))
+    return addr;
+  Address packet_start = entry.range.GetBaseAddress();
+  while (!entry.is_start_of_statement && idx > 0) {
+    LineEntry prev;
+    if (!line_table->GetLineEntryAtIndex(--idx, prev) || prev.is_terminal_entry)
+      return addr;
+    addr_t prev_end =
+        prev.range.GetBaseAddress().GetFileAddress() + prev.range.GetByteSize();
+    if (prev_end != entry.range.GetBaseAddress().GetFileAddress())
+      return addr;
+    entry = prev;
+    packet_start = entry.range.GetBaseAddress();
+  }
+  if (!entry.is_start_of_statement)
+    return addr;
+
+  addr_t breakable_addr = packet_start.GetLoadAddress(&target);
+  if (breakable_addr == LLDB_INVALID_ADDRESS)
+    breakable_addr = packet_start.GetFileAddress();
+  if (breakable_addr != addr)
+    LLDB_LOGF(log,
+              "Target::%s Breakpoint at 0x%8.8" PRIx64
+              " is adjusted to 0x%8.8" PRIx64 " at the start of its packet\n",
+              __FUNCTION__, addr, breakable_addr);
+  return breakable_addr;
+}
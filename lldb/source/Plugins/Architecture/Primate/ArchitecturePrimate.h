@@ -0,0 +1,41 @@
+//===-- ArchitecturePrimate.h -----------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLDB_SOURCE_PLUGINS_ARCHITECTURE_PRIMATE_ARCHITECTUREPRIMATE_H
+#define LLDB_SOURCE_PLUGINS_ARCHITECTURE_PRIMATE_ARCHITECTUREPRIMATE_H
+
+#include "lldb/Core/Architecture.h"
+#include "lldb/Utility/ArchSpec.h"
+
+namespace lldb_private {
+
+// Primate issues a VLIW packet at a time, one slot per functional unit, and
+// only a packet address is a place execution can stop. The first
+// line table row of each packet is the only one marked is_stmt, so
+// breakpoints are moved back to the start of the packet they fall in.
+class ArchitecturePrimate : public Architecture {
+public:
+  static llvm::StringRef GetPluginNameStatic() { return "primate"; }
+  static void Initialize();
+  static void Terminate();
+
+  llvm::StringRef GetPluginName() override { return GetPluginNameStatic(); }
+
+  void OverrideStopInfo(Thread &thread) const override {}
+
+  lldb::addr_t GetBreakableLoadAddress(lldb::addr_t addr,
+                                       Target &target) const override;
+
+private:
+  static std::unique_ptr<Architecture> Create(const ArchSpec &arch);
+  ArchitecturePrimate() = default;
+};
+
+} // namespace lldb_private
+
+#endif // LLDB_SOURCE_PLUGINS_ARCHITECTURE_PRIMATE_ARCHITECTUREPRIMATE_H
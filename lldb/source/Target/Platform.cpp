@@ -2104,6 +2104,15 @@ size_t Platform::GetSoftwareBreakpointTrapOpcode(Target &target,
     }
   } break;
 
+  case llvm::Triple::primate32:
+  case llvm::Triple::primate64: {
+    // Slots are wider than 4 bytes with more than 32 registers, the stub
+    // plants its own breakpoints from Z0 packets.
+    static const uint8_t g_primate_opcode[] = {0x73, 0x00, 0x10, 0x00}; // ebreak
+    trap_opcode = g_primate_opcode;
+    trap_opcode_size = sizeof(g_primate_opcode);
+  } break;
+
   case llvm::Triple::loongarch32:
   case llvm::Triple::loongarch64: {
     static const uint8_t g_loongarch_opcode[] = {0x05, 0x00, 0x2a,
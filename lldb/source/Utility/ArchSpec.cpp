@@ -225,6 +225,11 @@ static const CoreDefinition g_core_definitions[] = {
     {eByteOrderLittle, 8, 2, 4, llvm::Triple::riscv64, ArchSpec::eCore_riscv64,
      "riscv64"},
 
+    {eByteOrderLittle, 4, 4, 4, llvm::Triple::primate32,
+     ArchSpec::eCore_primate32, "primate32"},
+    {eByteOrderLittle, 8, 4, 4, llvm::Triple::primate64,
+     ArchSpec::eCore_primate64, "primate64"},
+
     {eByteOrderLittle, 4, 4, 4, llvm::Triple::loongarch32,
      ArchSpec::eCore_loongarch32, "loongarch32"},
     {eByteOrderLittle, 8, 4, 4, llvm::Triple::loongarch64,
@@ -418,6 +423,10 @@ static const ArchDefinitionEntry g_elf_arch_entries[] = {
      ArchSpec::eRISCVSubType_riscv32, 0xFFFFFFFFu, 0xFFFFFFFFu}, // riscv32
     {ArchSpec::eCore_riscv64, llvm::ELF::EM_RISCV,
      ArchSpec::eRISCVSubType_riscv64, 0xFFFFFFFFu, 0xFFFFFFFFu}, // riscv64
+    {ArchSpec::eCore_primate32, llvm::ELF::EM_PRIMATE,
+     ArchSpec::ePrimateSubType_primate32, 0xFFFFFFFFu, 0xFFFFFFFFu}, // primate32
+    {ArchSpec::eCore_primate64, llvm::ELF::EM_PRIMATE,
+     ArchSpec::ePrimateSubType_primate64, 0xFFFFFFFFu, 0xFFFFFFFFu}, // primate64
     {ArchSpec::eCore_loongarch32, llvm::ELF::EM_LOONGARCH,
      ArchSpec::eLoongArchSubType_loongarch32, 0xFFFFFFFFu,
      0xFFFFFFFFu}, // loongarch32
@@ -19,6 +19,7 @@
 #include "lldb/Utility/DataBufferHeap.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
@@ -308,3 +309,38 @@ Sections:
   auto entry_point_addr = module_sp->GetObjectFile()->GetEntryPointAddress();
   ASSERT_EQ(entry_point_addr.GetAddressClass(), AddressClass::eCode);
 }
+
+TEST_F(ObjectFileELFTest, GetArchitecture_Primate) {
+  // EM_PRIMATE objects are primate32 or primate64 by their ELF class.
+  const struct {
+    const char *elf_class;
+    llvm::Triple::ArchType arch;
+    uint32_t address_byte_size;
+  } cases[] = {{"ELFCLASS32", llvm::Triple::primate32, 4},
+               {"ELFCLASS64", llvm::Triple::primate64, 8}};
+  for (const auto &c : cases) {
+    auto ExpectedFile = TestFile::fromYaml(llvm::formatv(R"(
+--- !ELF
+FileHeader:
+  Class:           {0}
+  Data:            ELFDATA2LSB
+  Type:            ET_EXEC
+  Machine:         EM_PRIMATE
+Sections:
+  - Name:            .text
+    Type:            SHT_PROGBITS
+    Flags:           [ SHF_ALLOC, SHF_EXECINSTR ]
+    AddressAlign:    0x0000000000000004
+    Content:         '73001000'
+...
+)",
+                                                         c.elf_class)
+                                               .str());
+    ASSERT_THAT_EXPECTED(ExpectedFile, llvm::Succeeded());
+
+    auto module_sp = std::make_shared<Module>(ExpectedFile->moduleSpec());
+    ArchSpec arch = module_sp->GetObjectFile()->GetArchitecture();
+    EXPECT_EQ(arch.GetTriple().getArch(), c.arch);
+    EXPECT_EQ(arch.GetAddressByteSize(), c.address_byte_size);
+  }
+}
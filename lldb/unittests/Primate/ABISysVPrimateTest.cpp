@@ -0,0 +1,83 @@
+//===-- ABISysVPrimateTest.cpp --------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Plugins/ABI/Primate/ABISysV_primate.h"
+#include "lldb/Target/DynamicRegisterInfo.h"
+#include "lldb/Utility/ArchSpec.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+
+using namespace lldb;
+using namespace lldb_private;
+
+namespace {
+class ABISysVPrimateTest : public testing::Test {
+public:
+  static void SetUpTestCase() {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargetMCs();
+  }
+
+protected:
+  // The registers primate_gdbserver.py describes in target.xml: the scalar
+  // view x<n>, the wide register p<n> and its p<n>_b<k> blocks.
+  static std::vector<DynamicRegisterInfo::Register>
+  MakeRegisters(llvm::ArrayRef<const char *> names) {
+    std::vector<DynamicRegisterInfo::Register> regs;
+    for (const char *name : names) {
+      DynamicRegisterInfo::Register reg;
+      reg.name.SetCString(name);
+      regs.push_back(reg);
+    }
+    return regs;
+  }
+};
+} // namespace
+
+TEST_F(ABISysVPrimateTest, CreateInstance) {
+  EXPECT_TRUE(ABISysV_primate::CreateInstance(
+      ProcessSP(), ArchSpec("primate32-unknown-unknown-elf")));
+  EXPECT_TRUE(ABISysV_primate::CreateInstance(
+      ProcessSP(), ArchSpec("primate64-unknown-unknown-elf")));
+  EXPECT_FALSE(ABISysV_primate::CreateInstance(
+      ProcessSP(), ArchSpec("riscv32-unknown-unknown-elf")));
+}
+
+TEST_F(ABISysVPrimateTest, AugmentRegisterInfo) {
+  ABISP abi = ABISysV_primate::CreateInstance(
+      ProcessSP(), ArchSpec("primate32-unknown-unknown-elf"));
+  ASSERT_TRUE(abi);
+
+  auto regs = MakeRegisters({"x1", "x2", "x8", "x10", "x17", "x18", "pc",
+                             "p10", "p10_b0"});
+  abi->AugmentRegisterInfo(regs);
+
+  EXPECT_EQ(regs[0].alt_name, ConstString("ra"));
+  EXPECT_EQ(regs[0].regnum_dwarf, 1u);
+  EXPECT_EQ(regs[0].regnum_generic, uint32_t(LLDB_REGNUM_GENERIC_RA));
+  EXPECT_EQ(regs[1].alt_name, ConstString("sp"));
+  EXPECT_EQ(regs[1].regnum_generic, uint32_t(LLDB_REGNUM_GENERIC_SP));
+  EXPECT_EQ(regs[2].alt_name, ConstString("fp"));
+  EXPECT_EQ(regs[2].regnum_generic, uint32_t(LLDB_REGNUM_GENERIC_FP));
+  EXPECT_EQ(regs[3].regnum_dwarf, 10u);
+  EXPECT_EQ(regs[3].regnum_ehframe, 10u);
+  EXPECT_EQ(regs[3].regnum_generic, uint32_t(LLDB_REGNUM_GENERIC_ARG1));
+  EXPECT_EQ(regs[4].regnum_generic, uint32_t(LLDB_REGNUM_GENERIC_ARG8));
+  EXPECT_EQ(regs[5].regnum_dwarf, 18u);
+  EXPECT_EQ(regs[5].regnum_generic, LLDB_INVALID_REGNUM);
+  EXPECT_EQ(regs[6].regnum_generic, uint32_t(LLDB_REGNUM_GENERIC_PC));
+
+  // The wide views share their register with x<n> but not its numbers, so
+  // unwinding and argument reads only ever go through x<n>.
+  for (const auto &reg : llvm::ArrayRef(regs).take_back(2)) {
+    EXPECT_EQ(reg.regnum_dwarf, LLDB_INVALID_REGNUM) << reg.name.AsCString();
+    EXPECT_EQ(reg.regnum_ehframe, LLDB_INVALID_REGNUM) << reg.name.AsCString();
+    EXPECT_EQ(reg.regnum_generic, LLDB_INVALID_REGNUM) << reg.name.AsCString();
+    EXPECT_FALSE(reg.alt_name) << reg.name.AsCString();
+  }
+}
@@ -0,0 +1,164 @@
+//===-- ArchitecturePrimateTest.cpp ---------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Plugins/Architecture/Primate/ArchitecturePrimate.h"
+#include "Plugins/ObjectFile/ELF/ObjectFileELF.h"
+#include "Plugins/Platform/Linux/PlatformLinux.h"
+#include "Plugins/SymbolFile/DWARF/SymbolFileDWARF.h"
+#include "TestingSupport/SubsystemRAII.h"
+#include "TestingSupport/TestUtilities.h"
+#include "lldb/Core/Debugger.h"
+#include "lldb/Core/Module.h"
+#include "lldb/Host/FileSystem.h"
+#include "lldb/Host/HostInfo.h"
+#include "lldb/Target/Target.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+using namespace lldb;
+using namespace lldb_private;
+using namespace lldb_private::plugin::dwarf;
+
+namespace {
+class ArchitecturePrimateTest : public testing::Test {
+  SubsystemRAII<FileSystem, HostInfo, ObjectFileELF, SymbolFileDWARF,
+                platform_linux::PlatformLinux, ArchitecturePrimate>
+      subsystems;
+
+public:
+  void SetUp() override;
+
+protected:
+  std::optional<TestFile> m_file;
+  DebuggerSP m_debugger_sp;
+  TargetSP m_target_sp;
+};
+} // namespace
+
+// Two packets of 0x10 bytes at 0x1000. The AsmPrinter gives every slot a
+// row and marks only the first row of a packet is_stmt: the first packet
+// has rows for lines 3, 4 and 5 at 0x1000, 0x1004 and 0x1008, the second
+// starts at 0x1010 with line 6.
+void ArchitecturePrimateTest::SetUp() {
+  auto ExpectedFile = TestFile::fromYaml(R"(
+--- !ELF
+FileHeader:
+  Class:           ELFCLASS32
+  Data:            ELFDATA2LSB
+  Type:            ET_EXEC
+  Machine:         EM_PRIMATE
+Sections:
+  - Name:            .text
+    Type:            SHT_PROGBITS
+    Flags:           [ SHF_ALLOC, SHF_EXECINSTR ]
+    Address:         0x1000
+    AddressAlign:    0x10
+    Size:            0x20
+DWARF:
+  debug_abbrev:
+    - Table:
+        - Code:            0x1
+          Tag:             DW_TAG_compile_unit
+          Children:        DW_CHILDREN_no
+          Attributes:
+            - Attribute:       DW_AT_name
+              Form:            DW_FORM_string
+            - Attribute:       DW_AT_low_pc
+              Form:            DW_FORM_addr
+            - Attribute:       DW_AT_high_pc
+              Form:            DW_FORM_data4
+            - Attribute:       DW_AT_stmt_list
+              Form:            DW_FORM_sec_offset
+  debug_info:
+    - Version:         4
+      AddrSize:        4
+      Entries:
+        - AbbrCode:        0x1
+          Values:
+            - CStr:            main.c
+            - Value:           0x1000
+            - Value:           0x20
+            - Value:           0x0
+  debug_line:
+    - Version:         4
+      MinInstLength:   1
+      MaxOpsPerInst:   1
+      DefaultIsStmt:   1
+      LineBase:        251
+      LineRange:       14
+      OpcodeBase:      13
+      StandardOpcodeLengths: [ 0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 ]
+      Files:
+        - Name:            main.c
+          DirIdx:          0
+          ModTime:         0
+          Length:          0
+      Opcodes:
+        - Opcode:          DW_LNS_extended_op
+          ExtLen:          5
+          SubOpcode:       DW_LNE_set_address
+          Data:            0x1000
+        - Opcode:          DW_LNS_advance_line
+          SData:           2
+        - Opcode:          DW_LNS_copy
+        - Opcode:          DW_LNS_negate_stmt
+        - Opcode:          DW_LNS_advance_pc
+          Data:            4
+        - Opcode:          DW_LNS_advance_line
+          SData:           1
+        - Opcode:          DW_LNS_copy
+        - Opcode:          DW_LNS_advance_pc
+          Data:            4
+        - Opcode:          DW_LNS_advance_line
+          SData:           1
+        - Opcode:          DW_LNS_copy
+        - Opcode:          DW_LNS_negate_stmt
+        - Opcode:          DW_LNS_advance_pc
+          Data:            8
+        - Opcode:          DW_LNS_advance_line
+          SData:           1
+        - Opcode:          DW_LNS_copy
+        - Opcode:          DW_LNS_advance_pc
+          Data:            0x10
+        - Opcode:          DW_LNS_extended_op
+          ExtLen:          1
+          SubOpcode:       DW_LNE_end_sequence
+...
+)");
+  ASSERT_THAT_EXPECTED(ExpectedFile, llvm::Succeeded());
+  m_file.emplace(std::move(*ExpectedFile));
+  auto module_sp = std::make_shared<Module>(m_file->moduleSpec());
+
+  ArchSpec arch("primate32-unknown-unknown-elf");
+  Platform::SetHostPlatform(
+      platform_linux::PlatformLinux::CreateInstance(true, &arch));
+  m_debugger_sp = Debugger::CreateInstance();
+  ASSERT_TRUE(m_debugger_sp);
+  PlatformSP platform_sp;
+  m_debugger_sp->GetTargetList().CreateTarget(
+      *m_debugger_sp, "", arch, eLoadDependentsNo, platform_sp, m_target_sp);
+  ASSERT_TRUE(m_target_sp);
+  m_target_sp->GetImages().Append(module_sp);
+}
+
+TEST_F(ArchitecturePrimateTest, GetBreakableLoadAddress) {
+  Architecture *plugin = m_target_sp->GetArchitecturePlugin();
+  ASSERT_NE(plugin, nullptr);
+  EXPECT_EQ(plugin->GetPluginName(), "primate");
+
+  // slots move back to the first row of their packet
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x1000, *m_target_sp), 0x1000u);
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x1004, *m_target_sp), 0x1000u);
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x1008, *m_target_sp), 0x1000u);
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x100c, *m_target_sp), 0x1000u);
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x1010, *m_target_sp), 0x1010u);
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x1018, *m_target_sp), 0x1010u);
+
+  // addresses without line information stay where they are
+  EXPECT_EQ(plugin->GetBreakableLoadAddress(0x2000, *m_target_sp), 0x2000u);
+}
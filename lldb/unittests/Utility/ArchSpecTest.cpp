@@ -396,6 +396,30 @@ TEST(ArchSpecTest, Compatibility) {
   }
 }
 
+TEST(ArchSpecTest, Primate) {
+  {
+    ArchSpec A("primate32-unknown-elf");
+    ArchSpec B("primate64-unknown-elf");
+    EXPECT_EQ(ArchSpec::eCore_primate32, A.GetCore());
+    EXPECT_EQ(ArchSpec::eCore_primate64, B.GetCore());
+    EXPECT_EQ(4u, A.GetAddressByteSize());
+    EXPECT_EQ(8u, B.GetAddressByteSize());
+    EXPECT_EQ(4u, A.GetMinimumOpcodeByteSize());
+    EXPECT_FALSE(A.IsCompatibleMatch(B));
+  }
+  {
+    ArchSpec A, B;
+    A.SetArchitecture(eArchTypeELF, llvm::ELF::EM_PRIMATE,
+                      ArchSpec::ePrimateSubType_primate32,
+                      llvm::ELF::ELFOSABI_NONE);
+    B.SetArchitecture(eArchTypeELF, llvm::ELF::EM_PRIMATE,
+                      ArchSpec::ePrimateSubType_primate64,
+                      llvm::ELF::ELFOSABI_NONE);
+    EXPECT_EQ(llvm::Triple::primate32, A.GetTriple().getArch());
+    EXPECT_EQ(llvm::Triple::primate64, B.GetTriple().getArch());
+  }
+}
+
 TEST(ArchSpecTest, OperatorBool) {
   EXPECT_FALSE(ArchSpec());
   EXPECT_TRUE(ArchSpec("x86_64-pc-linux"));
@@ -17,8 +17,11 @@
 #ifndef LLVM_SUPPORT_PRIMATEATTRIBUTES_H
 #define LLVM_SUPPORT_PRIMATEATTRIBUTES_H
 
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/ELFAttributes.h"
 
+#include <string>
+
 namespace llvm {
 namespace PrimateAttrs {
 
@@ -32,12 +35,24 @@ enum AttrType : unsigned {
   PRIV_SPEC = 8,
   PRIV_SPEC_MINOR = 10,
   PRIV_SPEC_REVISION = 12,
+  // The primate.cfg an object was compiled for (text, as tag is odd).
+  CONFIG_HASH = 33,
+  CONFIG = 35,
 };
 
 enum StackAlign { ALIGN_4 = 4, ALIGN_16 = 16 };
 
 enum { NOT_ALLOWED = 0, ALLOWED = 1 };
 
+// Fingerprint of the contents of a primate.cfg: the MD5 of its non-empty
+// lines, stripped and sorted, as 16 hex digits. The image tools compute the
+// same from the primate.cfg they are given.
+std::string getConfigFingerprint(StringRef Config);
+
+// The NUM_ALUS, NUM_BFUS, ... lines of a primate.cfg, space separated, so a
+// fingerprint mismatch can say which of them differ.
+std::string getConfigSummary(StringRef Config);
+
 } // namespace PrimateAttrs
 } // namespace llvm
 
@@ -18,6 +18,7 @@
 #include <map>
 #include <math.h>
 #include <set>
+#include <string>
 #include <stdlib.h>
 
 #include "llvm/Support/Debug.h"
@@ -31,12 +32,19 @@
 
 namespace llvm {
 
+class Loop;
+class ScalarEvolution;
+
 class PrimateArchGen : public PassInfoMixin<PrimateArchGen>, 
                        public DataFlow<BitVector>, 
                        public AssemblyAnnotationWriter {
 public:
     // set forward false in the constructor DataFlow()
-    PrimateArchGen() : DataFlow<BitVector>(false) {
+    // outputDir prefixes every generated file. isStage marks the run for
+    // one pipeline stage, which is a core of its own and never joins the
+    // program family.
+    PrimateArchGen(std::string outputDir = "", bool isStage = false) 
+        : DataFlow<BitVector>(false), outputDir(outputDir), isStage(isStage) {
     }
     
     PreservedAnalyses run(Module &M, ModuleAnalysisManager& AM);
@@ -73,6 +81,23 @@ private:
     std::map<BasicBlock*, double> bbWeight;
     std::map<BasicBlock*, int> bbNumInst;
     std::map<BasicBlock*, int> bbNumVLIWInst;
+    // ops issued to the single IO unit, each takes a VLIW instruction
+    std::map<BasicBlock*, int> bbNumIOOps;
+    // cycles the busiest bank's LSU is busy, atomics count their full RMW
+    // latency
+    std::map<BasicBlock*, int> bbLSUBusy;
+    // the data memory banks, one LSU each, and the globals in them
+    std::map<GlobalVariable*, unsigned> memBankOf;
+    std::vector<std::vector<GlobalVariable*>> memBankMembers;
+    std::vector<double> memBankTraffic;
+    // loop-carried recurrences bound how fast a loop can issue no matter
+    // how many ALUs it gets
+    struct loopRec_t {
+        BasicBlock *header;
+        std::vector<BasicBlock*> blocks;
+        unsigned recMII;
+    };
+    std::vector<loopRec_t> loopRecs;
 
     int numBFs;
     std::map<std::string, std::set<Value*>*> bfu2bf;
@@ -89,6 +114,16 @@ private:
     
     int live[50];
     unsigned int n = 0;
+
+    std::string outputDir;
+    bool isStage;
+
+    // program family (-primate-family): requirements of the other programs
+    // that share the hardware, by program name, and those of this one
+    std::map<std::string, std::map<std::string, std::string>> family;
+    std::map<std::string, std::string> familyOwn;
+    std::string familyName;
+    std::map<int, double> perfCurve; // cycles per packet by ALU count
     
 public:
     static char ID;
@@ -119,6 +154,35 @@ private:
     unsigned getStructWidth(StructType &s, unsigned start, const bool arcGen);
     unsigned getTypeBitWidth(Type *ty, bool trackSizes = false);
     void printRegfileKnobs(Module &M, raw_fd_stream &primateCFG);
+    void printRegLayouts(Module &M, unsigned regWidth);
+    bool isIOOp(Instruction *ii);
+    bool isSharedAccess(Instruction *ii);
+    void printAtomicContention(Module &M, unsigned numThreads,
+                               raw_fd_stream &primateCFG);
+    void printInputChecks(Module &M);
+    // optional ALU capabilities, the bits of ALU_CAPS in primate.cfg
+    enum aluCap_t {
+        CapMul = 1,
+        CapShift = 2,
+        CapBitManip = 4,
+        CapCompare = 8
+    };
+    unsigned getALUCap(Instruction *ii);
+    bool isFieldBSwap(Instruction *ii);
+    bool addressEscapes(GlobalVariable *GV);
+    void planMemBanks(Module &M);
+    unsigned getMemBank(Instruction *ii);
+    unsigned assignMemBanks(Module &M, raw_fd_stream &primateCFG,
+                            raw_fd_stream &bankLD);
+    void printLaneCaps(Module &M, unsigned numLanes,
+                       raw_fd_stream &primateCFG);
+    void loadFamily(Module &M);
+    void mergeFamilyFields(unsigned &maxRegWidth);
+    void recordPerfCurve(Function &F, int numALU);
+    void writeFamilyROMs(raw_fd_stream &romCFG);
+    void writeFamilyModels(raw_fd_stream &modelCFG);
+    void writeFamily(Module &M);
+    unsigned getElementBitPos(StructType &s, unsigned idx);
     void generate_header(Module &M, raw_fd_stream &primateHeader);
     unsigned getMaxConst(Function &F);
     std::vector<Value*>* getBFCOutputs(Instruction *ii);
@@ -157,10 +221,14 @@ private:
     
     void VLIWSim(Function &F, int numALU);
     void initializeBBWeight(Function &F);
+    double getExpectedTripCount(Loop *L, ScalarEvolution &SE);
+    unsigned getRecMII(Loop *L);
     int evalPerf(Function &F, int numALU, double &perf, double &util);
     void numALUDSE(Function &F, int &numALU, int &numInst, int option);
     void initializeBFCMeta(Module &M);
     void generateInterconnect(int numALU, raw_fd_stream &interconnectCFG);
+    void generateROMs(Module &M, raw_fd_stream &romCFG);
+    void generateModels(Module &M, raw_fd_stream &modelCFG);
     unsigned getNumThreads(Module &M, unsigned numALU);
 
     virtual void InitializeBranchLevel(Function &F);
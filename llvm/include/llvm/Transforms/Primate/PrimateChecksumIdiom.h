@@ -0,0 +1,64 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATECHECKSUMIDIOM_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATECHECKSUMIDIOM_H
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/PassManager.h>
+
+namespace llvm {
+
+class DominatorTree;
+class Loop;
+class LoopInfo;
+class ScalarEvolution;
+
+// Recognizes software CRC and ones'-complement checksum idioms and maps them
+// onto a BFU declared for the polynomial. Handled shapes:
+//
+//   bitwise step     x' = (x >> 1) ^ (POLY & -(x & 1))   (and select forms),
+//                    unrolled chains and rolled loops of 8*k steps
+//   table step       x' = T[y & 0xff] ^ (x >> 8)         T = 8-round table
+//   checksum fold    while (s >> 16) s = (s & 0xffff) + (s >> 16);
+//
+// A BFU implements CRC polynomial POLY when its unit name is "crc_<hex POLY>"
+// (reflected form, 8 rounds per call, one input) and the checksum fold when
+// its unit name is "csum16".
+class PrimateChecksumIdiom : public PassInfoMixin<PrimateChecksumIdiom> {
+public:
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+
+private:
+    struct CRCStep {
+        Value *In;
+        APInt Poly;
+    };
+
+    bool matchLowBitSet(Value *Cond, Value *&X, bool &Inverted);
+    bool matchLowBitMask(Value *M, Value *&X);
+    bool matchCRCStep(Value *V, CRCStep &Step);
+    bool matchCRCTableStep(Instruction *I, Value *&State, Value *&Byte,
+                           APInt &Poly);
+    bool matchFold16(Value *V, Value *&S);
+
+    Function *findBFU(Module &M, StringRef UnitName, Type *Ty);
+    Value *emitCRCRounds(IRBuilder<> &B, Value *X, const APInt &Poly,
+                         unsigned Rounds);
+    Value *emitFold16(IRBuilder<> &B, Value *S);
+
+    bool collapseStepChains(Function &F);
+    bool collapseTableSteps(Function &F);
+    bool collapseFoldChains(Function &F);
+    bool collapseCRCLoop(Loop &L, DominatorTree &DT, LoopInfo &LI,
+                         ScalarEvolution &SE);
+    bool collapseFoldLoop(Loop &L, DominatorTree &DT, LoopInfo &LI,
+                          ScalarEvolution &SE);
+
+    SmallVector<Instruction *, 16> deadInsts;
+};
+
+} // namespace llvm
+
+#endif
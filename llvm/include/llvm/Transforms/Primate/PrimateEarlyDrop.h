@@ -0,0 +1,31 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATEEARLYDROP_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATEEARLYDROP_H
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+
+namespace llvm {
+
+// Ends drop paths of primate_main with llvm.primate.drop.
+//
+// A drop path is an edge P -> S where nothing has been written to the output
+// on any path reaching the end of P, and everything from S on does nothing
+// but release the packet (__primate_input_done / __primate_output_done) and
+// return. Taking such an edge produces no output, so it is redirected to a
+// block that drops the packet and retires the thread on the spot instead of
+// running the shared tail of primate_main.
+class PrimateEarlyDrop : public PassInfoMixin<PrimateEarlyDrop> {
+public:
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+    bool isReleaseOnly(BasicBlock &BB, bool &releasesOutput);
+    void findDropTails(Function &F, DenseMap<BasicBlock *, bool> &Tail);
+    void findOutputFree(Function &F, DenseMap<BasicBlock *, bool> &Free);
+};
+
+} // namespace llvm
+
+#endif
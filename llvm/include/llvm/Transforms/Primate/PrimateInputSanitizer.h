@@ -0,0 +1,58 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATEINPUTSANITIZER_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATEINPUTSANITIZER_H
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/ValueHandle.h>
+
+namespace llvm {
+
+class DominatorTree;
+class PostDominatorTree;
+
+// Checks input reads and seeks against the length of the packet.
+//
+// Every __primate_input(n) and __primate_input_seek(n) gets a check that the
+// input cursor plus n stays within __primate_input_len() before it runs.
+// Checks on the same cursor value are merged: one dominated by a check that
+// covers at least as many bytes is dropped, and one that runs whenever an
+// earlier one does is folded into it, so a header parsed field by field
+// costs a single compare and branch. A failed check drops the packet, traps,
+// or calls __primate_sanitizer_input_overflow(end, len) for host builds of
+// the program.
+class PrimateInputSanitizer : public PassInfoMixin<PrimateInputSanitizer> {
+public:
+    enum Action { Drop, Trap, Report };
+
+    // the action of -primate-input-sanitizer, drop when it is not given
+    PrimateInputSanitizer();
+    explicit PrimateInputSanitizer(Action A) : A(A) {}
+
+    // whether -primate-input-sanitizer asks for the checks
+    static bool isEnabled();
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+    static bool isRequired() { return true; }
+
+private:
+    // the input must hold End bytes past Base when At runs
+    struct Check {
+        Instruction *At;
+        WeakTrackingVH Base;
+        int64_t End;
+    };
+
+    Action A;
+
+    bool instrument(Function &F, FunctionAnalysisManager &FAM,
+                    const SmallPtrSetImpl<Function *> &Readers);
+    void merge(SmallVectorImpl<Check> &Checks, DominatorTree &DT,
+               PostDominatorTree &PDT);
+    void emit(Check &C, Value *Len);
+};
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATEMAIN_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATEMAIN_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Demangle/Demangle.h>
+#include <llvm/IR/Function.h>
+
+#include <string>
+
+namespace llvm {
+
+// Whether F is the program's primate_main, C or C++, however LTO left it.
+// Internalization keeps the name, but ThinLTO renames promoted locals to
+// <name>.llvm.<hash>, which no longer demangles.
+inline bool isPrimateMain(const Function &F) {
+    std::string name = demangle(F.getName().split('.').first);
+    return name == "primate_main" ||
+           StringRef(name).starts_with("primate_main(");
+}
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATEPIPELINEPARTITION_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATEPIPELINEPARTITION_H
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+// Splits primate_main into -primate-pipeline-stages pipeline stages, one per
+// Primate core, and sizes each core with archgen.
+//
+// Stages are cut at blocks every packet passes exactly once. Among the cut
+// points that keep the stages balanced, the one with the fewest live bits is
+// taken. State live across a cut is sent over an inter-core FIFO
+// (llvm.primate.fifo.send / llvm.primate.fifo.recv, one channel per value).
+//
+// The input module is not modified. The stages are chained back together,
+// with each FIFO turned into a plain value, and the result has to be the
+// original primate_main again, or nothing is written. For every stage k the
+// pass then writes stage<k>/primate_main.ll plus the usual archgen outputs
+// into stage<k>/, and topology.cfg describing the stages and links.
+class PrimatePipelinePartition
+    : public PassInfoMixin<PrimatePipelinePartition> {
+public:
+    // outputDir prefixes stage<k>/ and topology.cfg, as for PrimateArchGen
+    PrimatePipelinePartition(std::string outputDir = "")
+        : outputDir(outputDir) {}
+
+    // whether -primate-pipeline-stages asks for more than one stage
+    static bool isEnabled();
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+    struct StageCut {
+        BasicBlock *block;
+        unsigned prefixInsts;          // instructions executed before the cut
+        unsigned liveBits;             // state crossing the cut
+        SmallVector<Value*, 8> liveIn; // values crossing, in channel order
+    };
+
+    bool analyzeCut(Function &F, BasicBlock *B, DominatorTree &DT,
+                    StageCut &Cut);
+    void findCuts(Function &F, unsigned numStages,
+                  SmallVectorImpl<StageCut> &Cuts);
+    std::unique_ptr<Module> buildStage(Module &M, Function &F,
+                                       ArrayRef<StageCut> Cuts,
+                                       unsigned stage);
+    bool checkStages(Module &M, Function &F,
+                     ArrayRef<std::unique_ptr<Module>> Stages);
+
+    std::string outputDir;
+};
+
+} // namespace llvm
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATESPECIALIZE_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATESPECIALIZE_H
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/PassManager.h>
+
+namespace llvm {
+
+// Specializes primate_main for its dominant packet type.
+//
+// Header fields (values read out of __primate_input) that branches compare
+// against constants are profiled by the weights of those branches, which
+// come from PGO or from __builtin_expect / [[likely]]. When a few fields
+// together take their hottest values with probability at least
+// -primate-specialize-min-prob, everything after the last of them is read
+// is cloned, the clone gets the fields replaced by those values and folded,
+// and a guard comparing the fields picks the version.
+//
+// The guard branch is tagged with !primate.specialize and carries the
+// expected probability as branch weights, which archgen uses to weight the
+// two versions.
+class PrimateSpecialize : public PassInfoMixin<PrimateSpecialize> {
+public:
+    PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+
+private:
+    struct HotValue {
+        Instruction *Field;
+        ConstantInt *Value;
+        double Prob;
+    };
+
+    bool isPacketField(Value *V);
+    void collectHotValues(Function &F, SmallVectorImpl<HotValue> &Hot);
+    bool specialize(Function &F, DominatorTree &DT, ArrayRef<HotValue> Hot,
+                    double Prob);
+};
+
+} // namespace llvm
+
+#endif
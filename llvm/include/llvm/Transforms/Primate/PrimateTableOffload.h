@@ -0,0 +1,40 @@
+#ifndef LLVM_TRANSFORMS_PRIMATE_PRIMATETABLEOFFLOAD_H
+#define LLVM_TRANSFORMS_PRIMATE_PRIMATETABLEOFFLOAD_H
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassManager.h>
+
+namespace llvm {
+
+// Moves small read-only lookup tables out of rodata and into ROM backed BFUs.
+// Every load from a qualifying table with a computed index is replaced by a
+// one input BFU call that takes the index and returns the element.
+//
+// Before archgen the lookup is a call to a declared function carrying blue
+// metadata (unit name "ROM_<table>") plus a "primate.rom" node holding the
+// table contents, which archgen turns into rom.cfg and <unit>.mem. Once the
+// BFU intrinsics have been regenerated, -primate-rom-bfu-base=<N> makes the
+// same pass emit llvm.primate.BFU.<N+i> for the i-th table instead.
+class PrimateTableOffload : public PassInfoMixin<PrimateTableOffload> {
+public:
+    // With RequireBFUBase the pass only runs when ROM BFU intrinsics exist,
+    // which is how the codegen pipeline uses it.
+    PrimateTableOffload(bool RequireBFUBase = false)
+        : RequireBFUBase(RequireBFUBase) {}
+
+    PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+    bool isOffloadCandidate(GlobalVariable &GV,
+                            SmallVectorImpl<LoadInst *> &Lookups);
+    Function *getLookupFunction(Module &M, GlobalVariable &GV, unsigned Idx);
+
+    bool RequireBFUBase;
+};
+
+} // namespace llvm
+
+#endif
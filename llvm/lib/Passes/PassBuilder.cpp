@@ -176,6 +176,12 @@
 #include "llvm/Transforms/Instrumentation/ThreadSanitizer.h"
 #include "llvm/Transforms/ObjCARC.h"
 #include "llvm/Transforms/Primate/PrimateArchGen.h"
+#include "llvm/Transforms/Primate/PrimateChecksumIdiom.h"
+#include "llvm/Transforms/Primate/PrimateEarlyDrop.h"
+#include "llvm/Transforms/Primate/PrimateInputSanitizer.h"
+#include "llvm/Transforms/Primate/PrimatePipelinePartition.h"
+#include "llvm/Transforms/Primate/PrimateSpecialize.h"
+#include "llvm/Transforms/Primate/PrimateTableOffload.h"
 #include "llvm/Transforms/Scalar/ADCE.h"
 #include "llvm/Transforms/Scalar/AlignmentFromAssumptions.h"
 #include "llvm/Transforms/Scalar/AnnotationRemarks.h"
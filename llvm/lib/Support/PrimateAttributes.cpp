@@ -7,6 +7,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/PrimateAttributes.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MD5.h"
+
+#include <algorithm>
 
 using namespace llvm;
 using namespace llvm::PrimateAttrs;
@@ -18,9 +24,57 @@ static constexpr TagNameItem tagData[] = {
     {PRIV_SPEC, "Tag_priv_spec"},
     {PRIV_SPEC_MINOR, "Tag_priv_spec_minor"},
     {PRIV_SPEC_REVISION, "Tag_priv_spec_revision"},
+    {CONFIG_HASH, "Tag_config_hash"},
+    {CONFIG, "Tag_config"},
 };
 
 constexpr TagNameMap PrimateAttributeTags{tagData};
 const TagNameMap &llvm::PrimateAttrs::getPrimateAttributeTags() {
   return PrimateAttributeTags;
 }
+
+static void getConfigLines(StringRef Config, SmallVectorImpl<StringRef> &Lines) {
+  SmallVector<StringRef, 32> All;
+  Config.split(All, '\n');
+  for (StringRef Line : All) {
+    Line = Line.trim();
+    if (!Line.empty())
+      Lines.push_back(Line);
+  }
+  llvm::sort(Lines);
+}
+
+std::string llvm::PrimateAttrs::getConfigFingerprint(StringRef Config) {
+  SmallVector<StringRef, 32> Lines;
+  getConfigLines(Config, Lines);
+  MD5 Hash;
+  for (StringRef Line : Lines) {
+    Hash.update(Line);
+    Hash.update("\n");
+  }
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().substr(0, 16).str();
+}
+
+std::string llvm::PrimateAttrs::getConfigSummary(StringRef Config) {
+  static const char *const Keys[] = {"NUM_ALUS",  "NUM_BFUS",  "NUM_REGS",
+                                     "REG_WIDTH", "NUM_LSUS",  "NUM_THREADS",
+                                     "ALU_CAPS",  "FIELD_BSWAP"};
+  SmallVector<StringRef, 32> Lines;
+  getConfigLines(Config, Lines);
+  std::string Summary;
+  for (const char *Key : Keys) {
+    for (StringRef Line : Lines) {
+      auto [Name, Value] = Line.split('=');
+      if (Name != Key)
+        continue;
+      if (!Summary.empty())
+        Summary += ' ';
+      std::string Values = Value.str();
+      std::replace(Values.begin(), Values.end(), ' ', ',');
+      Summary += Name.str() + "=" + Values;
+    }
+  }
+  return Summary;
+}
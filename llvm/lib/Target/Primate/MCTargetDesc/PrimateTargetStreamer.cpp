@@ -78,6 +78,14 @@ void PrimateTargetStreamer::emitTargetAttributes(const MCSubtargetInfo &STI) {
   emitTextAttribute(PrimateAttrs::ARCH, Arch);
 }
 
+// Records which primate.cfg the object was compiled for, so tools working on
+// it for another configuration can refuse it.
+void PrimateTargetStreamer::emitConfigAttributes(StringRef Fingerprint,
+                                                 StringRef Summary) {
+  emitTextAttribute(PrimateAttrs::CONFIG_HASH, Fingerprint);
+  emitTextAttribute(PrimateAttrs::CONFIG, Summary);
+}
+
 // This part is for ascii assembly output
 PrimateTargetAsmStreamer::PrimateTargetAsmStreamer(MCStreamer &S,
                                                formatted_raw_ostream &OS)
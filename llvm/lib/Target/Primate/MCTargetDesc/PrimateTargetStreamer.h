@@ -36,6 +36,7 @@ public:
                                     StringRef StringValue);
 
   void emitTargetAttributes(const MCSubtargetInfo &STI);
+  void emitConfigAttributes(StringRef Fingerprint, StringRef Summary);
 };
 
 // This part is for ascii assembly output
@@ -53,6 +53,9 @@ void initializePrimatePacketizerPass(PassRegistry &);
 FunctionPass *createPrimateStructToRegPass();
 void initializePrimateStructToRegPassPass(PassRegistry &);
 
+FunctionPass *createPrimateISelRegionSplitPass();
+void initializePrimateISelRegionSplitPass(PassRegistry &);
+
 // PrimateOPMerge
 MachineFunctionPass *createPrimateOPMergePass();
 void initializePrimateOPMergePass(PassRegistry &);
@@ -63,6 +66,9 @@ void initializePrimateCustomSchedulePass(PassRegistry&);
 MachineFunctionPass *createPrimatePacketLegalizerPass();
 void initializePrimatePacketLegalizerPass(PassRegistry &);
 
+MachineFunctionPass *createPrimateLineRatePass();
+void initializePrimateLineRatePass(PassRegistry &);
+
 
 MachineFunctionPass *createPrimateExtMergePass();
 void initializePrimateExtMergePass(PassRegistry &);
@@ -23,15 +23,30 @@
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstr.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCDwarf.h"
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/TargetRegistry.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrimateAttributes.h"
 #include "llvm/Support/raw_ostream.h"
 #include <vector>
 using namespace llvm;
 
+// Written by archgen2tablegen.py, empty for the stock TableGen files.
+#include "PrimateConfigFingerprint.inc"
+
+static cl::opt<std::string> PrimateBuildConfig(
+    "primate-config-fingerprint", cl::Hidden,
+    cl::init(PrimateConfigFingerprint),
+    cl::desc("Fingerprint of the primate.cfg the compiler was generated "
+             "for (empty: do not record or check it)"));
+
 #define DEBUG_TYPE "asm-printer"
 
 STATISTIC(PrimateNumInstrsCompressed,
@@ -75,6 +90,8 @@ public:
 
 private:
   void emitAttributes();
+  void emitPacketSlotLoc(const MachineInstr &MI, unsigned slotIdx,
+                         bool packetStart);
 };
 }
 
@@ -433,6 +450,35 @@ void PrimateAsmPrinter::EmitToStreamer(MCStreamer &S, const MCInst &Inst) {
 // instructions) auto-generated.
 #include "PrimateGenMCPseudoLowering.inc"
 
+// The generic DWARF path only sees the BUNDLE header, so a whole packet would
+// map to one source line. Emit a line table row per slot instead: the first
+// row of a packet is the statement boundary and carries the packet address,
+// the others are told apart by a discriminator of slot + 1. A packet address
+// then maps to every source line its slots execute.
+void PrimateAsmPrinter::emitPacketSlotLoc(const MachineInstr &MI,
+                                          unsigned slotIdx, bool packetStart) {
+  const DebugLoc &DL = MI.getDebugLoc();
+  const DISubprogram *SP = MI.getMF()->getFunction().getSubprogram();
+  if (!DL || DL.getLine() == 0 || !SP ||
+      SP->getUnit()->getEmissionKind() == DICompileUnit::NoDebug)
+    return;
+
+  const DIFile *File = cast<DILocation>(DL.get())->getFile();
+  std::optional<MD5::MD5Result> Checksum;
+  if (OutContext.getDwarfVersion() >= 5)
+    if (auto CS = File->getChecksum(); CS && CS->Kind == DIFile::CSK_MD5) {
+      std::string Bytes = fromHex(CS->Value);
+      Checksum.emplace();
+      std::copy(Bytes.begin(), Bytes.end(), Checksum->data());
+    }
+  unsigned FileNo = OutStreamer->emitDwarfFileDirective(
+      0, File->getDirectory(), File->getFilename(), Checksum,
+      File->getSource(), OutContext.getDwarfCompileUnitID());
+  OutStreamer->emitDwarfLocDirective(FileNo, DL.getLine(), DL.getCol(),
+                                     packetStart ? DWARF2_FLAG_IS_STMT : 0, 0,
+                                     slotIdx + 1, File->getFilename());
+}
+
 void PrimateAsmPrinter::emitInstruction(const MachineInstr *MI) {
   Primate_MC::verifyInstructionPredicates(MI->getOpcode(), STI->getFeatureBits());
 
@@ -453,6 +499,7 @@ void PrimateAsmPrinter::emitInstruction(const MachineInstr *MI) {
     LLVM_DEBUG(dbgs() << MBB->getFullName() << " " << MBB->getName() << "\n"; MBB->printAsOperand(dbgs(), false));
     LLVM_DEBUG(dbgs() << "========== Bundle ===========\n");
     unsigned lastSlotIdx = 0;
+    bool packetStart = true;
     std::vector<const MachineInstr*> ordered_machine_instrs;
     for (++MII; MII != MBB->instr_end() && MII->isInsideBundle(); ++MII) {
       ordered_machine_instrs.push_back(&(*MII));
@@ -490,10 +537,16 @@ void PrimateAsmPrinter::emitInstruction(const MachineInstr *MI) {
           MII->dump();
         });
 
+        // the packet's first row has to start at slot 0, ahead of any nops
+        if (packetStart)
+          emitPacketSlotLoc(*MII, slotIdx, true);
         if (slotIdx > lastSlotIdx) {
           emitNops(slotIdx - lastSlotIdx);
           lastSlotIdx = slotIdx;
         }
+        if (!packetStart)
+          emitPacketSlotLoc(*MII, slotIdx, false);
+        packetStart = false;
         ++lastSlotIdx;
 
         // may need to emit multiple ops, and then advance the slot idx.
@@ -633,11 +686,29 @@ void PrimateAsmPrinter::emitEndOfAsmFile(Module &M) {
     RTS.finishAttributeSection();
 }
 
+// The instruction formats, schedule and register file of the compiler are
+// generated from one primate.cfg, and PrimateTargetLowering reads the rest of
+// the configuration from PrimateConfigFile when compiling. Objects record the
+// first; compiling against any other primate.cfg is an error.
 void PrimateAsmPrinter::emitAttributes() {
-  return;
   PrimateTargetStreamer &RTS =
       static_cast<PrimateTargetStreamer &>(*OutStreamer->getTargetStreamer());
-  RTS.emitTargetAttributes(*STI);
+  if (PrimateBuildConfig.empty())
+    return;
+  std::string Summary;
+  if (auto Config = MemoryBuffer::getFile(PrimateConfigFile, /*IsText=*/true)) {
+    StringRef Text = (*Config)->getBuffer();
+    std::string Fingerprint = PrimateAttrs::getConfigFingerprint(Text);
+    Summary = PrimateAttrs::getConfigSummary(Text);
+    if (Fingerprint != PrimateBuildConfig)
+      report_fatal_error(Twine(PrimateConfigFile) + " is primate config " +
+                             Fingerprint + " (" + Summary +
+                             ") but the compiler was generated for " +
+                             PrimateBuildConfig +
+                             ", rerun archgen2tablegen.py and rebuild it",
+                         false);
+  }
+  RTS.emitConfigAttributes(PrimateBuildConfig, Summary);
 }
 
 // Force static initialization.
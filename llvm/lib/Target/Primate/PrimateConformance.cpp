@@ -0,0 +1,240 @@
+#include "PrimateConformance.h"
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Demangle/Demangle.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "primate-conformance"
+
+// Depth first walk of the direct call graph below F. A call to a function
+// still on the stack closes a cycle, which the backend cannot execute since
+// Primate has no call stack.
+bool PrimateConformance::checkCalls(Function& F,
+                                    SmallPtrSetImpl<Function*>& onStack,
+                                    SmallPtrSetImpl<Function*>& done) {
+    bool ok = checkBody(F);
+    onStack.insert(&F);
+    for(auto& inst: instructions(F)) {
+        auto* call = dyn_cast<CallBase>(&inst);
+        if(!call || isa<IntrinsicInst>(call)) {
+            continue;
+        }
+        if(call->isInlineAsm()) {
+            continue;
+        }
+        Function* callee = call->getCalledFunction();
+        if(!callee) {
+            F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+                "Primate programs cannot call through a function pointer or "
+                "virtual method; call the function directly",
+                call->getDebugLoc()));
+            ok = false;
+            continue;
+        }
+        if(callee->isDeclaration()) {
+            continue;
+        }
+        if(onStack.count(callee)) {
+            F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+                "recursive call to '" + demangle(callee->getName()) +
+                "'; Primate has no call stack, rewrite it as a loop",
+                call->getDebugLoc()));
+            ok = false;
+            continue;
+        }
+        if(done.insert(callee).second) {
+            ok &= checkCalls(*callee, onStack, done);
+        }
+    }
+    onStack.erase(&F);
+    return ok;
+}
+
+bool PrimateConformance::checkBody(Function& F) {
+    bool ok = true;
+    for(auto& inst: instructions(F)) {
+        auto* ai = dyn_cast<AllocaInst>(&inst);
+        if(!ai || ai->isStaticAlloca()) {
+            continue;
+        }
+        F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+            ai->isArrayAllocation() && !isa<ConstantInt>(ai->getArraySize())
+                ? "variable sized allocation; Primate needs every stack "
+                  "object to have a constant size"
+                : "allocation inside a loop or after a branch; Primate needs "
+                  "every stack object to be allocated on entry",
+            ai->getDebugLoc()));
+        ok = false;
+    }
+    return ok;
+}
+
+// Counts calls to the done intrinsic along every path through F. The IO unit
+// releases the packet on the done call, so it must happen exactly once per
+// invocation and nothing may touch the IO unit after it. A drop releases
+// whatever is still held, so it completes every path that called done at
+// most once, including a drop reached both with and without the done call.
+bool PrimateConformance::checkIODone(Function& F, Intrinsic::ID doneID,
+                                     ArrayRef<Intrinsic::ID> useIDs,
+                                     StringRef doneName) {
+    // 0, 1, 2 (twice or more), 3 (0 or 1 depending on the path) or 4 (differs
+    // between paths otherwise), -1 not seen
+    enum { Many = 2, AtMostOnce = 3, Varies = 4 };
+    auto join = [](int a, int b) {
+        if(a < 0 || a == b) {
+            return b;
+        }
+        return a != Many && b != Many && a != Varies && b != Varies
+            ? int(AtMostOnce) : int(Varies);
+    };
+    auto afterDone = [](int state) {
+        return state == AtMostOnce || state == Varies
+            ? int(Varies) : std::min(state + 1, int(Many));
+    };
+    auto isCallTo = [](Instruction& inst, Intrinsic::ID id) {
+        auto* ii = dyn_cast<IntrinsicInst>(&inst);
+        return ii && ii->getIntrinsicID() == id;
+    };
+    auto isDrop = [&](Instruction& inst) {
+        return isCallTo(inst, Intrinsic::primate_drop);
+    };
+    bool used = false;
+    for(auto& inst: instructions(F)) {
+        used |= isCallTo(inst, doneID) || isDrop(inst);
+    }
+    if(!used) {
+        return true;
+    }
+
+    DenseMap<BasicBlock*, int> outState;
+    ReversePostOrderTraversal<Function*> RPOT(&F);
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(BasicBlock* bb: RPOT) {
+            int state = bb->isEntryBlock() ? 0 : -1;
+            for(BasicBlock* pred: predecessors(bb)) {
+                auto it = outState.find(pred);
+                if(it == outState.end() || it->second < 0) {
+                    continue;
+                }
+                state = join(state, it->second);
+            }
+            for(auto& inst: *bb) {
+                if(isCallTo(inst, doneID) && state >= 0) {
+                    state = afterDone(state);
+                }
+                if(isDrop(inst) && state >= 0 && state != Many &&
+                   state != Varies) {
+                    state = 1;
+                }
+            }
+            // joins only move states towards Varies, so this terminates
+            auto it = outState.find(bb);
+            if(it == outState.end() || it->second != state) {
+                outState[bb] = state;
+                changed = true;
+            }
+        }
+    }
+
+    bool ok = true;
+    std::string name = doneName.str() + "()";
+    for(BasicBlock* bb: RPOT) {
+        // the state on entry to the block, recomputed from the fixed point
+        int state = bb->isEntryBlock() ? 0 : -1;
+        for(BasicBlock* pred: predecessors(bb)) {
+            auto it = outState.find(pred);
+            if(it == outState.end() || it->second < 0) {
+                continue;
+            }
+            state = join(state, it->second);
+        }
+        for(auto& inst: *bb) {
+            bool isUse = any_of(useIDs, [&](Intrinsic::ID id) {
+                return isCallTo(inst, id);
+            });
+            if(isUse && state != 0) {
+                bool always = state == 1 || state == Many;
+                F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+                    "IO access " + Twine(always ? "happens" : "may happen") +
+                    " after " + name + " released the packet",
+                    inst.getDebugLoc()));
+                ok = false;
+            }
+            if(isCallTo(inst, doneID)) {
+                state = afterDone(state);
+            }
+            if(isDrop(inst) && (state == Many || state == Varies)) {
+                F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+                    name + Twine(state == Many ? " is" : " may be") +
+                    " called more than once before this drop; call it at "
+                    "most once",
+                    inst.getDebugLoc()));
+                ok = false;
+            }
+            if(isDrop(inst) && state != Many && state != Varies) {
+                state = 1;
+            }
+            if(!isa<ReturnInst>(inst) || state == 1) {
+                continue;
+            }
+            std::string msg =
+                state == 0 ? name + " is not called on this path to the return"
+                : state == Many ? name + " is called more than once before "
+                                  "this return; call it exactly once"
+                : name + " is only called on some paths to this return; "
+                  "call it exactly once on every path";
+            F.getContext().diagnose(DiagnosticInfoUnsupported(F, msg,
+                                                              inst.getDebugLoc()));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+PreservedAnalyses PrimateConformance::run(Module& M, ModuleAnalysisManager& MAM) {
+    Function* mainFunc = nullptr;
+    for(auto& F: M) {
+        if(!F.isDeclaration() && isPrimateMain(F)) {
+            mainFunc = &F;
+        }
+    }
+    // libraries compiled on their own have nothing to check yet
+    if(!mainFunc) {
+        LLVM_DEBUG(dbgs() << "no primate_main in " << M.getName() << "\n";);
+        return PreservedAnalyses::all();
+    }
+
+    SmallPtrSet<Function*, 16> onStack;
+    SmallPtrSet<Function*, 16> done;
+    done.insert(mainFunc);
+    bool ok = checkCalls(*mainFunc, onStack, done);
+    ok &= checkIODone(*mainFunc, Intrinsic::primate_input_done,
+                      {Intrinsic::primate_input, Intrinsic::primate_input_seek,
+                       Intrinsic::primate_input_len},
+                      "__primate_input_done");
+    ok &= checkIODone(*mainFunc, Intrinsic::primate_output_done,
+                      {Intrinsic::primate_output, Intrinsic::primate_output_seek},
+                      "__primate_output_done");
+
+    // The backend would crash or silently fall back to memory on any of the
+    // above. The errors are already reported, so the driver fails with its
+    // error count; drop the bodies so that nothing after this compiles them.
+    if(!ok) {
+        for(auto& F: M) {
+            if(!F.isDeclaration()) {
+                F.deleteBody();
+            }
+        }
+        return PreservedAnalyses::none();
+    }
+    return PreservedAnalyses::all();
+}
@@ -0,0 +1,43 @@
+//===-- PrimateConformance.h - Primate Program Conformance Checks --*- C++ -*-=//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Reject programs the Primate backend and archgen cannot handle before they
+// get there. Everything reachable from primate_main is checked for recursion,
+// indirect calls and variable sized allocas, and primate_main for calling
+// the IO done intrinsics exactly once on every path. Violations are reported
+// as errors at the offending source location, and the bodies of a module
+// with errors are dropped instead of passed on to codegen.
+//
+/// \file
+//===----------------------------------------------------------------------===//
+
+#ifndef PRIMATE_CONFORMANCE_H
+#define PRIMATE_CONFORMANCE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+  struct PrimateConformance : public PassInfoMixin<PrimateConformance> {
+    PrimateConformance() {}
+
+    PreservedAnalyses run(Module&, ModuleAnalysisManager&);
+    static bool isRequired() { return true; }
+
+  private:
+    bool checkCalls(Function& F, SmallPtrSetImpl<Function*>& onStack,
+                    SmallPtrSetImpl<Function*>& done);
+    bool checkBody(Function& F);
+    bool checkIODone(Function& F, Intrinsic::ID doneID,
+                     ArrayRef<Intrinsic::ID> useIDs, StringRef doneName);
+  };
+}
+
+#endif
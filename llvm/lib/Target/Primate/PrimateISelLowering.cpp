@@ -20,6 +20,7 @@
 #include "PrimateTargetMachine.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
@@ -30,6 +31,7 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/IntrinsicsPrimate.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/KnownBits.h"
@@ -45,6 +47,11 @@ using namespace llvm;
 
 STATISTIC(NumTailCalls, "Number of tail calls");
 
+// The driver points this at <dir>/primate.cfg for --primate-config=<dir>.
+cl::opt<std::string> llvm::PrimateConfigFile(
+    "primate-config", cl::Hidden, cl::init("primate.cfg"),
+    cl::desc("Architecture configuration written by archgen"));
+
 PrimateTargetLowering::PrimateTargetLowering(const TargetMachine &TM,
                                          const PrimateSubtarget &STI)
     : TargetLowering(TM), Subtarget(STI) {
@@ -412,9 +419,23 @@ PrimateTargetLowering::PrimateTargetLowering(const TargetMachine &TM,
   if (Subtarget.is64Bit())
     setOperationAction(ISD::INTRINSIC_WO_CHAIN, MVT::i32, Custom);
 
+  // Primate memory model: the NUM_THREADS barrel threads of a core share one
+  // in-order LSU. It performs accesses one at a time in issue order, and an
+  // AMO is a single LSU operation that reads, modifies and writes back a word
+  // before the next access from any thread. So aligned XLEN accesses are
+  // atomic, every ordering is already sequentially consistent, fences only
+  // have to stop the compiler from reordering, and atomicrmw/cmpxchg on a
+  // word are single AMOs. Sub-word and nand RMWs become an AMOCAS loop, which
+  // only retries when another thread changed the word in between.
+  //
+  // With one LSU per data memory bank (NUM_LSUS > 1) each LSU is still in
+  // order, but accesses to different banks are not ordered with each other.
+  // Fences are then real FENCEs, which wait for every LSU, and orderings
+  // stronger than monotonic get them too (see shouldInsertFencesForAtomic).
   if (Subtarget.hasStdExtA()) {
     setMaxAtomicSizeInBitsSupported(Subtarget.getXLen());
     setMinCmpXchgSizeInBits(32);
+    setOperationAction(ISD::ATOMIC_FENCE, MVT::Other, Custom);
   } else {
     setMaxAtomicSizeInBitsSupported(0);
   }
@@ -874,6 +895,10 @@ PrimateTargetLowering::PrimateTargetLowering(const TargetMachine &TM,
   setTargetDAGCombine(ISD::XOR);
   setTargetDAGCombine(ISD::ANY_EXTEND);
   setTargetDAGCombine(ISD::ZERO_EXTEND);
+  setTargetDAGCombine(ISD::INSERT_VALUE);
+  setTargetDAGCombine(ISD::SRL);
+  setTargetDAGCombine(ISD::INTRINSIC_W_CHAIN);
+  setTargetDAGCombine(ISD::BSWAP);
   if (Subtarget.hasStdExtV()) {
     setTargetDAGCombine(ISD::FCOPYSIGN);
     setTargetDAGCombine(ISD::MGATHER);
@@ -886,9 +911,9 @@ PrimateTargetLowering::PrimateTargetLowering(const TargetMachine &TM,
   int bfucount = 0;
   // Need to read in the archgen params for the reg file.
   dbgs() << "reading in register indexing parameters\n";
-  std::ifstream archgenParams ("primate.cfg");
+  std::ifstream archgenParams (PrimateConfigFile);
   if(!archgenParams.good()) {
-    errs() << "primate.cfg not found! any default we try will be bad. (Run arch-gen?)\n";
+    errs() << PrimateConfigFile << " not found! any default we try will be bad. (Run arch-gen?)\n";
     errs() << "This better not run the backend!\n";
   }
   else {
@@ -920,10 +945,38 @@ PrimateTargetLowering::PrimateTargetLowering(const TargetMachine &TM,
 	dbgs() << "number of ALUs found: " << alucount << "\n";
       }
       else if(name == "NUM_BFUS") {
-	bfucount = std::stoi(value) + 2;
+	bfucount = std::stoi(value) + 1; // IO and the LSUs are hidden
 	dbgs() << "number of BFUs found: " << bfucount << "\n";
       }
+      else if(name == "NUM_THREADS") {
+	numThreads = std::stoi(value);
+      }
+      else if(name == "NUM_LSUS") {
+	numLSUs = std::stoi(value);
+	dbgs() << "number of LSUs found: " << numLSUs << "\n";
+	// one PseudoMemBank per bank tells the packetizer which LSU to use
+	if (numLSUs > 4)
+	  report_fatal_error(Twine("Primate: ") + PrimateConfigFile + " has " +
+			     Twine(numLSUs) + " LSUs, the backend supports "
+			     "up to 4 data memory banks",
+			     false);
+      }
+      else if(name == "MEM_BANKS") {
+	// global:bank pairs for every global the program accesses
+	auto iss = std::istringstream{value};
+	auto str = std::string{};
+
+	while (iss >> str) {
+	  size_t colon = str.rfind(':');
+	  if (colon != std::string::npos)
+	    memBanks[str.substr(0, colon)] = std::stoi(str.substr(colon + 1));
+	}
+      }
+      else if(name == "FIELD_BSWAP") {
+	fieldBSwap = std::stoi(value) != 0;
+      }
     }
+    bfucount += numLSUs;
   }
 
   int functionalUnitIdx = 0;
@@ -979,62 +1032,111 @@ PrimateTargetLowering::PrimateTargetLowering(const TargetMachine &TM,
   slotToFUIndex[slotIdx] = functionalUnitIdx;
 }
 
-bool PrimateTargetLowering::supportedArray(ArrayType &ATy, int bitpos) const {
-  uint64_t ele = ATy.getNumElements();
-  auto eTy = ATy.getElementType();
-  if(!(eTy->isSized())) {
-    llvm_unreachable("struct contains elements that are unsized types");
-  }
-  // array types need to access individual elements
-  if(auto aty = dyn_cast<ArrayType>(eTy)) {
-    if(!supportedArray(*aty, bitpos))
-      return false;
-  }
-  else if(auto sty = dyn_cast<StructType>(eTy)) {
-    if(!supportedAggregate(*sty, bitpos))
-      return false;
-  }
-  else {
-    if(find(allSizes.begin(), allSizes.end(), eTy->getScalarSizeInBits()) == allSizes.end()) {
-      LLVM_DEBUG(dbgs() << "array failed to match regs due to element size unsupported\n";);
-      return false;
+// The data memory bank (and so the LSU) a load or store goes to. The stack,
+// constant pools and pointers that cannot be followed use bank 0, which is
+// where archgen keeps everything it could not separate; globals use the bank
+// MEM_BANKS gives them. Archgen maps accesses the same way, through every
+// object a pointer may reach, so an access left without exactly one bank
+// means primate.cfg was generated for another program. Issuing it on a
+// guessed LSU would read the wrong memory, so that is an error.
+unsigned PrimateTargetLowering::getMemBank(const MachineInstr &MI) const {
+  if (numLSUs <= 1)
+    return 0;
+  auto fail = [&](const Twine &Why) {
+    report_fatal_error("Primate: " + Twine(MI.getMF()->getName()) +
+                           ": cannot tell the memory bank of an access: " +
+                           Why + "; rerun archgen for this program",
+                       false);
+  };
+  if (MI.memoperands_empty())
+    fail("no memory operand");
+
+  std::optional<unsigned> bank;
+  auto use = [&](unsigned b) {
+    if (bank && *bank != b)
+      fail("it may reach banks " + Twine(*bank) + " and " + Twine(b));
+    bank = b;
+  };
+  for (const MachineMemOperand *MMO : MI.memoperands()) {
+    if (MMO->getPseudoValue()) {
+      use(0);
+      continue;
     }
-    if(find(allPoses.begin(), allPoses.end(), bitpos) == allPoses.end()) {
-      LLVM_DEBUG(dbgs() << "array failed to match regs due to element offset unsupported\n";);
-      return false;
+    const Value *V = MMO->getValue();
+    if (!V)
+      fail("its memory operand has no value");
+    SmallVector<const Value *, 4> objs;
+    getUnderlyingObjects(V, objs);
+    for (const Value *obj : objs) {
+      auto *GV = dyn_cast<GlobalValue>(obj);
+      if (!GV) {
+        use(0);
+        continue;
+      }
+      auto it = memBanks.find(GV->getName().str());
+      if (it == memBanks.end())
+        fail("@" + GV->getName() + " is not in MEM_BANKS");
+      if (it->second >= numLSUs)
+        fail("@" + GV->getName() + " is in bank " + Twine(it->second) +
+             " of " + Twine(numLSUs));
+      use(it->second);
     }
   }
-  bitpos += eTy->getScalarSizeInBits() * ele;
-  return true;
+  return bank.value_or(0);
+}
+
+bool PrimateTargetLowering::supportedArray(ArrayType &ATy, int bitpos) const {
+  SmallVector<unsigned, 4> path;
+  return getUnsupportedFieldReason(ATy, path, bitpos).empty();
 }
 
 bool PrimateTargetLowering::supportedAggregate(StructType &STy, int bitpos) const {
-  for(Type* eTy: STy.elements()) {
-    if(!(eTy->isSized())) {
-      llvm_unreachable("struct contains elements that are unsized types");
-    }
-    // array types need to access individual elements
-    if(auto aty = dyn_cast<ArrayType>(eTy)) {
-      if(!supportedArray(*aty, bitpos))
-        return false;
-    }
-    else if(auto sty = dyn_cast<StructType>(eTy)) {
-      if(!supportedAggregate(*sty, bitpos))
-        return false;
-    }
-    else {
-      if(find(allSizes.begin(), allSizes.end(), eTy->getScalarSizeInBits()) == allSizes.end()) {
-        LLVM_DEBUG(dbgs() << "struct failed to match regs due to element size unsupported\n";);
-        return false;
-      }
-      if(find(allPoses.begin(), allPoses.end(), bitpos) == allPoses.end()) {
-        LLVM_DEBUG(dbgs() << "struct failed to match regs due to element offset unsupported\n";);
-        return false;
-      }
+  SmallVector<unsigned, 4> path;
+  return getUnsupportedFieldReason(STy, path, bitpos).empty();
+}
+
+// Returns why Ty cannot be held in a wide register, or an empty string if it
+// can. Every scalar leaf needs a register field of its width at its bit
+// position; arrays are checked through their first element. On failure path
+// holds the element indices leading to the offending leaf.
+std::string PrimateTargetLowering::getUnsupportedFieldReason(
+    Type &Ty, SmallVectorImpl<unsigned> &path, int bitpos) const {
+  if(!(Ty.isSized())) {
+    llvm_unreachable("struct contains elements that are unsized types");
+  }
+  // array types need to access individual elements
+  if(auto aty = dyn_cast<ArrayType>(&Ty)) {
+    path.push_back(0);
+    std::string reason = getUnsupportedFieldReason(*aty->getElementType(), path, bitpos);
+    if(reason.empty())
+      path.pop_back();
+    return reason;
+  }
+  if(auto sty = dyn_cast<StructType>(&Ty)) {
+    for(unsigned i = 0; i < sty->getNumElements(); i++) {
+      Type *eTy = sty->getElementType(i);
+      path.push_back(i);
+      std::string reason = getUnsupportedFieldReason(*eTy, path, bitpos);
+      if(!reason.empty())
+        return reason;
+      path.pop_back();
+      bitpos += eTy->getScalarSizeInBits();
     }
-    bitpos += eTy->getScalarSizeInBits();
+    return "";
   }
-  return true;
+
+  unsigned size = Ty.getScalarSizeInBits();
+  if(find(allSizes.begin(), allSizes.end(), size) == allSizes.end()) {
+    LLVM_DEBUG(dbgs() << "aggregate failed to match regs due to element size unsupported\n";);
+    if(size == 0)
+      return "a field of this type cannot be held in a register";
+    return "no register field is " + std::to_string(size) + " bits wide";
+  }
+  if(find(allPoses.begin(), allPoses.end(), bitpos) == allPoses.end()) {
+    LLVM_DEBUG(dbgs() << "aggregate failed to match regs due to element offset unsupported\n";);
+    return "no register field starts at bit " + std::to_string(bitpos);
+  }
+  return "";
 }
 
 EVT PrimateTargetLowering::getSetCCResultType(const DataLayout &DL,
@@ -2260,6 +2362,13 @@ SDValue PrimateTargetLowering::LowerOperation(SDValue Op,
   switch (Op.getOpcode()) {
   default:
     report_fatal_error("unimplemented operand");
+  case ISD::ATOMIC_FENCE:
+    // One LSU accesses memory in issue order, the fence only orders the
+    // compiler. The LSUs of different banks need the FENCE.
+    if (numLSUs > 1)
+      return Op;
+    return DAG.getNode(ISD::MEMBARRIER, SDLoc(Op), MVT::Other,
+                       Op.getOperand(0));
   case ISD::GlobalAddress:
     return lowerGlobalAddress(Op, DAG);
   case ISD::BlockAddress:
@@ -3892,6 +4001,7 @@ SDValue PrimateTargetLowering::LowerINTRINSIC_VOID(SDValue Op,
   default:
     LLVM_DEBUG(dbgs()<< "no custom lower for this void intrin\n");
     return Op;
+  case Intrinsic::primate_fifo_send:
   case Intrinsic::primate_output:{
     if(hasChain) {
       SDValue chain  = Op.getOperand(0);
@@ -3948,6 +4058,23 @@ SDValue PrimateTargetLowering::LowerINTRINSIC_W_CHAIN(SDValue Op,
       llvm_unreachable("primate input with chain not implemented");
     }
   }
+  case Intrinsic::primate_fifo_recv:{
+    SDValue chain   = Op.getOperand(0);
+    SDValue intrin  = Op.getOperand(1);
+    SDValue channel = Op.getOperand(2);
+
+    if(Op.getValueType() == MVT::Primate_aggregate) {
+      return Op;
+    }
+
+    // receive the whole register and pull the scalar field out of it
+    EVT returnType = Op.getValueType();
+    unsigned int fieldSpec = getScalarField(returnType.getFixedSizeInBits());
+    SmallVector<EVT> retTypes = {MVT::Primate_aggregate, MVT::Other};
+    SDValue recv = DAG.getNode(ISD::INTRINSIC_W_CHAIN, DL, retTypes, {chain, intrin, channel});
+    SDValue extract = DAG.getNode(ISD::EXTRACT_VALUE, DL, returnType, recv, DAG.getConstant(fieldSpec, DL, MVT::i32));
+    return DAG.getMergeValues({extract, recv.getValue(1)}, DL);
+  }
   default:
     LLVM_DEBUG(dbgs() << "no custom lower for this chain intrin\n");
     return Op;
@@ -5495,6 +5622,7 @@ void PrimateTargetLowering::ReplaceNodeResults(SDNode *N,
     default:
       llvm_unreachable(
           "Don't know how to custom type legalize this intrinsic!");
+    case Intrinsic::primate_fifo_recv:
     case Intrinsic::primate_input: {
       SmallVector<SDValue> ops = {N->getOperand(0), N->getOperand(1), N->getOperand(2)};
       SmallVector<EVT> retTypes = {MVT::Primate_aggregate, MVT::Other};
@@ -6189,6 +6317,267 @@ static SDValue performANY_EXTENDCombine(SDNode *N,
   return SDValue(N, 0);
 }
 
+// A multi-result BFU writes all of its results into one WIDEREG. Copying
+// them field by field into another aggregate is a chain of
+//   (insert_value ... (extract_value R, i) ..., i)
+// on top of undef or R itself. Every field either comes from R at the same
+// position or is undefined, so the chain is just R and the consumer reads
+// the BFU's destination fields directly.
+static SDValue performINSERT_VALUECombine(SDNode *N,
+                                          TargetLowering::DAGCombinerInfo &DCI) {
+  SDValue Src;
+  SDValue Agg(N, 0);
+  while (Agg.getOpcode() == ISD::INSERT_VALUE) {
+    SDValue Val = Agg.getOperand(1);
+    auto *Idx = dyn_cast<ConstantSDNode>(Agg.getOperand(2));
+    if (Val.getOpcode() != ISD::EXTRACT_VALUE || !Idx)
+      return SDValue();
+    auto *SrcIdx = dyn_cast<ConstantSDNode>(Val.getOperand(1));
+    if (!SrcIdx || SrcIdx->getZExtValue() != Idx->getZExtValue())
+      return SDValue();
+    if (!Src)
+      Src = Val.getOperand(0);
+    else if (Src != Val.getOperand(0))
+      return SDValue();
+    // Intermediate inserts with other users must stay materialized.
+    if (Agg.getNode() != N && !Agg.hasOneUse())
+      return SDValue();
+    Agg = Agg.getOperand(0);
+  }
+  if (!Src || Src.getValueType() != N->getValueType(0))
+    return SDValue();
+  if (!Agg.isUndef() && Agg != Src)
+    return SDValue();
+  return Src;
+}
+
+// clang reads a bit-field as a shift and mask of its storage unit:
+//   (and (srl (extract_value R, F), C), 2^W-1)
+// When the register file has a field for bits [pos(F)+C, pos(F)+C+W) (archgen
+// adds one for every bit-field of a #pragma primate reg struct), that is a
+// single extract of the narrower field. EXTRACT zero fills above the field,
+// so the mask goes away with the shift.
+static SDValue performBitFieldExtractCombine(SDNode *N,
+                                             TargetLowering::DAGCombinerInfo &DCI,
+                                             const PrimateTargetLowering &TLI) {
+  EVT VT = N->getValueType(0);
+  if (!VT.isScalarInteger())
+    return SDValue();
+
+  SDValue Val(N, 0);
+  uint64_t Width = VT.getSizeInBits();
+  if (Val.getOpcode() == ISD::AND) {
+    auto *Mask = dyn_cast<ConstantSDNode>(Val.getOperand(1));
+    if (!Mask || !isMask_64(Mask->getZExtValue()))
+      return SDValue();
+    Width = llvm::countr_one(Mask->getZExtValue());
+    Val = Val.getOperand(0);
+  }
+  uint64_t Shift = 0;
+  if (Val.getOpcode() == ISD::SRL) {
+    auto *Amt = dyn_cast<ConstantSDNode>(Val.getOperand(1));
+    if (!Amt)
+      return SDValue();
+    Shift = Amt->getZExtValue();
+    Val = Val.getOperand(0);
+  }
+  // Only the bits of the narrowest type on the way down are meaningful.
+  while (Val.getOpcode() == ISD::ZERO_EXTEND ||
+         Val.getOpcode() == ISD::ANY_EXTEND ||
+         Val.getOpcode() == ISD::TRUNCATE) {
+    uint64_t Bits = Val.getOpcode() == ISD::TRUNCATE
+                        ? Val.getValueSizeInBits()
+                        : Val.getOperand(0).getValueSizeInBits();
+    if (Bits <= Shift)
+      return SDValue();
+    Width = std::min(Width, Bits - Shift);
+    Val = Val.getOperand(0);
+  }
+  if (Val.getOpcode() != ISD::EXTRACT_VALUE || !Val.getValueType().isInteger())
+    return SDValue();
+  auto *Spec = dyn_cast<ConstantSDNode>(Val.getOperand(1));
+  unsigned Pos, Size;
+  if (!Spec || !TLI.decodeFieldSpec(Spec->getZExtValue(), Pos, Size) ||
+      Shift >= Size)
+    return SDValue();
+  Width = std::min<uint64_t>(Width, Size - Shift);
+  if (Shift == 0 && Width == Size)
+    return SDValue();
+  std::optional<unsigned> NewSpec = TLI.getFieldSpec(Pos + Shift, Width);
+  if (!NewSpec)
+    return SDValue();
+
+  SelectionDAG &DAG = DCI.DAG;
+  SDLoc DL(N);
+  return DAG.getNode(ISD::EXTRACT_VALUE, DL, VT, Val.getOperand(0),
+                     DAG.getConstant(*NewSpec, DL, MVT::i32));
+}
+
+// The store side of a bit-field is a read-modify-write of its storage unit:
+//   (insert_value R, (or (and (extract_value R, F), ~(M << C)),
+//                        (shl (and X, M), C)), F)
+// With a field for the bit-field's bits this is (insert_value R, X, F').
+// clang drops the (and X, M) when the shift already clears the high bits,
+// and the shl when C is 0. When the cleared bits are the high ones the and
+// is a mask of the low bits, which the extract combine may already have
+// turned into (extract_value R, F'') of the field's low bits.
+static SDValue performBitFieldInsertCombine(SDNode *N,
+                                            TargetLowering::DAGCombinerInfo &DCI,
+                                            const PrimateTargetLowering &TLI) {
+  SDValue Agg = N->getOperand(0);
+  SDValue Val = N->getOperand(1);
+  auto *Spec = dyn_cast<ConstantSDNode>(N->getOperand(2));
+  unsigned Pos, Size;
+  if (!Spec || Val.getOpcode() != ISD::OR || !Val.hasOneUse() ||
+      !TLI.decodeFieldSpec(Spec->getZExtValue(), Pos, Size) || Size > 64)
+    return SDValue();
+
+  for (unsigned Old = 0; Old != 2; ++Old) {
+    SDValue Clear = Val.getOperand(Old);
+    SDValue Ins = Val.getOperand(1 - Old);
+    // the bits of F the write keeps
+    uint64_t Keep;
+    if (Clear.getOpcode() == ISD::AND &&
+        Clear.getOperand(0).getOpcode() == ISD::EXTRACT_VALUE &&
+        Clear.getOperand(0).getOperand(0) == Agg &&
+        Clear.getOperand(0).getOperand(1) == N->getOperand(2) &&
+        isa<ConstantSDNode>(Clear.getOperand(1))) {
+      Keep = Clear.getConstantOperandVal(1);
+    } else if (Clear.getOpcode() == ISD::EXTRACT_VALUE &&
+               Clear.getOperand(0) == Agg &&
+               isa<ConstantSDNode>(Clear.getOperand(1))) {
+      unsigned KeepPos, KeepSize;
+      if (!TLI.decodeFieldSpec(Clear.getConstantOperandVal(1), KeepPos,
+                               KeepSize) ||
+          KeepPos != Pos || KeepSize >= Size)
+        continue;
+      Keep = maskTrailingOnes<uint64_t>(KeepSize);
+    } else {
+      continue;
+    }
+
+    uint64_t Shift = 0;
+    if (Ins.getOpcode() == ISD::SHL) {
+      auto *Amt = dyn_cast<ConstantSDNode>(Ins.getOperand(1));
+      if (!Amt || Amt->getZExtValue() >= Size)
+        continue;
+      Shift = Amt->getZExtValue();
+      Ins = Ins.getOperand(0);
+    }
+    uint64_t Width = Size - Shift;
+    if (Ins.getOpcode() == ISD::AND) {
+      auto *Mask = dyn_cast<ConstantSDNode>(Ins.getOperand(1));
+      if (Mask && isMask_64(Mask->getZExtValue())) {
+        Width = std::min<uint64_t>(Width, llvm::countr_one(Mask->getZExtValue()));
+        Ins = Ins.getOperand(0);
+      }
+    }
+    if (Shift == 0 && Width == Size)
+      continue;
+    // The cleared bits have to be exactly the ones being written.
+    uint64_t FieldMask = maskTrailingOnes<uint64_t>(Size);
+    uint64_t BitsMask = maskTrailingOnes<uint64_t>(Width) << Shift;
+    if ((Keep & FieldMask) != (~BitsMask & FieldMask))
+      continue;
+    std::optional<unsigned> NewSpec = TLI.getFieldSpec(Pos + Shift, Width);
+    if (!NewSpec)
+      continue;
+
+    SelectionDAG &DAG = DCI.DAG;
+    SDLoc DL(N);
+    return DAG.getNode(ISD::INSERT_VALUE, DL, N->getValueType(0), Agg, Ins,
+                       DAG.getConstant(*NewSpec, DL, MVT::i32));
+  }
+  return SDValue();
+}
+
+// Network order fields are read with ntohs/ntohl:
+//   (bswap (extract_value R, F))
+// possibly through a truncate of a wider extract. When the extract units swap
+// bytes (FIELD_BSWAP in primate.cfg) and F is exactly as wide as the swap,
+// that is one EXTRACT_SWAP instead of an extract and an ALU op.
+static SDValue performFieldBSwapExtractCombine(SDNode *N,
+                                               TargetLowering::DAGCombinerInfo &DCI,
+                                               const PrimateTargetLowering &TLI) {
+  EVT VT = N->getValueType(0);
+  MVT XLenVT = TLI.getSubtarget().getXLenVT();
+  if (!TLI.hasFieldBSwap() || !VT.isScalarInteger() ||
+      VT.getSizeInBits() > XLenVT.getSizeInBits())
+    return SDValue();
+
+  SDValue Val = N->getOperand(0);
+  if (Val.getOpcode() == ISD::TRUNCATE)
+    Val = Val.getOperand(0);
+  if (Val.getOpcode() != ISD::EXTRACT_VALUE || !Val.getValueType().isInteger())
+    return SDValue();
+  auto *Spec = dyn_cast<ConstantSDNode>(Val.getOperand(1));
+  unsigned Pos, Size;
+  if (!Spec || !TLI.decodeFieldSpec(Spec->getZExtValue(), Pos, Size) ||
+      Size != VT.getSizeInBits())
+    return SDValue();
+
+  SelectionDAG &DAG = DCI.DAG;
+  SDLoc DL(N);
+  SDValue Swap = DAG.getNode(PrimateISD::EXTRACT_SWAP, DL, XLenVT,
+                             Val.getOperand(0), Val.getOperand(1));
+  return DAG.getZExtOrTrunc(Swap, DL, VT);
+}
+
+// The write side, htons/htonl into a field:
+//   (insert_value R, (bswap X), F)
+// possibly through an extend to the field's type, is one INSERT_SWAP.
+static SDValue performFieldBSwapInsertCombine(SDNode *N,
+                                              TargetLowering::DAGCombinerInfo &DCI,
+                                              const PrimateTargetLowering &TLI) {
+  MVT XLenVT = TLI.getSubtarget().getXLenVT();
+  SDValue Val = N->getOperand(1);
+  auto *Spec = dyn_cast<ConstantSDNode>(N->getOperand(2));
+  unsigned Pos, Size;
+  if (!TLI.hasFieldBSwap() || !Spec ||
+      N->getValueType(0) != MVT::Primate_aggregate ||
+      !TLI.decodeFieldSpec(Spec->getZExtValue(), Pos, Size))
+    return SDValue();
+
+  if (Val.getOpcode() == ISD::ZERO_EXTEND || Val.getOpcode() == ISD::ANY_EXTEND)
+    Val = Val.getOperand(0);
+  if (Val.getOpcode() != ISD::BSWAP || Val.getValueSizeInBits() != Size ||
+      Size > XLenVT.getSizeInBits())
+    return SDValue();
+
+  SelectionDAG &DAG = DCI.DAG;
+  SDLoc DL(N);
+  SDValue Ins = DAG.getAnyExtOrTrunc(Val.getOperand(0), DL, XLenVT);
+  return DAG.getNode(PrimateISD::INSERT_SWAP, DL, MVT::Primate_aggregate,
+                     N->getOperand(0), Ins, N->getOperand(2));
+}
+
+// Parsing past a variable length header is a seek by a computed byte count
+// followed by a fixed size read of the next header. The IO unit takes one op
+// per packet, so when nothing uses the cursor the seek returns, both are issued
+// as a single INPUT_SEEK_READ.
+static SDValue performInputSeekReadCombine(SDNode *N,
+                                           TargetLowering::DAGCombinerInfo &DCI) {
+  if (N->getConstantOperandVal(1) != Intrinsic::primate_input ||
+      N->getValueType(0) != MVT::Primate_aggregate)
+    return SDValue();
+  auto *Bytes = dyn_cast<ConstantSDNode>(N->getOperand(2));
+  SDValue Seek = N->getOperand(0);
+  if (!Bytes || !isInt<12>(Bytes->getSExtValue()) ||
+      Seek.getOpcode() != ISD::INTRINSIC_W_CHAIN ||
+      Seek.getConstantOperandVal(1) != Intrinsic::primate_input_seek ||
+      Seek.getResNo() != 1 || !Seek.hasOneUse() ||
+      !Seek.getNode()->hasNUsesOfValue(0, 0))
+    return SDValue();
+
+  SelectionDAG &DAG = DCI.DAG;
+  SDLoc DL(N);
+  SDValue SeekRead = DAG.getNode(
+      PrimateISD::INPUT_SEEK_READ, DL,
+      DAG.getVTList(MVT::Primate_aggregate, MVT::Other),
+      {Seek.getOperand(0), Seek.getOperand(2), SDValue(Bytes, 0)});
+  return DCI.CombineTo(N, SeekRead.getValue(0), SeekRead.getValue(1));
+}
+
 SDValue PrimateTargetLowering::PerformDAGCombine(SDNode *N,
                                                DAGCombinerInfo &DCI) const {
   SelectionDAG &DAG = DCI.DAG;
@@ -6196,6 +6585,20 @@ SDValue PrimateTargetLowering::PerformDAGCombine(SDNode *N,
   switch (N->getOpcode()) {
   default:
     break;
+  case ISD::INSERT_VALUE:
+    if (SDValue V = performFieldBSwapInsertCombine(N, DCI, *this))
+      return V;
+    if (SDValue V = performBitFieldInsertCombine(N, DCI, *this))
+      return V;
+    return performINSERT_VALUECombine(N, DCI);
+  case ISD::BSWAP:
+    return performFieldBSwapExtractCombine(N, DCI, *this);
+  case ISD::SRL:
+    if (SDValue V = performBitFieldExtractCombine(N, DCI, *this))
+      return V;
+    break;
+  case ISD::INTRINSIC_W_CHAIN:
+    return performInputSeekReadCombine(N, DCI);
   case PrimateISD::SplitF64: {
     SDValue Op0 = N->getOperand(0);
     // If the input to SplitF64 is just BuildPairF64 then the operation is
@@ -6408,6 +6811,8 @@ SDValue PrimateTargetLowering::PerformDAGCombine(SDNode *N,
                        DAG.getConstant(~SignBit, DL, MVT::i64));
   }
   case ISD::AND:
+    if (SDValue V = performBitFieldExtractCombine(N, DCI, *this))
+      return V;
     return performANDCombine(N, DCI, Subtarget);
   case ISD::OR:
     return performORCombine(N, DCI, Subtarget);
@@ -7323,6 +7728,24 @@ static const MCPhysReg ArgVRM2s[] = {Primate::V8M2,  Primate::V10M2, Primate::V1
 static const MCPhysReg ArgVRM4s[] = {Primate::V8M4, Primate::V12M4, Primate::V16M4,
                                      Primate::V20M4};
 static const MCPhysReg ArgVRM8s[] = {Primate::V8M8, Primate::V16M8};
+// The wide registers holding the argument GPRs.
+static const MCPhysReg ArgWideRegs[] = {
+  Primate::P10, Primate::P11, Primate::P12, Primate::P13,
+  Primate::P14, Primate::P15, Primate::P16, Primate::P17
+};
+
+// Structs are passed and returned whole in a WIDEREG (see the clang Primate
+// ABI). A wide register contains its GPR, so a struct takes the place of one
+// XLEN argument. There is no stack form for a WIDEREG value.
+static bool CC_PrimateAssignAggregate(unsigned ValNo, MVT ValVT, MVT LocVT,
+                                      CCValAssign::LocInfo LocInfo,
+                                      CCState &State) {
+  if (Register Reg = State.AllocateReg(ArgWideRegs)) {
+    State.addLoc(CCValAssign::getReg(ValNo, ValVT, Reg, LocVT, LocInfo));
+    return false;
+  }
+  report_fatal_error("Primate: no argument register left for a struct");
+}
 
 // Pass a 2*XLEN argument that has been split into two XLEN values through
 // registers or the stack as necessary.
@@ -7399,6 +7822,9 @@ static bool CC_Primate(const DataLayout &DL, PrimateABI::ABI ABI, unsigned ValNo
   if (!LocVT.isVector() && IsRet && ValNo > 1)
     return true;
 
+  if (ValVT == MVT::Primate_aggregate)
+    return CC_PrimateAssignAggregate(ValNo, ValVT, LocVT, LocInfo, State);
+
   // UseGPRForF16_F32 if targeting one of the soft-float ABIs, if passing a
   // variadic argument, or if no F16/F32 argument registers are available.
   bool UseGPRForF16_F32 = true;
@@ -7819,6 +8245,9 @@ static bool CC_Primate_FastCC(const DataLayout &DL, PrimateABI::ABI ABI,
       Primate::X15, Primate::X16, Primate::X17, Primate::X7,  Primate::X28,
       Primate::X29, Primate::X30, Primate::X31};
 
+  if (ValVT == MVT::Primate_aggregate)
+    return CC_PrimateAssignAggregate(ValNo, ValVT, LocVT, LocInfo, State);
+
   if (LocVT == MVT::i32 || LocVT == MVT::i64) {
     if (unsigned Reg = State.AllocateReg(GPRList)) {
       State.addLoc(CCValAssign::getReg(ValNo, ValVT, Reg, LocVT, LocInfo));
@@ -8765,8 +9194,11 @@ const char *PrimateTargetLowering::getTargetNodeName(unsigned Opcode) const {
   NODE_NAME_CASE(READ_CSR)
   NODE_NAME_CASE(WRITE_CSR)
   NODE_NAME_CASE(SWAP_CSR)
+  NODE_NAME_CASE(INPUT_SEEK_READ)
   NODE_NAME_CASE(EXTRACT)
   NODE_NAME_CASE(INSERT)
+  NODE_NAME_CASE(EXTRACT_SWAP)
+  NODE_NAME_CASE(INSERT_SWAP)
   }
   // clang-format on
   return nullptr;
@@ -9044,6 +9476,12 @@ Instruction *PrimateTargetLowering::emitLeadingFence(IRBuilderBase &Builder,
     return Builder.CreateFence(Ord);
   if (isa<StoreInst>(Inst) && isReleaseOrStronger(Ord))
     return Builder.CreateFence(AtomicOrdering::Release);
+  // AMOs only order the accesses of their own LSU
+  bool IsAMO = isa<AtomicRMWInst>(Inst) || isa<AtomicCmpXchgInst>(Inst);
+  if (IsAMO && isReleaseOrStronger(Ord))
+    return Builder.CreateFence(Ord == AtomicOrdering::SequentiallyConsistent
+                                   ? Ord
+                                   : AtomicOrdering::Release);
   return nullptr;
 }
 
@@ -9052,20 +9490,21 @@ Instruction *PrimateTargetLowering::emitTrailingFence(IRBuilderBase &Builder,
                                                     AtomicOrdering Ord) const {
   if (isa<LoadInst>(Inst) && isAcquireOrStronger(Ord))
     return Builder.CreateFence(AtomicOrdering::Acquire);
+  bool IsAMO = isa<AtomicRMWInst>(Inst) || isa<AtomicCmpXchgInst>(Inst);
+  if (IsAMO && isAcquireOrStronger(Ord))
+    return Builder.CreateFence(AtomicOrdering::Acquire);
   return nullptr;
 }
 
 TargetLowering::AtomicExpansionKind
 PrimateTargetLowering::shouldExpandAtomicRMWInIR(AtomicRMWInst *AI) const {
-  // atomicrmw {fadd,fsub} must be expanded to use compare-exchange, as floating
-  // point operations can't be used in an lr/sc sequence without breaking the
-  // forward-progress guarantee.
-  if (AI->isFloatingPointOperation())
-    return AtomicExpansionKind::CmpXChg;
-
+  // Word sized integer RMWs are single AMOs. The LSU has no floating point,
+  // nand or sub-word AMO, so those are built on AMOCAS instead of an LR/SC
+  // loop.
   unsigned Size = AI->getType()->getPrimitiveSizeInBits();
-  if (Size == 8 || Size == 16)
-    return AtomicExpansionKind::MaskedIntrinsic;
+  if (AI->isFloatingPointOperation() ||
+      AI->getOperation() == AtomicRMWInst::Nand || Size < 32)
+    return AtomicExpansionKind::CmpXChg;
   return AtomicExpansionKind::None;
 }
 
@@ -9166,9 +9605,7 @@ Value *PrimateTargetLowering::emitMaskedAtomicRMWIntrinsic(
 TargetLowering::AtomicExpansionKind
 PrimateTargetLowering::shouldExpandAtomicCmpXchgInIR(
     AtomicCmpXchgInst *CI) const {
-  unsigned Size = CI->getCompareOperand()->getType()->getPrimitiveSizeInBits();
-  if (Size == 8 || Size == 16)
-    return AtomicExpansionKind::MaskedIntrinsic;
+  // Sub-word cmpxchg is widened to an AMOCAS of the containing word.
   return AtomicExpansionKind::None;
 }
 
@@ -18,6 +18,7 @@
 #include "llvm/CodeGen/CallingConvLower.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/CodeGen/TargetLowering.h"
+#include "llvm/Support/CommandLine.h"
 #include <optional>
 
 #define DEBUG_TYPE "primate-isel-lowering"
@@ -31,6 +32,10 @@ enum NodeType : unsigned {
 
   EXTRACT,
   INSERT,
+  // EXTRACT/INSERT with the bytes of the field swapped. Same operands as
+  // extract_value/insert_value, the scalar is XLenVT.
+  EXTRACT_SWAP,
+  INSERT_SWAP,
 
   RET_FLAG,
   URET_FLAG,
@@ -180,6 +185,11 @@ enum NodeType : unsigned {
   // the value read before the modification and the new chain pointer.
   SWAP_CSR,
 
+  // Skip input bytes and read a fixed size header in one IO op.
+  // Operands are a chain, the byte count to skip and the (constant) number of
+  // bytes to read. Produces the WIDEREG read and the new chain.
+  INPUT_SEEK_READ,
+
   STRICT_FCVT_W_PR64 = ISD::FIRST_TARGET_STRICTFP_OPCODE,
   STRICT_FCVT_WU_PR64,
   STRICT_FADD_VL,
@@ -214,6 +224,9 @@ enum NodeType : unsigned {
 };
 } // namespace PrimateISD
 
+// primate.cfg the lowering and the ELF attributes are built from
+extern cl::opt<std::string> PrimateConfigFile;
+
 class PrimateTargetLowering : public TargetLowering {
   const PrimateSubtarget &Subtarget;
 
@@ -221,6 +234,10 @@ class PrimateTargetLowering : public TargetLowering {
   std::vector<int> allPoses;
   std::vector<int> allSlotInfo;
   std::map<unsigned, unsigned> slotToFUIndex; // maps a subinstruction slot to the Functional unit slot
+  bool fieldBSwap = false; // extract/insert units can swap bytes (FIELD_BSWAP)
+  unsigned numThreads = 1; // interleaved threads per core (NUM_THREADS)
+  unsigned numLSUs = 1; // one LSU per data memory bank (NUM_LSUS)
+  std::map<std::string, unsigned> memBanks; // global -> bank (MEM_BANKS)
 
   enum SlotTypes{
     GREEN,
@@ -281,6 +298,37 @@ public:
     return (sizeIdx & ((1 << sizeBits) - 1)) << posBits;
   }
 
+  // Bit position and size of the field a field spec selects.
+  bool decodeFieldSpec(unsigned int spec, unsigned int &pos,
+                       unsigned int &size) const {
+    int posBits = 32 - __builtin_clz(allPoses.size());
+    unsigned posIdx = spec & ((1 << posBits) - 1);
+    unsigned sizeIdx = spec >> posBits;
+    if (posIdx >= allPoses.size() || sizeIdx >= allSizes.size())
+      return false;
+    pos = allPoses[posIdx];
+    size = allSizes[sizeIdx];
+    return true;
+  }
+
+  bool hasFieldBSwap() const { return fieldBSwap; }
+
+  unsigned getNumThreads() const { return numThreads; }
+  unsigned getNumLSUs() const { return numLSUs; }
+  unsigned getMemBank(const MachineInstr &MI) const;
+
+  // Field spec for size bits at bit pos, if the register file has that field.
+  std::optional<unsigned int> getFieldSpec(unsigned int pos,
+                                           unsigned int size) const {
+    int posBits = 32 - __builtin_clz(allPoses.size());
+    auto posIt = find(allPoses.begin(), allPoses.end(), (int)pos);
+    auto sizeIt = find(allSizes.begin(), allSizes.end(), (int)size);
+    if (posIt == allPoses.end() || sizeIt == allSizes.end())
+      return std::nullopt;
+    return (std::distance(allSizes.begin(), sizeIt) << posBits) +
+           std::distance(allPoses.begin(), posIt);
+  }
+
   virtual unsigned int getSlotFUIndex(unsigned int slotIdx) const {
     if(slotIdx > slotToFUIndex.size()) {
       llvm_unreachable("tried to get FU index of a to large slot");
@@ -398,6 +446,8 @@ public:
 
   virtual bool supportedAggregate(StructType &STy, int bitpos = 0) const override;
   virtual bool supportedArray(ArrayType &STy, int bitpos = 0) const override;
+  std::string getUnsupportedFieldReason(Type &Ty, SmallVectorImpl<unsigned> &path,
+                                        int bitpos = 0) const;
 
   // returns the EVT of a given aggregate if its supported by the target.
   virtual EVT getAggregateVT(StructType &STy) const override {
@@ -478,8 +528,11 @@ public:
   }
   bool convertSelectOfConstantsToMath(EVT VT) const override { return true; }
 
+  // One LSU performs every access in issue order, so atomics only need
+  // fences when each data memory bank has its own LSU (see the memory model
+  // in PrimateISelLowering.cpp).
   bool shouldInsertFencesForAtomic(const Instruction *I) const override {
-    return isa<LoadInst>(I) || isa<StoreInst>(I);
+    return numLSUs > 1;
   }
   Instruction *emitLeadingFence(IRBuilderBase &Builder, Instruction *Inst,
                                 AtomicOrdering Ord) const override;
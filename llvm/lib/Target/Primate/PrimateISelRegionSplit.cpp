@@ -0,0 +1,181 @@
+//===----- PrimateISelRegionSplit.cpp - Bound SelectionDAG region size ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// After inlining and unrolling primate_main is frequently a single basic block
+// with tens of thousands of instructions. SelectionDAG builds one DAG per
+// basic block, so combining, legalization (including the custom aggregate
+// lowering of wide structs) and scheduling all scale with the block size.
+//
+// This pass runs right before instruction selection and cuts oversized blocks
+// into bounded regions joined by unconditional branches:
+//
+//   bb:                         bb:
+//     ... N insts ...             ... ~RegionSize insts ...
+//     call @llvm.primate.output   call @llvm.primate.output
+//     ... M insts ...    ==>      br label %bb.isel.region
+//                               bb.isel.region:
+//                                 ... M insts ...
+//
+// Cuts are placed right after IO intrinsics and BFU calls since those already
+// serialize the packet stream. A cut is only forced at an arbitrary point if
+// no such boundary appears within RegionSize * PrimateISelRegionSlack insts.
+//
+// Values that are live across a cut are exported by SelectionDAGBuilder as
+// virtual registers (WIDEREG for aggregates), so no memory traffic is added.
+// The regions fall through into each other, so branch folding merges them
+// back after register allocation and the packetizer sees the original block
+// again, recovering any parallelism across the cut.
+//===----------------------------------------------------------------------===//
+
+#include "Primate.h"
+#include "PrimateTargetMachine.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "primate-isel-region-split"
+#define PRIMATE_ISEL_REGION_SPLIT_NAME "Primate ISel Region Split"
+
+STATISTIC(NumRegionCuts, "Number of ISel region cuts");
+STATISTIC(NumForcedCuts, "Number of ISel region cuts not on an IO/BFU boundary");
+
+static cl::opt<unsigned> PrimateISelRegionSize(
+    "primate-isel-region-size", cl::Hidden, cl::init(1024),
+    cl::desc("Maximum number of IR instructions handed to SelectionDAG as "
+             "a single block (0 disables region splitting)"));
+
+static cl::opt<unsigned> PrimateISelRegionSlack(
+    "primate-isel-region-slack", cl::Hidden, cl::init(2),
+    cl::desc("Multiple of the region size to search for an IO/BFU boundary "
+             "before forcing a region cut"));
+
+namespace {
+
+struct PrimateISelRegionSplit : public FunctionPass {
+  static char ID;
+  PrimateISelRegionSplit() : FunctionPass(ID) {}
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override {
+    return PRIMATE_ISEL_REGION_SPLIT_NAME;
+  }
+
+private:
+  bool isRegionBoundary(const Instruction &I) const;
+  bool splitBlock(BasicBlock &BB);
+};
+} // end anonymous namespace
+
+char PrimateISelRegionSplit::ID = 0;
+INITIALIZE_PASS(PrimateISelRegionSplit, DEBUG_TYPE,
+                PRIMATE_ISEL_REGION_SPLIT_NAME, false, false)
+
+// IO intrinsics and BFU calls are the natural cut points. Both occupy a
+// dedicated unit and are ordered with respect to each other anyway, so a cut
+// right after them costs the packetizer very little.
+bool PrimateISelRegionSplit::isRegionBoundary(const Instruction &I) const {
+  const auto *CI = dyn_cast<CallInst>(&I);
+  if (!CI)
+    return false;
+
+  if (const auto *II = dyn_cast<IntrinsicInst>(CI)) {
+    switch (II->getIntrinsicID()) {
+    default:
+      break;
+    case Intrinsic::primate_input:
+    case Intrinsic::primate_input_seek:
+    case Intrinsic::primate_input_done:
+    case Intrinsic::primate_input_len:
+    case Intrinsic::primate_output:
+    case Intrinsic::primate_output_seek:
+    case Intrinsic::primate_output_done:
+    case Intrinsic::primate_drop:
+    case Intrinsic::primate_fifo_send:
+    case Intrinsic::primate_fifo_recv:
+      return true;
+    }
+  }
+
+  MDNode *PrimateMD = CI->getMetadata("primate");
+  if (!PrimateMD && CI->getCalledFunction())
+    PrimateMD = CI->getCalledFunction()->getMetadata("primate");
+  if (!PrimateMD)
+    return false;
+  auto *Kind = dyn_cast<MDString>(PrimateMD->getOperand(0));
+  return Kind && Kind->getString() == "blue";
+}
+
+bool PrimateISelRegionSplit::splitBlock(BasicBlock &BB) {
+  const unsigned RegionSize = PrimateISelRegionSize;
+  const unsigned ForceSize = RegionSize * std::max(1u, (unsigned)PrimateISelRegionSlack);
+
+  bool Changed = false;
+  BasicBlock *Cur = &BB;
+  while (true) {
+    unsigned Count = 0;
+    Instruction *CutPoint = nullptr;
+    bool Forced = false;
+    for (Instruction &I : *Cur) {
+      if (isa<PHINode>(I) || I.isDebugOrPseudoInst())
+        continue;
+      if (I.isTerminator())
+        break;
+      ++Count;
+      if (Count < RegionSize)
+        continue;
+      // Cut after the boundary so that the IO/BFU op ends its region.
+      if (isRegionBoundary(I)) {
+        CutPoint = I.getNextNode();
+        break;
+      }
+      if (Count >= ForceSize) {
+        CutPoint = &I;
+        Forced = true;
+        break;
+      }
+    }
+    if (!CutPoint || CutPoint->isTerminator())
+      return Changed;
+
+    LLVM_DEBUG(dbgs() << "Cutting " << Cur->getName() << " after " << Count
+                      << " instructions" << (Forced ? " (forced)" : "")
+                      << "\n");
+    Cur = Cur->splitBasicBlock(CutPoint, Cur->getName() + ".isel.region");
+    ++NumRegionCuts;
+    if (Forced)
+      ++NumForcedCuts;
+    Changed = true;
+  }
+}
+
+bool PrimateISelRegionSplit::runOnFunction(Function &F) {
+  if (skipFunction(F) || PrimateISelRegionSize == 0)
+    return false;
+
+  SmallVector<BasicBlock *, 8> Worklist;
+  for (BasicBlock &BB : F)
+    if (BB.size() > PrimateISelRegionSize && !BB.isEHPad())
+      Worklist.push_back(&BB);
+
+  bool Changed = false;
+  for (BasicBlock *BB : Worklist)
+    Changed |= splitBlock(*BB);
+  return Changed;
+}
+
+/// Returns an instance of the ISel region split pass.
+FunctionPass *llvm::createPrimateISelRegionSplitPass() {
+  return new PrimateISelRegionSplit();
+}
@@ -0,0 +1,346 @@
+//===-- PrimateLineRate.cpp - Primate worst case line rate ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file bounds the packets primate_main issues per input packet on the
+// final bundled code and writes the line rate certificate, linerate.cfg.
+//
+//===----------------------------------------------------------------------===//
+
+
+#include "PrimateLineRate.h"
+#include "Primate.h"
+#include "PrimateISelLowering.h"
+#include "MCTargetDesc/PrimateBaseInfo.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/Demangle/Demangle.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
+
+#include <algorithm>
+
+#define DEBUG_TYPE "primate-line-rate"
+
+namespace llvm {
+
+static cl::opt<double> PrimateMinMpps(
+    "primate-min-mpps", cl::Hidden, cl::init(0.0),
+    cl::desc("Fail the build unless the worst path of primate_main sustains "
+             "this many million packets per second (0 only reports)"));
+
+static cl::opt<double> PrimateClockMHz(
+    "primate-clock-mhz", cl::Hidden, cl::init(250.0),
+    cl::desc("Core clock the line rate certificate assumes"));
+
+PrimateLineRate::Cost &PrimateLineRate::Cost::operator+=(const Cost &O) {
+    Packets += O.Packets;
+    IOOps += O.IOOps;
+    BFUOps += O.BFUOps;
+    LSUOps += O.LSUOps;
+    return *this;
+}
+
+PrimateLineRate::Cost PrimateLineRate::Cost::operator*(double N) const {
+    Cost C = *this;
+    C.Packets *= N;
+    C.IOOps *= N;
+    C.BFUOps *= N;
+    C.LSUOps *= N;
+    return C;
+}
+
+void PrimateLineRate::Cost::maxWith(const Cost &O) {
+    Packets = std::max(Packets, O.Packets);
+    IOOps = std::max(IOOps, O.IOOps);
+    BFUOps = std::max(BFUOps, O.BFUOps);
+    LSUOps = std::max(LSUOps, O.LSUOps);
+}
+
+void PrimateLineRate::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+    AU.addRequired<MachineLoopInfo>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+// The ops issued to the IO unit (ItinIO).
+static bool isIOInstr(unsigned Opcode) {
+    switch (Opcode) {
+    case Primate::INPUT_READ:
+    case Primate::INPUT_DONE:
+    case Primate::INPUT_SEEK:
+    case Primate::INPUT_SEEK_READ:
+    case Primate::INPUT_LEN:
+    case Primate::OUTPUT_WRITE:
+    case Primate::OUTPUT_DONE:
+    case Primate::OUTPUT_DROP:
+    case Primate::OUTPUT_SEEK:
+    case Primate::FIFO_RECV:
+    case Primate::FIFO_SEND:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// One packet per bundle or lone instruction. A call costs what the whole
+// callee costs. Codegen runs bottom-up over the call graph (see
+// PrimatePassConfig), so only recursion and calls out of the module find
+// no cost here.
+PrimateLineRate::Cost PrimateLineRate::blockCost(const MachineBasicBlock &MBB) {
+    Cost C;
+    for (const MachineInstr &MI : MBB.instrs()) {
+        if (MI.isBundle()) {
+            C.Packets += 1;
+            continue;
+        }
+        if (MI.isMetaInstruction()) {
+            continue;
+        }
+        if (!MI.isInsideBundle()) {
+            C.Packets += 1;
+        }
+        if (isIOInstr(MI.getOpcode())) {
+            C.IOOps += 1;
+        } else if (PrimateII::isBFUInstr(MI.getDesc().TSFlags)) {
+            C.BFUOps += 1;
+        } else if (MI.mayLoad() || MI.mayStore()) {
+            C.LSUOps += 1;
+        }
+        if (!MI.isCall()) {
+            continue;
+        }
+        const Function *callee = nullptr;
+        for (const MachineOperand &MO : MI.operands()) {
+            if (MO.isGlobal()) {
+                callee = dyn_cast<Function>(MO.getGlobal());
+            }
+        }
+        auto it = callee ? FunctionCost.find(callee->getName())
+                         : FunctionCost.end();
+        if (it == FunctionCost.end()) {
+            Unbounded = "call to " +
+                        (callee ? demangle(callee->getName()) : "unknown") +
+                        " without a bound";
+            continue;
+        }
+        C += it->second;
+    }
+    return C;
+}
+
+// Worst cost from MBB to the end of Scope (one iteration of a loop, or the
+// whole function for nullptr). Loops nested in Scope count as a single node
+// from which their exits are taken.
+PrimateLineRate::Cost PrimateLineRate::pathCost(const MachineBasicBlock *MBB,
+                                                const MachineLoop *Scope) {
+    auto key = std::make_pair(MBB, Scope);
+    auto it = PathCost.find(key);
+    if (it != PathCost.end()) {
+        return it->second;
+    }
+    if (!OnPath.insert(key).second) {
+        Unbounded = "irreducible control flow at " + MBB->getFullName();
+        return Cost();
+    }
+
+    const MachineLoop *inner = MLI->getLoopFor(MBB);
+    if (inner == Scope) {
+        inner = nullptr;
+    } else {
+        while (inner->getParentLoop() != Scope) {
+            inner = inner->getParentLoop();
+        }
+    }
+
+    Cost own;
+    SmallVector<MachineBasicBlock*, 8> next;
+    if (inner) {
+        own = loopCost(inner);
+        inner->getExitBlocks(next);
+    } else {
+        own = blockCost(*MBB);
+        next.append(MBB->succ_begin(), MBB->succ_end());
+    }
+    Cost worst;
+    for (const MachineBasicBlock *succ : next) {
+        // leaving Scope or taking its back edge ends the iteration
+        if (Scope && (!Scope->contains(succ) || succ == Scope->getHeader())) {
+            continue;
+        }
+        worst.maxWith(pathCost(succ, Scope));
+    }
+    own += worst;
+
+    OnPath.erase(key);
+    PathCost[key] = own;
+    return own;
+}
+
+PrimateLineRate::Cost PrimateLineRate::loopCost(const MachineLoop *ML) {
+    std::optional<unsigned> bound = getTripCountBound(ML);
+    if (!bound) {
+        Unbounded = "no trip count bound for the loop at " +
+                    ML->getHeader()->getFullName();
+        bound = 1;
+    }
+    return pathCost(ML->getHeader(), ML) * *bound;
+}
+
+// Most times the header of ML runs per entry into the loop: the exact SCEV
+// trip count, the SCEV maximum, or llvm.loop.primate.max_trip_count for
+// loops bounded by packet contents.
+std::optional<unsigned>
+PrimateLineRate::getTripCountBound(const MachineLoop *ML) {
+    const BasicBlock *BB = ML->getHeader()->getBasicBlock();
+    if (!BB) {
+        return std::nullopt;
+    }
+    Loop *L = LI->getLoopFor(BB);
+    while (L && L->getLoopDepth() > ML->getLoopDepth()) {
+        L = L->getParentLoop();
+    }
+    if (!L) {
+        return std::nullopt;
+    }
+    if (unsigned tc = SE->getSmallConstantTripCount(L)) {
+        return tc;
+    }
+    if (unsigned max = SE->getSmallConstantMaxTripCount(L)) {
+        return max;
+    }
+    if (std::optional<int> md = getOptionalIntLoopAttribute(
+            L, "llvm.loop.primate.max_trip_count")) {
+        if (*md > 0) {
+            return *md;
+        }
+    }
+    return std::nullopt;
+}
+
+// NUM_THREADS threads issue round robin, one packet a cycle for the core, so
+// the core finishes an input packet every Packets cycles and each thread
+// takes Packets * NUM_THREADS cycles for one.
+void PrimateLineRate::writeCertificate(MachineFunction &MF, const Cost &Worst) {
+    unsigned threads = std::max(1u, TLI->getNumThreads());
+    double packets = std::max(1.0, Worst.Packets);
+    double mpps = PrimateClockMHz / packets;
+    bool bounded = Unbounded.empty();
+    bool certified = bounded && mpps >= PrimateMinMpps;
+
+    // next to the primate.cfg it was computed against
+    SmallString<128> path(sys::path::parent_path(PrimateConfigFile));
+    sys::path::append(path, "linerate.cfg");
+    std::error_code EC;
+    raw_fd_ostream cert(path, EC);
+    if (EC) {
+        errs() << "could not write " << path << ": " << EC.message() << "\n";
+    } else {
+        cert << "PROGRAM=" << MF.getFunction().getParent()->getSourceFileName()
+             << "\n";
+        cert << "BOUNDED=" << bounded << "\n";
+        if (!bounded) {
+            cert << "UNBOUNDED=" << Unbounded << "\n";
+        }
+        cert << "WORST_PACKETS=" << uint64_t(Worst.Packets) << "\n";
+        cert << "WORST_IO_OPS=" << uint64_t(Worst.IOOps) << "\n";
+        cert << "WORST_BFU_OPS=" << uint64_t(Worst.BFUOps) << "\n";
+        cert << "WORST_LSU_OPS=" << uint64_t(Worst.LSUOps) << "\n";
+        cert << "IO_OCCUPANCY=" << format("%.3f", Worst.IOOps / packets) << "\n";
+        cert << "BFU_OCCUPANCY=" << format("%.3f", Worst.BFUOps / packets)
+             << "\n";
+        cert << "NUM_THREADS=" << threads << "\n";
+        cert << "THREAD_CYCLES=" << uint64_t(packets) * threads << "\n";
+        cert << "CLOCK_MHZ=" << format("%.1f", double(PrimateClockMHz)) << "\n";
+        cert << "LINE_RATE_MPPS=" << format("%.3f", mpps) << "\n";
+        cert << "MIN_MPPS=" << format("%.3f", double(PrimateMinMpps)) << "\n";
+        cert << "CERTIFIED=" << certified << "\n";
+    }
+
+    // linerate.cfg has the numbers, only a build that asks for a rate
+    // reports them
+    auto printSummary = [&](raw_ostream &os) {
+        os << "worst case packets: " << uint64_t(Worst.Packets)
+           << ", IO ops: " << uint64_t(Worst.IOOps)
+           << ", BFU ops: " << uint64_t(Worst.BFUOps)
+           << ", line rate: " << format("%.3f", mpps) << " Mpps";
+        if (!bounded) {
+            os << " (unbounded: " << Unbounded << ")";
+        }
+        os << "\n";
+    };
+    if (PrimateMinMpps > 0.0) {
+        printSummary(errs());
+    } else {
+        LLVM_DEBUG(printSummary(dbgs()));
+    }
+
+    if (PrimateMinMpps > 0.0 && !certified) {
+        std::string msg;
+        raw_string_ostream os(msg);
+        if (bounded) {
+            os << "worst path of primate_main takes "
+               << uint64_t(Worst.Packets) << " packets, "
+               << format("%.3f", mpps) << " Mpps is below the required "
+               << format("%.3f", double(PrimateMinMpps)) << " Mpps";
+        } else {
+            os << "primate_main cannot be certified for line rate: "
+               << Unbounded;
+        }
+        const Function &F = MF.getFunction();
+        F.getContext().diagnose(DiagnosticInfoUnsupported(F, os.str()));
+    }
+}
+
+bool PrimateLineRate::runOnMachineFunction(MachineFunction& MF) {
+    PII = MF.getSubtarget<PrimateSubtarget>().getInstrInfo();
+    TLI = MF.getSubtarget<PrimateSubtarget>().getTargetLowering();
+    MLI = &getAnalysis<MachineLoopInfo>();
+    LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    PathCost.clear();
+    OnPath.clear();
+    Unbounded.clear();
+
+    Cost worst = pathCost(&MF.front(), nullptr);
+    LLVM_DEBUG(dbgs() << MF.getName() << ": " << worst.Packets
+                      << " packets worst case\n");
+    if (Unbounded.empty()) {
+        FunctionCost[MF.getName()] = worst;
+    }
+    if (isPrimateMain(MF.getFunction())) {
+        writeCertificate(MF, worst);
+    }
+    return false;
+}
+
+MachineFunctionPass *createPrimateLineRatePass();
+void initializePrimateLineRatePass(PassRegistry&);
+}
+
+using namespace llvm;
+
+INITIALIZE_PASS_BEGIN(PrimateLineRate, "PrimateLineRate",
+                      "Primate Line Rate", false, true)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_END(PrimateLineRate, "PrimateLineRate",
+                    "Primate Line Rate", false, true)
+
+llvm::MachineFunctionPass *llvm::createPrimateLineRatePass() {
+  return new llvm::PrimateLineRate();
+}
@@ -0,0 +1,90 @@
+//===-- PrimateLineRate.h - Primate worst case line rate --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_PRIMATE_PRIMATELINERATE_H
+#define LLVM_LIB_TARGET_PRIMATE_PRIMATELINERATE_H
+
+#include "llvm/Pass.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/Support/Debug.h"
+#include "PrimateInstrInfo.h"
+#include "PrimateSubtarget.h"
+
+#include <optional>
+#include <string>
+
+namespace llvm {
+
+// Worst case packets per input packet of primate_main, on the final bundled
+// code.
+//
+// Every path through the machine CFG is costed in VLIW packets, with loops
+// collapsed to their trip count bound times their worst iteration. Bounds
+// come from SCEV (exact, then maximum trip count) or from
+// llvm.loop.primate.max_trip_count metadata. IO, BFU and LSU ops are counted
+// the same way, each maximized on its own, so every figure is a bound.
+//
+// With NUM_THREADS threads interleaved, a thread issues a packet every
+// NUM_THREADS cycles and the core issues one every cycle, so the core
+// sustains one input packet per worst case packet count. The result is
+// written to linerate.cfg next to primate.cfg and checked against
+// -primate-min-mpps.
+class PrimateLineRate : public MachineFunctionPass {
+public:
+    static char ID;
+    PrimateLineRate() : MachineFunctionPass(ID){};
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override;
+    bool runOnMachineFunction(MachineFunction& MF) override;
+
+private:
+    struct Cost {
+        double Packets = 0.0;
+        double IOOps = 0.0;
+        double BFUOps = 0.0;
+        double LSUOps = 0.0;
+
+        Cost &operator+=(const Cost &O);
+        Cost operator*(double N) const;
+        void maxWith(const Cost &O);
+    };
+
+    const PrimateInstrInfo *PII;
+    const PrimateTargetLowering *TLI;
+    MachineLoopInfo *MLI;
+    LoopInfo *LI;
+    ScalarEvolution *SE;
+
+    // worst cost from a block to the end of the scope it is costed in
+    DenseMap<std::pair<const MachineBasicBlock*, const MachineLoop*>, Cost>
+        PathCost;
+    DenseSet<std::pair<const MachineBasicBlock*, const MachineLoop*>> OnPath;
+    StringMap<Cost> FunctionCost; // functions done so far, for calls
+    std::string Unbounded;        // why no bound exists, empty if it does
+
+    Cost blockCost(const MachineBasicBlock &MBB);
+    Cost pathCost(const MachineBasicBlock *MBB, const MachineLoop *Scope);
+    Cost loopCost(const MachineLoop *ML);
+    std::optional<unsigned> getTripCountBound(const MachineLoop *ML);
+    void writeCertificate(MachineFunction &MF, const Cost &Worst);
+};
+
+char PrimateLineRate::ID = 0;
+static RegisterPass<PrimateLineRate> LR("PrimateLineRate", "Primate Line Rate",
+                             false /* Only looks at CFG */,
+                             true /* Analysis Pass */);
+
+} // end namespace llvm
+
+#endif // LLVM_LIB_TARGET_PRIMATE_PRIMATELINERATE_H
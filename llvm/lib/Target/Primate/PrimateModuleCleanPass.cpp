@@ -1,6 +1,6 @@
 #include "PrimateModuleCleanPass.h"
 
-#include "llvm/Demangle/Demangle.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
  
 using namespace llvm;
 
@@ -11,7 +11,12 @@ PreservedAnalyses PrimateModuleCleanPass::run(Module& M, ModuleAnalysisManager&
     SmallVector<Function*, 8> functionsToRemove;
 
     for(auto& F: M) {
-        if (demangle(F.getName()).find("primate_main") != std::string::npos) {
+        if (isPrimateMain(F)) {
+            continue;
+        }
+        // Once LTO internalized the program, a definition that is still
+        // external is called from another ThinLTO module or a regular object.
+        if (PostLink && !F.isDeclaration() && !F.hasLocalLinkage()) {
             continue;
         }
         if(F.getNumUses() == 0) {
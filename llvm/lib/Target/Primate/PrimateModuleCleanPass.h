@@ -26,10 +26,14 @@
 
 namespace llvm {
   struct PrimateModuleCleanPass : public PassInfoMixin<PrimateModuleCleanPass> {
-    PrimateModuleCleanPass() {}
+    // PostLink: the module is the result of an LTO link
+    PrimateModuleCleanPass(bool PostLink = false) : PostLink(PostLink) {}
 
     PreservedAnalyses run(Module&, ModuleAnalysisManager&);
     static bool isRequired() { return true; }
+
+  private:
+    bool PostLink;
   };
 }
 
@@ -213,6 +213,7 @@ void PrimatePacketLegalizer::fixBundle(MachineInstr *BundleMI) {
             switch (newBundle[i]->getOpcode())
             {
             case Primate::EXTRACT_hang:
+            case Primate::EXTRACT_SWAP:
             case Primate::EXTRACT:{
                 if(isNewInstr[i])
                     continue; // new extracts have been handled. 
@@ -251,6 +252,7 @@ void PrimatePacketLegalizer::fixBundle(MachineInstr *BundleMI) {
                 break;
             }
             case Primate::INSERT_hang:
+            case Primate::INSERT_SWAP:
             case Primate::INSERT:{
                 // check if the op exists
                 int opCheck = i - 1;
@@ -1,12 +1,14 @@
 #include "PrimateStructToAggre.h"
 
-#include "llvm/Demangle/Demangle.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/IR/User.h" 
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/InstIterator.h"
 
 #include <cstring>
 #include <fstream>
@@ -50,8 +52,109 @@ namespace llvm {
     void PrimateStructToAggre::findBFUTypes(Module& M) {
     }
 
+    // Calls a register struct can be handed to: the Primate intrinsics and
+    // blue functions take it in a register, lifetime and debug markers do not
+    // look at it, and whole struct copies are split into its fields.
+    static bool isRegStructCall(const CallInst* ci) {
+        if(isa<DbgInfoIntrinsic>(ci) || ci->isLifetimeStartOrEnd() ||
+           isa<MemIntrinsic>(ci)) {
+            return true;
+        }
+        const Function* callee = ci->getCalledFunction();
+        if(!callee) {
+            return false;
+        }
+        if(callee->isIntrinsic() && callee->getName().starts_with("llvm.primate.")) {
+            return true;
+        }
+        MDNode* priTop = callee->getMetadata("primate");
+        return priTop && isa<MDString>(priTop->getOperand(0)) &&
+               cast<MDString>(priTop->getOperand(0))->getString() == "blue";
+    }
+
+    // #pragma primate reg promises a struct never lives in memory, so what
+    // would keep it there is an error here instead of a silent fallback.
+    void PrimateStructToAggre::checkRegTypes(Function& F) {
+        NamedMDNode* regMD = F.getParent()->getNamedMetadata("primate.reg");
+        if(!regMD) {
+            return;
+        }
+        const PrimateTargetLowering* PTLI =
+            TM.getSubtarget<PrimateSubtarget>(F).getTargetLowering();
+        for(MDNode* entry: regMD->operands()) {
+            auto* sty = cast<StructType>(
+                mdconst::extract<Constant>(entry->getOperand(0))->getType());
+            std::string name = cast<MDString>(entry->getOperand(1))->getString().str();
+            auto* fieldNames = cast<MDNode>(entry->getOperand(2));
+
+            SmallVector<unsigned, 4> path;
+            std::string reason = PTLI->getUnsupportedFieldReason(*sty, path);
+            if(!reason.empty()) {
+                std::string field = cast<MDString>(fieldNames->getOperand(path[0]))->getString().str();
+                if(field.empty()) {
+                    field = "#" + std::to_string(path[0]);
+                }
+                Type* ty = sty->getElementType(path[0]);
+                for(unsigned i = 1; i < path.size(); i++) {
+                    if(auto* aty = dyn_cast<ArrayType>(ty)) {
+                        field += "[]";
+                        ty = aty->getElementType();
+                    } else {
+                        field += "." + std::to_string(path[i]);
+                        ty = cast<StructType>(ty)->getElementType(path[i]);
+                    }
+                }
+                F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+                    "#pragma primate reg struct " + name +
+                    " cannot be held in a register: field '" + field + "': " +
+                    reason + " (rerun archgen?)"));
+                continue;
+            }
+
+            for(auto& inst: instructions(F)) {
+                auto* ai = dyn_cast<AllocaInst>(&inst);
+                if(!ai || ai->getAllocatedType() != sty) {
+                    continue;
+                }
+                for(User* u: ai->users()) {
+                    auto* ui = cast<Instruction>(u);
+                    if(auto* gepi = dyn_cast<GetElementPtrInst>(ui)) {
+                        if(gepi->hasAllConstantIndices()) {
+                            continue;
+                        }
+                    }
+                    else if(auto* ci = dyn_cast<CallInst>(ui)) {
+                        if(isRegStructCall(ci)) {
+                            continue;
+                        }
+                    }
+                    else if(isa<LoadInst>(ui)) {
+                        continue;
+                    }
+                    else if(auto* si = dyn_cast<StoreInst>(ui)) {
+                        if(si->getPointerOperand() == ai) {
+                            continue;
+                        }
+                    }
+                    std::string what = isa<GetElementPtrInst>(ui)
+                                           ? "variable index"
+                                           : ui->getOpcodeName();
+                    if(auto* ci = dyn_cast<CallInst>(ui)) {
+                        const Function* callee = ci->getCalledFunction();
+                        what = callee ? "call to " + callee->getName().str()
+                                      : "indirect call";
+                    }
+                    F.getContext().diagnose(DiagnosticInfoUnsupported(F,
+                        "#pragma primate reg struct " + name +
+                        " is kept in memory by this " + what,
+                        ui->getDebugLoc()));
+                }
+            }
+        }
+    }
+
     PreservedAnalyses PrimateStructToAggre::run(Function& F, FunctionAnalysisManager& PA) {
-        if (strcmp(demangle(F.getName()).c_str(), "primate_main") != 0)
+        if (!isPrimateMain(F))
           return PreservedAnalyses::none();
 
         BFUTypes = PA.getResult<PrimateBFUTypeFinding>(F);
@@ -61,6 +164,7 @@ namespace llvm {
         }
 
         TLI = TM.getSubtarget<PrimateSubtarget>(F).getTargetLowering();
+        checkRegTypes(F);
         // first normalize all the function calls to the same form 
         // 1. revert all vectorized aggregates to structs
         LLVM_DEBUG(dbgs() << "looking for struct allocas in func: " << F.getName() << "\n");
@@ -44,6 +44,7 @@ namespace llvm {
     void convertAndTrimGEP(GetElementPtrInst* gepI);
     void findBFUTypes(Module& M);
     bool isBFUType(Type* ty);
+    void checkRegTypes(Function& F);
     static bool isRequired() { return true; }
   };
 }
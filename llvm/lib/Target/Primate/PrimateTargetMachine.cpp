@@ -20,6 +20,7 @@
 #include "PrimateGEPFilter.h"
 #include "PrimateStructToAggre.h"
 #include "PrimateIntrinsicPromotion.h"
+#include "PrimateConformance.h"
 #include "PrimateModuleCleanPass.h"
 #include "PrimateScheduleStrategy.h"
 #include "PrimateMachineFunctionInfo.h"
@@ -38,16 +39,59 @@
 #include "llvm/CodeGen/TargetLoweringObjectFileImpl.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Transforms/Primate/PrimateArchGen.h"
+#include "llvm/Transforms/Primate/PrimateChecksumIdiom.h"
+#include "llvm/Transforms/Primate/PrimateEarlyDrop.h"
+#include "llvm/Transforms/Primate/PrimateInputSanitizer.h"
+#include "llvm/Transforms/Primate/PrimatePipelinePartition.h"
+#include "llvm/Transforms/Primate/PrimateSpecialize.h"
+#include "llvm/Transforms/Primate/PrimateTableOffload.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/SROA.h"
 #include <memory>
 using namespace llvm;
 
+// Set by the driver on the compile jobs of -flto builds, whose modules are
+// only one file of the program until the link.
+static cl::opt<bool> PrimateLTOPrelink(
+    "primate-lto-prelink", cl::Hidden, cl::init(false),
+    cl::desc("Leave the whole program Primate passes to the LTO link"));
+
+// Set by the driver on -flto links. ThinLTO backends run the per-file
+// pipeline on modules whose external definitions other modules still call.
+static cl::opt<bool> PrimateLTOPostlink(
+    "primate-lto-postlink", cl::Hidden, cl::init(false),
+    cl::desc("The Primate passes run on the modules of an LTO link"));
+
+// Set by the driver for --primate-archgen; archgen runs on the whole
+// program, which is the merged module under full LTO.
+static cl::opt<std::string> PrimateArchGenDir(
+    "primate-archgen-dir", cl::Hidden, cl::init(""),
+    cl::desc("Run archgen at the end of the optimizer and write its "
+             "configuration files to this directory"));
+
+static void addArchGen(ModulePassManager &MPM) {
+  // both passes take a prefix for the files they write
+  std::string prefix;
+  if (!PrimateArchGenDir.empty()) {
+    sys::fs::create_directories(PrimateArchGenDir);
+    prefix = PrimateArchGenDir + "/";
+  }
+  // -primate-pipeline-stages: a core per stage, next to the single core
+  if (llvm::PrimatePipelinePartition::isEnabled())
+    MPM.addPass(llvm::PrimatePipelinePartition(prefix));
+  if (!PrimateArchGenDir.empty())
+    MPM.addPass(llvm::PrimateArchGen(prefix));
+}
+
 extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializePrimateTarget() {
   RegisterTargetMachine<PrimateTargetMachine> X(getThePrimate32Target());
   RegisterTargetMachine<PrimateTargetMachine> Y(getThePrimate64Target());
@@ -55,6 +99,7 @@ extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializePrimateTarget() {
   initializePrimateStructToRegPassPass(*PR); // needs to run on IR with struct information
   initializeGlobalISel(*PR);
   initializePrimateDAGToDAGISelPass(*PR);
+  initializePrimateISelRegionSplitPass(*PR);
   initializePrimateMergeBaseOffsetOptPass(*PR);
   initializePrimateExpandPseudoPass(*PR);
   initializePrimatePacketizerPass(*PR);
@@ -150,7 +195,10 @@ namespace {
 class PrimatePassConfig : public TargetPassConfig {
 public:
   PrimatePassConfig(PrimateTargetMachine &TM, PassManagerBase &PM)
-      : TargetPassConfig(TM, PM) {}
+      : TargetPassConfig(TM, PM) {
+    // callees first, so that PrimateLineRate has their bounds for calls
+    setRequiresCodeGenSCCOrder();
+  }
 
   PrimateTargetMachine &getPrimateTargetMachine() const {
     return getTM<PrimateTargetMachine>();
@@ -171,6 +219,7 @@ public:
 
   void addMachineSSAOptimization() override;
   void addIRPasses() override;
+  bool addPreISel() override;
   bool addInstSelector() override;
   bool addIRTranslator() override;
   bool addLegalizeMachineIR() override;
@@ -201,6 +250,13 @@ void PrimatePassConfig::addIRPasses() {
   TargetPassConfig::addIRPasses();
 }
 
+bool PrimatePassConfig::addPreISel() {
+  // Bound the size of the blocks handed to SelectionDAG.
+  if (TM->getOptLevel() != CodeGenOptLevel::None)
+    addPass(createPrimateISelRegionSplitPass());
+  return false;
+}
+
 bool PrimatePassConfig::addInstSelector() {
   addPass(createPrimateISelDag(getPrimateTargetMachine(), getOptLevel()));
 
@@ -231,18 +287,59 @@ void PrimateTargetMachine::registerPassBuilderCallbacks(llvm::PassBuilder &PB, b
   });
   // need to run primateStructToAggre before SROA otherwise we won't promote any allocas...
   PB.registerCGSCCOptimizerLateEPCallback([this](llvm::CGSCCPassManager& MPM, OptimizationLevel opt) {
+    if (PrimateLTOPrelink)
+      return;
     FunctionPassManager FPM;
     FPM.addPass(llvm::PrimateIntrinsicPromotion(*this));
     FPM.addPass(llvm::PrimateStructToAggre(*this));
 
     MPM.addPass(createCGSCCToFunctionPassAdaptor(std::move(FPM)));
   });
+  // CRC/checksum loops are only recognizable once unrolling and instcombine
+  // have canonicalized them, but should be gone before the vectorizers run.
+  PB.registerScalarOptimizerLateEPCallback([](llvm::FunctionPassManager& FPM, OptimizationLevel Level){
+    FPM.addPass(llvm::PrimateChecksumIdiom());
+    // branch weights are final here, and the cleanup after this EP folds
+    // the hot values through the specialized copy
+    FPM.addPass(llvm::PrimateSpecialize());
+  });
   PB.registerPeepholeEPCallback([](llvm::FunctionPassManager& FPM, OptimizationLevel Level){
     // FPM.addPass(llvm::PrimateGEPFilterPass());
     // FPM.addPass(llvm::PrimateStructLoadCombinerPass());
   });
   PB.registerOptimizerLastEPCallback([this](ModulePassManager &MPM, OptimizationLevel opt) {
-    MPM.addPass(llvm::PrimateModuleCleanPass());
+    // primate_main may call into files the compiler has not seen yet
+    if (PrimateLTOPrelink)
+      return;
+    // after inlining and devirtualization, before anything relies on the
+    // program's shape
+    MPM.addPass(llvm::PrimateConformance());
+    // -fsanitize=primate-input, before archgen so it sizes the checks too
+    if (llvm::PrimateInputSanitizer::isEnabled())
+      MPM.addPass(llvm::PrimateInputSanitizer());
+    // once the program is known to release the packet on every path
+    MPM.addPass(llvm::PrimateEarlyDrop());
+    // no-op unless ROM BFUs were generated (-primate-rom-bfu-base)
+    MPM.addPass(llvm::PrimateTableOffload(/*RequireBFUBase=*/true));
+    MPM.addPass(llvm::PrimateModuleCleanPass(/*PostLink=*/PrimateLTOPostlink));
+    addArchGen(MPM);
+  });
+  // The full LTO pipeline has no CGSCC or OptimizerLast extension points, so
+  // the merged module gets the same passes here, once it has been inlined.
+  PB.registerFullLinkTimeOptimizationLastEPCallback([this](ModulePassManager &MPM, OptimizationLevel opt) {
+    FunctionPassManager FPM;
+    FPM.addPass(llvm::PrimateIntrinsicPromotion(*this));
+    FPM.addPass(llvm::PrimateStructToAggre(*this));
+    FPM.addPass(SROAPass(SROAOptions::ModifyCFG));
+    MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
+
+    MPM.addPass(llvm::PrimateConformance());
+    if (llvm::PrimateInputSanitizer::isEnabled())
+      MPM.addPass(llvm::PrimateInputSanitizer());
+    MPM.addPass(llvm::PrimateEarlyDrop());
+    MPM.addPass(llvm::PrimateTableOffload(/*RequireBFUBase=*/true));
+    MPM.addPass(llvm::PrimateModuleCleanPass(/*PostLink=*/true));
+    addArchGen(MPM);
   });
 }
 
@@ -268,6 +365,8 @@ void PrimatePassConfig::addPreEmitPass2() {
   // need to expand all ops before packetizing
   addPass(createPrimatePacketizer());
   addPass(createPrimatePacketLegalizerPass());
+  // worst case per packet cost of the final packets, see -primate-min-mpps
+  addPass(createPrimateLineRatePass());
 }
 
 void PrimatePassConfig::addPreRegAlloc() {
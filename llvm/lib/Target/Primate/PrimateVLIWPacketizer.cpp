@@ -217,10 +217,33 @@ bool PrimatePacketizerList::insertBypassOps(MachineInstr* br_inst, llvm::SmallVe
   return false;
 }
 
+// With one LSU per data memory bank a load or store has to issue on the LSU
+// of its bank. Each bank has a pseudo whose itinerary is just that LSU, and
+// the packetizer reserves it in place of the access. nullptr when any LSU
+// will do. The target lowering rejects a primate.cfg with more banks than
+// there are pseudos.
+const MCInstrDesc *
+PrimatePacketizerList::getMemBankDesc(const MachineInstr &MI) const {
+  static const unsigned BankOpcodes[] = {
+      Primate::PseudoMemBank0, Primate::PseudoMemBank1,
+      Primate::PseudoMemBank2, Primate::PseudoMemBank3};
+  if (PLI->getNumLSUs() <= 1 || !(MI.mayLoad() || MI.mayStore()))
+    return nullptr;
+  unsigned bank = PLI->getMemBank(MI);
+  assert(bank < std::size(BankOpcodes) && "NUM_LSUS above the bank pseudos");
+  return &PII->get(BankOpcodes[bank]);
+}
+
 MachineBasicBlock::iterator
 PrimatePacketizerList::addToPacket(MachineInstr &MI) {
   MachineBasicBlock::iterator MII = MI.getIterator();
   //MachineBasicBlock *MBB = MI.getParent();
+  if (const MCInstrDesc *BankDesc = getMemBankDesc(MI)) {
+    assert(ResourceTracker->canReserveResources(BankDesc));
+    ResourceTracker->reserveResources(BankDesc);
+    CurrentPacketMIs.push_back(&MI);
+    return MII;
+  }
   assert(ResourceTracker->canReserveResources(MI));
   ResourceTracker->reserveResources(MI);
   CurrentPacketMIs.push_back(&MI);
@@ -431,6 +454,9 @@ bool PrimatePacketizerList::isSoloInstruction(const MachineInstr &MI) {
 }
 
 bool PrimatePacketizerList::shouldAddToPacket(const MachineInstr &MI) {
+  // some LSU is free, but it has to be the one of MI's bank
+  if (const MCInstrDesc *BankDesc = getMemBankDesc(MI))
+    return ResourceTracker->canReserveResources(BankDesc);
   return true;
 }
 
@@ -467,7 +493,8 @@ bool PrimatePacketizerList::isLegalToPacketizeTogether(SUnit *SUI, SUnit *SUJ) {
     SDep::Kind DepType = SUJ->Succs[i].getKind();
     switch(DepType) {
     case SDep::Kind::Data: {
-      if(SUI->getInstr()->getOpcode() == Primate::INSERT) {
+      if(SUI->getInstr()->getOpcode() == Primate::INSERT ||
+         SUI->getInstr()->getOpcode() == Primate::INSERT_SWAP) {
         LLVM_DEBUG({
           dbgs() << "Legal to packetize:\n\t";
           SUI->getInstr()->print(dbgs());
@@ -495,7 +522,8 @@ bool PrimatePacketizerList::isLegalToPacketizeTogether(SUnit *SUI, SUnit *SUJ) {
     //  dbgs() << "\tDue to WAR hazard\n";
     //  return false;
     case SDep::Kind::Output: {
-      if(SUI->getInstr()->getOpcode() == Primate::INSERT) {
+      if(SUI->getInstr()->getOpcode() == Primate::INSERT ||
+         SUI->getInstr()->getOpcode() == Primate::INSERT_SWAP) {
         LLVM_DEBUG({
           dbgs() << "Legal to packetize:\n\t";
           SUI->getInstr()->print(dbgs());
@@ -36,6 +36,7 @@ private:
   const PrimateTargetLowering *PLI;
 
   bool insertBypassOps(MachineInstr* br_inst, llvm::SmallVector<MachineInstr*, 2>& generated_bypass_ops);
+  const MCInstrDesc *getMemBankDesc(const MachineInstr &MI) const;
 
 public:
   PrimatePacketizerList(MachineFunction &MF, MachineLoopInfo &MLI,
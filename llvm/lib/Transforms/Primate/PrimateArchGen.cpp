@@ -21,15 +21,81 @@ Boundary Conditions: empty set for flow value. identified by no successors.
 
 #include <llvm/Support/Casting.h>
 #include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/Format.h>
 #include <llvm/Support/FormattedStream.h>
 #include <llvm/Transforms/Primate/PrimateArchGen.h>
+#include <llvm/Transforms/Primate/PrimateMain.h>
 #include <cstddef>
 #include <system_error>
 #include <algorithm>
-#include "llvm/Demangle/Demangle.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/ProfDataUtils.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include <functional>
 
 using namespace llvm;
 
+static cl::opt<unsigned> PrimateDefaultTripCount(
+    "primate-default-trip-count", cl::Hidden, cl::init(8),
+    cl::desc("Iterations archgen assumes for loops with no known trip count"));
+
+static cl::opt<unsigned> PrimateAtomicLatency(
+    "primate-atomic-latency", cl::Hidden, cl::init(2),
+    cl::desc("Cycles an atomic read-modify-write holds the LSU"));
+
+static cl::opt<double> PrimateDropFraction(
+    "primate-drop-fraction", cl::Hidden, cl::init(0.0),
+    cl::desc("Fraction of packets archgen assumes end on a drop path"));
+
+static cl::opt<unsigned> PrimateMaxLSUs(
+    "primate-max-lsus", cl::Hidden, cl::init(4),
+    cl::desc("Most LSUs (data memory banks) archgen may instance, up to 4"));
+
+static cl::opt<double> PrimateBankMinConflict(
+    "primate-bank-min-conflict", cl::Hidden, cl::init(0.05),
+    cl::desc("Share of the memory traffic that has to collide with a bank "
+             "before archgen opens another one"));
+
+static cl::list<std::string> PrimateMemBankPins(
+    "primate-mem-bank", cl::Hidden, cl::CommaSeparated,
+    cl::desc("Put a global in a data memory bank, <global>:<bank>, e.g. "
+             "where the other programs of its family have it"));
+
+static cl::opt<std::string> PrimateFamily(
+    "primate-family", cl::Hidden, cl::init(""),
+    cl::desc("File collecting the requirements of every program that has to "
+             "run on the same hardware, archgen emits their union"));
+
+static cl::opt<std::string> PrimateFamilyName(
+    "primate-family-name", cl::Hidden, cl::init(""),
+    cl::desc("Name of this program in -primate-family (default: its source "
+             "file)"));
+
+static cl::opt<double> PrimateALUCapHeadroom(
+    "primate-alu-cap-headroom", cl::Hidden, cl::init(1.5),
+    cl::desc("Lanes archgen gives an ALU capability relative to its share "
+             "of the green ops"));
+
+static cl::opt<double> PrimateALUCapMinArea(
+    "primate-alu-cap-min-area", cl::Hidden, cl::init(0.2),
+    cl::desc("Smallest area (in base lanes) an ALU capability must cost to "
+             "be left out of some lanes"));
+
 // set the boundary condition for block
 // explicit constructor of BitVector
 void PrimateArchGen::setBoundaryCondition(BitVector *BlkBoundry) {
@@ -171,6 +237,1051 @@ bool PrimateArchGen::isBlueCall(Instruction *ii) {
     return res;
 }
 
+// Input, output and seek intrinsics plus calls into the IO BFU all issue to
+// the one IO unit.
+bool PrimateArchGen::isIOOp(Instruction *ii) {
+    auto *call = dyn_cast<CallInst>(ii);
+    if (!call) {
+        return false;
+    }
+    if (auto *intrin = dyn_cast<IntrinsicInst>(call)) {
+        switch (intrin->getIntrinsicID()) {
+        case Intrinsic::primate_input:
+        case Intrinsic::primate_input_seek:
+        case Intrinsic::primate_input_done:
+        case Intrinsic::primate_input_len:
+        case Intrinsic::primate_output:
+        case Intrinsic::primate_output_seek:
+        case Intrinsic::primate_output_done:
+        case Intrinsic::primate_drop:
+            return true;
+        default:
+            break;
+        }
+    }
+    MDNode *primateMD = call->getMetadata("primate");
+    if (!primateMD && call->getCalledFunction()) {
+        primateMD = call->getCalledFunction()->getMetadata("primate");
+    }
+    return primateMD && primateMD->getNumOperands() > 1 &&
+           cast<MDString>(primateMD->getOperand(0))->getString() == "blue" &&
+           cast<MDString>(primateMD->getOperand(1))->getString() == "IO";
+}
+
+// Whether GV's address goes anywhere but the pointer operand of a memory
+// access, so that accesses through other pointers may reach it.
+bool PrimateArchGen::addressEscapes(GlobalVariable *GV) {
+    SmallVector<Value*, 8> worklist = {GV};
+    SmallPtrSet<Value*, 8> visited;
+    while (!worklist.empty()) {
+        Value *V = worklist.pop_back_val();
+        if (!visited.insert(V).second) {
+            continue;
+        }
+        for (User *U : V->users()) {
+            if (isa<GEPOperator>(U) || isa<BitCastOperator>(U)) {
+                worklist.push_back(U);
+            } else if (isa<LoadInst>(U)) {
+                continue;
+            } else if (auto *store = dyn_cast<StoreInst>(U)) {
+                if (store->getValueOperand() == V) {
+                    return true;
+                }
+            } else if (auto *rmw = dyn_cast<AtomicRMWInst>(U)) {
+                if (rmw->getValOperand() == V) {
+                    return true;
+                }
+            } else if (auto *cas = dyn_cast<AtomicCmpXchgInst>(U)) {
+                if (cas->getPointerOperand() != V) {
+                    return true;
+                }
+            } else {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Linker script fragment placing every bank in its own memory, given the
+// globals of each bank. Needs -fdata-sections. Bank 0 takes everything not
+// placed elsewhere, so it comes last.
+static void writeBankScript(raw_ostream &bankLD,
+                            const std::vector<std::vector<std::string>> &members) {
+    bankLD << "/* data memory banks, one per LSU */\n";
+    bankLD << "SECTIONS\n{\n";
+    for (unsigned b = members.size(); b-- > 0;) {
+        bankLD << "  .primate.bank" << b << " " << format_hex(b << 24, 10)
+               << " : {\n";
+        for (const std::string &GV : members[b]) {
+            bankLD << "    *(.data." << GV << " .bss." << GV << " .sdata."
+                   << GV << " .sbss." << GV << " .rodata." << GV << ")\n";
+        }
+        if (b == 0) {
+            bankLD << "    *(.data .data.* .sdata .sdata.* .bss .bss.* "
+                      ".sbss .sbss.* .rodata .rodata.*)\n";
+        }
+        bankLD << "  }\n";
+    }
+    bankLD << "}\n";
+}
+
+// Splits the globals the program accesses into data memory banks, one LSU
+// each, so that accesses to different banks can issue in the same packet.
+// Globals an access may reach through the same pointer share a bank, and
+// anything reached through pointers that cannot be followed lives in bank 0
+// with the escaping globals, as do globals a pointer shares with the stack.
+// The backend maps every access the same way and refuses any that this
+// leaves without a single bank. The rest are placed greedily, hottest first,
+// in the bank they collide least with (accesses in the same block, weighted
+// per packet). A new bank is opened while the collision is above
+// -primate-bank-min-conflict of the traffic. Globals given a bank with
+// -primate-mem-bank go there with their group, unless the group has to be
+// in bank 0. evalPerf charges every access to the LSU of its bank.
+void PrimateArchGen::planMemBanks(Module &M) {
+    const unsigned MAX_LSU_POSSIBLE = 4; // banks the backend can tell apart
+    if (PrimateMaxLSUs < 1 || PrimateMaxLSUs > MAX_LSU_POSSIBLE) {
+        M.getContext().diagnose(DiagnosticInfoGeneric(
+            "-primate-max-lsus=" + Twine(unsigned(PrimateMaxLSUs)) +
+            " is not between 1 and the " + Twine(MAX_LSU_POSSIBLE) +
+            " data memory banks the backend can tell apart"));
+    }
+    unsigned maxLSUs = std::clamp<unsigned>(PrimateMaxLSUs, 1,
+                                            MAX_LSU_POSSIBLE);
+    std::map<std::string, unsigned> userBanks;
+    for (StringRef pin : PrimateMemBankPins) {
+        auto [name, bankStr] = pin.rsplit(':');
+        unsigned bank;
+        if (bankStr.getAsInteger(10, bank) || bank >= maxLSUs) {
+            errs() << "ignoring -primate-mem-bank=" << pin << ": the bank has "
+                   << "to be below " << maxLSUs << "\n";
+            continue;
+        }
+        userBanks[name.str()] = bank;
+    }
+
+    EquivalenceClasses<GlobalVariable*> mustShare;
+    MapVector<GlobalVariable*, double> traffic; // in order of first access
+    std::map<std::pair<GlobalVariable*, GlobalVariable*>, double> together;
+    std::set<GlobalVariable*> pinned;
+    std::vector<GlobalVariable*> mixed; // also reach non-globals
+    bool unknownAccess = false;
+    double totalTraffic = 0.0;
+
+    for (auto &F : M) {
+        for (auto &BB : F) {
+            auto weight = bbWeight.find(&BB);
+            double w = weight == bbWeight.end() ? 1.0 : weight->second;
+            MapVector<GlobalVariable*, int> accesses;
+            for (auto &I : BB) {
+                SmallVector<Value*, 2> ptrs;
+                if (Value *ptr = getLoadStorePointerOperand(&I)) {
+                    ptrs.push_back(ptr);
+                } else if (auto *rmw = dyn_cast<AtomicRMWInst>(&I)) {
+                    ptrs.push_back(rmw->getPointerOperand());
+                } else if (auto *cas = dyn_cast<AtomicCmpXchgInst>(&I)) {
+                    ptrs.push_back(cas->getPointerOperand());
+                } else if (auto *mi = dyn_cast<MemIntrinsic>(&I)) {
+                    // lowered to loads and stores of the same objects
+                    ptrs.push_back(mi->getRawDest());
+                    if (auto *mt = dyn_cast<MemTransferInst>(mi)) {
+                        ptrs.push_back(mt->getRawSource());
+                    }
+                }
+                for (Value *ptr : ptrs) {
+                    SmallVector<const Value*, 4> objs;
+                    getUnderlyingObjects(ptr, objs);
+                    GlobalVariable *first = nullptr;
+                    bool other = false;
+                    for (const Value *obj : objs) {
+                        auto *GV = dyn_cast<GlobalVariable>(
+                            const_cast<Value*>(obj));
+                        if (!GV) {
+                            unknownAccess |= !isa<AllocaInst>(obj);
+                            other = true;
+                            continue;
+                        }
+                        mustShare.insert(GV);
+                        // listed in MEM_BANKS even if never the access's
+                        // own global, the backend looks every one up
+                        traffic.insert({GV, 0.0});
+                        if (first) {
+                            mustShare.unionSets(first, GV);
+                        }
+                        first = GV;
+                    }
+                    if (first) {
+                        accesses[first]++;
+                        // the same access may hit the stack or memory we
+                        // cannot follow, both of which are in bank 0
+                        if (other) {
+                            mixed.push_back(first);
+                        }
+                    }
+                }
+            }
+            for (auto &[GV, count] : accesses) {
+                traffic[GV] += w * count;
+                totalTraffic += w * count;
+                for (auto &[other, otherCount] : accesses) {
+                    if (GV < other) {
+                        together[{GV, other}] += w * std::min(count, otherCount);
+                    }
+                }
+            }
+        }
+    }
+    for (auto &[GV, t] : traffic) {
+        if (unknownAccess && addressEscapes(GV)) {
+            pinned.insert(mustShare.getLeaderValue(GV));
+        }
+    }
+    for (GlobalVariable *GV : mixed) {
+        pinned.insert(mustShare.getLeaderValue(GV));
+    }
+
+    // everything that has to stay together is placed as one group
+    MapVector<GlobalVariable*, double> groupTraffic;
+    std::map<std::pair<GlobalVariable*, GlobalVariable*>, double> groupTogether;
+    for (auto &[GV, t] : traffic) {
+        groupTraffic[mustShare.getLeaderValue(GV)] += t;
+    }
+    for (auto &[pair, t] : together) {
+        GlobalVariable *a = mustShare.getLeaderValue(pair.first);
+        GlobalVariable *b = mustShare.getLeaderValue(pair.second);
+        if (a != b) {
+            groupTogether[{std::min(a, b), std::max(a, b)}] += t;
+        }
+    }
+    std::vector<GlobalVariable*> groups;
+    for (auto &[leader, t] : groupTraffic) {
+        groups.push_back(leader);
+    }
+    llvm::stable_sort(groups, [&](GlobalVariable *a, GlobalVariable *b) {
+        return groupTraffic[a] > groupTraffic[b];
+    });
+
+    std::vector<std::vector<GlobalVariable*>> banks(1);
+    std::map<GlobalVariable*, unsigned> groupBank;
+    for (GlobalVariable *group : groups) {
+        if (pinned.count(group)) {
+            banks[0].push_back(group);
+            groupBank[group] = 0;
+        }
+    }
+    for (auto &[GV, t] : traffic) {
+        auto pin = userBanks.find(GV->getName().str());
+        GlobalVariable *group = mustShare.getLeaderValue(GV);
+        if (pin == userBanks.end() || groupBank.count(group)) {
+            if (pin != userBanks.end() && groupBank[group] != pin->second) {
+                errs() << "cannot put " << GV->getName() << " in bank "
+                       << pin->second << ", it shares bank "
+                       << groupBank[group] << " with other memory\n";
+            }
+            continue;
+        }
+        if (banks.size() <= pin->second) {
+            banks.resize(pin->second + 1);
+        }
+        banks[pin->second].push_back(group);
+        groupBank[group] = pin->second;
+    }
+    for (GlobalVariable *group : groups) {
+        if (groupBank.count(group)) {
+            continue;
+        }
+        unsigned best = 0;
+        double bestConflict = -1.0;
+        for (unsigned b = 0; b < banks.size(); b++) {
+            double conflict = 0.0;
+            for (GlobalVariable *other : banks[b]) {
+                conflict += groupTogether[{std::min(group, other),
+                                           std::max(group, other)}];
+            }
+            if (bestConflict < 0.0 || conflict < bestConflict) {
+                best = b;
+                bestConflict = conflict;
+            }
+        }
+        if (bestConflict > PrimateBankMinConflict * totalTraffic &&
+            banks.size() < maxLSUs) {
+            best = banks.size();
+            banks.emplace_back();
+        }
+        banks[best].push_back(group);
+        groupBank[group] = best;
+    }
+
+    memBankOf.clear();
+    memBankMembers.assign(banks.size(), {});
+    memBankTraffic.assign(banks.size(), 0.0);
+    for (auto &[GV, t] : traffic) {
+        unsigned b = groupBank[mustShare.getLeaderValue(GV)];
+        memBankOf[GV] = b;
+        memBankMembers[b].push_back(GV);
+        memBankTraffic[b] += t;
+    }
+}
+
+// The bank of the global a load, store or atomic accesses; everything else
+// is in bank 0.
+unsigned PrimateArchGen::getMemBank(Instruction *ii) {
+    Value *ptr = getLoadStorePointerOperand(ii);
+    if (auto *rmw = dyn_cast<AtomicRMWInst>(ii)) {
+        ptr = rmw->getPointerOperand();
+    } else if (auto *cas = dyn_cast<AtomicCmpXchgInst>(ii)) {
+        ptr = cas->getPointerOperand();
+    }
+    if (!ptr) {
+        return 0;
+    }
+    auto *GV = dyn_cast<GlobalVariable>(getUnderlyingObject(ptr));
+    auto it = memBankOf.find(GV);
+    return it == memBankOf.end() ? 0 : it->second;
+}
+
+// Writes the banks planMemBanks chose: NUM_LSUS and MEM_BANKS in
+// primate.cfg, and banks.ld. Returns the number of LSUs.
+unsigned PrimateArchGen::assignMemBanks(Module &M, raw_fd_stream &primateCFG,
+                                        raw_fd_stream &bankLD) {
+    if (memBankMembers.empty()) {
+        planMemBanks(M);
+    }
+    const auto &members = memBankMembers;
+    primateCFG << "NUM_LSUS=" << members.size() << "\n";
+    primateCFG << "MEM_BANKS=";
+    for (unsigned b = 0; b < members.size(); b++) {
+        for (GlobalVariable *GV : members[b]) {
+            primateCFG << GV->getName() << ":" << b << " ";
+        }
+    }
+    primateCFG << "\n";
+    for (unsigned b = 0; b < members.size(); b++) {
+        errs() << "LSU " << b << ": " << members[b].size() << " global(s), "
+               << memBankTraffic[b] << " accesses per packet\n";
+    }
+
+    std::vector<std::vector<std::string>> names(members.size());
+    for (unsigned b = 0; b < members.size(); b++) {
+        for (GlobalVariable *GV : members[b]) {
+            names[b].push_back(GV->getName().str());
+        }
+    }
+    writeBankScript(bankLD, names);
+    return members.size();
+}
+
+// The optional part of a lane an op needs, 0 for ops every lane can do.
+unsigned PrimateArchGen::getALUCap(Instruction *ii) {
+    switch (ii->getOpcode()) {
+    case Instruction::Mul:
+    case Instruction::UDiv:
+    case Instruction::SDiv:
+    case Instruction::URem:
+    case Instruction::SRem:
+        return CapMul;
+    case Instruction::Shl:
+    case Instruction::LShr:
+    case Instruction::AShr:
+        return CapShift;
+    case Instruction::ICmp:
+        // a compare that only feeds branches is done by the branch unit
+        return all_of(ii->users(), [](User *U) { return isa<BranchInst>(U); })
+                   ? 0 : CapCompare;
+    default:
+        break;
+    }
+    if (auto *intrin = dyn_cast<IntrinsicInst>(ii)) {
+        switch (intrin->getIntrinsicID()) {
+        case Intrinsic::bswap:
+            return isFieldBSwap(ii) ? 0 : CapBitManip;
+        case Intrinsic::ctlz:
+        case Intrinsic::cttz:
+        case Intrinsic::ctpop:
+        case Intrinsic::bitreverse:
+        case Intrinsic::fshl:
+        case Intrinsic::fshr:
+        case Intrinsic::smin:
+        case Intrinsic::smax:
+        case Intrinsic::umin:
+        case Intrinsic::umax:
+        case Intrinsic::abs:
+            return CapBitManip;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+// ntohs/ntohl of a field read or htons/htonl of a field write. The extract
+// and insert units do the swap when they are built with FIELD_BSWAP.
+bool PrimateArchGen::isFieldBSwap(Instruction *ii) {
+    auto *intrin = dyn_cast<IntrinsicInst>(ii);
+    if (!intrin || intrin->getIntrinsicID() != Intrinsic::bswap) {
+        return false;
+    }
+    Value *src = intrin->getArgOperand(0);
+    if (auto *trunc = dyn_cast<TruncInst>(src)) {
+        src = trunc->getOperand(0);
+    }
+    if (isa<ExtractValueInst>(src)) {
+        return true;
+    }
+    return !intrin->user_empty() && all_of(intrin->users(), [](User *U) {
+        if (isa<ZExtInst>(U) && U->hasOneUse()) {
+            U = *U->user_begin();
+        }
+        return isa<InsertValueInst>(U);
+    });
+}
+
+// Lanes do not all need a multiplier, a barrel shifter or bit-manip logic.
+// Each capability gets lanes in proportion to its share of the weighted
+// green ops, at least one since lowering may introduce any of them, and the
+// first lanes get them so the capabilities nest. Capabilities too cheap to
+// matter stay on every lane. The area left over is reported as full lanes.
+void PrimateArchGen::printLaneCaps(Module &M, unsigned numLanes,
+                                   raw_fd_stream &primateCFG) {
+    static const struct {
+        aluCap_t cap;
+        const char *name;
+        double area; // relative to the base lane
+    } caps[] = {
+        {CapMul, "mul", 1.5},
+        {CapShift, "shift", 0.4},
+        {CapBitManip, "bitmanip", 0.5},
+        {CapCompare, "compare", 0.1},
+    };
+
+    std::map<unsigned, double> demand;
+    double total = 0.0;
+    for (auto &F : M) {
+        for (auto &I : instructions(F)) {
+            unsigned cap = getALUCap(&I);
+            if (!cap && (isa<CmpInst>(I) ||
+                         (!isa<BinaryOperator>(I) && !isa<CastInst>(I) &&
+                          !isa<SelectInst>(I)))) {
+                continue;
+            }
+            auto weight = bbWeight.find(I.getParent());
+            double w = weight == bbWeight.end() ? 1.0 : weight->second;
+            demand[cap] += w;
+            total += w;
+        }
+    }
+
+    std::vector<unsigned> laneCaps(numLanes, 0);
+    double area = numLanes;
+    double fullLane = 1.0;
+    for (auto &c : caps) {
+        double share = total == 0.0 ? 0.0 : demand[c.cap] / total;
+        unsigned lanes = numLanes;
+        if (c.area >= PrimateALUCapMinArea) {
+            lanes = std::clamp<unsigned>(
+                ceil(share * numLanes * PrimateALUCapHeadroom), 1, numLanes);
+        }
+        for (unsigned i = 0; i < lanes; i++) {
+            laneCaps[i] |= c.cap;
+        }
+        area += lanes * c.area;
+        fullLane += c.area;
+        errs() << c.name << ": " << share * 100.0 << "% of green ops, "
+               << lanes << " of " << numLanes << " lanes\n";
+    }
+    errs() << "ALU area: " << area << " base lanes, "
+           << numLanes * fullLane - area << " saved ("
+           << (numLanes * fullLane - area) / fullLane << " full lanes)\n";
+
+    primateCFG << "ALU_CAPS=";
+    for (unsigned cap : laneCaps) {
+        primateCFG << cap << " ";
+    }
+    primateCFG << "\n";
+}
+
+// Knobs of primate.cfg the family takes the largest value of.
+static const char *const familyKnobs[] = {
+    "NUM_THREADS", "NUM_REGS",  "REG_WIDTH",   "NUM_ALUS",   "NUM_BFUS",
+    "NUM_LSUS",    "IMM_WIDTH", "FIELD_BSWAP", "LSU_ATOMICS"};
+
+static unsigned familyKnob(const std::map<std::string, std::string> &entry,
+                           StringRef knob) {
+    auto it = entry.find(knob.str());
+    unsigned value = 0;
+    if (it == entry.end() || StringRef(it->second).trim().getAsInteger(10, value)) {
+        return 0;
+    }
+    return value;
+}
+
+// Lanes with each ALU capability, from an ALU_CAPS list.
+static std::map<unsigned, unsigned> familyCapLanes(StringRef aluCaps) {
+    std::map<unsigned, unsigned> lanes;
+    SmallVector<StringRef, 8> toks;
+    aluCaps.split(toks, ' ', -1, false);
+    for (StringRef tok : toks) {
+        unsigned caps = 0;
+        if (tok.getAsInteger(10, caps)) {
+            continue;
+        }
+        for (unsigned bit = 1; bit <= 8; bit <<= 1) {
+            lanes[bit] += (caps & bit) ? 1 : 0;
+        }
+    }
+    return lanes;
+}
+
+// BFU name -> ALUs connected to it, from interconnect.cfg lines joined by ';'.
+static std::map<std::string, std::vector<unsigned>>
+familyInterconnect(StringRef interconnect) {
+    std::map<std::string, std::vector<unsigned>> bfus;
+    SmallVector<StringRef, 8> lines;
+    interconnect.split(lines, ';', -1, false);
+    for (StringRef line : lines) {
+        auto [name, bits] = line.split(':');
+        SmallVector<StringRef, 8> toks;
+        bits.split(toks, ' ', -1, false);
+        auto &alus = bfus[name.trim().str()];
+        for (StringRef tok : toks) {
+            unsigned bit = 0;
+            tok.getAsInteger(10, bit);
+            alus.push_back(bit);
+        }
+    }
+    return bfus;
+}
+
+// Reads what the other programs of the family left in -primate-family. The
+// entry of this program is replaced at the end of run.
+void PrimateArchGen::loadFamily(Module &M) {
+    familyName = PrimateFamilyName.empty() ? M.getSourceFileName()
+                                           : PrimateFamilyName;
+    family.clear();
+    familyOwn.clear();
+    auto buf = MemoryBuffer::getFile(PrimateFamily);
+    if (!buf) {
+        return;
+    }
+    SmallVector<StringRef, 64> lines;
+    (*buf)->getBuffer().split(lines, '\n', -1, false);
+    std::map<std::string, std::string> *entry = nullptr;
+    for (StringRef line : lines) {
+        auto [key, value] = line.split('=');
+        if (key == "PROGRAM") {
+            entry = &family[value.trim().str()];
+        } else if (entry) {
+            (*entry)[key.trim().str()] = value.trim().str();
+        }
+    }
+    family.erase(familyName);
+}
+
+// The register file has to hold the fields of every program: this one's are
+// recorded, the others' are added to fieldIndex before the layout knobs are
+// derived from it.
+void PrimateArchGen::mergeFamilyFields(unsigned &maxRegWidth) {
+    std::string fields;
+    for (const auto &[offset, sizes] : *fieldIndex) {
+        for (unsigned size : *sizes) {
+            fields += std::to_string(offset) + ":" + std::to_string(size) + " ";
+        }
+    }
+    familyOwn["FIELDS"] = fields;
+    familyOwn["REG_WIDTH"] = std::to_string(maxRegWidth);
+
+    for (auto &[name, entry] : family) {
+        maxRegWidth = std::max(maxRegWidth, familyKnob(entry, "REG_WIDTH"));
+        SmallVector<StringRef, 16> toks;
+        StringRef(entry["FIELDS"]).split(toks, ' ', -1, false);
+        for (StringRef tok : toks) {
+            auto [offsetStr, sizeStr] = tok.split(':');
+            unsigned offset, size;
+            if (offsetStr.getAsInteger(10, offset) ||
+                sizeStr.getAsInteger(10, size)) {
+                continue;
+            }
+            if (fieldIndex->find(offset) == fieldIndex->end()) {
+                (*fieldIndex)[offset] = new std::set<unsigned>();
+            }
+            (*fieldIndex)[offset]->insert(size);
+            gatherModes->insert(size);
+        }
+    }
+}
+
+// Cycles per packet for every ALU count the shared hardware could have, so
+// the family report can tell how F runs on lanes sized for another program.
+void PrimateArchGen::recordPerfCurve(Function &F, int numALU) {
+    perfCurve.clear();
+    for (int n = std::max(numALU_min, 1); n <= std::max(numALU, 7); n++) {
+        double perf, util;
+        evalPerf(F, n, perf, util);
+        perfCurve[n] = perf;
+    }
+    optimizeDependencyForest(2, numALU);
+    VLIWSim(F, numALU);
+}
+
+// ROM k is BFU base + k in every program, so the family keeps the slots:
+// each is deep, wide and slow enough for every program's table in it. The
+// contents are this program's, or those of the first program with a table in
+// the slot. Programs with different tables in one slot need separate cores.
+void PrimateArchGen::writeFamilyROMs(raw_fd_stream &romCFG) {
+    unsigned numROMs = 0;
+    for (auto &[name, entry] : family) {
+        numROMs = std::max(numROMs, familyKnob(entry, "NUM_ROMS"));
+    }
+    romCFG << "NUM_ROMS=" << numROMs << "\n";
+    for (unsigned i = 0; i < numROMs; i++) {
+        std::string prefix = "ROM_" + std::to_string(i) + "_";
+        std::string unitName, init, owner;
+        unsigned depth = 0, width = 0, latency = 0;
+        auto takeSlot = [&](const std::string &name,
+                            std::map<std::string, std::string> &entry) {
+            if (familyKnob(entry, prefix + "DEPTH") == 0) {
+                return;
+            }
+            depth = std::max(depth, familyKnob(entry, prefix + "DEPTH"));
+            width = std::max(width, familyKnob(entry, prefix + "WIDTH"));
+            latency = std::max(latency, familyKnob(entry, prefix + "LATENCY"));
+            if (unitName.empty()) {
+                unitName = entry[prefix + "NAME"];
+                init = entry[prefix + "INIT"];
+                owner = name;
+            } else if (entry[prefix + "NAME"] != unitName) {
+                errs() << "program family: ROM " << i << " holds "
+                       << unitName << " in " << owner << " but "
+                       << entry[prefix + "NAME"] << " in " << name << "\n";
+            }
+        };
+        takeSlot(familyName, family[familyName]);
+        for (auto &[name, entry] : family) {
+            if (name != familyName) {
+                takeSlot(name, entry);
+            }
+        }
+        if (depth == 0) {
+            romCFG << prefix << "DEPTH=0\n";
+            continue;
+        }
+        romCFG << prefix << "NAME=" << unitName << "\n";
+        romCFG << prefix << "DEPTH=" << depth << "\n";
+        romCFG << prefix << "WIDTH=" << width << "\n";
+        romCFG << prefix << "LATENCY=" << latency << "\n";
+        romCFG << prefix << "INIT=" << init << "\n";
+    }
+}
+
+// Model units are matched by name: the family has each once, with the
+// widest state, the longest latency, the most instances any program declares
+// and every operation any program implements. This program's models come
+// first, so its unit indices do not move.
+void PrimateArchGen::writeFamilyModels(raw_fd_stream &modelCFG) {
+    struct familyModel {
+        unsigned stateWidth = 0, latency = 0, numInstances = 0;
+        std::map<unsigned, std::string> ops;
+    };
+    std::vector<std::string> order;
+    std::map<std::string, familyModel> models;
+    auto takeModels = [&](std::map<std::string, std::string> &entry) {
+        for (unsigned i = 0; i < familyKnob(entry, "NUM_MODELS"); i++) {
+            std::string prefix = "MODEL_" + std::to_string(i) + "_";
+            std::string unitName = entry[prefix + "NAME"];
+            if (!models.count(unitName)) {
+                order.push_back(unitName);
+            }
+            familyModel &model = models[unitName];
+            model.stateWidth = std::max(
+                model.stateWidth, familyKnob(entry, prefix + "STATE_WIDTH"));
+            model.latency =
+                std::max(model.latency, familyKnob(entry, prefix + "LATENCY"));
+            model.numInstances = std::max(
+                model.numInstances, familyKnob(entry, prefix + "NUM_INSTANCES"));
+            for (auto &[key, value] : entry) {
+                unsigned opIdx;
+                StringRef op(key);
+                if (op.consume_front(prefix + "OP_") &&
+                    !op.getAsInteger(10, opIdx)) {
+                    model.ops.try_emplace(opIdx, value);
+                }
+            }
+        }
+    };
+    takeModels(family[familyName]);
+    for (auto &[name, entry] : family) {
+        if (name != familyName) {
+            takeModels(entry);
+        }
+    }
+
+    modelCFG << "NUM_MODELS=" << order.size() << "\n";
+    for (unsigned i = 0; i < order.size(); i++) {
+        familyModel &model = models[order[i]];
+        modelCFG << "MODEL_" << i << "_NAME=" << order[i] << "\n";
+        modelCFG << "MODEL_" << i << "_STATE_WIDTH=" << model.stateWidth
+                 << "\n";
+        modelCFG << "MODEL_" << i << "_LATENCY=" << model.latency << "\n";
+        modelCFG << "MODEL_" << i << "_NUM_INSTANCES=" << model.numInstances
+                 << "\n";
+        modelCFG << "MODEL_" << i << "_NUM_OPS=" << model.ops.size() << "\n";
+        for (auto &[opIdx, op] : model.ops) {
+            modelCFG << "MODEL_" << i << "_OP_" << opIdx << "=" << op << "\n";
+        }
+    }
+}
+
+// Adds this program to -primate-family and rewrites primate.cfg and
+// interconnect.cfg for the whole family. Register fields were merged by
+// mergeFamilyFields. Counts and widths take the largest value any program
+// needs, each capability the most lanes any program gives it (on the first
+// lanes, as printLaneCaps places them), and each BFU the union of the ALUs
+// the programs connect it to. That is the smallest configuration every
+// program fits, since each knob only has to cover the largest demand. Data
+// memory banks are the union of the programs' mappings, and banks.ld is
+// rewritten to match; a family whose programs put the same global in
+// different banks is rejected. rom.cfg and model.cfg get every program's
+// units (see writeFamilyROMs and writeFamilyModels).
+void PrimateArchGen::writeFamily(Module &M) {
+    auto cfgBuf = MemoryBuffer::getFile(outputDir + "primate.cfg");
+    auto icBuf = MemoryBuffer::getFile(outputDir + "interconnect.cfg");
+    if (!cfgBuf || !icBuf) {
+        errs() << "program family: cannot read back primate.cfg\n";
+        return;
+    }
+    // the ROM and model units are kept with the program's other requirements
+    for (const char *unitCfg : {"rom.cfg", "model.cfg"}) {
+        auto buf = MemoryBuffer::getFile(outputDir + unitCfg);
+        if (!buf) {
+            continue;
+        }
+        SmallVector<StringRef, 32> lines;
+        (*buf)->getBuffer().split(lines, '\n', -1, false);
+        for (StringRef line : lines) {
+            auto [key, value] = line.split('=');
+            familyOwn[key.trim().str()] = value.trim().str();
+        }
+    }
+    SmallVector<StringRef, 64> cfgLines;
+    (*cfgBuf)->getBuffer().split(cfgLines, '\n', -1, false);
+    SmallVector<StringRef, 16> icLines;
+    (*icBuf)->getBuffer().split(icLines, '\n', -1, false);
+
+    for (StringRef line : cfgLines) {
+        auto [key, value] = line.split('=');
+        if (familyOwn.count(key.str())) {
+            continue; // merged already, primate.cfg has the union
+        }
+        if (key == "ALU_CAPS" || key == "MEM_BANKS" ||
+            is_contained(familyKnobs, key)) {
+            familyOwn[key.str()] = value.trim().str();
+        }
+    }
+    std::string interconnect;
+    for (StringRef line : icLines) {
+        interconnect += line.trim().str() + ";";
+    }
+    familyOwn["INTERCONNECT"] = interconnect;
+    std::string perf;
+    for (auto &[n, cycles] : perfCurve) {
+        perf += std::to_string(n) + ":" + std::to_string(cycles) + " ";
+    }
+    familyOwn["PERF"] = perf;
+    family[familyName] = familyOwn;
+
+    std::map<std::string, unsigned> knobs;
+    std::map<unsigned, unsigned> capLanes;
+    std::map<std::string, std::vector<unsigned>> bfus;
+    std::map<std::string, unsigned> fieldUsers;
+    for (auto &[name, entry] : family) {
+        for (const char *knob : familyKnobs) {
+            knobs[knob] = std::max(knobs[knob], familyKnob(entry, knob));
+        }
+        for (auto &[bit, lanes] : familyCapLanes(entry["ALU_CAPS"])) {
+            capLanes[bit] = std::max(capLanes[bit], lanes);
+        }
+        for (auto &[bfu, alus] : familyInterconnect(entry["INTERCONNECT"])) {
+            auto &shared = bfus[bfu];
+            shared.resize(std::max(shared.size(), alus.size()), 0);
+            for (unsigned i = 0; i < alus.size(); i++) {
+                shared[i] |= alus[i];
+            }
+        }
+        SmallVector<StringRef, 16> fields;
+        StringRef(entry["FIELDS"]).split(fields, ' ', -1, false);
+        for (StringRef field : fields) {
+            fieldUsers[field.str()]++;
+        }
+    }
+    // The backend finds the bank of an access by the name of the global, so
+    // a name has to be in the same bank in every program. Each program keeps
+    // its own grouping, and the family has the union of the mappings.
+    // Versions of one program usually agree; when they do not, this
+    // program can be rerun with the global pinned to the other's bank.
+    std::map<std::string, unsigned> memBanks;
+    std::map<std::string, std::string> bankSetBy;
+    bool bankConflict = false;
+    for (auto &[name, entry] : family) {
+        SmallVector<StringRef, 16> toks;
+        StringRef(entry["MEM_BANKS"]).split(toks, ' ', -1, false);
+        for (StringRef tok : toks) {
+            auto [gv, bankStr] = tok.rsplit(':');
+            unsigned bank;
+            if (bankStr.getAsInteger(10, bank)) {
+                continue;
+            }
+            auto [it, inserted] = memBanks.try_emplace(gv.str(), bank);
+            if (inserted) {
+                bankSetBy[gv.str()] = name;
+                continue;
+            }
+            if (it->second == bank) {
+                continue;
+            }
+            const std::string &other = bankSetBy[gv.str()];
+            unsigned otherBank = name == familyName ? it->second : bank;
+            std::string msg =
+                ("program family: " + gv + " is in bank " + Twine(bank) +
+                 " of " + name + " but in bank " + Twine(it->second) + " of " +
+                 other + "; rerun archgen on " + familyName +
+                 " with -primate-mem-bank=" + gv + ":" + Twine(otherBank))
+                    .str();
+            M.getContext().diagnose(DiagnosticInfoGeneric(msg));
+            bankConflict = true;
+        }
+    }
+    if (bankConflict) {
+        return;
+    }
+    std::vector<std::vector<std::string>> bankMembers(knobs["NUM_LSUS"]);
+    for (auto &[gv, bank] : memBanks) {
+        if (bank >= bankMembers.size()) {
+            bankMembers.resize(bank + 1);
+        }
+        bankMembers[bank].push_back(gv);
+    }
+    knobs["NUM_LSUS"] = std::max<unsigned>(bankMembers.size(), 1);
+
+    unsigned numLanes = knobs["NUM_ALUS"];
+    knobs["NUM_BFUS"] = std::max<unsigned>(
+        knobs["NUM_BFUS"], count_if(bfus, [](auto &bfu) {
+            return bfu.first != "IO";
+        }));
+    std::vector<unsigned> laneCaps(numLanes, 0);
+    for (auto &[bit, lanes] : capLanes) {
+        for (unsigned i = 0; i < std::min(lanes, numLanes); i++) {
+            laneCaps[i] |= bit;
+        }
+    }
+
+    auto reportWrite = [](StringRef path, std::error_code EC) {
+        errs() << "program family: could not write " << path << ": "
+               << EC.message() << "\n";
+    };
+
+    std::error_code familyEC, cfgEC, icEC, bankEC, romEC, modelEC;
+    raw_fd_stream familyOut(PrimateFamily, familyEC);
+    if (familyEC) {
+        reportWrite(PrimateFamily, familyEC);
+        return; // the configuration would not include this program later
+    }
+    for (auto &[name, entry] : family) {
+        familyOut << "PROGRAM=" << name << "\n";
+        for (auto &[key, value] : entry) {
+            familyOut << key << "=" << value << "\n";
+        }
+    }
+    familyOut.close();
+
+    raw_fd_stream primateCFG(outputDir + "primate.cfg", cfgEC);
+    if (cfgEC) {
+        reportWrite(outputDir + "primate.cfg", cfgEC);
+        cfgLines.clear();
+    }
+    for (StringRef line : cfgLines) {
+        StringRef key = line.split('=').first;
+        if (key == "ALU_CAPS") {
+            primateCFG << "ALU_CAPS=";
+            for (unsigned caps : laneCaps) {
+                primateCFG << caps << " ";
+            }
+            primateCFG << "\n";
+        } else if (key == "MEM_BANKS") {
+            primateCFG << "MEM_BANKS=";
+            for (unsigned b = 0; b < bankMembers.size(); b++) {
+                for (const std::string &gv : bankMembers[b]) {
+                    primateCFG << gv << ":" << b << " ";
+                }
+            }
+            primateCFG << "\n";
+        } else if (is_contained(familyKnobs, key)) {
+            primateCFG << key << "=" << knobs[key.str()] << "\n";
+        } else {
+            primateCFG << line << "\n";
+        }
+    }
+    if (!cfgEC) {
+        primateCFG.close();
+    }
+
+    raw_fd_stream bankLD(outputDir + "banks.ld", bankEC);
+    if (bankEC) {
+        reportWrite(outputDir + "banks.ld", bankEC);
+    } else {
+        writeBankScript(bankLD, bankMembers);
+        bankLD.close();
+    }
+
+    size_t numALUs = 0;
+    for (auto &[bfu, alus] : bfus) {
+        numALUs = std::max(numALUs, alus.size());
+    }
+    raw_fd_stream interconnectCFG(outputDir + "interconnect.cfg", icEC);
+    if (icEC) {
+        reportWrite(outputDir + "interconnect.cfg", icEC);
+    } else {
+        for (auto &[bfu, alus] : bfus) {
+            interconnectCFG << bfu << ": ";
+            for (unsigned i = 0; i < numALUs; i++) {
+                interconnectCFG << (i < alus.size() ? alus[i] : 0) << " ";
+            }
+            interconnectCFG << "\n";
+        }
+        interconnectCFG.close();
+    }
+
+    raw_fd_stream romCFG(outputDir + "rom.cfg", romEC);
+    if (romEC) {
+        reportWrite(outputDir + "rom.cfg", romEC);
+    } else {
+        writeFamilyROMs(romCFG);
+        romCFG.close();
+    }
+    raw_fd_stream modelCFG(outputDir + "model.cfg", modelEC);
+    if (modelEC) {
+        reportWrite(outputDir + "model.cfg", modelEC);
+    } else {
+        writeFamilyModels(modelCFG);
+        modelCFG.close();
+    }
+
+    // how each program runs on the shared hardware, and what it holds up
+    errs() << "program family: " << family.size() << " program(s)\n";
+    for (auto &[name, entry] : family) {
+        std::map<unsigned, double> curve;
+        SmallVector<StringRef, 8> toks;
+        StringRef(entry["PERF"]).split(toks, ' ', -1, false);
+        for (StringRef tok : toks) {
+            auto [n, cycles] = tok.split(':');
+            unsigned alus;
+            double c;
+            if (!n.getAsInteger(10, alus) && !cycles.getAsDouble(c)) {
+                curve[alus] = c;
+            }
+        }
+        auto cyclesAt = [&](unsigned alus) {
+            auto it = curve.upper_bound(alus);
+            return it == curve.begin() ? 0.0 : std::prev(it)->second;
+        };
+
+        std::vector<std::string> constrains;
+        for (const char *knob : familyKnobs) {
+            if (knobs[knob] > 0 && familyKnob(entry, knob) == knobs[knob]) {
+                constrains.push_back(knob);
+            }
+        }
+        for (auto &[bit, lanes] : familyCapLanes(entry["ALU_CAPS"])) {
+            if (lanes > 0 && lanes == capLanes[bit] && lanes < numLanes) {
+                constrains.push_back("ALU_CAPS");
+                break;
+            }
+        }
+        SmallVector<StringRef, 16> fields;
+        StringRef(entry["FIELDS"]).split(fields, ' ', -1, false);
+        if (any_of(fields, [&](StringRef f) { return fieldUsers[f.str()] == 1; }) &&
+            family.size() > 1) {
+            constrains.push_back("register fields");
+        }
+
+        errs() << name << ": " << cyclesAt(numLanes)
+               << " cycles per packet on the shared configuration, "
+               << cyclesAt(familyKnob(entry, "NUM_ALUS")) << " on its own, "
+               << "constrains "
+               << (constrains.empty() ? std::string("nothing")
+                                      : join(constrains, ", "))
+               << "\n";
+    }
+}
+
+// Loads and stores of globals go through the LSU. Everything else a
+// program touches lives in registers after archgen.
+bool PrimateArchGen::isSharedAccess(Instruction *ii) {
+    Value *ptr = getLoadStorePointerOperand(ii);
+    return ptr && isa<GlobalVariable>(getUnderlyingObject(ptr));
+}
+
+// Threads updating the same global atomically serialize on the LSU. Report
+// how much of that each packet does, and tell the generator whether the LSU
+// needs its read-modify-write path at all.
+void PrimateArchGen::printAtomicContention(Module &M, unsigned numThreads,
+                                           raw_fd_stream &primateCFG) {
+    std::map<GlobalVariable*, double> updates;
+    for (auto &F : M) {
+        for (auto &I : instructions(F)) {
+            Value *ptr = nullptr;
+            if (auto *rmw = dyn_cast<AtomicRMWInst>(&I)) {
+                ptr = rmw->getPointerOperand();
+            } else if (auto *cas = dyn_cast<AtomicCmpXchgInst>(&I)) {
+                ptr = cas->getPointerOperand();
+            } else {
+                continue;
+            }
+            auto *GV = dyn_cast<GlobalVariable>(getUnderlyingObject(ptr));
+            auto weight = bbWeight.find(I.getParent());
+            updates[GV] += weight == bbWeight.end() ? 1.0 : weight->second;
+        }
+    }
+    primateCFG << "LSU_ATOMICS=" << (updates.empty() ? 0 : 1) << "\n";
+    for (auto &[GV, count] : updates) {
+        errs() << "shared " << (GV ? GV->getName() : "<unknown>") << ": "
+               << count << " atomic update(s) per packet, "
+               << count * PrimateAtomicLatency << " LSU cycles, shared by "
+               << numThreads << " threads\n";
+    }
+}
+
+// With -fsanitize=primate-input, what the bounds checks cost each packet:
+// every check is a compare and a branch, set against the instructions the
+// packet runs anyway.
+void PrimateArchGen::printInputChecks(Module &M) {
+    unsigned checks = 0;
+    double perPacket = 0.0;
+    for (auto &F : M) {
+        for (auto &I : instructions(F)) {
+            if (!I.getMetadata("primate.input.check")) {
+                continue;
+            }
+            checks++;
+            auto weight = bbWeight.find(I.getParent());
+            perPacket += weight == bbWeight.end() ? 1.0 : weight->second;
+        }
+    }
+    if (checks == 0) {
+        return;
+    }
+    double total = 0.0;
+    for (auto &[bb, weight] : bbWeight) {
+        total += weight * bbNumInst[bb];
+    }
+    errs() << "input checks: " << checks << " check(s), " << perPacket
+           << " per packet";
+    if (total > 0.0) {
+        errs() << ", " << format("%.1f", 200.0 * perPacket / total)
+               << "% of the instructions per packet";
+    }
+    errs() << "\n";
+}
+
 unsigned PrimateArchGen::getArrayWidth(ArrayType &a, unsigned start) {
     unsigned num_elem = a.getNumElements();
     auto elem = a.getElementType();
@@ -327,6 +1438,66 @@ Type* followPointerForType(Value* start) {
     }
 }
 
+// Report where each field of a #pragma primate reg struct sits in the wide
+// register, so it is visible at archgen time whether the struct stays in
+// registers.
+void PrimateArchGen::printRegLayouts(Module &M, unsigned regWidth) {
+    NamedMDNode *regMD = M.getNamedMetadata("primate.reg");
+    if (!regMD) {
+        return;
+    }
+    for (MDNode *entry : regMD->operands()) {
+        auto *sty = cast<StructType>(
+            mdconst::extract<Constant>(entry->getOperand(0))->getType());
+        StringRef name = cast<MDString>(entry->getOperand(1))->getString();
+        auto *fieldNames = cast<MDNode>(entry->getOperand(2));
+
+        unsigned width = getStructWidth(*sty, 0, false);
+        unsigned numRegs = (width + regWidth - 1) / regWidth;
+        errs() << "primate reg struct " << name << ": " << width << " bits in "
+               << numRegs << " register(s) of " << regWidth << " bits\n";
+        unsigned pos = 0;
+        for (unsigned i = 0; i < sty->getNumElements(); i++) {
+            Type *elemTy = sty->getElementType(i);
+            StringRef field = cast<MDString>(fieldNames->getOperand(i))->getString();
+            errs() << "    " << (field.empty() ? "<padding>" : field) << ": ";
+            if (!elemTy->isIntegerTy() && !elemTy->isAggregateType()) {
+                errs() << "not register resident (" << *elemTy << ")\n";
+                continue;
+            }
+            unsigned elemWidth = getTypeBitWidth(elemTy, false);
+            errs() << "bits [" << pos << ", " << pos + elemWidth << ") "
+                   << *elemTy << "\n";
+            pos += elemWidth;
+        }
+        if (entry->getNumOperands() < 4) {
+            continue;
+        }
+        for (const MDOperand &bf : cast<MDNode>(entry->getOperand(3))->operands()) {
+            auto *bfMD = cast<MDNode>(bf);
+            StringRef field = cast<MDString>(bfMD->getOperand(0))->getString();
+            unsigned elem = mdconst::extract<ConstantInt>(bfMD->getOperand(1))->getZExtValue();
+            unsigned offset = mdconst::extract<ConstantInt>(bfMD->getOperand(2))->getZExtValue();
+            unsigned size = mdconst::extract<ConstantInt>(bfMD->getOperand(3))->getZExtValue();
+            unsigned bfPos = getElementBitPos(*sty, elem) + offset;
+            errs() << "    bit-field " << field << ": bits [" << bfPos << ", "
+                   << bfPos + size << ")\n";
+        }
+    }
+}
+
+// Position of element idx of a register struct in the packed register layout.
+unsigned PrimateArchGen::getElementBitPos(StructType &s, unsigned idx) {
+    unsigned pos = 0;
+    for (unsigned i = 0; i < idx && i < s.getNumElements(); i++) {
+        Type *elemTy = s.getElementType(i);
+        if (elemTy->isIntegerTy() || elemTy->isAggregateType()) {
+            pos += getTypeBitWidth(elemTy, false);
+        }
+    }
+    return pos;
+}
+
 void PrimateArchGen::printRegfileKnobs(Module &M, raw_fd_stream &primateCFG) {
     auto structTypes = M.getIdentifiedStructTypes();
     unsigned maxRegWidth = 0;
@@ -400,6 +1571,35 @@ void PrimateArchGen::printRegfileKnobs(Module &M, raw_fd_stream &primateCFG) {
             }
         }
     }
+    // structs marked with #pragma primate reg get register fields whether or
+    // not a BFU takes them
+    if (NamedMDNode *regMD = M.getNamedMetadata("primate.reg")) {
+        for (MDNode *entry : regMD->operands()) {
+            Type *regTy = mdconst::extract<Constant>(entry->getOperand(0))->getType();
+            unsigned regWidth = getTypeBitWidth(regTy, true);
+            if (regWidth > maxRegWidth) {
+                maxRegWidth = regWidth;
+            }
+            // bit-fields get a field of their own so that reading one is a
+            // single extract rather than a shift and mask of its storage unit
+            if (entry->getNumOperands() < 4) {
+                continue;
+            }
+            auto *sty = cast<StructType>(regTy);
+            for (const MDOperand &bf : cast<MDNode>(entry->getOperand(3))->operands()) {
+                auto *bfMD = cast<MDNode>(bf);
+                unsigned elem = mdconst::extract<ConstantInt>(bfMD->getOperand(1))->getZExtValue();
+                unsigned offset = mdconst::extract<ConstantInt>(bfMD->getOperand(2))->getZExtValue();
+                unsigned size = mdconst::extract<ConstantInt>(bfMD->getOperand(3))->getZExtValue();
+                unsigned pos = getElementBitPos(*sty, elem) + offset;
+                if (fieldIndex->find(pos) == fieldIndex->end()) {
+                    (*fieldIndex)[pos] = new std::set<unsigned>();
+                }
+                (*fieldIndex)[pos]->insert(size);
+                gatherModes->insert(size);
+            }
+        }
+    }
     // fieldIndex contains the sizes and offsets of all fields in all Primate Structs
     if(maxRegWidth == 0) {
         maxRegWidth = 32;
@@ -413,7 +1613,11 @@ void PrimateArchGen::printRegfileKnobs(Module &M, raw_fd_stream &primateCFG) {
         // fieldIndex contains the sizes and offsets of all fields in all Primate Structs
     }
 
+    if (!PrimateFamily.empty() && !isStage) {
+        mergeFamilyFields(maxRegWidth);
+    }
     primateCFG << "REG_WIDTH=" << maxRegWidth << "\n";
+    printRegLayouts(M, maxRegWidth);
 
     LLVM_DEBUG(dbgs() << "after checking all function calls we have field index mappings: \n";
     for(const auto& [index, value]: *fieldIndex) {
@@ -615,6 +1819,16 @@ std::vector<Value*>* PrimateArchGen::getBFCOutputs(Instruction *ii) {
                 
                 unsigned numIn = unsigned(numIn_i.getZExtValue());
 
+                // an operation of a model unit updates the state of its
+                // instance, so calls on the same instance stay ordered
+                Function *callee = cast<CallInst>(ii)->getCalledFunction();
+                if (callee && callee->getMetadata("primate.model"))
+                    return new std::vector<Value*>({ii->getOperand(0)});
+
+                // a BFU returning its results as a value has no out-params
+                if (!ii->getType()->isVoidTy())
+                    return NULL;
+
                 // last operand is always metadata
                 if (numIn < (ii->getNumOperands()-1)) { 
                     std::vector<Value*> *outList = new std::vector<Value*>();
@@ -641,6 +1855,11 @@ std::vector<Value*>* PrimateArchGen::getBFCInputs(Instruction *ii) {
                         PrimateMetadata->getOperand(3))->getValue())->getValue();
                 
                 unsigned numIn = unsigned(numIn_i.getZExtValue());
+
+                // every argument is an input when the results come back as
+                // the call's value
+                if (!ii->getType()->isVoidTy())
+                    numIn = cast<CallInst>(ii)->arg_size();
                 
                 if (numIn > 0) {
                     std::vector<Value*> *inList = new std::vector<Value*>();
@@ -864,6 +2083,10 @@ void PrimateArchGen::initializeDependencyForest(Function &F) {
                                 unsigned size = getTypeBitWidth(op_type, false);
                                 inOps.push_back({srcPtr, size});
                                 memInstAddRAWDep(inst, srcPtr, size, storeInsts);
+                            } else if (isa<Instruction>(**op)) {
+                                Instruction *op_inst = cast<Instruction>(*op);
+                                if (op_inst->getParent() == bb && (!isa<PHINode>(*op_inst)))
+                                    (*(*dependencyForest)[&*inst])[op_inst] = true;
                             }
                         }
                     }
@@ -906,12 +2129,29 @@ void PrimateArchGen::initializeDependencyForest(Function &F) {
     }
 }
 
+// zext/sext are free, and so is reading one result out of a multi-result
+// BFU call since the BFU writes its results straight into the destination
+// fields.
+static bool isFreeForward(Value *v) {
+    if (isa<ZExtInst>(*v) || isa<SExtInst>(*v))
+        return true;
+    if (auto *ev = dyn_cast<ExtractValueInst>(v)) {
+        auto *ci = dyn_cast<CallInst>(ev->getAggregateOperand());
+        MDNode *md = ci ? ci->getMetadata("primate") : NULL;
+        return md && cast<MDString>(md->getOperand(0))->getString() == "blue";
+    }
+    return false;
+}
+
 void PrimateArchGen::mergeExtInstructions() {
     for (auto it = dependencyForest->begin(); it != dependencyForest->end(); it++) {
         for (auto dep = it->second->begin(); dep != it->second->end();) {
             Value* dep_inst = dep->first;
-            if (isa<ZExtInst>(*dep_inst) || isa<SExtInst>(*dep_inst)) {
-                Value* new_dep = (*dependencyForest)[dep_inst]->begin()->first;
+            if (isFreeForward(dep_inst)) {
+                auto fwd = dependencyForest->find(dep_inst);
+                Value* new_dep = NULL;
+                if (fwd != dependencyForest->end() && !fwd->second->empty())
+                    new_dep = fwd->second->begin()->first;
                 bool rel = dep->second;
                 // errs() << "start erase\n";
                 // errs() << "erase success\n";
@@ -930,7 +2170,7 @@ void PrimateArchGen::mergeExtInstructions() {
     }
     for (auto it = dependencyForest->begin(); it != dependencyForest->end();) {
         Value *inst = it->first;
-        if (isa<ZExtInst>(*inst) || isa<SExtInst>(*inst)) {
+        if (isFreeForward(inst)) {
             dependencyForest->erase(it++);
         } else {
             ++it;
@@ -1703,10 +2943,160 @@ void PrimateArchGen::VLIWSim(Function &F, int numALU) {
     // }
 }
 
+// Expected iterations per entry into L. An exact SCEV trip count wins, then
+// a count from profile branch weights or llvm.loop.primate.trip_count
+// metadata, then the SCEV upper bound. Loops nothing is known about (typically
+// option and TLV walks bounded by the packet) get -primate-default-trip-count.
+double PrimateArchGen::getExpectedTripCount(Loop *L, ScalarEvolution &SE) {
+    if (unsigned tc = SE.getSmallConstantTripCount(L))
+        return tc;
+    if (std::optional<unsigned> est = getLoopEstimatedTripCount(L))
+        if (*est)
+            return *est;
+    if (std::optional<int> md =
+            getOptionalIntLoopAttribute(L, "llvm.loop.primate.trip_count"))
+        if (*md > 0)
+            return *md;
+    if (unsigned max = SE.getSmallConstantMaxTripCount(L))
+        return max;
+    return PrimateDefaultTripCount;
+}
+
+// Longest latency chain from a header phi back to its own latch value. The
+// next iteration cannot start before that chain completes.
+unsigned PrimateArchGen::getRecMII(Loop *L) {
+    BasicBlock *latch = L->getLoopLatch();
+    if (!latch)
+        return 0;
+    unsigned recMII = 0;
+    for (PHINode &phi : L->getHeader()->phis()) {
+        std::map<Value*, int> depth;
+        std::function<int(Value*)> chain = [&](Value *v) -> int {
+            if (v == &phi)
+                return 0;
+            auto *inst = dyn_cast<Instruction>(v);
+            if (!inst || !L->contains(inst) || isa<PHINode>(inst))
+                return -1;
+            auto it = depth.find(v);
+            if (it != depth.end())
+                return it->second;
+            depth[v] = -1;
+            int longest = -1;
+            for (Value *op : inst->operands())
+                longest = std::max(longest, chain(op));
+            if (longest >= 0) {
+                int lat = 1;
+                if (isa<GetElementPtrInst>(inst) || isa<BitCastInst>(inst) ||
+                    isa<ZExtInst>(inst) || isa<SExtInst>(inst) ||
+                    isa<ExtractValueInst>(inst))
+                    lat = 0;
+                else if (isBlueCall(inst))
+                    lat = cast<ConstantInt>(cast<ConstantAsMetadata>(
+                        inst->getMetadata("primate")->getOperand(2))
+                            ->getValue())->getSExtValue();
+                longest += lat;
+            }
+            depth[v] = longest;
+            return longest;
+        };
+        int len = chain(phi.getIncomingValueForBlock(latch));
+        if (len > int(recMII))
+            recMII = len;
+    }
+    return recMII;
+}
+
+// Weight each block by how often it runs per packet: the product of the
+// expected trip counts of the loops around it.
 void PrimateArchGen::initializeBBWeight(Function &F) {
+    DominatorTree DT(F);
+    LoopInfo LI(DT);
+    TargetLibraryInfoImpl TLII(Triple(F.getParent()->getTargetTriple()));
+    TargetLibraryInfo TLI(TLII);
+    AssumptionCache AC(F);
+    ScalarEvolution SE(F, TLI, AC, DT, LI);
+
+    std::map<Loop*, double> tripCount;
+    for (Loop *L : LI.getLoopsInPreorder()) {
+        tripCount[L] = getExpectedTripCount(L, SE);
+        LLVM_DEBUG(dbgs() << "loop " << L->getHeader()->getName()
+                          << ": expected trip count " << tripCount[L] << "\n");
+    }
+
+    loopRecs.clear();
     for (Function::iterator bi = F.begin(); bi != F.end(); bi++) {
         BasicBlock *bb = &*bi;
-        bbWeight[bb] = 1.0;
+        double weight = 1.0;
+        for (Loop *L = LI.getLoopFor(bb); L; L = L->getParentLoop())
+            weight *= tripCount[L];
+        bbWeight[bb] = weight;
+        bbNumIOOps[bb] = count_if(*bb, [&](Instruction &I) {
+            return isIOOp(&I);
+        });
+    }
+
+    // A dropped packet leaves at its drop, so only the forwarded ones run the
+    // blocks past the last drop decision.
+    std::set<BasicBlock*> dropBlocks;
+    for (Instruction &I : instructions(F))
+        if (auto *II = dyn_cast<IntrinsicInst>(&I))
+            if (II->getIntrinsicID() == Intrinsic::primate_drop)
+                dropBlocks.insert(I.getParent());
+    if (!dropBlocks.empty()) {
+        std::set<BasicBlock*> undecided(dropBlocks.begin(), dropBlocks.end());
+        std::vector<BasicBlock*> worklist(dropBlocks.begin(), dropBlocks.end());
+        while (!worklist.empty()) {
+            BasicBlock *bb = worklist.back();
+            worklist.pop_back();
+            for (BasicBlock *pred : predecessors(bb))
+                if (undecided.insert(pred).second)
+                    worklist.push_back(pred);
+        }
+        for (BasicBlock &bb : F) {
+            if (dropBlocks.count(&bb))
+                bbWeight[&bb] *= PrimateDropFraction / dropBlocks.size();
+            else if (!undecided.count(&bb))
+                bbWeight[&bb] *= 1.0 - PrimateDropFraction;
+        }
+    }
+
+    // A specialized primate_main runs its hot version for the share of
+    // packets the guard's weights give it, and the generic one otherwise.
+    for (BasicBlock &guardBB : F) {
+        auto *guard = dyn_cast<BranchInst>(guardBB.getTerminator());
+        uint64_t hot, cold;
+        if (!guard || !guard->getMetadata("primate.specialize") ||
+            !extractBranchWeights(*guard, hot, cold) || hot + cold == 0)
+            continue;
+        double prob = double(hot) / (hot + cold);
+        for (BasicBlock &bb : F) {
+            if (DT.dominates(guard->getSuccessor(0), &bb))
+                bbWeight[&bb] *= prob;
+            else if (DT.dominates(guard->getSuccessor(1), &bb))
+                bbWeight[&bb] *= 1.0 - prob;
+        }
+    }
+    // All threads share the LSU of each bank, and an atomic holds it for the
+    // whole read-modify-write. The banks issue in parallel, so a block takes
+    // as long as its busiest one. The banks follow the weights above.
+    planMemBanks(*F.getParent());
+    for (BasicBlock &bb : F) {
+        std::vector<int> lsuBusy(std::max<size_t>(memBankMembers.size(), 1));
+        for (Instruction &I : bb) {
+            if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I))
+                lsuBusy[getMemBank(&I)] += PrimateAtomicLatency;
+            else if (isSharedAccess(&I))
+                lsuBusy[getMemBank(&I)] += 1;
+        }
+        bbLSUBusy[&bb] = *llvm::max_element(lsuBusy);
+    }
+
+    for (Loop *L : LI.getLoopsInPreorder()) {
+        unsigned recMII = getRecMII(L);
+        LLVM_DEBUG(dbgs() << "loop " << L->getHeader()->getName()
+                          << ": RecMII " << recMII << "\n");
+        if (recMII > 0)
+            loopRecs.push_back({L->getHeader(), L->getBlocks(), recMII});
     }
 }
 
@@ -1718,26 +3108,56 @@ int PrimateArchGen::evalPerf(Function &F, int numALU,
     perf = 0.0;
     util = 0.0;
 
-    int numBB = 0;
+    // the IO unit issues one op per VLIW instruction, so a block that parses
+    // or emits a lot takes at least as many cycles as it has IO ops no matter
+    // how many ALUs there are
+    auto bbCycles = [&](BasicBlock *bb) {
+        return std::max({bbNumVLIWInst[bb], bbNumIOOps[bb], bbLSUBusy[bb]});
+    };
+
+    double totalWeight = 0.0;
+    double ioBusy = 0.0;
+    double lsuBusy = 0.0;
     int numInst = 0;
     for (Function::iterator bi = F.begin(); bi != F.end(); bi++) {
         BasicBlock *bb = &*bi;
-        if (bbNumVLIWInst[bb] > 0) {
-            numBB++;
+        int cycles = bbCycles(bb);
+        if (cycles > 0) {
+            totalWeight += bbWeight[bb];
             numInst += bbNumVLIWInst[bb];
-            perf += (bbWeight[bb] * bbNumVLIWInst[bb]);
-            util += (bbWeight[bb] * bbNumInst[bb] / bbNumVLIWInst[bb] / numALU);
+            perf += (bbWeight[bb] * cycles);
+            ioBusy += (bbWeight[bb] * bbNumIOOps[bb]);
+            lsuBusy += (bbWeight[bb] * bbLSUBusy[bb]);
+            util += (bbWeight[bb] * bbNumInst[bb] / cycles / numALU);
         }
     }
 
-    if (numBB != 0) {
-        perf /= numBB;
-        util /= numBB;
+    // a loop whose body packs into fewer VLIW instructions than its RecMII
+    // still waits out the recurrence every iteration
+    for (auto &rec : loopRecs) {
+        if (bbWeight[rec.header] == 0.0)
+            continue;
+        double iterCycles = 0.0;
+        for (BasicBlock *bb : rec.blocks)
+            iterCycles += bbWeight[bb] * bbCycles(bb);
+        iterCycles /= bbWeight[rec.header];
+        if (iterCycles < rec.recMII)
+            perf += bbWeight[rec.header] * (rec.recMII - iterCycles);
+    }
+
+    if (totalWeight != 0.0) {
+        perf /= totalWeight;
+        util /= totalWeight;
     }
 
     errs() << "numALU: " << numALU 
            << ", perf: " << perf 
-           << ", utilization: " << util << "\n"; 
+           << ", utilization: " << util;
+    if (perf > 0.0) {
+        errs() << ", IO occupancy: " << ioBusy / totalWeight / perf
+               << ", LSU occupancy: " << lsuBusy / totalWeight / perf;
+    }
+    errs() << "\n"; 
 
     return numInst;
 }
@@ -1955,6 +3375,138 @@ void PrimateArchGen::generateInterconnect(int numALU,
     }
 }
 
+// ROM BFUs created by primate-table-offload carry their contents in a
+// primate.rom node: {table, rom index}. Hardware generation instantiates one
+// ROM per entry in rom.cfg, initialized from <unit>.mem (one hex word per line).
+// Codegen addresses ROM k as BFU base + k, so entries keep their index. A
+// table the program no longer uses leaves an empty ROM (depth 0) in its slot.
+void PrimateArchGen::generateROMs(Module &M, raw_fd_stream &romCFG) {
+    std::map<unsigned, Function*> roms;
+    unsigned numROMs = 0;
+    for (auto& F: M) {
+        MDNode *romMD = F.getMetadata("primate.rom");
+        if (!romMD)
+            continue;
+        auto romIdx = cast<ConstantInt>(
+            cast<ConstantAsMetadata>(romMD->getOperand(1))->getValue());
+        unsigned idx = unsigned(romIdx->getZExtValue());
+        numROMs = std::max(numROMs, idx + 1);
+        if (!F.hasNUses(0))
+            roms[idx] = &F;
+    }
+
+    romCFG << "NUM_ROMS=" << numROMs << "\n";
+    for (unsigned i = 0; i < numROMs; i++) {
+        auto rom = roms.find(i);
+        if (rom == roms.end()) {
+            romCFG << "ROM_" << i << "_DEPTH=0\n";
+            continue;
+        }
+        Function *F = rom->second;
+        MDNode *primateMD = F->getMetadata("primate");
+        MDNode *romMD = F->getMetadata("primate.rom");
+        auto *table = cast<ConstantDataArray>(
+            cast<ConstantAsMetadata>(romMD->getOperand(0))->getValue());
+        std::string unitName = cast<MDString>(primateMD->getOperand(1))
+            ->getString().str();
+        auto *latency = cast<ConstantInt>(
+            cast<ConstantAsMetadata>(primateMD->getOperand(2))->getValue());
+        unsigned width = table->getElementType()->getIntegerBitWidth();
+
+        romCFG << "ROM_" << i << "_NAME=" << unitName << "\n";
+        romCFG << "ROM_" << i << "_DEPTH=" << table->getNumElements() << "\n";
+        romCFG << "ROM_" << i << "_WIDTH=" << width << "\n";
+        romCFG << "ROM_" << i << "_LATENCY=" << latency->getZExtValue() << "\n";
+        romCFG << "ROM_" << i << "_INIT=" << unitName << ".mem\n";
+
+        std::error_code memEC;
+        raw_fd_stream romMem(outputDir + unitName + ".mem", memEC);
+        if (memEC) {
+            errs() << "Unable to write " << unitName << ".mem: "
+                   << memEC.message() << "\n";
+            continue;
+        }
+        for (unsigned e = 0; e < table->getNumElements(); e++) {
+            romMem << format_hex_no_prefix(table->getElementAsInteger(e),
+                                           (width + 3) / 4) << "\n";
+        }
+        romMem.close();
+        errs() << "ROM BFU " << unitName << ": " << table->getNumElements()
+               << " x " << width << " bits\n";
+    }
+}
+
+// One entry per '#pragma primate model' unit: its private state (the class
+// data members), the operations it implements and how many instances the
+// program declares. Every object of the class type is one instance, whether
+// a global, a local or an element of an array or struct of them.
+void PrimateArchGen::generateModels(Module &M, raw_fd_stream &modelCFG) {
+    NamedMDNode *modelMD = M.getNamedMetadata("primate.model");
+    unsigned numModels = modelMD ? modelMD->getNumOperands() : 0;
+    modelCFG << "NUM_MODELS=" << numModels << "\n";
+    for (unsigned i = 0; i < numModels; i++) {
+        MDNode *entry = modelMD->getOperand(i);
+        StringRef unitName = cast<MDString>(entry->getOperand(0))->getString();
+        Type *stateTy =
+            mdconst::extract<Constant>(entry->getOperand(1))->getType();
+
+        std::map<unsigned, StringRef> ops;
+        unsigned latency = 1;
+        for (auto &F : M) {
+            MDNode *opMD = F.getMetadata("primate.model");
+            if (!opMD || cast<MDString>(opMD->getOperand(0))->getString() != unitName)
+                continue;
+            unsigned opIdx = mdconst::extract<ConstantInt>(opMD->getOperand(1))
+                ->getZExtValue();
+            ops[opIdx] = cast<MDString>(opMD->getOperand(2))->getString();
+            // the unit is pipelined to its slowest operation
+            latency = std::max<unsigned>(latency, mdconst::extract<ConstantInt>(
+                F.getMetadata("primate")->getOperand(2))->getZExtValue());
+        }
+
+        // instances may be globals or locals, and arrays or members of them
+        std::function<uint64_t(Type*)> countIn = [&](Type *T) -> uint64_t {
+            if (T == stateTy)
+                return 1;
+            if (auto *AT = dyn_cast<ArrayType>(T))
+                return AT->getNumElements() * countIn(AT->getElementType());
+            uint64_t n = 0;
+            if (auto *ST = dyn_cast<StructType>(T))
+                for (Type *elem : ST->elements())
+                    n += countIn(elem);
+            return n;
+        };
+        uint64_t numInstances = 0;
+        for (auto &GV : M.globals())
+            numInstances += countIn(GV.getValueType());
+        for (auto &F : M) {
+            if (F.getMetadata("primate.model"))
+                continue; // the host model of the unit itself
+            for (auto &I : instructions(F)) {
+                auto *AI = dyn_cast<AllocaInst>(&I);
+                if (!AI)
+                    continue;
+                uint64_t n = countIn(AI->getAllocatedType());
+                if (auto *size = dyn_cast<ConstantInt>(AI->getArraySize()))
+                    n *= size->getZExtValue();
+                numInstances += n;
+            }
+        }
+
+        modelCFG << "MODEL_" << i << "_NAME=" << unitName << "\n";
+        modelCFG << "MODEL_" << i << "_STATE_WIDTH="
+                 << getTypeBitWidth(stateTy, false) << "\n";
+        modelCFG << "MODEL_" << i << "_LATENCY=" << latency << "\n";
+        modelCFG << "MODEL_" << i << "_NUM_INSTANCES=" << numInstances << "\n";
+        modelCFG << "MODEL_" << i << "_NUM_OPS=" << ops.size() << "\n";
+        for (auto &op : ops)
+            modelCFG << "MODEL_" << i << "_OP_" << op.first << "="
+                     << op.second << "\n";
+        errs() << "Model BFU " << unitName << ": " << numInstances
+               << " instance(s), " << ops.size() << " operation(s)\n";
+    }
+}
+
 unsigned PrimateArchGen::getNumThreads(Module &M, unsigned numALU) {
     APInt maxVal(64, 0);
     for (auto FI = blueFunctions.begin(); FI != blueFunctions.end(); FI++) {
@@ -2193,6 +3745,9 @@ PrimateArchGen::evalFunc(Function &F, int &numALU,
 
     // printDependencyForest(F);
     numALUDSE(F, numALU, numInst, BALANCE);
+    if (!PrimateFamily.empty() && !isStage) {
+        recordPerfCurve(F, numALU);
+    }
 
     maxConst = getMaxConst(F);
 
@@ -2269,6 +3824,14 @@ PrimateArchGen::emitInstructionAnnot(const Instruction *i,
 }
 
 PreservedAnalyses PrimateArchGen::run(Module &M, ModuleAnalysisManager& AM) {
+    // a file of a multi-file program, the driver may run archgen on each
+    if (llvm::none_of(M, [](const Function &F) {
+            return !F.isDeclaration() && isPrimateMain(F);
+        })) {
+        errs() << "no primate_main in " << M.getModuleIdentifier()
+               << ", not running archgen\n";
+        return PreservedAnalyses::all();
+    }
     bvIndexToInstrArg = new std::vector<Value*>();
     valueToBitVectorIndex = new ValueMap<Value*, int>();
     instrInSet = new ValueMap<const Instruction*, BitVector*>();
@@ -2282,14 +3845,23 @@ PreservedAnalyses PrimateArchGen::run(Module &M, ModuleAnalysisManager& AM) {
 
     std::fill_n(live,50,0);
 
-    std::error_code primateEC, interconnEC, primateHeaderEC, asmHeaderEC;
+    std::error_code primateEC, interconnEC, primateHeaderEC, asmHeaderEC, romEC,
+                    modelEC, bankEC;
 
-    raw_fd_stream primateCFG("primate.cfg", primateEC);
-    raw_fd_stream interconnectCFG("interconnect.cfg", interconnEC);
-    raw_fd_stream primateHeader("header.scala", primateHeaderEC);
-    raw_fd_stream assemblerHeader("primate_assembler.h", asmHeaderEC);
+    raw_fd_stream primateCFG(outputDir + "primate.cfg", primateEC);
+    raw_fd_stream interconnectCFG(outputDir + "interconnect.cfg", interconnEC);
+    raw_fd_stream primateHeader(outputDir + "header.scala", primateHeaderEC);
+    raw_fd_stream assemblerHeader(outputDir + "primate_assembler.h", asmHeaderEC);
+    raw_fd_stream romCFG(outputDir + "rom.cfg", romEC);
+    raw_fd_stream modelCFG(outputDir + "model.cfg", modelEC);
+    raw_fd_stream bankLD(outputDir + "banks.ld", bankEC);
     // Check error codes
 
+    // pipeline stages are separate cores, only whole programs form a family
+    if (!PrimateFamily.empty() && !isStage) {
+        loadFamily(M);
+    }
+
     assemblerHeader << "#include <iostream>\n#include <map>\n#include <string>\n\n";
     printRegfileKnobs(M, primateCFG);
     generate_header(M, primateHeader);
@@ -2303,7 +3875,7 @@ PreservedAnalyses PrimateArchGen::run(Module &M, ModuleAnalysisManager& AM) {
 
     initializeBFCMeta(M);
     for (Module::iterator MI = M.begin(), ME = M.end(); MI != ME; ++MI) {
-        if (demangle(MI->getName()).find("primate_main") == std::string::npos) {
+        if (!isPrimateMain(*MI)) {
             LLVM_DEBUG(dbgs() << "non primate main. skipping eval\n");
             continue;
         }
@@ -2331,6 +3903,8 @@ PreservedAnalyses PrimateArchGen::run(Module &M, ModuleAnalysisManager& AM) {
     numRegs = numRegs < 32 ? 32 : numRegs;
 
     primateCFG << "NUM_THREADS=" << int(pow(2, ceil(log2(maxLatency)))) << "\n";
+    printAtomicContention(M, int(pow(2, ceil(log2(maxLatency)))), primateCFG);
+    printInputChecks(M);
     errs() << "Number of regs: " << numRegs << "\n";
     primateCFG << "NUM_REGS=" << int(pow(2, ceil(log2(numRegs)))) << "\n";
     assemblerHeader << "#define NUM_REGS " << int(pow(2, ceil(log2(numRegs)))) << "\n";
@@ -2343,8 +3917,20 @@ PreservedAnalyses PrimateArchGen::run(Module &M, ModuleAnalysisManager& AM) {
         primateCFG << "NUM_ALUS=" << num_bfu_clean << "\n";
     else
         primateCFG << "NUM_ALUS=" << maxNumALU << "\n";
+    printLaneCaps(M, std::max(num_bfu_clean, maxNumALU), primateCFG);
 
     primateCFG << "NUM_BFUS=" << num_bfu_clean << "\n";
+    assignMemBanks(M, primateCFG, bankLD);
+
+    // byte swapped field accesses are worth a swap on the extract/insert units
+    int numFieldBSwaps = 0;
+    for (auto &F : M) {
+        for (auto &I : instructions(F)) {
+            numFieldBSwaps += isFieldBSwap(&I);
+        }
+    }
+    errs() << "Byte swapped field accesses: " << numFieldBSwaps << "\n";
+    primateCFG << "FIELD_BSWAP=" << (numFieldBSwaps > 0 ? 1 : 0) << "\n";
     assemblerHeader << "#define NUM_ALUS " << maxNumALU << "\n";
     assemblerHeader << "#define NUM_FUS " << maxNumALU + num_bfu_clean << "\n";
     assemblerHeader << "#define NUM_FUS_LG int(ceil(log2(NUM_FUS)))\n";
@@ -2357,12 +3943,21 @@ PreservedAnalyses PrimateArchGen::run(Module &M, ModuleAnalysisManager& AM) {
     assemblerHeader << "#define IMM_W " << int(ceil(log2(maxConst))) << "\n";
 
     generateInterconnect(maxNumALU, interconnectCFG);
+    generateROMs(M, romCFG);
+    generateModels(M, modelCFG);
 
     primateCFG.close();
     interconnectCFG.close();
+    romCFG.close();
+    modelCFG.close();
+    bankLD.close();
     primateHeader.close();
     assemblerHeader.close();
 
+    if (!PrimateFamily.empty() && !isStage) {
+        writeFamily(M);
+    }
+
     delete bvIndexToInstrArg;
     delete valueToBitVectorIndex;
     delete instrInSet;
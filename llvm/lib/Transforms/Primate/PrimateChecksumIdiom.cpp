@@ -0,0 +1,545 @@
+//	PrimateChecksumIdiom.cpp
+//	Map software CRC and ones'-complement checksum idioms onto a BFU declared
+//	for them.
+//
+//	A reflected CRC over a register is a sequence of rounds
+//
+//	    x = (x >> 1) ^ (POLY & -(x & 1))
+//
+//	and a crc_<POLY> BFU performs 8 of them per call. The byte-wise table form
+//
+//	    x = T[(x ^ b) & 0xff] ^ (x >> 8)
+//
+//	is the same 8 rounds applied to (x ^ b), so both collapse to one call.
+//	The checksum fold of RFC 1071 reaches its fixed point after two folds for
+//	a 32-bit accumulator, so the data dependent loop becomes straight line.
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include <llvm/Transforms/Primate/PrimateChecksumIdiom.h>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+#define DEBUG_TYPE "primate-checksum-idiom"
+
+STATISTIC(NumCRCChains, "Number of CRC round chains collapsed");
+STATISTIC(NumCRCTables, "Number of table driven CRC steps collapsed");
+STATISTIC(NumCRCLoops, "Number of rolled CRC loops collapsed");
+STATISTIC(NumFoldLoops, "Number of checksum fold loops collapsed");
+
+static cl::opt<bool> PrimateChecksumIdiomDisable(
+    "primate-disable-checksum-idiom", cl::Hidden, cl::init(false),
+    cl::desc("Do not map CRC/checksum idioms onto BFUs"));
+
+// 8 reflected rounds on a single byte, i.e. entry I of the lookup table.
+static APInt crcTableEntry(const APInt &Poly, uint64_t I) {
+    APInt X(Poly.getBitWidth(), I);
+    for (int r = 0; r < 8; r++) {
+        bool Low = X[0];
+        X.lshrInPlace(1);
+        if (Low)
+            X ^= Poly;
+    }
+    return X;
+}
+
+// (and X, 1) != 0, or the trunc to i1 instcombine likes to produce.
+bool PrimateChecksumIdiom::matchLowBitSet(Value *Cond, Value *&X,
+                                          bool &Inverted) {
+    ICmpInst::Predicate Pred;
+    if (match(Cond, m_ICmp(Pred, m_And(m_Value(X), m_One()), m_Zero()))) {
+        if (Pred != ICmpInst::ICMP_NE && Pred != ICmpInst::ICMP_EQ)
+            return false;
+        Inverted = Pred == ICmpInst::ICMP_EQ;
+        return true;
+    }
+    if (match(Cond, m_ICmp(Pred, m_And(m_Value(X), m_One()), m_One()))) {
+        if (Pred != ICmpInst::ICMP_NE && Pred != ICmpInst::ICMP_EQ)
+            return false;
+        Inverted = Pred == ICmpInst::ICMP_NE;
+        return true;
+    }
+    if (match(Cond, m_Trunc(m_Value(X))) && Cond->getType()->isIntegerTy(1)) {
+        Inverted = false;
+        return true;
+    }
+    return false;
+}
+
+// -(X & 1) in any of its usual spellings.
+bool PrimateChecksumIdiom::matchLowBitMask(Value *M, Value *&X) {
+    unsigned W = M->getType()->getScalarSizeInBits();
+    if (match(M, m_Neg(m_And(m_Value(X), m_One()))))
+        return true;
+    if (match(M, m_AShr(m_Shl(m_Value(X), m_SpecificInt(W - 1)),
+                        m_SpecificInt(W - 1))))
+        return true;
+    Value *T;
+    if (match(M, m_SExt(m_Value(T))) && T->getType()->isIntegerTy(1)) {
+        bool Inverted;
+        return matchLowBitSet(T, X, Inverted) && !Inverted;
+    }
+    Value *Cond;
+    if (match(M, m_Select(m_Value(Cond), m_AllOnes(), m_Zero()))) {
+        bool Inverted;
+        return matchLowBitSet(Cond, X, Inverted) && !Inverted;
+    }
+    return false;
+}
+
+// One reflected CRC round on an integer register.
+bool PrimateChecksumIdiom::matchCRCStep(Value *V, CRCStep &Step) {
+    if (!V->getType()->isIntegerTy() || V->getType()->getIntegerBitWidth() < 8)
+        return false;
+
+    const APInt *C;
+    Value *X, *Y, *Cond, *M;
+    bool Inverted;
+
+    // (X >> 1) ^ (POLY & -(X & 1))
+    // (X >> 1) ^ select(X & 1, POLY, 0)
+    Value *T;
+    if (match(V, m_c_Xor(m_LShr(m_Value(X), m_One()), m_Value(T)))) {
+        if (match(T, m_c_And(m_Value(M), m_APInt(C))) &&
+            matchLowBitMask(M, Y) && X == Y) {
+            Step = {X, *C};
+            return !C->isZero();
+        }
+        if (match(T, m_Select(m_Value(Cond), m_APInt(C), m_Zero())) &&
+            matchLowBitSet(Cond, Y, Inverted) && !Inverted && X == Y) {
+            Step = {X, *C};
+            return !C->isZero();
+        }
+        if (match(T, m_Select(m_Value(Cond), m_Zero(), m_APInt(C))) &&
+            matchLowBitSet(Cond, Y, Inverted) && Inverted && X == Y) {
+            Step = {X, *C};
+            return !C->isZero();
+        }
+        return false;
+    }
+
+    // select(X & 1, (X >> 1) ^ POLY, X >> 1)
+    Value *A, *B;
+    if (match(V, m_Select(m_Value(Cond), m_Value(A), m_Value(B))) &&
+        matchLowBitSet(Cond, X, Inverted)) {
+        if (Inverted)
+            std::swap(A, B);
+        if (match(A, m_c_Xor(m_LShr(m_Specific(X), m_One()), m_APInt(C))) &&
+            match(B, m_LShr(m_Specific(X), m_One()))) {
+            Step = {X, *C};
+            return !C->isZero();
+        }
+    }
+    return false;
+}
+
+// T[Y & 0xff] ^ (State >> 8) where T is the byte table of a reflected CRC.
+bool PrimateChecksumIdiom::matchCRCTableStep(Instruction *I, Value *&State,
+                                             Value *&Byte, APInt &Poly) {
+    Value *L;
+    if (!match(I, m_c_Xor(m_Value(L), m_LShr(m_Value(State), m_SpecificInt(8)))))
+        return false;
+    auto *Ld = dyn_cast<LoadInst>(L);
+    if (!Ld || !Ld->isSimple() || Ld->getType() != I->getType())
+        return false;
+    auto *GEP = dyn_cast<GEPOperator>(Ld->getPointerOperand());
+    if (!GEP)
+        return false;
+    auto *GV = dyn_cast<GlobalVariable>(GEP->getPointerOperand());
+    if (!GV || !GV->isConstant() || !GV->hasDefinitiveInitializer())
+        return false;
+    auto *Table = dyn_cast<ConstantDataArray>(GV->getInitializer());
+    if (!Table || Table->getNumElements() != 256 ||
+        Table->getElementType() != I->getType())
+        return false;
+
+    // Either gep [256 x iN], @T, 0, idx or gep iN, @T, idx.
+    Value *Idx;
+    if (GEP->getSourceElementType() == Table->getType() &&
+        GEP->getNumIndices() == 2 &&
+        match(GEP->getOperand(1), m_Zero()))
+        Idx = GEP->getOperand(2);
+    else if (GEP->getSourceElementType() == Table->getElementType() &&
+             GEP->getNumIndices() == 1)
+        Idx = GEP->getOperand(1);
+    else
+        return false;
+
+    match(Idx, m_ZExtOrSExt(m_Value(Idx)));
+    if (Idx->getType()->isIntegerTy(8))
+        Byte = Idx;
+    else if (!match(Idx, m_And(m_Value(Byte), m_SpecificInt(0xff))))
+        return false;
+
+    // Entry 0x80 runs into the feedback only on the last round, so it is
+    // the polynomial itself.
+    Poly = Table->getElementAsAPInt(0x80);
+    if (Poly.isZero())
+        return false;
+    for (unsigned i = 0; i < 256; i++)
+        if (Table->getElementAsAPInt(i) != crcTableEntry(Poly, i))
+            return false;
+    return true;
+}
+
+// (S & 0xffff) + (S >> 16)
+bool PrimateChecksumIdiom::matchFold16(Value *V, Value *&S) {
+    if (!V->getType()->isIntegerTy(32))
+        return false;
+    return match(V, m_c_Add(m_And(m_Value(S), m_SpecificInt(0xffff)),
+                            m_LShr(m_Deferred(S), m_SpecificInt(16))));
+}
+
+Function *PrimateChecksumIdiom::findBFU(Module &M, StringRef UnitName,
+                                        Type *Ty) {
+    FunctionType *FTy = FunctionType::get(Ty, {Ty}, false);
+    for (Function &G : M) {
+        MDNode *PrimateMD = G.getMetadata("primate");
+        if (!PrimateMD || PrimateMD->getNumOperands() < 2)
+            continue;
+        auto *Kind = dyn_cast<MDString>(PrimateMD->getOperand(0));
+        auto *Unit = dyn_cast<MDString>(PrimateMD->getOperand(1));
+        if (!Kind || Kind->getString() != "blue" || !Unit ||
+            Unit->getString() != UnitName)
+            continue;
+        if (G.getFunctionType() == FTy)
+            return &G;
+    }
+    return nullptr;
+}
+
+// Emit Rounds (a multiple of 8) reflected rounds of Poly on X. Returns null
+// without touching the IR when no BFU implements Poly.
+Value *PrimateChecksumIdiom::emitCRCRounds(IRBuilder<> &B, Value *X,
+                                           const APInt &Poly,
+                                           unsigned Rounds) {
+    if (Rounds == 0 || Rounds % 8)
+        return nullptr;
+    Type *Ty = X->getType();
+    Function *F = B.GetInsertBlock()->getParent();
+
+    uint64_t P = Poly.getLimitedValue();
+    Function *BFU = findBFU(*F->getParent(), "crc_" + utohexstr(P, true), Ty);
+    if (!BFU)
+        return nullptr;
+    Value *V = X;
+    for (unsigned r = 0; r < Rounds; r += 8) {
+        CallInst *CI = B.CreateCall(BFU, {V});
+        CI->setMetadata("primate", BFU->getMetadata("primate"));
+        V = CI;
+    }
+    return V;
+}
+
+Value *PrimateChecksumIdiom::emitFold16(IRBuilder<> &B, Value *S) {
+    Function *F = B.GetInsertBlock()->getParent();
+    if (Function *BFU = findBFU(*F->getParent(), "csum16", S->getType())) {
+        CallInst *CI = B.CreateCall(BFU, {S});
+        CI->setMetadata("primate", BFU->getMetadata("primate"));
+        return CI;
+    }
+    Value *V = S;
+    for (int i = 0; i < 2; i++)
+        V = B.CreateAdd(B.CreateAnd(V, 0xffff), B.CreateLShr(V, 16), "csum.fold");
+    return V;
+}
+
+// The instructions making up one round between In and Out, so that In is only
+// extended into a chain when nothing outside the round reads it.
+static void collectRound(Instruction *Out, Value *In,
+                         SmallPtrSetImpl<Instruction *> &Round) {
+    SmallVector<std::pair<Instruction *, int>, 8> Stack = {{Out, 0}};
+    while (!Stack.empty()) {
+        auto [I, Depth] = Stack.pop_back_val();
+        if (!Round.insert(I).second || Depth >= 4)
+            continue;
+        for (Value *Op : I->operands())
+            if (auto *OpI = dyn_cast<Instruction>(Op))
+                if (OpI != In)
+                    Stack.push_back({OpI, Depth + 1});
+    }
+}
+
+bool PrimateChecksumIdiom::collapseStepChains(Function &F) {
+    DenseMap<Instruction *, CRCStep> Steps;
+    SmallVector<Instruction *, 32> Order;
+    for (Instruction &I : instructions(F)) {
+        CRCStep S;
+        if (matchCRCStep(&I, S)) {
+            Steps.insert({&I, S});
+            Order.push_back(&I);
+        }
+    }
+
+    DenseMap<Instruction *, Instruction *> Prev;
+    SmallPtrSet<Instruction *, 32> HasNext;
+    for (Instruction *I : Order) {
+        auto *In = dyn_cast<Instruction>(Steps.find(I)->second.In);
+        auto It = In ? Steps.find(In) : Steps.end();
+        if (It == Steps.end() || It->second.Poly != Steps.find(I)->second.Poly)
+            continue;
+        SmallPtrSet<Instruction *, 8> Round;
+        collectRound(I, In, Round);
+        if (!all_of(In->users(), [&](User *U) {
+                return Round.count(cast<Instruction>(U));
+            }))
+            continue;
+        Prev[I] = In;
+        HasNext.insert(In);
+    }
+
+    bool Changed = false;
+    for (Instruction *Last : Order) {
+        if (HasNext.count(Last))
+            continue;
+        SmallVector<Instruction *, 64> Chain = {Last};
+        while (Instruction *P = Prev.lookup(Chain.back()))
+            Chain.push_back(P);
+        std::reverse(Chain.begin(), Chain.end());
+
+        unsigned Rounds = Chain.size() - Chain.size() % 8;
+        if (Rounds == 0)
+            continue;
+        const CRCStep &First = Steps.find(Chain.front())->second;
+        unsigned Lead = Chain.size() - Rounds;
+        Value *Start = Lead ? Chain[Lead - 1] : First.In;
+
+        IRBuilder<> B(Last);
+        Value *V = emitCRCRounds(B, Start, First.Poly, Rounds);
+        if (!V)
+            continue;
+        LLVM_DEBUG(dbgs() << "Collapsed " << Rounds << " CRC rounds into "
+                          << *V << "\n");
+        V->takeName(Last);
+        Last->replaceAllUsesWith(V);
+        deadInsts.push_back(Last);
+        NumCRCChains++;
+        Changed = true;
+    }
+    return Changed;
+}
+
+bool PrimateChecksumIdiom::collapseTableSteps(Function &F) {
+    SmallVector<Instruction *, 8> Worklist;
+    for (Instruction &I : instructions(F))
+        if (I.getOpcode() == Instruction::Xor)
+            Worklist.push_back(&I);
+
+    bool Changed = false;
+    for (Instruction *I : Worklist) {
+        Value *State, *Byte;
+        APInt Poly;
+        if (!matchCRCTableStep(I, State, Byte, Poly))
+            continue;
+        // crc(x ^ b) over one byte: keep the upper bits of the state and
+        // take the low byte from the table index.
+        IRBuilder<> B(I);
+        Type *Ty = I->getType();
+        Value *Low = B.CreateAnd(B.CreateZExtOrTrunc(Byte, Ty), 0xff);
+        Value *High =
+            B.CreateAnd(State, APInt::getHighBitsSet(Ty->getIntegerBitWidth(),
+                                                     Ty->getIntegerBitWidth() - 8));
+        Value *In = B.CreateOr(High, Low);
+        Value *V = emitCRCRounds(B, In, Poly, 8);
+        if (!V) {
+            RecursivelyDeleteTriviallyDeadInstructions(In);
+            continue;
+        }
+        V->takeName(I);
+        I->replaceAllUsesWith(V);
+        deadInsts.push_back(I);
+        NumCRCTables++;
+        Changed = true;
+    }
+    return Changed;
+}
+
+// Straight line fold(fold(s)) only changes when a csum16 BFU can take it.
+bool PrimateChecksumIdiom::collapseFoldChains(Function &F) {
+    if (!findBFU(*F.getParent(), "csum16", Type::getInt32Ty(F.getContext())))
+        return false;
+    SmallVector<Instruction *, 8> Worklist;
+    for (Instruction &I : instructions(F)) {
+        Value *S, *S0;
+        if (matchFold16(&I, S) && S->hasNUses(2) && matchFold16(S, S0))
+            Worklist.push_back(&I);
+    }
+
+    bool Changed = false;
+    for (Instruction *I : Worklist) {
+        Value *S, *S0;
+        if (!matchFold16(I, S) || !matchFold16(S, S0))
+            continue;
+        IRBuilder<> B(I);
+        Value *V = emitFold16(B, S0);
+        V->takeName(I);
+        I->replaceAllUsesWith(V);
+        deadInsts.push_back(I);
+        Changed = true;
+    }
+    return Changed;
+}
+
+// Loops we replace must be side effect free and leave only through LCSSA
+// phis of the values we know how to compute.
+static bool isCollapsibleLoop(Loop &L, DominatorTree &DT) {
+    if (!L.isInnermost() || !L.getLoopPreheader() || !L.getExitingBlock() ||
+        !L.getExitBlock() || !L.isLCSSAForm(DT))
+        return false;
+    for (BasicBlock *BB : L.blocks())
+        for (Instruction &I : *BB)
+            if (I.mayHaveSideEffects())
+                return false;
+    return true;
+}
+
+bool PrimateChecksumIdiom::collapseCRCLoop(Loop &L, DominatorTree &DT,
+                                           LoopInfo &LI, ScalarEvolution &SE) {
+    if (!isCollapsibleLoop(L, DT) || L.getNumBlocks() != 1)
+        return false;
+    unsigned TripCount = SE.getSmallConstantTripCount(&L);
+    if (TripCount == 0 || TripCount % 8)
+        return false;
+
+    BasicBlock *Header = L.getHeader();
+    BasicBlock *Exit = L.getExitBlock();
+    BasicBlock *Preheader = L.getLoopPreheader();
+    for (PHINode &P : Header->phis()) {
+        CRCStep S;
+        Value *Next = P.getIncomingValueForBlock(Header);
+        if (!matchCRCStep(Next, S) || S.In != &P)
+            continue;
+        // The state after TripCount rounds is the only thing that may leave.
+        if (!all_of(Exit->phis(), [&](PHINode &EP) {
+                return EP.getIncomingValueForBlock(Header) == Next;
+            }))
+            return false;
+
+        IRBuilder<> B(Preheader->getTerminator());
+        Value *V = emitCRCRounds(B, P.getIncomingValueForBlock(Preheader),
+                                 S.Poly, TripCount);
+        if (!V)
+            return false;
+        for (PHINode &EP : Exit->phis())
+            EP.setIncomingValueForBlock(Header, V);
+        LLVM_DEBUG(dbgs() << "Collapsed CRC loop " << Header->getName()
+                          << " of " << TripCount << " rounds\n");
+        deleteDeadLoop(&L, &DT, &SE, &LI);
+        NumCRCLoops++;
+        return true;
+    }
+    return false;
+}
+
+bool PrimateChecksumIdiom::collapseFoldLoop(Loop &L, DominatorTree &DT,
+                                            LoopInfo &LI, ScalarEvolution &SE) {
+    if (!isCollapsibleLoop(L, DT) || L.getNumBlocks() > 2)
+        return false;
+
+    BasicBlock *Header = L.getHeader();
+    BasicBlock *Latch = L.getLoopLatch();
+    BasicBlock *Exiting = L.getExitingBlock();
+    BasicBlock *Exit = L.getExitBlock();
+    BasicBlock *Preheader = L.getLoopPreheader();
+    auto *Br = dyn_cast<BranchInst>(Exiting->getTerminator());
+    if (!Latch || !Br || !Br->isConditional())
+        return false;
+
+    for (PHINode &P : Header->phis()) {
+        Value *S;
+        Value *Next = P.getIncomingValueForBlock(Latch);
+        if (!matchFold16(Next, S) || S != &P)
+            continue;
+
+        // The loop has to leave exactly when the tested value fits 16 bits.
+        ICmpInst::Predicate Pred;
+        Value *X;
+        bool ExitWhenFits;
+        if (match(Br->getCondition(),
+                  m_ICmp(Pred, m_LShr(m_Value(X), m_SpecificInt(16)), m_Zero())) &&
+            ICmpInst::isEquality(Pred))
+            ExitWhenFits = (Pred == ICmpInst::ICMP_EQ) ==
+                           (Br->getSuccessor(0) == Exit);
+        else if (match(Br->getCondition(),
+                       m_ICmp(Pred, m_Value(X), m_SpecificInt(0xffff))) &&
+                 (Pred == ICmpInst::ICMP_UGT || Pred == ICmpInst::ICMP_ULE))
+            ExitWhenFits = (Pred == ICmpInst::ICMP_ULE) ==
+                           (Br->getSuccessor(0) == Exit);
+        else if (match(Br->getCondition(),
+                       m_ICmp(Pred, m_Value(X), m_SpecificInt(0x10000))) &&
+                 (Pred == ICmpInst::ICMP_UGE || Pred == ICmpInst::ICMP_ULT))
+            ExitWhenFits = (Pred == ICmpInst::ICMP_ULT) ==
+                           (Br->getSuccessor(0) == Exit);
+        else
+            return false;
+        if (!ExitWhenFits || (X != &P && X != Next))
+            return false;
+
+        // Once the tested value fits, further folds are the identity, so the
+        // live out is the fixed point fold(fold(init)).
+        if (!all_of(Exit->phis(), [&](PHINode &EP) {
+                Value *Out = EP.getIncomingValueForBlock(Exiting);
+                return Out == X || (X == &P && Out == Next);
+            }))
+            return false;
+
+        IRBuilder<> B(Preheader->getTerminator());
+        Value *V = emitFold16(B, P.getIncomingValueForBlock(Preheader));
+        for (PHINode &EP : Exit->phis())
+            EP.setIncomingValueForBlock(Exiting, V);
+        LLVM_DEBUG(dbgs() << "Collapsed checksum fold loop "
+                          << Header->getName() << "\n");
+        deleteDeadLoop(&L, &DT, &SE, &LI);
+        NumFoldLoops++;
+        return true;
+    }
+    return false;
+}
+
+PreservedAnalyses PrimateChecksumIdiom::run(Function &F,
+                                            FunctionAnalysisManager &AM) {
+    if (PrimateChecksumIdiomDisable || F.isDeclaration())
+        return PreservedAnalyses::all();
+
+    bool Changed = false;
+    {
+        auto &LI = AM.getResult<LoopAnalysis>(F);
+        auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
+        auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+        SmallVector<Loop *, 8> Loops;
+        for (Loop *L : LI.getLoopsInPreorder())
+            if (L->isInnermost())
+                Loops.push_back(L);
+        for (Loop *L : Loops)
+            if (!collapseCRCLoop(*L, DT, LI, SE))
+                Changed |= collapseFoldLoop(*L, DT, LI, SE);
+            else
+                Changed = true;
+    }
+
+    Changed |= collapseStepChains(F);
+    Changed |= collapseTableSteps(F);
+    Changed |= collapseFoldChains(F);
+
+    for (Instruction *I : deadInsts)
+        RecursivelyDeleteTriviallyDeadInstructions(I);
+    deadInsts.clear();
+
+    return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
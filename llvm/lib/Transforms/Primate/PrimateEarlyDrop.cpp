@@ -0,0 +1,186 @@
+//	PrimateEarlyDrop.cpp
+//	Retire threads that drop their packet as soon as the drop is decided.
+//
+//	Programs decide early that a packet goes nowhere (bad checksum, unknown
+//	ethertype, ACL deny) and then branch to the common exit of primate_main,
+//	which releases the packet with the IO done calls. The thread keeps its
+//	slot until it gets there. A single drop on the IO unit does the same
+//	release and frees the slot right away, which is what matters when most
+//	of the traffic is dropped.
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include <llvm/Transforms/Primate/PrimateEarlyDrop.h>
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "primate-early-drop"
+
+STATISTIC(NumDropPaths, "Number of drop paths ended with an early drop");
+
+static cl::opt<bool> PrimateEarlyDropDisable(
+    "primate-disable-early-drop", cl::Hidden, cl::init(false),
+    cl::desc("Run drop paths through the tail of primate_main instead of "
+             "retiring the thread with a drop"));
+
+static bool isOutputOp(const Instruction &I) {
+    auto *II = dyn_cast<IntrinsicInst>(&I);
+    if (!II)
+        return false;
+    switch (II->getIntrinsicID()) {
+    case Intrinsic::primate_output:
+    case Intrinsic::primate_output_seek:
+    case Intrinsic::primate_output_done:
+    case Intrinsic::primate_drop:
+    case Intrinsic::primate_fifo_send:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A block may be skipped by a drop when all it does is compute values and
+// release the packet. Anything else with an effect (stores, atomics, blue
+// calls, output) has to keep running.
+bool PrimateEarlyDrop::isReleaseOnly(BasicBlock &BB, bool &releasesOutput) {
+    releasesOutput = false;
+    for (Instruction &I : BB) {
+        if (auto *II = dyn_cast<IntrinsicInst>(&I)) {
+            if (II->getIntrinsicID() == Intrinsic::primate_output_done) {
+                releasesOutput = true;
+                continue;
+            }
+            if (II->getIntrinsicID() == Intrinsic::primate_input_done ||
+                II->isAssumeLikeIntrinsic())
+                continue;
+        }
+        if (I.isTerminator() && !isa<BranchInst>(I) && !isa<SwitchInst>(I) &&
+            !isa<ReturnInst>(I))
+            return false;
+        if (I.mayHaveSideEffects())
+            return false;
+    }
+    return true;
+}
+
+// Blocks from which every path only releases the packet and returns,
+// releasing the output on the way. Grows backwards from the returns, so
+// loops never qualify.
+void PrimateEarlyDrop::findDropTails(Function &F,
+                                     DenseMap<BasicBlock *, bool> &Tail) {
+    DenseMap<BasicBlock *, bool> releasesOutput;
+    DenseMap<BasicBlock *, bool> toReturn; // release only up to the return
+    for (BasicBlock &BB : F) {
+        Tail[&BB] = false;
+        toReturn[&BB] = false;
+        bool releases;
+        if (isReleaseOnly(BB, releases))
+            releasesOutput[&BB] = releases;
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BasicBlock *BB : post_order(&F)) {
+            auto it = releasesOutput.find(BB);
+            if (it == releasesOutput.end())
+                continue;
+            bool isRet = isa<ReturnInst>(BB->getTerminator());
+            auto allSuccs = [&](DenseMap<BasicBlock *, bool> &Map) {
+                return !isRet && succ_size(BB) > 0 &&
+                       all_of(successors(BB),
+                              [&](BasicBlock *S) { return Map[S]; });
+            };
+            bool ret = isRet || allSuccs(toReturn);
+            bool tail = ret && (it->second || allSuccs(Tail));
+            if (ret != toReturn[BB] || tail != Tail[BB]) {
+                toReturn[BB] = ret;
+                Tail[BB] = tail;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Blocks at whose end no path from the entry has written any output yet.
+void PrimateEarlyDrop::findOutputFree(Function &F,
+                                      DenseMap<BasicBlock *, bool> &Free) {
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    for (BasicBlock *BB : RPOT)
+        Free[BB] = true;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BasicBlock *BB : RPOT) {
+            bool free = none_of(*BB, isOutputOp);
+            if (!BB->isEntryBlock())
+                for (BasicBlock *Pred : predecessors(BB)) {
+                    auto it = Free.find(Pred);
+                    free &= it == Free.end() || it->second;
+                }
+            if (Free[BB] != free) {
+                Free[BB] = free;
+                changed = true;
+            }
+        }
+    }
+}
+
+PreservedAnalyses PrimateEarlyDrop::run(Module &M, ModuleAnalysisManager &AM) {
+    if (PrimateEarlyDropDisable)
+        return PreservedAnalyses::all();
+
+    Function *F = nullptr;
+    for (Function &Fn : M)
+        if (!Fn.isDeclaration() && isPrimateMain(Fn))
+            F = &Fn;
+    if (!F || !F->getReturnType()->isVoidTy())
+        return PreservedAnalyses::all();
+
+    DenseMap<BasicBlock *, bool> Tail;
+    DenseMap<BasicBlock *, bool> Free;
+    findDropTails(*F, Tail);
+    findOutputFree(*F, Free);
+
+    // the earliest edge into a tail, later edges are inside the tail already
+    SmallVector<std::pair<BasicBlock *, BasicBlock *>, 8> Edges;
+    for (BasicBlock &BBRef : *F) {
+        BasicBlock *BB = &BBRef;
+        auto it = Free.find(BB);
+        if (it == Free.end() || !it->second || Tail[BB])
+            continue;
+        SmallSetVector<BasicBlock *, 4> Succs(succ_begin(BB), succ_end(BB));
+        for (BasicBlock *S : Succs)
+            if (Tail[S])
+                Edges.push_back({BB, S});
+    }
+    if (Edges.empty())
+        return PreservedAnalyses::all();
+
+    BasicBlock *DropBB = BasicBlock::Create(M.getContext(), "primate.drop", F);
+    IRBuilder<> B(DropBB);
+    Function *Drop = Intrinsic::getDeclaration(&M, Intrinsic::primate_drop);
+    B.CreateCall(Drop);
+    B.CreateUnreachable();
+
+    for (auto [BB, S] : Edges) {
+        LLVM_DEBUG(dbgs() << "drop path " << BB->getName() << " -> "
+                          << S->getName() << "\n");
+        for (PHINode &Phi : S->phis())
+            while (Phi.getBasicBlockIndex(BB) >= 0)
+                Phi.removeIncomingValue(BB, /*DeletePHIIfEmpty=*/false);
+        BB->getTerminator()->replaceSuccessorWith(S, DropBB);
+        NumDropPaths++;
+    }
+    removeUnreachableBlocks(*F);
+    return PreservedAnalyses::none();
+}
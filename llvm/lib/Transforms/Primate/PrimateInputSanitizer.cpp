@@ -0,0 +1,350 @@
+//	PrimateInputSanitizer.cpp
+//	Bounds checks for the input reads of header parsers.
+//
+//	Parsers trust the packet. A header length or an option length read from
+//	the packet moves the input cursor, and nothing stops a short or malformed
+//	packet from sending the following reads past its end, where the IO unit
+//	returns whatever it still holds. This pass puts a check against the
+//	packet length in front of every read and seek, and merges the checks on
+//	the same cursor value so that a header costs one compare, not one per
+//	field.
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include <llvm/Transforms/Primate/PrimateInputSanitizer.h>
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/TargetParser/Triple.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "primate-input-sanitizer"
+
+STATISTIC(NumChecks, "Number of input bounds checks inserted");
+STATISTIC(NumMerged, "Number of input bounds checks merged into an earlier one");
+
+namespace {
+enum class SanitizerMode { Off, Drop, Trap, Report };
+enum class InputOp { None, Read, Seek, Len, Done };
+} // namespace
+
+static cl::opt<SanitizerMode> PrimateInputSanitizerMode(
+    "primate-input-sanitizer", cl::Hidden, cl::init(SanitizerMode::Off),
+    cl::desc("Check input reads and seeks against the packet length"),
+    cl::values(clEnumValN(SanitizerMode::Off, "off", "No checks"),
+               clEnumValN(SanitizerMode::Drop, "drop",
+                          "Drop packets that are too short"),
+               clEnumValN(SanitizerMode::Trap, "trap",
+                          "Trap on packets that are too short"),
+               clEnumValN(SanitizerMode::Report, "report",
+                          "Call __primate_sanitizer_input_overflow(end, len)")));
+
+// The Primate intrinsics, or the functions of primate_host.h that stand in
+// for them in host builds.
+static InputOp getInputOp(const Instruction &I) {
+    auto *CB = dyn_cast<CallBase>(&I);
+    if (!CB)
+        return InputOp::None;
+    if (auto *II = dyn_cast<IntrinsicInst>(CB)) {
+        switch (II->getIntrinsicID()) {
+        case Intrinsic::primate_input:
+            return InputOp::Read;
+        case Intrinsic::primate_input_seek:
+            return InputOp::Seek;
+        case Intrinsic::primate_input_len:
+            return InputOp::Len;
+        case Intrinsic::primate_input_done:
+            return InputOp::Done;
+        default:
+            return InputOp::None;
+        }
+    }
+    Function *Callee = CB->getCalledFunction();
+    if (!Callee)
+        return InputOp::None;
+    return StringSwitch<InputOp>(Callee->getName())
+        .Case("__primate_input", InputOp::Read)
+        .Case("__primate_input_seek", InputOp::Seek)
+        .Case("__primate_input_len", InputOp::Len)
+        .Case("__primate_input_done", InputOp::Done)
+        .Default(InputOp::None);
+}
+
+static bool isPrimate(const Module &M) {
+    return Triple(M.getTargetTriple()).isPrimate();
+}
+
+static CallInst *createInputSeek(IRBuilder<> &B, Value *Bytes) {
+    Module &M = *B.GetInsertBlock()->getModule();
+    if (isPrimate(M))
+        return B.CreateIntrinsic(Intrinsic::primate_input_seek, {}, {Bytes});
+    return B.CreateCall(M.getOrInsertFunction("__primate_input_seek",
+                                              B.getInt32Ty(), B.getInt32Ty()),
+                        {Bytes});
+}
+
+static CallInst *createInputLen(IRBuilder<> &B) {
+    Module &M = *B.GetInsertBlock()->getModule();
+    if (isPrimate(M))
+        return B.CreateIntrinsic(Intrinsic::primate_input_len, {}, {},
+                                 nullptr, "input.len");
+    return B.CreateCall(M.getOrInsertFunction("__primate_input_len",
+                                              B.getInt32Ty()),
+                        {}, "input.len");
+}
+
+static FunctionCallee getNoReturn(Module &M, StringRef Name,
+                                  FunctionType *Ty) {
+    FunctionCallee Fn = M.getOrInsertFunction(Name, Ty);
+    if (auto *F = dyn_cast<Function>(Fn.getCallee())) {
+        F->setDoesNotReturn();
+        F->setDoesNotThrow();
+    }
+    return Fn;
+}
+
+PrimateInputSanitizer::PrimateInputSanitizer() {
+    switch (PrimateInputSanitizerMode) {
+    case SanitizerMode::Trap:
+        A = Trap;
+        break;
+    case SanitizerMode::Report:
+        A = Report;
+        break;
+    default:
+        A = Drop;
+        break;
+    }
+}
+
+bool PrimateInputSanitizer::isEnabled() {
+    return PrimateInputSanitizerMode != SanitizerMode::Off;
+}
+
+// Tracks the input cursor through an alloca that mem2reg turns into SSA
+// values afterwards. Within a block the cursor is the value it had on entry
+// plus a constant, so the checks of fixed size reads all share that value.
+bool PrimateInputSanitizer::instrument(Function &F, FunctionAnalysisManager &FAM,
+                                       const SmallPtrSetImpl<Function *> &Readers) {
+    bool reads = any_of(instructions(F), [](Instruction &I) {
+        InputOp Op = getInputOp(I);
+        return Op == InputOp::Read || Op == InputOp::Seek;
+    });
+    if (!reads)
+        return false;
+
+    Type *I32 = Type::getInt32Ty(F.getContext());
+    BasicBlock &Entry = F.getEntryBlock();
+    IRBuilder<> AB(&Entry, Entry.getFirstInsertionPt());
+    AllocaInst *Cursor = AB.CreateAlloca(I32, nullptr, "input.cursor");
+    IRBuilder<> B(&*Entry.getFirstNonPHIOrDbgOrAlloca());
+    Value *Len = createInputLen(B);
+    // primate_main starts at the top of the packet, anything else asks the
+    // IO unit where its caller left the cursor
+    Value *Start = isPrimateMain(F) ? (Value *)B.getInt32(0)
+                                    : createInputSeek(B, B.getInt32(0));
+    B.CreateStore(Start, Cursor);
+
+    SmallVector<Check> Checks;
+    SmallVector<WeakTrackingVH> Created;
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    for (BasicBlock *BB : RPOT) {
+        // the cursor on entry is Base, loaded on first use, and Off after it
+        Value *Base = BB == &Entry ? Start : nullptr;
+        int64_t Off = 0;
+        bool moved = false;
+        auto base = [&]() {
+            if (!Base) {
+                IRBuilder<> LB(BB, BB->getFirstInsertionPt());
+                Base = LB.CreateLoad(I32, Cursor, "input.pos");
+            }
+            return Base;
+        };
+        for (Instruction &I : *BB) {
+            auto *CB = dyn_cast<CallBase>(&I);
+            if (!CB)
+                continue;
+            InputOp Op = getInputOp(I);
+            if (Op == InputOp::Read || Op == InputOp::Seek) {
+                Value *Bytes = CB->getArgOperand(0);
+                if (auto *C = dyn_cast<ConstantInt>(Bytes)) {
+                    Off += C->getSExtValue();
+                    // seeking back stays inside the packet
+                    if (C->getSExtValue() > 0)
+                        Checks.push_back({&I, base(), Off});
+                } else {
+                    IRBuilder<> IB(&I);
+                    Value *Pos = Off ? IB.CreateAdd(base(), IB.getInt32(Off))
+                                     : base();
+                    Base = IB.CreateAdd(Pos, IB.CreateZExtOrTrunc(Bytes, I32),
+                                        "input.end");
+                    Created.push_back(Base);
+                    Off = 0;
+                    Checks.push_back({&I, Base, 0});
+                }
+                moved = true;
+            } else if (isa<CallInst>(CB) && CB->getCalledFunction() &&
+                       Readers.count(CB->getCalledFunction())) {
+                // the callee moved the cursor by as much as the packet said
+                IRBuilder<> IB(I.getNextNode());
+                Base = createInputSeek(IB, IB.getInt32(0));
+                Off = 0;
+                moved = true;
+            }
+        }
+        if (moved) {
+            IRBuilder<> TB(BB->getTerminator());
+            Value *Pos = Off ? TB.CreateAdd(base(), TB.getInt32(Off)) : base();
+            Created.push_back(Pos);
+            TB.CreateStore(Pos, Cursor);
+        }
+    }
+
+    auto &DT = FAM.getResult<DominatorTreeAnalysis>(F);
+    auto &AC = FAM.getResult<AssumptionAnalysis>(F);
+    PromoteMemToReg({Cursor}, DT, &AC);
+
+    auto &PDT = FAM.getResult<PostDominatorTreeAnalysis>(F);
+    merge(Checks, DT, PDT);
+    for (Check &C : Checks)
+        emit(C, Len);
+    // the length is an IO unit op, only worth issuing for a check
+    if (Checks.empty())
+        cast<Instruction>(Len)->eraseFromParent();
+
+    // positions only a merged check or no later block needed
+    RecursivelyDeleteTriviallyDeadInstructionsPermissive(Created);
+    return true;
+}
+
+// Checks come in dominator order: blocks in RPO, program order within a
+// block. A check is dropped when the nearest earlier check on the same
+// cursor value dominates it and either covers at least as many bytes, or is
+// always followed by it, in which case the earlier check takes over the
+// larger bound. A packet that fails the earlier check then fails it a few
+// instructions sooner, which drops (or reports) the same packets.
+void PrimateInputSanitizer::merge(SmallVectorImpl<Check> &Checks,
+                                  DominatorTree &DT, PostDominatorTree &PDT) {
+    // so that checks against x + 4 and (x + 4) + 8 meet at x
+    for (Check &C : Checks) {
+        Value *V = C.Base;
+        while (auto *BO = dyn_cast<BinaryOperator>(V)) {
+            auto *Off = dyn_cast<ConstantInt>(BO->getOperand(1));
+            if (BO->getOpcode() != Instruction::Add || !Off)
+                break;
+            C.End += Off->getSExtValue();
+            V = BO->getOperand(0);
+        }
+        C.Base = V;
+    }
+
+    SmallVector<Check> Kept;
+    for (Check &C : Checks) {
+        Check *Into = nullptr;
+        for (Check &K : reverse(Kept)) {
+            if ((Value *)K.Base == (Value *)C.Base && DT.dominates(K.At, C.At)) {
+                Into = &K;
+                break;
+            }
+        }
+        if (Into && (Into->End >= C.End ||
+                     PDT.dominates(C.At->getParent(), Into->At->getParent()))) {
+            LLVM_DEBUG(dbgs() << "merging check before " << *C.At
+                              << " into the one before " << *Into->At << "\n");
+            Into->End = std::max(Into->End, C.End);
+            ++NumMerged;
+            continue;
+        }
+        Kept.push_back(C);
+    }
+    Checks.swap(Kept);
+}
+
+// if Base + End > Len, leave through the violation action before C.At runs
+void PrimateInputSanitizer::emit(Check &C, Value *Len) {
+    IRBuilder<> B(C.At);
+    Value *End = C.End ? B.CreateAdd(C.Base, B.getInt32(C.End), "input.end")
+                       : (Value *)C.Base;
+    Value *Over = B.CreateICmpUGT(End, Len, "input.over");
+    // archgen reports what the checks cost per packet
+    cast<Instruction>(Over)->setMetadata("primate.input.check",
+                                         MDNode::get(B.getContext(), {}));
+    MDNode *Weights = MDBuilder(B.getContext()).createBranchWeights(1, 100000);
+    Instruction *Term =
+        SplitBlockAndInsertIfThen(Over, C.At, /*Unreachable=*/true, Weights);
+    B.SetInsertPoint(Term);
+    B.SetCurrentDebugLocation(C.At->getDebugLoc());
+
+    Module &M = *B.GetInsertBlock()->getModule();
+    switch (A) {
+    case Drop:
+        if (isPrimate(M))
+            B.CreateIntrinsic(Intrinsic::primate_drop, {}, {});
+        else
+            B.CreateCall(getNoReturn(M, "__primate_drop",
+                                     FunctionType::get(B.getVoidTy(), false)));
+        break;
+    case Trap:
+        B.CreateIntrinsic(Intrinsic::trap, {}, {});
+        break;
+    case Report:
+        B.CreateCall(getNoReturn(M, "__primate_sanitizer_input_overflow",
+                                 FunctionType::get(B.getVoidTy(),
+                                                   {B.getInt32Ty(), B.getInt32Ty()},
+                                                   false)),
+                     {End, Len});
+        break;
+    }
+    ++NumChecks;
+}
+
+PreservedAnalyses PrimateInputSanitizer::run(Module &M, ModuleAnalysisManager &AM) {
+    auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+    // functions that move the input cursor, themselves or through a callee
+    SmallPtrSet<Function *, 16> Readers;
+    bool grew = true;
+    while (grew) {
+        grew = false;
+        for (Function &F : M) {
+            if (F.isDeclaration() || Readers.count(&F))
+                continue;
+            bool reads = any_of(instructions(F), [&](Instruction &I) {
+                InputOp Op = getInputOp(I);
+                auto *CB = dyn_cast<CallBase>(&I);
+                return Op == InputOp::Read || Op == InputOp::Seek ||
+                       (CB && CB->getCalledFunction() &&
+                        Readers.count(CB->getCalledFunction()));
+            });
+            if (reads) {
+                Readers.insert(&F);
+                grew = true;
+            }
+        }
+    }
+
+    bool changed = false;
+    for (Function &F : M) {
+        if (F.isDeclaration() ||
+            F.hasFnAttribute(Attribute::DisableSanitizerInstrumentation))
+            continue;
+        changed |= instrument(F, FAM, Readers);
+    }
+    return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
@@ -0,0 +1,454 @@
+//	PrimatePipelinePartition.cpp
+//	Split primate_main into pipeline stages that run on separate Primate cores.
+//
+//	One core can only sustain as many packets per cycle as its longest
+//	dependence chain allows. When a program does not fit the line rate, the
+//	packet path is cut into consecutive stages and each stage gets its own core.
+//	Every live value at a cut travels to the next core over a FIFO channel,
+//	so a cut is only good if little state crosses it and the stages on either
+//	side cost about the same.
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include <llvm/Transforms/Primate/PrimatePipelinePartition.h>
+#include <llvm/Transforms/Primate/PrimateArchGen.h>
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/FunctionComparator.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "primate-pipeline-partition"
+
+using namespace llvm;
+
+static cl::opt<unsigned> PrimatePipelineStages(
+    "primate-pipeline-stages", cl::Hidden, cl::init(1),
+    cl::desc("Number of Primate cores primate_main is pipelined across"));
+
+static cl::opt<double> PrimatePipelineSlack(
+    "primate-pipeline-slack", cl::Hidden, cl::init(0.25),
+    cl::desc("Fraction of a stage's ideal size a cut may move to reduce the "
+             "state sent between cores"));
+
+static bool isInputIntrinsic(const Instruction &I) {
+    auto *II = dyn_cast<IntrinsicInst>(&I);
+    return II && (II->getIntrinsicID() == Intrinsic::primate_input ||
+                  II->getIntrinsicID() == Intrinsic::primate_input_seek ||
+                  II->getIntrinsicID() == Intrinsic::primate_input_done ||
+                  II->getIntrinsicID() == Intrinsic::primate_input_len);
+}
+
+static bool isOutputIntrinsic(const Instruction &I) {
+    auto *II = dyn_cast<IntrinsicInst>(&I);
+    return II && (II->getIntrinsicID() == Intrinsic::primate_output ||
+                  II->getIntrinsicID() == Intrinsic::primate_output_seek ||
+                  II->getIntrinsicID() == Intrinsic::primate_output_done ||
+                  II->getIntrinsicID() == Intrinsic::primate_drop);
+}
+
+// Fills in the state crossing a cut placed at the top of B and checks that
+// the program can be cut there at all: input has to stay in front of the cut,
+// output behind it, and no memory may be shared between the two cores.
+bool PrimatePipelinePartition::analyzeCut(Function &F, BasicBlock *B,
+                                          DominatorTree &DT, StageCut &Cut) {
+    const DataLayout &DL = F.getParent()->getDataLayout();
+    Cut.block = B;
+    Cut.prefixInsts = 0;
+    Cut.liveBits = 0;
+    Cut.liveIn.clear();
+
+    DenseMap<const Value*, unsigned> memSide;
+    auto touch = [&](Value *Ptr, bool after) {
+        const Value *Obj = getUnderlyingObject(Ptr);
+        if (auto *GV = dyn_cast<GlobalVariable>(Obj))
+            if (GV->isConstant())
+                return true;
+        unsigned &side = memSide[Obj];
+        side |= after ? 2 : 1;
+        return side != 3;
+    };
+
+    SetVector<Value*> live;
+    for (PHINode &PN : B->phis())
+        live.insert(&PN);
+    for (Argument &A : F.args())
+        if (!A.use_empty())
+            return false;
+
+    for (BasicBlock &BB : F) {
+        bool after = DT.dominates(B, &BB);
+        for (Instruction &I : BB) {
+            if (!after)
+                Cut.prefixInsts++;
+            if (after ? isInputIntrinsic(I) : isOutputIntrinsic(I))
+                return false;
+            if (auto *Ld = dyn_cast<LoadInst>(&I)) {
+                if (!touch(Ld->getPointerOperand(), after))
+                    return false;
+            } else if (auto *St = dyn_cast<StoreInst>(&I)) {
+                if (!touch(St->getPointerOperand(), after))
+                    return false;
+            } else if (auto *CB = dyn_cast<CallBase>(&I)) {
+                for (Value *Arg : CB->args())
+                    if (Arg->getType()->isPointerTy() && !touch(Arg, after))
+                        return false;
+            }
+            if (after)
+                continue;
+            for (User *U : I.users()) {
+                auto *UI = cast<Instruction>(U);
+                if (UI->getParent() == B && isa<PHINode>(UI))
+                    continue;
+                if (DT.dominates(B, UI->getParent())) {
+                    live.insert(&I);
+                    break;
+                }
+            }
+        }
+    }
+
+    for (Value *V : live) {
+        Type *Ty = V->getType();
+        if (!Ty->isSized() || Ty->isPointerTy() || Ty->isTokenTy())
+            return false;
+        Cut.liveBits += DL.getTypeSizeInBits(Ty);
+        Cut.liveIn.push_back(V);
+    }
+    return true;
+}
+
+// Candidate cuts are the blocks every packet passes through exactly once:
+// outside any loop, dominating the return and post-dominating the entry.
+// For each stage boundary the cheapest candidate within the slack window
+// around the ideal split point wins.
+void PrimatePipelinePartition::findCuts(Function &F, unsigned numStages,
+                                        SmallVectorImpl<StageCut> &Cuts) {
+    DominatorTree DT(F);
+    PostDominatorTree PDT(F);
+    LoopInfo LI(DT);
+
+    BasicBlock *Ret = nullptr;
+    for (BasicBlock &BB : F) {
+        if (isa<ReturnInst>(BB.getTerminator())) {
+            if (Ret)
+                return;
+            Ret = &BB;
+        }
+    }
+    if (!Ret)
+        return;
+
+    unsigned total = 0;
+    for (BasicBlock &BB : F)
+        total += BB.size();
+
+    SmallVector<StageCut, 16> candidates;
+    for (DomTreeNode *N = DT.getNode(Ret); N; N = N->getIDom()) {
+        BasicBlock *B = N->getBlock();
+        if (B == &F.getEntryBlock() || LI.getLoopFor(B) ||
+            !PDT.dominates(B, &F.getEntryBlock()))
+            continue;
+        StageCut Cut;
+        if (analyzeCut(F, B, DT, Cut))
+            candidates.push_back(Cut);
+    }
+    llvm::sort(candidates, [](const StageCut &A, const StageCut &B) {
+        return A.prefixInsts < B.prefixInsts;
+    });
+
+    unsigned prev = 0;
+    double window = PrimatePipelineSlack * total / numStages;
+    for (unsigned k = 1; k < numStages; k++) {
+        double target = (double)k * total / numStages;
+        const StageCut *best = nullptr;
+        const StageCut *closest = nullptr;
+        for (const StageCut &C : candidates) {
+            if (C.prefixInsts <= prev)
+                continue;
+            double dist = std::abs((double)C.prefixInsts - target);
+            if (!closest ||
+                dist < std::abs((double)closest->prefixInsts - target))
+                closest = &C;
+            if (dist <= window && (!best || C.liveBits < best->liveBits))
+                best = &C;
+        }
+        if (!best)
+            best = closest;
+        if (!best)
+            break;
+        LLVM_DEBUG(dbgs() << "Stage boundary " << k << ": "
+                          << best->block->getName() << " after "
+                          << best->prefixInsts << "/" << total
+                          << " instructions, " << best->liveBits << " bits in "
+                          << best->liveIn.size() << " channels\n");
+        Cuts.push_back(*best);
+        prev = best->prefixInsts;
+    }
+}
+
+// Stage k keeps the blocks between cut k-1 and cut k. It starts by receiving
+// the state of cut k-1 and ends by sending the state of cut k.
+std::unique_ptr<Module> PrimatePipelinePartition::buildStage(
+        Module &M, Function &F, ArrayRef<StageCut> Cuts, unsigned stage) {
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> SM = CloneModule(M, VMap);
+    LLVMContext &Ctx = SM->getContext();
+    Function *SF = cast<Function>(VMap[&F]);
+
+    BasicBlock *Begin = stage > 0
+        ? cast<BasicBlock>(VMap[Cuts[stage - 1].block]) : &SF->getEntryBlock();
+    BasicBlock *End = stage < Cuts.size()
+        ? cast<BasicBlock>(VMap[Cuts[stage].block]) : nullptr;
+
+    DominatorTree DT(*SF);
+    SmallPtrSet<BasicBlock*, 32> region;
+    for (BasicBlock &BB : *SF)
+        if (DT.dominates(Begin, &BB) && !(End && DT.dominates(End, &BB)))
+            region.insert(&BB);
+
+    if (End) {
+        BasicBlock *Send = BasicBlock::Create(Ctx, "stage.send", SF);
+        region.insert(Send);
+        SmallVector<BasicBlock*, 4> preds(predecessors(End));
+        IRBuilder<> Builder(Send);
+
+        // PHIs of the cut block are resolved here, where the edges now end.
+        SmallVector<Value*, 8> outs;
+        for (Value *V : Cuts[stage].liveIn) {
+            Value *Out = VMap[V];
+            if (auto *PN = dyn_cast<PHINode>(Out); PN && PN->getParent() == End) {
+                PHINode *NewPN = Builder.CreatePHI(PN->getType(), preds.size(),
+                                                   PN->getName());
+                for (BasicBlock *P : preds)
+                    NewPN->addIncoming(PN->getIncomingValueForBlock(P), P);
+                Out = NewPN;
+            }
+            outs.push_back(Out);
+        }
+        for (auto [channel, Out] : enumerate(outs))
+            Builder.CreateIntrinsic(Intrinsic::primate_fifo_send,
+                                    {Out->getType()},
+                                    {Out, Builder.getInt32(channel)});
+        Builder.CreateRetVoid();
+        for (BasicBlock *P : preds)
+            P->getTerminator()->replaceSuccessorWith(End, Send);
+    }
+
+    if (stage > 0) {
+        BasicBlock *Recv = BasicBlock::Create(Ctx, "stage.recv", SF,
+                                              &SF->getEntryBlock());
+        region.insert(Recv);
+        IRBuilder<> Builder(Recv);
+        for (auto [channel, V] : enumerate(Cuts[stage - 1].liveIn)) {
+            Value *In = VMap[V];
+            Value *R = Builder.CreateIntrinsic(Intrinsic::primate_fifo_recv,
+                                               {In->getType()},
+                                               {Builder.getInt32(channel)},
+                                               nullptr, In->getName());
+            if (auto *PN = dyn_cast<PHINode>(In); PN && PN->getParent() == Begin) {
+                PN->replaceAllUsesWith(R);
+                PN->eraseFromParent();
+                continue;
+            }
+            In->replaceUsesWithIf(R, [&](Use &U) {
+                auto *I = dyn_cast<Instruction>(U.getUser());
+                return I && region.count(I->getParent());
+            });
+        }
+        Builder.CreateBr(Begin);
+    }
+
+    SmallVector<BasicBlock*, 32> dead;
+    for (BasicBlock &BB : *SF)
+        if (!region.count(&BB))
+            dead.push_back(&BB);
+    DeleteDeadBlocks(dead);
+    return SM;
+}
+
+// Chains the stages back into one function in a copy of M: a FIFO send
+// stores to a slot the receive of the next stage loads from, and the return
+// of a stage continues into the next stage. Once the slots are promoted and
+// the blocks around each cut are merged again, that has to be primate_main
+// itself. State the cut analysis missed shows up as poison in the later
+// stage, and a stage that lost or reordered work no longer matches.
+bool PrimatePipelinePartition::checkStages(
+        Module &M, Function &F, ArrayRef<std::unique_ptr<Module>> Stages) {
+    ValueToValueMapTy RefMap;
+    std::unique_ptr<Module> RM = CloneModule(M, RefMap);
+    Function *Ref = cast<Function>(RefMap[&F]);
+    Function *Chain = Function::Create(Ref->getFunctionType(),
+                                       Ref->getLinkage(),
+                                       Ref->getAddressSpace(),
+                                       Ref->getName() + ".stages", RM.get());
+    Chain->copyAttributesFrom(Ref);
+
+    SmallVector<SmallVector<BasicBlock*, 32>, 4> blocks(Stages.size());
+    for (auto [k, SM] : enumerate(Stages)) {
+        ValueToValueMapTy VMap;
+        for (GlobalValue &G : SM->global_values()) {
+            if (GlobalValue *RG = RM->getNamedValue(G.getName())) {
+                VMap[&G] = RG;
+            } else if (auto *SF = dyn_cast<Function>(&G)) {
+                // the FIFO intrinsics
+                VMap[&G] = Function::Create(SF->getFunctionType(),
+                                            GlobalValue::ExternalLinkage,
+                                            SF->getName(), RM.get());
+            } else {
+                return false;
+            }
+        }
+        for (BasicBlock &BB : *SM->getFunction(F.getName())) {
+            BasicBlock *NB = CloneBasicBlock(&BB, VMap, "", Chain);
+            VMap[&BB] = NB;
+            blocks[k].push_back(NB);
+        }
+        remapInstructionsInBlocks(blocks[k], VMap);
+    }
+
+    IRBuilder<> Entry(&Chain->getEntryBlock(),
+                      Chain->getEntryBlock().begin());
+    std::map<std::pair<unsigned, uint64_t>, AllocaInst*> slots;
+    auto slot = [&](unsigned link, Value *Channel, Type *Ty) {
+        AllocaInst *&A =
+            slots[{link, cast<ConstantInt>(Channel)->getZExtValue()}];
+        if (!A)
+            A = Entry.CreateAlloca(Ty);
+        return A;
+    };
+    for (auto [k, stageBlocks] : enumerate(blocks)) {
+        for (BasicBlock *BB : stageBlocks) {
+            for (Instruction &I : make_early_inc_range(*BB)) {
+                auto *II = dyn_cast<IntrinsicInst>(&I);
+                if (II && II->getIntrinsicID() == Intrinsic::primate_fifo_send) {
+                    Value *V = II->getArgOperand(0);
+                    new StoreInst(V, slot(k, II->getArgOperand(1), V->getType()),
+                                  II);
+                    II->eraseFromParent();
+                } else if (II && II->getIntrinsicID() ==
+                                     Intrinsic::primate_fifo_recv) {
+                    Value *In = new LoadInst(
+                        II->getType(),
+                        slot(k - 1, II->getArgOperand(0), II->getType()),
+                        II->getName(), II);
+                    II->replaceAllUsesWith(In);
+                    II->eraseFromParent();
+                } else if (isa<ReturnInst>(I) && k + 1 < blocks.size()) {
+                    BranchInst::Create(blocks[k + 1].front(), &I);
+                    I.eraseFromParent();
+                }
+            }
+        }
+    }
+
+    SmallVector<AllocaInst*, 16> allocas;
+    for (auto &[channel, A] : slots)
+        allocas.push_back(A);
+    DominatorTree DT(*Chain);
+    PromoteMemToReg(allocas, DT);
+
+    // stage.send, stage.recv and the cut block were one block
+    for (unsigned k = 1; k < blocks.size(); k++) {
+        BasicBlock *Recv = blocks[k].front();
+        BasicBlock *Begin = Recv->getSingleSuccessor();
+        if (!Begin || !MergeBlockIntoPredecessor(Recv) ||
+            !MergeBlockIntoPredecessor(Begin))
+            return false;
+    }
+
+    GlobalNumberState GN;
+    return FunctionComparator(Ref, Chain, &GN).compare() == 0;
+}
+
+bool PrimatePipelinePartition::isEnabled() {
+    return PrimatePipelineStages > 1;
+}
+
+PreservedAnalyses PrimatePipelinePartition::run(Module &M,
+                                                ModuleAnalysisManager &AM) {
+    if (!isEnabled())
+        return PreservedAnalyses::all();
+
+    Function *Main = nullptr;
+    for (Function &F : M)
+        if (!F.isDeclaration() && isPrimateMain(F))
+            Main = &F;
+    if (!Main) {
+        errs() << "Pipeline partitioning needs a primate_main\n";
+        return PreservedAnalyses::all();
+    }
+    if (!Main->getReturnType()->isVoidTy() || !Main->arg_empty()) {
+        errs() << "primate_main must be void(void) to be pipelined\n";
+        return PreservedAnalyses::all();
+    }
+
+    SmallVector<StageCut, 4> Cuts;
+    findCuts(*Main, PrimatePipelineStages, Cuts);
+    if (Cuts.size() + 1 < PrimatePipelineStages)
+        errs() << "Only found " << Cuts.size() + 1 << " of "
+               << PrimatePipelineStages << " pipeline stages\n";
+    if (Cuts.empty())
+        return PreservedAnalyses::all();
+
+    unsigned numStages = Cuts.size() + 1;
+    SmallVector<std::unique_ptr<Module>, 4> Stages;
+    for (unsigned k = 0; k < numStages; k++) {
+        Stages.push_back(buildStage(M, *Main, Cuts, k));
+        if (verifyModule(*Stages.back(), &errs())) {
+            errs() << "Stage " << k << " is malformed, no stages emitted\n";
+            return PreservedAnalyses::all();
+        }
+    }
+    if (!checkStages(M, *Main, Stages)) {
+        errs() << "The pipeline stages do not chain up to primate_main, "
+                  "no stages emitted\n";
+        return PreservedAnalyses::all();
+    }
+
+    for (unsigned k = 0; k < numStages; k++) {
+        std::string dir = outputDir + "stage" + std::to_string(k) + "/";
+        if (std::error_code EC = sys::fs::create_directories(dir)) {
+            errs() << "Cannot create " << dir << ": " << EC.message() << "\n";
+            return PreservedAnalyses::all();
+        }
+        std::error_code EC;
+        raw_fd_ostream ir(dir + "primate_main.ll", EC);
+        Stages[k]->print(ir, nullptr);
+
+        ModuleAnalysisManager stageAM;
+        PrimateArchGen(dir, /*isStage=*/true).run(*Stages[k], stageAM);
+    }
+
+    std::error_code EC;
+    raw_fd_stream topology(outputDir + "topology.cfg", EC);
+    topology << "NUM_STAGES=" << numStages << "\n";
+    for (unsigned k = 0; k < numStages; k++)
+        topology << "STAGE_" << k << "_DIR=stage" << k << "/\n";
+    for (auto [link, Cut] : enumerate(Cuts)) {
+        topology << "LINK_" << link << "_SRC=" << link << "\n";
+        topology << "LINK_" << link << "_DST=" << link + 1 << "\n";
+        topology << "LINK_" << link << "_WIDTH=" << Cut.liveBits << "\n";
+        topology << "LINK_" << link << "_CHANNELS=" << Cut.liveIn.size() << "\n";
+        const DataLayout &DL = M.getDataLayout();
+        for (auto [channel, V] : enumerate(Cut.liveIn))
+            topology << "LINK_" << link << "_CHANNEL_" << channel << "_WIDTH="
+                     << DL.getTypeSizeInBits(V->getType()) << "\n";
+    }
+    topology.close();
+
+    return PreservedAnalyses::all();
+}
@@ -0,0 +1,252 @@
+//	PrimateSpecialize.cpp
+//	Clone primate_main for the packet type that dominates the traffic.
+//
+//	Most packets share a few header shapes (IPv4/TCP without options, one
+//	VLAN tag, ...), yet the generic body branches on every field and the
+//	packetizer cannot pack across those branches. Once the hot field values
+//	are known, a copy of the rest of primate_main with those values folded in
+//	turns most of the branches into straight line code, and one guard in
+//	front sends every other packet to the unchanged generic body.
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include <llvm/Transforms/Primate/PrimateSpecialize.h>
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsPrimate.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/ProfDataUtils.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Primate/PrimateMain.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "primate-specialize"
+
+STATISTIC(NumSpecialized, "Number of primate_main bodies specialized");
+STATISTIC(NumFieldsFolded, "Number of header fields folded into a version");
+
+static cl::opt<double> PrimateSpecializeMinProb(
+    "primate-specialize-min-prob", cl::Hidden, cl::init(0.6),
+    cl::desc("Smallest share of packets a specialized version must cover"));
+
+static cl::opt<unsigned> PrimateSpecializeMaxFields(
+    "primate-specialize-max-fields", cl::Hidden, cl::init(2),
+    cl::desc("Most header fields the guard of a specialized version checks "
+             "(0 disables specialization)"));
+
+static cl::opt<unsigned> PrimateSpecializeMaxInsts(
+    "primate-specialize-max-insts", cl::Hidden, cl::init(1024),
+    cl::desc("Largest part of primate_main (in IR instructions) cloned for a "
+             "specialized version"));
+
+// A value read out of the packet: a field of an input read, possibly
+// shifted, masked or resized.
+bool PrimateSpecialize::isPacketField(Value *V) {
+    while (auto *I = dyn_cast<Instruction>(V)) {
+        if (auto *II = dyn_cast<IntrinsicInst>(I))
+            return II->getIntrinsicID() == Intrinsic::primate_input;
+        if (isa<ExtractValueInst>(I) || isa<CastInst>(I))
+            V = I->getOperand(0);
+        else if (isa<BinaryOperator>(I) && isa<ConstantInt>(I->getOperand(1)))
+            V = I->getOperand(0);
+        else
+            return false;
+    }
+    return false;
+}
+
+// The hottest constant each header field is compared against, with the
+// share of packets the branch weights give it.
+void PrimateSpecialize::collectHotValues(Function &F,
+                                         SmallVectorImpl<HotValue> &Hot) {
+    MapVector<Instruction *, HotValue> best;
+    auto note = [&](Value *V, ConstantInt *C, double prob) {
+        auto *field = dyn_cast<Instruction>(V);
+        if (!field || !isPacketField(field))
+            return;
+        auto it = best.find(field);
+        if (it == best.end() || it->second.Prob < prob)
+            best[field] = {field, C, prob};
+    };
+
+    for (BasicBlock &BB : F) {
+        Instruction *term = BB.getTerminator();
+        SmallVector<uint32_t, 8> weights;
+        if (!extractBranchWeights(*term, weights))
+            continue;
+        double total = 0.0;
+        for (uint32_t w : weights)
+            total += w;
+        if (total == 0.0)
+            continue;
+
+        if (auto *br = dyn_cast<BranchInst>(term)) {
+            auto *cmp = dyn_cast<ICmpInst>(br->getCondition());
+            if (!cmp || !cmp->isEquality() || weights.size() != 2)
+                continue;
+            auto *C = dyn_cast<ConstantInt>(cmp->getOperand(1));
+            if (!C)
+                continue;
+            unsigned eqIdx = cmp->getPredicate() == ICmpInst::ICMP_EQ ? 0 : 1;
+            note(cmp->getOperand(0), C, weights[eqIdx] / total);
+        } else if (auto *sw = dyn_cast<SwitchInst>(term)) {
+            for (auto &c : sw->cases())
+                note(sw->getCondition(), c.getCaseValue(),
+                     weights[c.getSuccessorIndex()] / total);
+        }
+    }
+
+    for (auto &[field, hot] : best)
+        Hot.push_back(hot);
+    llvm::stable_sort(Hot, [](const HotValue &A, const HotValue &B) {
+        return A.Prob > B.Prob;
+    });
+}
+
+bool PrimateSpecialize::specialize(Function &F, DominatorTree &DT,
+                                   ArrayRef<HotValue> Hot, double Prob) {
+    // the guard goes right after the last field is read
+    Instruction *last = Hot.front().Field;
+    for (const HotValue &H : Hot)
+        if (DT.dominates(last, H.Field))
+            last = H.Field;
+
+    unsigned size = 0;
+    BasicBlock *head = last->getParent();
+    for (BasicBlock &BB : F)
+        if (DT.isReachableFromEntry(&BB) && DT.dominates(head, &BB))
+            size += BB.size();
+    if (size > PrimateSpecializeMaxInsts) {
+        LLVM_DEBUG(dbgs() << "specialized body would clone " << size
+                          << " instructions\n");
+        return false;
+    }
+
+    BasicBlock *tail = SplitBlock(head, last->getNextNode(), &DT, nullptr,
+                                  nullptr, "primate.generic");
+    SmallVector<BasicBlock *, 32> region;
+    SmallPtrSet<BasicBlock *, 32> inRegion;
+    for (BasicBlock &BB : F)
+        if (DT.isReachableFromEntry(&BB) && DT.dominates(tail, &BB)) {
+            region.push_back(&BB);
+            inRegion.insert(&BB);
+        }
+
+    ValueToValueMapTy VMap;
+    SmallVector<BasicBlock *, 32> clones;
+    SmallPtrSet<BasicBlock *, 32> inClone;
+    for (BasicBlock *BB : region) {
+        BasicBlock *clone = CloneBasicBlock(BB, VMap, ".hot", &F);
+        VMap[BB] = clone;
+        clones.push_back(clone);
+        inClone.insert(clone);
+    }
+    remapInstructionsInBlocks(clones, VMap);
+    // unreachable predecessors keep pointing at the generic version only
+    for (BasicBlock *clone : clones)
+        for (PHINode &phi : clone->phis())
+            for (unsigned i = phi.getNumIncomingValues(); i-- > 0;)
+                if (!inClone.count(phi.getIncomingBlock(i)))
+                    phi.removeIncomingValue(i, /*DeletePHIIfEmpty=*/false);
+
+    // edges leaving the region now come from both versions
+    for (BasicBlock *BB : region) {
+        SmallPtrSet<BasicBlock *, 4> seen;
+        for (BasicBlock *succ : successors(BB)) {
+            if (inRegion.count(succ) || !seen.insert(succ).second)
+                continue;
+            for (PHINode &phi : succ->phis()) {
+                SmallVector<Value *, 2> incoming;
+                for (unsigned i = 0; i < phi.getNumIncomingValues(); i++)
+                    if (phi.getIncomingBlock(i) == BB)
+                        incoming.push_back(phi.getIncomingValue(i));
+                for (Value *V : incoming) {
+                    Value *mapped = VMap.lookup(V);
+                    phi.addIncoming(mapped ? mapped : V,
+                                    cast<BasicBlock>(VMap[BB]));
+                }
+            }
+        }
+    }
+
+    IRBuilder<> B(head->getTerminator());
+    Value *guard = nullptr;
+    for (const HotValue &H : Hot) {
+        Value *eq = B.CreateICmpEQ(H.Field, H.Value, "primate.hot");
+        guard = guard ? B.CreateAnd(guard, eq) : eq;
+        H.Field->replaceUsesWithIf(H.Value, [&](Use &U) {
+            auto *user = dyn_cast<Instruction>(U.getUser());
+            return user && inClone.count(user->getParent());
+        });
+        NumFieldsFolded++;
+    }
+    const uint32_t scale = 1 << 20;
+    uint32_t hotWeight = std::max<uint32_t>(1, Prob * scale);
+    uint32_t coldWeight = std::max<uint32_t>(1, (1.0 - Prob) * scale);
+    BranchInst *br = B.CreateCondBr(
+        guard, cast<BasicBlock>(VMap[tail]), tail,
+        MDBuilder(F.getContext()).createBranchWeights(hotWeight, coldWeight));
+    br->setMetadata("primate.specialize", MDNode::get(F.getContext(), {}));
+    head->getTerminator()->eraseFromParent();
+
+    // fold the hot values through the clone; later passes finish the job
+    for (BasicBlock *clone : clones) {
+        SimplifyInstructionsInBlock(clone);
+        ConstantFoldTerminator(clone, /*DeleteDeadConditions=*/true);
+    }
+    removeUnreachableBlocks(F);
+    return true;
+}
+
+PreservedAnalyses PrimateSpecialize::run(Function &F,
+                                         FunctionAnalysisManager &AM) {
+    if (PrimateSpecializeMaxFields == 0 || F.isDeclaration() ||
+        !isPrimateMain(F))
+        return PreservedAnalyses::all();
+    // the function simplification pipeline may visit primate_main again
+    for (BasicBlock &BB : F)
+        if (BB.getTerminator()->getMetadata("primate.specialize"))
+            return PreservedAnalyses::all();
+
+    SmallVector<HotValue, 8> candidates;
+    collectHotValues(F, candidates);
+    if (candidates.empty())
+        return PreservedAnalyses::all();
+
+    // Fields are assumed independent. Every field the guard checks has to be
+    // read on the same path and outside of loops, so the guard can run once.
+    DominatorTree DT(F);
+    LoopInfo LI(DT);
+    SmallVector<HotValue, 4> chosen;
+    double prob = 1.0;
+    for (const HotValue &H : candidates) {
+        if (chosen.size() == PrimateSpecializeMaxFields)
+            break;
+        if (prob * H.Prob < PrimateSpecializeMinProb)
+            continue;
+        if (LI.getLoopFor(H.Field->getParent()))
+            continue;
+        if (!all_of(chosen, [&](const HotValue &C) {
+                return DT.dominates(C.Field, H.Field) ||
+                       DT.dominates(H.Field, C.Field);
+            }))
+            continue;
+        LLVM_DEBUG(dbgs() << "specializing on " << *H.Field << " == "
+                          << *H.Value << " (" << H.Prob << ")\n");
+        chosen.push_back(H);
+        prob *= H.Prob;
+    }
+    if (chosen.empty() || !specialize(F, DT, chosen, prob))
+        return PreservedAnalyses::all();
+    NumSpecialized++;
+    return PreservedAnalyses::none();
+}
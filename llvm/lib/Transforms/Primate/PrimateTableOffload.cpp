@@ -0,0 +1,178 @@
+//	PrimateTableOffload.cpp
+//	Turn small constant lookup tables into ROM backed BFUs.
+//
+//	A load from a const global with a computed index goes through the single
+//	LSU, and archgen has to serialize it against every other memory access it
+//	cannot disambiguate. Protocol tables, S-boxes and small routing maps are
+//	read-only, so a ROM next to the datapath answers the same lookup as a
+//	blue function call with a fixed latency, in parallel with other work.
+/////////////////////////////////////////////////////////////////////////////////////
+
+#include <llvm/Transforms/Primate/PrimateTableOffload.h>
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "primate-table-offload"
+
+STATISTIC(NumTables, "Number of lookup tables moved into ROM BFUs");
+STATISTIC(NumLookups, "Number of table loads replaced by ROM BFU calls");
+
+static cl::opt<unsigned> PrimateROMMaxBytes(
+    "primate-rom-max-bytes", cl::Hidden, cl::init(1024),
+    cl::desc("Largest constant table (in bytes) moved into a ROM BFU"));
+
+static cl::opt<unsigned> PrimateROMLatency(
+    "primate-rom-latency", cl::Hidden, cl::init(1),
+    cl::desc("Latency declared for generated ROM BFUs"));
+
+static cl::opt<int> PrimateROMBFUBase(
+    "primate-rom-bfu-base", cl::Hidden, cl::init(-1),
+    cl::desc("Index of the first BFU intrinsic generated for ROM tables "
+             "(as printed by archgen2tablegen.py); unset before archgen"));
+
+// A table qualifies when it is a small integer array that is only ever read
+// element-wise through computed indices. Anything else (address taken,
+// constant indices, partial reads) stays in rodata.
+bool PrimateTableOffload::isOffloadCandidate(
+    GlobalVariable &GV, SmallVectorImpl<LoadInst *> &Lookups) {
+    if (!GV.isConstant() || !GV.hasDefinitiveInitializer() ||
+        GV.isThreadLocal())
+        return false;
+    auto *Table = dyn_cast<ConstantDataArray>(GV.getInitializer());
+    if (!Table || !Table->getElementType()->isIntegerTy() ||
+        Table->getElementType()->getIntegerBitWidth() > 32)
+        return false;
+    const DataLayout &DL = GV.getParent()->getDataLayout();
+    if (DL.getTypeAllocSize(Table->getType()) > PrimateROMMaxBytes)
+        return false;
+
+    Type *ElemTy = Table->getElementType();
+    for (User *U : GV.users()) {
+        auto *GEP = dyn_cast<GetElementPtrInst>(U);
+        if (!GEP || GEP->getPointerOperand() != &GV)
+            return false;
+        Value *Idx;
+        if (GEP->getSourceElementType() == Table->getType() &&
+            GEP->getNumIndices() == 2 &&
+            isa<ConstantInt>(GEP->getOperand(1)) &&
+            cast<ConstantInt>(GEP->getOperand(1))->isZero())
+            Idx = GEP->getOperand(2);
+        else if (GEP->getSourceElementType() == ElemTy &&
+                 GEP->getNumIndices() == 1)
+            Idx = GEP->getOperand(1);
+        else
+            return false;
+        if (isa<Constant>(Idx))
+            return false;
+        for (User *GU : GEP->users()) {
+            auto *Ld = dyn_cast<LoadInst>(GU);
+            if (!Ld || !Ld->isSimple() || Ld->getType() != ElemTy ||
+                Ld->getPointerOperand() != GEP)
+                return false;
+            Lookups.push_back(Ld);
+        }
+    }
+    return !Lookups.empty();
+}
+
+Function *PrimateTableOffload::getLookupFunction(Module &M,
+                                                 GlobalVariable &GV,
+                                                 unsigned Idx) {
+    LLVMContext &Ctx = M.getContext();
+    auto *Table = cast<ConstantDataArray>(GV.getInitializer());
+    Type *ElemTy = Table->getElementType();
+    Type *IdxTy = Type::getInt32Ty(Ctx);
+
+    std::string UnitName = "ROM_";
+    for (char C : GV.getName())
+        UnitName += isAlnum(C) ? C : '_';
+
+    MDNode *PrimateMD = MDNode::get(Ctx,
+        {MDString::get(Ctx, "blue"),
+         MDString::get(Ctx, UnitName),
+         ConstantAsMetadata::get(ConstantInt::get(Type::getInt64Ty(Ctx),
+                                                  PrimateROMLatency)),
+         ConstantAsMetadata::get(ConstantInt::get(Type::getInt64Ty(Ctx), 1))});
+
+    Function *F;
+    if (PrimateROMBFUBase >= 0) {
+        std::string IntrinName =
+            "llvm.primate.BFU." + std::to_string(PrimateROMBFUBase + Idx);
+        Intrinsic::ID ID = Function::lookupIntrinsicID(IntrinName);
+        if (ID == Intrinsic::not_intrinsic) {
+            errs() << "No BFU intrinsic " << IntrinName << " for "
+                   << UnitName << ". Rerun archgen2tablegen.py with --rom_cfg\n";
+            return nullptr;
+        }
+        F = Intrinsic::getDeclaration(&M, ID, {ElemTy, IdxTy});
+    } else {
+        F = cast<Function>(M.getOrInsertFunction("primate_rom_" +
+                                                     UnitName.substr(4),
+                                                 ElemTy, IdxTy)
+                               .getCallee());
+        F->setDoesNotThrow();
+        F->setMetadata("primate.rom",
+            MDNode::get(Ctx, {ConstantAsMetadata::get(Table),
+                              ConstantAsMetadata::get(
+                                  ConstantInt::get(IdxTy, Idx))}));
+    }
+    F->setMetadata("primate", PrimateMD);
+    return F;
+}
+
+PreservedAnalyses PrimateTableOffload::run(Module &M,
+                                           ModuleAnalysisManager &AM) {
+    if (RequireBFUBase && PrimateROMBFUBase < 0)
+        return PreservedAnalyses::all();
+
+    // Tables are numbered by name so that the BFU indices picked before and
+    // after archgen agree no matter how the module was laid out.
+    SmallVector<GlobalVariable *, 8> Tables;
+    for (GlobalVariable &GV : M.globals())
+        Tables.push_back(&GV);
+    llvm::sort(Tables, [](GlobalVariable *A, GlobalVariable *B) {
+        return A->getName() < B->getName();
+    });
+
+    bool Changed = false;
+    unsigned NumROMs = 0;
+    for (GlobalVariable *GV : Tables) {
+        SmallVector<LoadInst *, 8> Lookups;
+        if (!isOffloadCandidate(*GV, Lookups))
+            continue;
+        Function *Lookup = getLookupFunction(M, *GV, NumROMs++);
+        if (!Lookup)
+            continue;
+        LLVM_DEBUG(dbgs() << "Moving " << GV->getName() << " into "
+                          << Lookup->getName() << "\n");
+
+        for (LoadInst *Ld : Lookups) {
+            auto *GEP = cast<GetElementPtrInst>(Ld->getPointerOperand());
+            IRBuilder<> B(Ld);
+            Value *Idx = B.CreateSExtOrTrunc(
+                GEP->getOperand(GEP->getNumOperands() - 1), B.getInt32Ty());
+            CallInst *CI = B.CreateCall(Lookup, {Idx});
+            CI->setMetadata("primate", Lookup->getMetadata("primate"));
+            CI->takeName(Ld);
+            Ld->replaceAllUsesWith(CI);
+            Ld->eraseFromParent();
+            if (GEP->use_empty())
+                GEP->eraseFromParent();
+            NumLookups++;
+        }
+        if (GV->use_empty() && GV->hasLocalLinkage())
+            GV->eraseFromParent();
+        NumTables++;
+        Changed = true;
+    }
+    return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
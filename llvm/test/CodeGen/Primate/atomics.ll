@@ -0,0 +1,111 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -mattr=+a -primate-config=%t/one.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - | FileCheck %s
+; RUN: llc -mtriple=primate32 -mattr=+a -primate-config=%t/banks.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - \
+; RUN:   | FileCheck --check-prefix=BANKS %s
+; RUN: sed 's/NUM_LSUS=2/NUM_LSUS=5/' %t/banks.cfg > %t/five.cfg
+; RUN: not llc -mtriple=primate32 -mattr=+a -primate-config=%t/five.cfg \
+; RUN:   %t/main.ll -o /dev/null 2>&1 | FileCheck --check-prefix=FIVE %s
+
+; With one LSU a word RMW is a single AMO that carries the ordering, and
+; nothing needs a fence.
+; CHECK-LABEL: name: word_add
+; CHECK-NOT:   FENCE
+; CHECK:       = AMOADD_W_AQ_RL
+; CHECK-NOT:   FENCE
+
+; Sub-word and nand RMWs are an AMOCAS loop, never LR/SC.
+; CHECK-LABEL: name: byte_add
+; CHECK-NOT:   LR_W
+; CHECK:       = AMOCAS_W {{.*}}
+; CHECK-NOT:   SC_W
+; CHECK-LABEL: name: word_nand
+; CHECK-NOT:   AMOAND_W
+; CHECK:       = AMOCAS_W {{.*}}
+
+; CHECK-LABEL: name: cas
+; CHECK-NOT:   FENCE
+; CHECK:       = AMOCAS_W_AQ_RL
+; CHECK-NOT:   FENCE
+
+; CHECK-LABEL: name: fence_only
+; CHECK:       MEMBARRIER
+; CHECK-NOT:   FENCE
+
+; CHECK-LABEL: name: store_release
+; CHECK-NOT:   FENCE
+; CHECK:       SW
+
+; With one LSU per bank the LSUs are not ordered with each other, so the
+; orderings become fences around monotonic accesses.
+; BANKS-LABEL: name: word_add
+; BANKS:       FENCE 3, 3
+; BANKS:       = AMOADD_W {{.*}}
+; BANKS:       FENCE 2, 3
+
+; BANKS-LABEL: name: cas
+; BANKS:       FENCE 3, 3
+; BANKS:       = AMOCAS_W {{.*}}
+; BANKS:       FENCE 2, 3
+
+; BANKS-LABEL: name: fence_only
+; BANKS:       FENCE 3, 3
+; BANKS-NOT:   MEMBARRIER
+
+; BANKS-LABEL: name: store_release
+; BANKS:       FENCE 3, 1
+; BANKS:       SW
+
+; The packetizer has a bank pseudo for each of at most 4 LSUs.
+; FIVE: LLVM ERROR: Primate: {{.*}}five.cfg has 5 LSUs, the backend supports up to 4 data memory banks
+
+;--- one.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 8
+SRC_MODE=8
+
+;--- banks.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 8
+SRC_MODE=8
+NUM_LSUS=2
+MEM_BANKS=count:0 byte:0 flag:1
+
+;--- main.ll
+@count = global i32 0
+@byte = global i8 0
+@flag = global i32 0
+
+define i32 @word_add(i32 %v) {
+  %old = atomicrmw add ptr @count, i32 %v seq_cst
+  ret i32 %old
+}
+
+define i8 @byte_add(i8 %v) {
+  %old = atomicrmw add ptr @byte, i8 %v monotonic
+  ret i8 %old
+}
+
+define i32 @word_nand(i32 %v) {
+  %old = atomicrmw nand ptr @count, i32 %v monotonic
+  ret i32 %old
+}
+
+define i32 @cas(i32 %expected, i32 %new) {
+  %pair = cmpxchg ptr @count, i32 %expected, i32 %new seq_cst seq_cst
+  %old = extractvalue { i32, i1 } %pair, 0
+  ret i32 %old
+}
+
+define void @fence_only() {
+  fence seq_cst
+  ret void
+}
+
+define void @store_release(i32 %v) {
+  store atomic i32 %v, ptr @flag release, align 4
+  ret void
+}
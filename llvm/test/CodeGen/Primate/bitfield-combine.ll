@@ -0,0 +1,78 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - | FileCheck %s
+
+; The register file has 4 bit fields at bits 0 and 4 of the first byte, as
+; archgen adds them for `uint8_t lo : 4, hi : 4;`. With 3 positions a field
+; spec is size index << 2 | position index, so [0,4) is 0, [4,8) is 1 and
+; the whole byte [0,8) is 4.
+
+; Reads of a bit-field are one extract of its field.
+; CHECK-LABEL: name: read_hi
+; CHECK:       = EXTRACT %{{[0-9]+}}, 1{{$}}
+; CHECK-NOT:   SRLI
+; CHECK-LABEL: name: read_lo
+; CHECK:       = EXTRACT %{{[0-9]+}}, 0{{$}}
+; CHECK-NOT:   ANDI
+
+; Writes are one insert into its field. Writing the high bits clears them
+; with a mask of the low bits, which is itself a bit-field read.
+; CHECK-LABEL: name: write_hi
+; CHECK-NOT:   ANDI
+; CHECK:       = INSERT %{{[0-9]+}}, %{{[0-9]+}}, 1{{$}}
+; CHECK-NOT:   {{^ *[^ ]+ = OR }}
+; CHECK-LABEL: name: write_lo
+; CHECK-NOT:   ANDI
+; CHECK:       = INSERT %{{[0-9]+}}, %{{[0-9]+}}, 0{{$}}
+; CHECK-NOT:   {{^ *[^ ]+ = OR }}
+; CHECK-LABEL: name:
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 4 8
+SRC_MODE=4 8
+
+;--- main.ll
+%struct.hdr = type { i8, i8 }
+
+declare %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32)
+declare void @llvm.primate.output.s_struct.hdr.i32(%struct.hdr, i32)
+
+define i32 @read_hi() {
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %b = extractvalue %struct.hdr %h, 0
+  %s = lshr i8 %b, 4
+  %r = zext i8 %s to i32
+  ret i32 %r
+}
+
+define i32 @read_lo() {
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %b = extractvalue %struct.hdr %h, 0
+  %m = and i8 %b, 15
+  %r = zext i8 %m to i32
+  ret i32 %r
+}
+
+define void @write_hi(i8 %x) {
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %b = extractvalue %struct.hdr %h, 0
+  %clear = and i8 %b, 15
+  %sh = shl i8 %x, 4
+  %or = or i8 %clear, %sh
+  %h2 = insertvalue %struct.hdr %h, i8 %or, 0
+  call void @llvm.primate.output.s_struct.hdr.i32(%struct.hdr %h2, i32 2)
+  ret void
+}
+
+define void @write_lo(i8 %x) {
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %b = extractvalue %struct.hdr %h, 0
+  %clear = and i8 %b, -16
+  %m = and i8 %x, 15
+  %or = or i8 %clear, %m
+  %h2 = insertvalue %struct.hdr %h, i8 %or, 0
+  call void @llvm.primate.output.s_struct.hdr.i32(%struct.hdr %h2, i32 2)
+  ret void
+}
@@ -0,0 +1,44 @@
+; RUN: rm -rf %t && split-file %s %t
+
+; Objects record the fingerprint of the primate.cfg the compiler was
+; generated for.
+; RUN: llc -mtriple=primate32 -filetype=obj -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint=46818eefaeaa3b30 %t/main.ll -o %t/main.o
+; RUN: llvm-objdump -h --primate-config=%t/primate.cfg %t/main.o \
+; RUN:   | FileCheck --check-prefix=SAME %s
+; SAME: primate config 46818eefaeaa3b30 NUM_ALUS=2 NUM_BFUS=1
+
+; Compiling against another primate.cfg is an error.
+; RUN: not llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint=0123456789abcdef %t/main.ll \
+; RUN:   -o /dev/null 2>&1 | FileCheck --check-prefix=OTHER %s
+; OTHER: LLVM ERROR: {{.*}}primate.cfg is primate config 46818eefaeaa3b30 (NUM_ALUS=2 NUM_BFUS=1) but the compiler was generated for 0123456789abcdef, rerun archgen2tablegen.py and rebuild it
+
+; Objects from a compiler built from the stock tablegen files have no
+; fingerprint. objdump only warns about that when asked to check one.
+; RUN: llc -mtriple=primate32 -filetype=obj -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= %t/main.ll -o %t/stock.o
+; RUN: llvm-objdump -h %t/stock.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=STOCK --implicit-check-not=warning: %s
+; RUN: llvm-objdump -h --primate-config=%t/primate.cfg %t/stock.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=STOCK-CHECKED %s
+; STOCK: file format
+; STOCK-CHECKED: warning: {{.*}}stock.o': no primate.cfg fingerprint, the configuration it was compiled for cannot be checked
+
+; An object made for another configuration is refused.
+; RUN: not llvm-objdump -h --primate-config=%t/other.cfg %t/main.o 2>&1 \
+; RUN:   | FileCheck --check-prefix=MISMATCH %s
+; MISMATCH: error: {{.*}}main.o': compiled for primate config 46818eefaeaa3b30 (NUM_ALUS=2 NUM_BFUS=1) but {{.*}}other.cfg is {{[0-9a-f]+}} (NUM_ALUS=4 NUM_BFUS=1)
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+
+;--- other.cfg
+NUM_ALUS=4
+NUM_BFUS=1
+
+;--- main.ll
+define void @primate_main() {
+  ret void
+}
@@ -0,0 +1,49 @@
+; A drop releases the packet whether or not __primate_input_done ran before
+; it, also when that differs between the paths to the drop, but not after a
+; second call.
+; RUN: rm -rf %t && split-file %s %t
+; RUN: opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/some.ll 2>&1 | FileCheck --allow-empty --check-prefix=SOME %s
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/twice.ll 2>&1 | FileCheck --check-prefix=TWICE %s
+
+; SOME-NOT: error:
+
+; TWICE: error: {{.*}}__primate_input_done() may be called more than once before this drop; call it at most once
+; TWICE-NOT: error: {{.*}}__primate_input_done()
+; TWICE-NOT: LLVM ERROR
+
+;--- some.ll
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.drop()
+
+define void @primate_main(i1 %short) {
+entry:
+  br i1 %short, label %release, label %drop
+
+release:
+  call void @llvm.primate.input.done()
+  br label %drop
+
+drop:
+  call void @llvm.primate.drop()
+  unreachable
+}
+
+;--- twice.ll
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.drop()
+
+define void @primate_main(i1 %short) {
+entry:
+  call void @llvm.primate.input.done()
+  br i1 %short, label %release, label %drop
+
+release:
+  call void @llvm.primate.input.done()
+  br label %drop
+
+drop:
+  call void @llvm.primate.drop()
+  unreachable
+}
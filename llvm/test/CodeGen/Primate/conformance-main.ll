@@ -0,0 +1,129 @@
+; Everything primate_main reaches must run without a call stack or dynamic
+; stack objects, and primate_main must release the packet exactly once.
+; RUN: rm -rf %t && split-file %s %t
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/recursion.ll 2>&1 | FileCheck --check-prefix=RECURSION %s
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/indirect.ll 2>&1 | FileCheck --check-prefix=INDIRECT %s
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/vla.ll 2>&1 | FileCheck --check-prefix=VLA %s
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/late-alloca.ll 2>&1 | FileCheck --check-prefix=LATE %s
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/missing-done.ll 2>&1 | FileCheck --check-prefix=MISSING %s
+; RUN: not opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/after-done.ll 2>&1 | FileCheck --check-prefix=AFTER %s
+; A module without primate_main is a library and is not checked.
+; RUN: opt -mtriple=primate32 -passes='default<O0>' -disable-output \
+; RUN:   %t/library.ll 2>&1 | FileCheck --allow-empty --check-prefix=LIBRARY %s
+
+; RECURSION: error: {{.*}}recursive call to 'walk'; Primate has no call stack, rewrite it as a loop
+; RECURSION-NOT: LLVM ERROR
+; INDIRECT: error: {{.*}}Primate programs cannot call through a function pointer or virtual method; call the function directly
+; INDIRECT-NOT: LLVM ERROR
+; VLA: error: {{.*}}variable sized allocation; Primate needs every stack object to have a constant size
+; VLA-NOT: LLVM ERROR
+; LATE: error: {{.*}}allocation inside a loop or after a branch; Primate needs every stack object to be allocated on entry
+; LATE-NOT: LLVM ERROR
+; MISSING: error: {{.*}}__primate_input_done() is only called on some paths to this return; call it exactly once on every path
+; MISSING-NOT: LLVM ERROR
+; AFTER: error: {{.*}}IO access happens after __primate_input_done() released the packet
+; AFTER-NOT: LLVM ERROR
+; LIBRARY-NOT: error:
+
+;--- recursion.ll
+define void @primate_main() {
+entry:
+  call void @walk(i32 4)
+  ret void
+}
+
+define void @walk(i32 %n) {
+entry:
+  %more = icmp ne i32 %n, 0
+  br i1 %more, label %recurse, label %exit
+
+recurse:
+  %next = sub i32 %n, 1
+  call void @walk(i32 %next)
+  br label %exit
+
+exit:
+  ret void
+}
+
+;--- indirect.ll
+@handler = global ptr null
+
+define void @primate_main() {
+entry:
+  %f = load ptr, ptr @handler
+  call void %f()
+  ret void
+}
+
+;--- vla.ll
+declare i32 @llvm.primate.input.len()
+
+define void @primate_main() {
+entry:
+  %n = call i32 @llvm.primate.input.len()
+  %buf = alloca i8, i32 %n
+  store volatile i8 0, ptr %buf
+  ret void
+}
+
+;--- late-alloca.ll
+define void @primate_main(i1 %c) {
+entry:
+  br i1 %c, label %then, label %exit
+
+then:
+  %tmp = alloca i32
+  store volatile i32 0, ptr %tmp
+  br label %exit
+
+exit:
+  ret void
+}
+
+;--- missing-done.ll
+declare void @llvm.primate.input.done()
+
+define void @primate_main(i1 %c) {
+entry:
+  br i1 %c, label %done, label %exit
+
+done:
+  call void @llvm.primate.input.done()
+  br label %exit
+
+exit:
+  ret void
+}
+
+;--- after-done.ll
+declare void @llvm.primate.input.done()
+declare i32 @llvm.primate.input.len()
+
+define void @primate_main() {
+entry:
+  call void @llvm.primate.input.done()
+  %n = call i32 @llvm.primate.input.len()
+  ret void
+}
+
+;--- library.ll
+define void @walk(i32 %n) {
+entry:
+  %more = icmp ne i32 %n, 0
+  br i1 %more, label %recurse, label %exit
+
+recurse:
+  %next = sub i32 %n, 1
+  call void @walk(i32 %next)
+  br label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,25 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - | FileCheck %s
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg %t/main.ll -o - \
+; RUN:   | FileCheck --check-prefix=ASM %s
+
+; A drop is a single instruction on the IO unit.
+; CHECK-LABEL: name: reject
+; CHECK:       OUTPUT_DROP
+; ASM-LABEL:   reject:
+; ASM:         drop
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 8
+SRC_MODE=8
+
+;--- main.ll
+declare void @llvm.primate.drop()
+
+define void @reject() {
+  call void @llvm.primate.drop()
+  unreachable
+}
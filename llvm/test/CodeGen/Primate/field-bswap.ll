@@ -0,0 +1,81 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -primate-config=%t/swap.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - | FileCheck %s
+; RUN: llc -mtriple=primate32 -primate-config=%t/noswap.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - \
+; RUN:   | FileCheck --check-prefix=NOSWAP %s
+
+; With FIELD_BSWAP a byte swap of a field read or written as a whole is
+; done by the extract or insert unit.
+; CHECK-LABEL: name: ntohs
+; CHECK:       = EXTRACT_SWAP %{{[0-9]+}}, {{[0-9]+}}{{$}}
+; CHECK-NOT:   = EXTRACT {{%|\$}}
+; CHECK-LABEL: name: ntohl
+; CHECK:       = EXTRACT_SWAP %{{[0-9]+}}, {{[0-9]+}}{{$}}
+; CHECK-NOT:   = EXTRACT {{%|\$}}
+; CHECK-LABEL: name: htons
+; CHECK:       = INSERT_SWAP %{{[0-9]+}}, %{{[0-9]+}}, {{[0-9]+}}{{$}}
+
+; A swap wider than the field is not a swap of the field's bytes: the 12 bit
+; field at bit 4 is read with a plain extract.
+; CHECK-LABEL: name: swap_narrow
+; CHECK:       = EXTRACT %{{[0-9]+}}, {{[0-9]+}}{{$}}
+; CHECK-NOT:   EXTRACT_SWAP
+; CHECK-LABEL: name:
+
+; Without FIELD_BSWAP the swaps stay on the ALUs.
+; NOSWAP-NOT: EXTRACT_SWAP
+; NOSWAP-NOT: INSERT_SWAP
+
+;--- swap.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 4 16 32
+SRC_MODE=12 16 32
+FIELD_BSWAP=1
+
+;--- noswap.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 4 16 32
+SRC_MODE=12 16 32
+
+;--- main.ll
+%struct.pkt = type { i16, i16, i32 }
+
+declare %struct.pkt @llvm.primate.input.s_struct.pkt.i32(i32)
+declare void @llvm.primate.output.s_struct.pkt.i32(%struct.pkt, i32)
+declare i16 @llvm.bswap.i16(i16)
+declare i32 @llvm.bswap.i32(i32)
+
+define i32 @ntohs() {
+  %p = call %struct.pkt @llvm.primate.input.s_struct.pkt.i32(i32 8)
+  %f = extractvalue %struct.pkt %p, 1
+  %s = call i16 @llvm.bswap.i16(i16 %f)
+  %r = zext i16 %s to i32
+  ret i32 %r
+}
+
+define i32 @ntohl() {
+  %p = call %struct.pkt @llvm.primate.input.s_struct.pkt.i32(i32 8)
+  %f = extractvalue %struct.pkt %p, 2
+  %s = call i32 @llvm.bswap.i32(i32 %f)
+  ret i32 %s
+}
+
+define void @htons(i16 %x) {
+  %p = call %struct.pkt @llvm.primate.input.s_struct.pkt.i32(i32 8)
+  %s = call i16 @llvm.bswap.i16(i16 %x)
+  %q = insertvalue %struct.pkt %p, i16 %s, 1
+  call void @llvm.primate.output.s_struct.pkt.i32(%struct.pkt %q, i32 8)
+  ret void
+}
+
+define i32 @swap_narrow() {
+  %p = call %struct.pkt @llvm.primate.input.s_struct.pkt.i32(i32 8)
+  %f = extractvalue %struct.pkt %p, 0
+  %hi = lshr i16 %f, 4
+  %s = call i16 @llvm.bswap.i16(i16 %hi)
+  %r = zext i16 %s to i32
+  ret i32 %r
+}
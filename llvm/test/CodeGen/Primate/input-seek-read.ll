@@ -0,0 +1,56 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - | FileCheck %s
+
+; A seek whose position is unused, followed by a fixed size read, is a single
+; inputseekread.
+; CHECK-LABEL: name: skip_options
+; CHECK-NOT:   INPUT_SEEK {{%|\$}}
+; CHECK:       = INPUT_SEEK_READ %{{[0-9]+}}, 2{{$}}
+; CHECK-NOT:   INPUT_READ
+
+; A constant added to the distance of a seek goes in its immediate.
+; CHECK-LABEL: name: seek_add
+; CHECK:       = INPUT_SEEK %{{[0-9]+}}, 8{{$}}
+
+; The read is not fused when the new position is used.
+; CHECK-LABEL: name: keep_position
+; CHECK:       = INPUT_SEEK %{{[0-9]+}}, 0{{$}}
+; CHECK:       = INPUT_READ $x0, 2{{$}}
+; CHECK-NOT:   INPUT_SEEK_READ
+; CHECK-LABEL: name:
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 8
+SRC_MODE=8
+
+;--- main.ll
+%struct.hdr = type { i8, i8 }
+
+declare i32 @llvm.primate.input.seek(i32)
+declare %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32)
+
+define i32 @skip_options(i32 %n) {
+  %p = call i32 @llvm.primate.input.seek(i32 %n)
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %b = extractvalue %struct.hdr %h, 1
+  %r = zext i8 %b to i32
+  ret i32 %r
+}
+
+define i32 @seek_add(i32 %n) {
+  %len = add i32 %n, 8
+  %p = call i32 @llvm.primate.input.seek(i32 %len)
+  ret i32 %p
+}
+
+define i32 @keep_position(i32 %n) {
+  %p = call i32 @llvm.primate.input.seek(i32 %n)
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %b = extractvalue %struct.hdr %h, 1
+  %v = zext i8 %b to i32
+  %r = add i32 %p, %v
+  ret i32 %r
+}
@@ -0,0 +1,61 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+
+; Blocks over -primate-isel-region-size instructions are cut right after the
+; first IO op past the size, or at twice the size when none comes.
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-isel-region-size=4 -stop-after=primate-isel-region-split \
+; RUN:   %t/main.ll -o - | FileCheck --check-prefix=SPLIT %s
+; SPLIT-LABEL: define i32 @long(
+; SPLIT:       %x4 = add i32 %x3, 7
+; SPLIT-NEXT:  call void @llvm.primate.input.done()
+; SPLIT-NEXT:  br label %entry.isel.region
+; SPLIT:       entry.isel.region:
+; SPLIT:       %y7 = add i32 %y6, 13
+; SPLIT-NEXT:  br label %entry.isel.region.isel.region
+; SPLIT:       entry.isel.region.isel.region:
+; SPLIT-NEXT:  %y8 = mul i32 %y7, 15
+; SPLIT:       ret i32
+
+; The regions fall through into each other, so branch folding merges them
+; back into one block before the packetizer runs.
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-isel-region-size=4 -stop-after=branch-folder \
+; RUN:   %t/main.ll -o - | FileCheck --check-prefix=MERGED %s
+; MERGED-LABEL: name: long
+; MERGED:       bb.0.entry:
+; MERGED-NOT:   bb.1
+; MERGED:       PseudoRET
+
+; Without the split the block goes to SelectionDAG whole.
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-isel-region-size=0 -stop-after=primate-isel-region-split \
+; RUN:   %t/main.ll -o - | FileCheck --check-prefix=WHOLE %s
+; WHOLE-LABEL: define i32 @long(
+; WHOLE-NOT:   isel.region
+; WHOLE:       ret i32
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+
+;--- main.ll
+declare void @llvm.primate.input.done()
+
+define i32 @long(i32 %a) {
+entry:
+  %x1 = add i32 %a, 1
+  %x2 = mul i32 %x1, 3
+  %x3 = xor i32 %x2, 5
+  %x4 = add i32 %x3, 7
+  call void @llvm.primate.input.done()
+  %y1 = mul i32 %x4, %a
+  %y2 = xor i32 %y1, 9
+  %y3 = add i32 %y2, 11
+  %y4 = mul i32 %y3, %x1
+  %y5 = xor i32 %y4, %x2
+  %y6 = add i32 %y5, %x3
+  %y7 = add i32 %y6, 13
+  %y8 = mul i32 %y7, 15
+  %y9 = xor i32 %y8, %y1
+  ret i32 %y9
+}
@@ -0,0 +1,101 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+
+; A call costs its callee's bound, also when the callee comes later in the
+; module. The loop runs 4, 8 and 12 times: the worst path grows by the same
+; packets every 4 iterations, and the only IO op, the callee's seek, counts
+; once per iteration. Without -primate-min-mpps nothing is printed.
+; RUN: sed 's/TRIPS/4/' %t/bounded.ll > %t/bounded4.ll
+; RUN: sed 's/TRIPS/8/' %t/bounded.ll > %t/bounded8.ll
+; RUN: sed 's/TRIPS/12/' %t/bounded.ll > %t/bounded12.ll
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= %t/bounded4.ll -o /dev/null 2>&1 \
+; RUN:   | FileCheck --check-prefix=QUIET --allow-empty %s
+; RUN: mv %t/linerate.cfg %t/lr4.cfg
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= %t/bounded8.ll -o /dev/null
+; RUN: mv %t/linerate.cfg %t/lr8.cfg
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= %t/bounded12.ll -o /dev/null
+; RUN: cat %t/lr4.cfg %t/lr8.cfg %t/linerate.cfg \
+; RUN:   | FileCheck --check-prefix=BOUNDED %s
+; QUIET-NOT:    worst case packets
+; BOUNDED:      BOUNDED=1
+; BOUNDED-NOT:  UNBOUNDED=
+; BOUNDED:      WORST_PACKETS=[[#P4:]]
+; BOUNDED-NEXT: WORST_IO_OPS=4
+; BOUNDED-NEXT: WORST_BFU_OPS=0
+; BOUNDED:      IO_OCCUPANCY=0.{{[0-9]*[1-9][0-9]*}}
+; BOUNDED-NEXT: BFU_OCCUPANCY=0.000
+; BOUNDED-NEXT: NUM_THREADS=4
+; BOUNDED-NEXT: THREAD_CYCLES=[[#P4 * 4]]
+; BOUNDED:      CERTIFIED=1
+; BOUNDED:      WORST_PACKETS=[[#P8:]]
+; BOUNDED-NEXT: WORST_IO_OPS=8
+; BOUNDED:      WORST_PACKETS=[[#P8 + P8 - P4]]
+; BOUNDED-NEXT: WORST_IO_OPS=12
+
+; RUN: not llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= -primate-min-mpps=100000 %t/bounded4.ll \
+; RUN:   -o /dev/null 2>&1 \
+; RUN:   | FileCheck --check-prefix=SLOW %s
+; SLOW:      worst case packets: {{[0-9]+}}, IO ops: 4, BFU ops: 0, line rate: {{.*}} Mpps
+; SLOW-NEXT: error: {{.*}}worst path of primate_main takes {{[0-9]+}} packets, {{.*}} Mpps is below the required 100000.000 Mpps
+
+; RUN: not llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= -primate-min-mpps=1 %t/unbounded.ll \
+; RUN:   -o /dev/null 2>&1 \
+; RUN:   | FileCheck --check-prefix=UNBOUNDED %s
+; RUN: FileCheck --check-prefix=UNBOUNDED-CFG %s < %t/linerate.cfg
+; UNBOUNDED: error: {{.*}}primate_main cannot be certified for line rate: no trip count bound for the loop at
+; UNBOUNDED-CFG: BOUNDED=0
+; UNBOUNDED-CFG: UNBOUNDED=no trip count bound for the loop at
+; UNBOUNDED-CFG: CERTIFIED=0
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+NUM_THREADS=4
+
+;--- bounded.ll
+declare i32 @llvm.primate.input.seek(i32)
+
+define void @primate_main() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = call i32 @helper(i32 %i)
+  %i.next = add nuw nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, TRIPS
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i32 @helper(i32 %x) noinline {
+  %y = call i32 @llvm.primate.input.seek(i32 %x)
+  ret i32 %y
+}
+
+;--- unbounded.ll
+define void @primate_main(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = call i32 @helper(i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i32 @helper(i32 %x) noinline {
+  %y = mul i32 %x, 3
+  ret i32 %y
+}
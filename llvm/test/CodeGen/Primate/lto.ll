@@ -0,0 +1,72 @@
+; primate_main and the parser it calls are in different files. The compile
+; jobs leave the whole program passes to the link, which runs them on the
+; merged module. primate_main stays external through llvm.used, parse is
+; internalized and inlined, and the external @exported survives ModuleClean
+; because a regular object may still call it.
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: opt -primate-lto-prelink -passes='lto-pre-link<O2>' \
+; RUN:   -debug-pass-manager %t/main.ll -o %t/main.bc 2>&1 \
+; RUN:   | FileCheck --check-prefix=PRELINK %s
+; RUN: opt -primate-lto-prelink -passes='lto-pre-link<O2>' \
+; RUN:   -debug-pass-manager %t/lib.ll -o %t/lib.bc 2>&1 \
+; RUN:   | FileCheck --check-prefix=PRELINK %s
+; RUN: llvm-lto2 run -primate-lto-postlink -primate-config=%t/primate.cfg \
+; RUN:   -primate-config-fingerprint= -debug-pass-manager -save-temps \
+; RUN:   -o %t/out %t/main.bc %t/lib.bc \
+; RUN:   -r=%t/main.bc,primate_main,p -r=%t/main.bc,parse, \
+; RUN:   -r=%t/lib.bc,parse,p -r=%t/lib.bc,exported,px 2>&1 \
+; RUN:   | FileCheck --check-prefix=POSTLINK %s
+; RUN: llvm-dis %t/out.0.5.precodegen.bc -o - | FileCheck --check-prefix=IR %s
+
+; PRELINK-NOT: Running pass: PrimateIntrinsicPromotion
+; PRELINK-NOT: Running pass: PrimateStructToAggre
+; PRELINK-NOT: Running pass: PrimateConformance
+; PRELINK-NOT: Running pass: PrimateModuleCleanPass
+
+; POSTLINK: Running pass: PrimateIntrinsicPromotion on primate_main
+; POSTLINK: Running pass: PrimateStructToAggre on primate_main
+; POSTLINK: Running pass: PrimateConformance on [module]
+; POSTLINK: Running pass: PrimateModuleCleanPass on [module]
+
+; IR:     @llvm.used = appending global [1 x ptr] [ptr @primate_main]
+; IR-NOT: @parse
+; IR:     define void @primate_main()
+; IR-NOT: call {{.*}}@parse
+; IR:     define {{.*}}i32 @exported()
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+
+;--- main.ll
+target datalayout = "e-G1-m:e-p:32:32-i64:64-n32-S128"
+target triple = "primate32-unknown-elf"
+
+@llvm.used = appending global [1 x ptr] [ptr @primate_main], section "llvm.metadata"
+
+declare i32 @parse(i32)
+declare i32 @llvm.primate.input.len()
+declare void @llvm.primate.input.done()
+
+define void @primate_main() {
+entry:
+  %len = call i32 @llvm.primate.input.len()
+  %hdr = call i32 @parse(i32 %len)
+  call void @llvm.primate.input.done()
+  ret void
+}
+
+;--- lib.ll
+target datalayout = "e-G1-m:e-p:32:32-i64:64-n32-S128"
+target triple = "primate32-unknown-elf"
+
+define i32 @parse(i32 %len) {
+entry:
+  %hdr = lshr i32 %len, 2
+  ret i32 %hdr
+}
+
+define i32 @exported() {
+entry:
+  ret i32 0
+}
@@ -0,0 +1,55 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg -filetype=obj \
+; RUN:   %t/main.ll -o %t/main.o
+; RUN: llvm-dwarfdump --debug-line -v %t/main.o | FileCheck --check-prefix=LINE %s
+; RUN: llvm-objdump -d -l %t/main.o | FileCheck --check-prefix=OBJDUMP %s
+
+; The independent add and xor share the first packet of 10 slots of 4 bytes.
+; The packet's first row is its statement boundary and sits at the packet
+; start, ahead of any leading nops. The other slot gets a row of its own at
+; its address, 4 * slot, with discriminator slot + 1 and no is_stmt.
+; LINE:      DW_LNE_set_discriminator ([[#]])
+; LINE:      {{^ +}}0x0000000000000000 {{ +}}[[#L0:]] {{ +}}5 {{ +}}1 {{ +}}0 {{ +}}[[#]] {{ +}}0 {{ +}}is_stmt{{$}}
+; LINE:      DW_LNE_set_discriminator ([[#D:]])
+; LINE:      DW_LNS_negate_stmt
+; LINE:      {{^ +}}0x[[#%.16x,mul(4,D-1)]] {{ +}}[[#L1:]] {{ +}}5 {{ +}}1 {{ +}}0 {{ +}}[[#D]] {{ +}}0 {{ *$}}
+; The or that needs both starts the next packet, at 40 bytes.
+; LINE:      DW_LNS_negate_stmt
+; LINE:      {{^ +}}0x0000000000000028 {{ +}}5 {{ +}}5 {{ +}}1 {{ +}}0 {{ +}}[[#]] {{ +}}0 {{ +}}is_stmt{{$}}
+
+; objdump shows every line a packet executes after the packet break, once.
+; OBJDUMP:      0 --------
+; OBJDUMP-NEXT: ; f():
+; OBJDUMP-NEXT: ; /src{{[/\\]}}packet.c:[[#L0]]
+; OBJDUMP-NEXT: ; /src{{[/\\]}}packet.c:[[#L1]]
+; OBJDUMP-NOT:  packet.c
+; OBJDUMP:      1 --------
+; OBJDUMP-NEXT: ; /src{{[/\\]}}packet.c:5
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 8
+SRC_MODE=8
+
+;--- main.ll
+define i32 @f(i32 %a, i32 %b, i32 %c, i32 %d) !dbg !5 {
+  %x = add i32 %a, %b, !dbg !8
+  %y = xor i32 %c, %d, !dbg !9
+  %z = or i32 %x, %y, !dbg !10
+  ret i32 %z, !dbg !11
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C11, file: !1, emissionKind: LineTablesOnly)
+!1 = !DIFile(filename: "packet.c", directory: "/src")
+!2 = !DISubroutineType(types: !{})
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!5 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !2, scopeLine: 1, spFlags: DISPFlagDefinition, unit: !0)
+!8 = !DILocation(line: 3, column: 5, scope: !5)
+!9 = !DILocation(line: 4, column: 5, scope: !5)
+!10 = !DILocation(line: 5, column: 5, scope: !5)
+!11 = !DILocation(line: 6, column: 5, scope: !5)
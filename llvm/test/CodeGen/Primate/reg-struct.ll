@@ -0,0 +1,60 @@
+; A #pragma primate reg struct must never need to live in memory, so what
+; would keep it there is an error rather than a silent fallback.
+; RUN: rm -rf %t && split-file %s %t
+; RUN: not opt -mtriple=primate32 -primate-config=%t/reg.cfg \
+; RUN:   -passes='default<O0>' -disable-output %t/call.ll 2>&1 \
+; RUN:   | FileCheck --check-prefix=CALL %s
+; RUN: not opt -mtriple=primate32 -primate-config=%t/reg.cfg \
+; RUN:   -passes='default<O0>' -disable-output %t/width.ll 2>&1 \
+; RUN:   | FileCheck --check-prefix=WIDTH %s
+
+; Only primate intrinsics, BFUs and the lifetime, debug and mem intrinsics
+; may take the struct's address.
+; CALL: error: {{.*}}#pragma primate reg struct flow is kept in memory by this call to hash
+; CALL-NOT: LLVM ERROR
+
+; WIDTH: error: {{.*}}#pragma primate reg struct flow cannot be held in a register: field 'port': no register field is 16 bits wide (rerun archgen?)
+; WIDTH-NOT: LLVM ERROR
+
+;--- reg.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 32
+SRC_MODE=32
+
+;--- call.ll
+%struct.flow = type { i32, i32 }
+
+declare void @llvm.lifetime.start.p0(i64, ptr)
+declare i32 @hash(ptr)
+
+define void @primate_main() {
+entry:
+  %f = alloca %struct.flow
+  call void @llvm.lifetime.start.p0(i64 8, ptr %f)
+  %src = getelementptr %struct.flow, ptr %f, i32 0, i32 0
+  store i32 1, ptr %src
+  %h = call i32 @hash(ptr %f)
+  ret void
+}
+
+!primate.reg = !{!0}
+!0 = !{%struct.flow poison, !"flow", !1, !2}
+!1 = !{!"src", !"dst"}
+!2 = !{}
+
+;--- width.ll
+%struct.flow = type { i32, i16 }
+
+define void @primate_main() {
+entry:
+  %f = alloca %struct.flow
+  %src = getelementptr %struct.flow, ptr %f, i32 0, i32 0
+  store i32 1, ptr %src
+  ret void
+}
+
+!primate.reg = !{!0}
+!0 = !{%struct.flow poison, !"flow", !1, !2}
+!1 = !{!"src", !"port"}
+!2 = !{}
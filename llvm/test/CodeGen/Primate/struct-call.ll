@@ -0,0 +1,60 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: llc -mtriple=primate32 -primate-config=%t/primate.cfg \
+; RUN:   -stop-after=finalize-isel %t/main.ll -o - | FileCheck %s
+
+; Structs that fit a WIDEREG are passed and returned in the wide register
+; holding the argument GPR, here p10 for the struct and x11 for the scalar.
+; CHECK-LABEL: name: swap
+; CHECK:       liveins: $p10, $x11
+; CHECK:       %{{[0-9]+}}:widereg = COPY $p10
+; CHECK:       $p10 = COPY %{{[0-9]+}}
+; CHECK-NEXT:  PseudoRET implicit $p10
+
+; CHECK-LABEL: name: swap_fast
+; CHECK:       liveins: $p10
+; CHECK:       PseudoRET implicit $p10
+
+; CHECK-LABEL: name: caller
+; CHECK:       $p10 = COPY %{{[0-9]+}}
+; CHECK:       $x11 = COPY %{{[0-9]+}}
+; CHECK:       PseudoCALL {{.*}}@swap, {{.*}}implicit $p10, implicit $x11
+; CHECK:       %{{[0-9]+}}:widereg = COPY $p10
+; CHECK:       PseudoCALL {{.*}}@swap_fast, {{.*}}implicit $p10
+; CHECK:       = COPY $p10
+
+;--- primate.cfg
+NUM_ALUS=2
+NUM_BFUS=1
+SRC_POS=0 8
+SRC_MODE=8
+
+;--- main.ll
+%struct.hdr = type { i8, i8 }
+
+declare %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32)
+
+define %struct.hdr @swap(%struct.hdr %h, i8 %c) noinline {
+  %a = extractvalue %struct.hdr %h, 0
+  %b = extractvalue %struct.hdr %h, 1
+  %s = add i8 %b, %c
+  %r0 = insertvalue %struct.hdr undef, i8 %s, 0
+  %r1 = insertvalue %struct.hdr %r0, i8 %a, 1
+  ret %struct.hdr %r1
+}
+
+define internal fastcc %struct.hdr @swap_fast(%struct.hdr %h) noinline {
+  %a = extractvalue %struct.hdr %h, 0
+  %b = extractvalue %struct.hdr %h, 1
+  %r0 = insertvalue %struct.hdr undef, i8 %b, 0
+  %r1 = insertvalue %struct.hdr %r0, i8 %a, 1
+  ret %struct.hdr %r1
+}
+
+define i32 @caller(i8 %c) {
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %r = call %struct.hdr @swap(%struct.hdr %h, i8 %c)
+  %f = call fastcc %struct.hdr @swap_fast(%struct.hdr %r)
+  %b = extractvalue %struct.hdr %f, 0
+  %z = zext i8 %b to i32
+  ret i32 %z
+}
@@ -0,0 +1,21 @@
+# RUN: llvm-mc %s -triple=primate32 -show-encoding \
+# RUN:   | FileCheck -check-prefixes=CHECK-ASM,CHECK-ASM-AND-OBJ %s
+# RUN: llvm-mc -filetype=obj -triple=primate32 < %s \
+# RUN:   | llvm-objdump -d - \
+# RUN:   | FileCheck --check-prefix=CHECK-ASM-AND-OBJ %s
+
+# CHECK-ASM-AND-OBJ: extractbs x10, p1, 3
+# CHECK-ASM: encoding: [0x2b,0xc5,0x30,0x00]
+extractbs x10, p1, 3
+# CHECK-ASM-AND-OBJ: extractbs x31, p31, 2047
+# CHECK-ASM: encoding: [0xab,0xcf,0xff,0x7f]
+extractbs x31, p31, 2047
+
+# The wide register is both source and destination, the value to insert goes
+# in the rs1 field.
+# CHECK-ASM-AND-OBJ: insertbs p1, p1, x11, 3
+# CHECK-ASM: encoding: [0xab,0xd0,0x35,0x00]
+insertbs p1, p1, x11, 3
+# CHECK-ASM-AND-OBJ: insertbs p31, p31, x31, 2047
+# CHECK-ASM: encoding: [0xab,0xdf,0xff,0x7f]
+insertbs p31, p31, x31, 2047
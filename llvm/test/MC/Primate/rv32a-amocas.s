@@ -0,0 +1,18 @@
+# RUN: llvm-mc %s -triple=primate32 -mattr=+a -show-encoding \
+# RUN:   | FileCheck -check-prefixes=CHECK-ASM,CHECK-ASM-AND-OBJ %s
+# RUN: llvm-mc -filetype=obj -triple=primate32 -mattr=+a < %s \
+# RUN:   | llvm-objdump -d --mattr=+a - \
+# RUN:   | FileCheck --check-prefix=CHECK-ASM-AND-OBJ %s
+
+# CHECK-ASM-AND-OBJ: amocas.w x10, x11, (x12)
+# CHECK-ASM: encoding: [0x2f,0x25,0xb6,0x28]
+amocas.w x10, x11, (x12)
+# CHECK-ASM-AND-OBJ: amocas.w.aq x10, x11, (x12)
+# CHECK-ASM: encoding: [0x2f,0x25,0xb6,0x2c]
+amocas.w.aq x10, x11, (x12)
+# CHECK-ASM-AND-OBJ: amocas.w.rl x10, x11, (x12)
+# CHECK-ASM: encoding: [0x2f,0x25,0xb6,0x2a]
+amocas.w.rl x10, x11, (x12)
+# CHECK-ASM-AND-OBJ: amocas.w.aqrl x10, x11, (x12)
+# CHECK-ASM: encoding: [0x2f,0x25,0xb6,0x2e]
+amocas.w.aqrl x10, x11, (x12)
@@ -0,0 +1,16 @@
+# RUN: llvm-mc %s -triple=primate64 -mattr=+a -show-encoding \
+# RUN:   | FileCheck -check-prefixes=CHECK-ASM,CHECK-ASM-AND-OBJ %s
+# RUN: llvm-mc -filetype=obj -triple=primate64 -mattr=+a < %s \
+# RUN:   | llvm-objdump -d --mattr=+a - \
+# RUN:   | FileCheck --check-prefix=CHECK-ASM-AND-OBJ %s
+# RUN: not llvm-mc -triple=primate32 -mattr=+a < %s 2>&1 \
+# RUN:   | FileCheck --check-prefix=CHECK-RV32 %s
+
+# CHECK-ASM-AND-OBJ: amocas.d x10, x11, (x12)
+# CHECK-ASM: encoding: [0x2f,0x35,0xb6,0x28]
+# CHECK-RV32: :[[@LINE+1]]:1: error: instruction requires the following: PR64I Base Instruction Set{{$}}
+amocas.d x10, x11, (x12)
+# CHECK-ASM-AND-OBJ: amocas.d.aqrl x10, x11, (x12)
+# CHECK-ASM: encoding: [0x2f,0x35,0xb6,0x2e]
+# CHECK-RV32: :[[@LINE+1]]:1: error: instruction requires the following: PR64I Base Instruction Set{{$}}
+amocas.d.aqrl x10, x11, (x12)
@@ -0,0 +1,43 @@
+; RUN: rm -rf %t && mkdir %t && cd %t
+; RUN: opt -passes=primate-arch-gen -disable-output %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=REPORT %s
+; RUN: FileCheck --check-prefix=CFG --input-file=%t/primate.cfg %s
+
+; Half of the green ops multiply and half are bit-manip, so each of the two
+; gets ceil(0.5 * 1.5 * N) of the N lanes, the first ones. Nothing shifts,
+; but the first lane keeps a shifter in case lowering introduces one, and
+; the comparator is cheap enough to stay on every lane.
+; REPORT:      mul: 50% of green ops, [[#LANES:]] of [[#N:]] lanes
+; REPORT-NEXT: shift: 0% of green ops, 1 of [[#N]] lanes
+; REPORT-NEXT: bitmanip: 50% of green ops, [[#LANES]] of [[#N]] lanes
+; REPORT-NEXT: compare: 0% of green ops, [[#N]] of [[#N]] lanes
+
+; Lane 0 has every capability (15), the other multiplier lanes the
+; multiplier (bit 1) and bit-manip (bit 4) with the comparator (13), the
+; rest only the comparator (8).
+; CFG: ALU_CAPS=15 {{(13 )*(8 )*$}}
+
+@a = global i32 0
+@b = global i32 0
+@out = global [4 x i32] zeroinitializer
+
+declare i32 @llvm.ctpop.i32(i32)
+declare i32 @llvm.umin.i32(i32, i32)
+
+define void @primate_main() {
+entry:
+  %x = load i32, ptr @a
+  %y = load i32, ptr @b
+  %m0 = mul i32 %x, %y
+  %m1 = mul i32 %x, 3
+  %pop = call i32 @llvm.ctpop.i32(i32 %y)
+  %min = call i32 @llvm.umin.i32(i32 %x, i32 %y)
+  store i32 %m0, ptr @out
+  %o1 = getelementptr [4 x i32], ptr @out, i32 0, i32 1
+  store i32 %m1, ptr %o1
+  %o2 = getelementptr [4 x i32], ptr @out, i32 0, i32 2
+  store i32 %pop, ptr %o2
+  %o3 = getelementptr [4 x i32], ptr @out, i32 0, i32 3
+  store i32 %min, ptr %o3
+  ret void
+}
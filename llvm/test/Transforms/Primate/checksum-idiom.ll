@@ -0,0 +1,220 @@
+; RUN: opt -passes=primate-checksum-idiom -S %s | FileCheck %s
+
+; CRC idioms collapse onto the BFU whose unit is named after the reflected
+; polynomial, 8 rounds per call.
+
+@crc_table = internal constant [256 x i32] [i32 0, i32 1996959894, i32 -301047508, i32 -1727442502, i32 124634137, i32 1886057615, i32 -379345611, i32 -1637575261, i32 249268274, i32 2044508324, i32 -522852066, i32 -1747789432, i32 162941995, i32 2125561021, i32 -407360249, i32 -1866523247, i32 498536548, i32 1789927666, i32 -205950648, i32 -2067906082, i32 450548861, i32 1843258603, i32 -187386543, i32 -2083289657, i32 325883990, i32 1684777152, i32 -43845254, i32 -1973040660, i32 335633487, i32 1661365465, i32 -99664541, i32 -1928851979, i32 997073096, i32 1281953886, i32 -715111964, i32 -1570279054, i32 1006888145, i32 1258607687, i32 -770865667, i32 -1526024853, i32 901097722, i32 1119000684, i32 -608450090, i32 -1396901568, i32 853044451, i32 1172266101, i32 -589951537, i32 -1412350631, i32 651767980, i32 1373503546, i32 -925412992, i32 -1076862698, i32 565507253, i32 1454621731, i32 -809855591, i32 -1195530993, i32 671266974, i32 1594198024, i32 -972236366, i32 -1324619484, i32 795835527, i32 1483230225, i32 -1050600021, i32 -1234817731, i32 1994146192, i32 31158534, i32 -1731059524, i32 -271249366, i32 1907459465, i32 112637215, i32 -1614814043, i32 -390540237, i32 2013776290, i32 251722036, i32 -1777751922, i32 -519137256, i32 2137656763, i32 141376813, i32 -1855689577, i32 -429695999, i32 1802195444, i32 476864866, i32 -2056965928, i32 -228458418, i32 1812370925, i32 453092731, i32 -2113342271, i32 -183516073, i32 1706088902, i32 314042704, i32 -1950435094, i32 -54949764, i32 1658658271, i32 366619977, i32 -1932296973, i32 -69972891, i32 1303535960, i32 984961486, i32 -1547960204, i32 -725929758, i32 1256170817, i32 1037604311, i32 -1529756563, i32 -740887301, i32 1131014506, i32 879679996, i32 -1385723834, i32 -631195440, i32 1141124467, i32 855842277, i32 -1442165665, i32 -586318647, i32 1342533948, i32 654459306, i32 -1106571248, i32 -921952122, i32 1466479909, i32 544179635, i32 -1184443383, i32 -832445281, i32 1591671054, i32 702138776, i32 -1328506846, i32 -942167884, i32 1504918807, i32 783551873, i32 -1212326853, i32 -1061524307, i32 -306674912, i32 -1698712650, i32 62317068, i32 1957810842, i32 -355121351, i32 -1647151185, i32 81470997, i32 1943803523, i32 -480048366, i32 -1805370492, i32 225274430, i32 2053790376, i32 -468791541, i32 -1828061283, i32 167816743, i32 2097651377, i32 -267414716, i32 -2029476910, i32 503444072, i32 1762050814, i32 -144550051, i32 -2140837941, i32 426522225, i32 1852507879, i32 -19653770, i32 -1982649376, i32 282753626, i32 1742555852, i32 -105259153, i32 -1900089351, i32 397917763, i32 1622183637, i32 -690576408, i32 -1580100738, i32 953729732, i32 1340076626, i32 -776247311, i32 -1497606297, i32 1068828381, i32 1219638859, i32 -670225446, i32 -1358292148, i32 906185462, i32 1090812512, i32 -547295293, i32 -1469587627, i32 829329135, i32 1181335161, i32 -882789492, i32 -1134132454, i32 628085408, i32 1382605366, i32 -871598187, i32 -1156888829, i32 570562233, i32 1426400815, i32 -977650754, i32 -1296233688, i32 733239954, i32 1555261956, i32 -1026031705, i32 -1244606671, i32 752459403, i32 1541320221, i32 -1687895376, i32 -328994266, i32 1969922972, i32 40735498, i32 -1677130071, i32 -351390145, i32 1913087877, i32 83908371, i32 -1782625662, i32 -491226604, i32 2075208622, i32 213261112, i32 -1831694693, i32 -438977011, i32 2094854071, i32 198958881, i32 -2032938284, i32 -237706686, i32 1759359992, i32 534414190, i32 -2118248755, i32 -155638181, i32 1873836001, i32 414664567, i32 -2012718362, i32 -15766928, i32 1711684554, i32 285281116, i32 -1889165569, i32 -127750551, i32 1634467795, i32 376229701, i32 -1609899400, i32 -686959890, i32 1308918612, i32 956543938, i32 -1486412191, i32 -799009033, i32 1231636301, i32 1047427035, i32 -1362007478, i32 -640263460, i32 1088359270, i32 936918000, i32 -1447252397, i32 -558129467, i32 1202900863, i32 817233897, i32 -1111625188, i32 -893730166, i32 1404277552, i32 615818150, i32 -1160759803, i32 -841546093, i32 1423857449, i32 601450431, i32 -1285129682, i32 -1000256840, i32 1567103746, i32 711928724, i32 -1274298825, i32 -1022587231, i32 1510334235, i32 755167117]
+
+declare !primate !0 i32 @crc32_bfu(i32)
+
+; CHECK-LABEL: @crc_rounds(
+; CHECK-NEXT:    %x8 = call i32 @crc32_bfu(i32 %x), !primate !0
+; CHECK-NEXT:    ret i32 %x8
+define i32 @crc_rounds(i32 %x) {
+  %a0 = and i32 %x, 1
+  %m0 = sub i32 0, %a0
+  %p0 = and i32 %m0, -306674912
+  %s0 = lshr i32 %x, 1
+  %x1 = xor i32 %s0, %p0
+  %a1 = and i32 %x1, 1
+  %m1 = sub i32 0, %a1
+  %p1 = and i32 %m1, -306674912
+  %s1 = lshr i32 %x1, 1
+  %x2 = xor i32 %s1, %p1
+  %a2 = and i32 %x2, 1
+  %m2 = sub i32 0, %a2
+  %p2 = and i32 %m2, -306674912
+  %s2 = lshr i32 %x2, 1
+  %x3 = xor i32 %s2, %p2
+  %a3 = and i32 %x3, 1
+  %m3 = sub i32 0, %a3
+  %p3 = and i32 %m3, -306674912
+  %s3 = lshr i32 %x3, 1
+  %x4 = xor i32 %s3, %p3
+  %a4 = and i32 %x4, 1
+  %m4 = sub i32 0, %a4
+  %p4 = and i32 %m4, -306674912
+  %s4 = lshr i32 %x4, 1
+  %x5 = xor i32 %s4, %p4
+  %a5 = and i32 %x5, 1
+  %m5 = sub i32 0, %a5
+  %p5 = and i32 %m5, -306674912
+  %s5 = lshr i32 %x5, 1
+  %x6 = xor i32 %s5, %p5
+  %a6 = and i32 %x6, 1
+  %m6 = sub i32 0, %a6
+  %p6 = and i32 %m6, -306674912
+  %s6 = lshr i32 %x6, 1
+  %x7 = xor i32 %s6, %p6
+  %a7 = and i32 %x7, 1
+  %m7 = sub i32 0, %a7
+  %p7 = and i32 %m7, -306674912
+  %s7 = lshr i32 %x7, 1
+  %x8 = xor i32 %s7, %p7
+  ret i32 %x8
+}
+
+; Seven rounds are not a whole BFU call.
+; CHECK-LABEL: @crc_partial(
+; CHECK-NOT:     call
+; CHECK:         ret i32 %x7
+define i32 @crc_partial(i32 %x) {
+  %a0 = and i32 %x, 1
+  %m0 = sub i32 0, %a0
+  %p0 = and i32 %m0, -306674912
+  %s0 = lshr i32 %x, 1
+  %x1 = xor i32 %s0, %p0
+  %a1 = and i32 %x1, 1
+  %m1 = sub i32 0, %a1
+  %p1 = and i32 %m1, -306674912
+  %s1 = lshr i32 %x1, 1
+  %x2 = xor i32 %s1, %p1
+  %a2 = and i32 %x2, 1
+  %m2 = sub i32 0, %a2
+  %p2 = and i32 %m2, -306674912
+  %s2 = lshr i32 %x2, 1
+  %x3 = xor i32 %s2, %p2
+  %a3 = and i32 %x3, 1
+  %m3 = sub i32 0, %a3
+  %p3 = and i32 %m3, -306674912
+  %s3 = lshr i32 %x3, 1
+  %x4 = xor i32 %s3, %p3
+  %a4 = and i32 %x4, 1
+  %m4 = sub i32 0, %a4
+  %p4 = and i32 %m4, -306674912
+  %s4 = lshr i32 %x4, 1
+  %x5 = xor i32 %s4, %p4
+  %a5 = and i32 %x5, 1
+  %m5 = sub i32 0, %a5
+  %p5 = and i32 %m5, -306674912
+  %s5 = lshr i32 %x5, 1
+  %x6 = xor i32 %s5, %p5
+  %a6 = and i32 %x6, 1
+  %m6 = sub i32 0, %a6
+  %p6 = and i32 %m6, -306674912
+  %s6 = lshr i32 %x6, 1
+  %x7 = xor i32 %s6, %p6
+  ret i32 %x7
+}
+
+; The table step is 8 rounds on the state with the data byte in its low bits.
+; CHECK-LABEL: @crc_table_step(
+; CHECK:         [[LOW:%.*]] = and i32 %y, 255
+; CHECK:         [[HIGH:%.*]] = and i32 %crc, -256
+; CHECK:         [[IN:%.*]] = or i32 [[HIGH]], [[LOW]]
+; CHECK:         %next = call i32 @crc32_bfu(i32 [[IN]]), !primate !0
+; CHECK-NOT:     @crc_table
+; CHECK:         ret i32 %next
+define i32 @crc_table_step(i32 %crc, i8 %byte) {
+  %b = zext i8 %byte to i32
+  %y = xor i32 %crc, %b
+  %i = and i32 %y, 255
+  %idx = zext i32 %i to i64
+  %gep = getelementptr inbounds [256 x i32], ptr @crc_table, i64 0, i64 %idx
+  %t = load i32, ptr %gep, align 4
+  %sh = lshr i32 %crc, 8
+  %next = xor i32 %t, %sh
+  ret i32 %next
+}
+
+; A rolled loop of 16 rounds becomes two calls.
+; CHECK-LABEL: @crc_loop(
+; CHECK:         [[C0:%.*]] = call i32 @crc32_bfu(i32 %init)
+; CHECK-NEXT:    [[C1:%.*]] = call i32 @crc32_bfu(i32 [[C0]])
+; CHECK-NOT:     br i1
+; CHECK:         %r = phi i32 [ [[C1]], %entry ]
+; CHECK-NEXT:    ret i32 %r
+define i32 @crc_loop(i32 %init) {
+entry:
+  br label %loop
+
+loop:
+  %x = phi i32 [ %init, %entry ], [ %next, %loop ]
+  %n = phi i32 [ 0, %entry ], [ %n.next, %loop ]
+  %a = and i32 %x, 1
+  %m = sub i32 0, %a
+  %p = and i32 %m, -306674912
+  %s = lshr i32 %x, 1
+  %next = xor i32 %s, %p
+  %n.next = add nuw nsw i32 %n, 1
+  %done = icmp eq i32 %n.next, 16
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ %next, %loop ]
+  ret i32 %r
+}
+
+; Without a BFU for the polynomial nothing changes.
+; CHECK-LABEL: @crc_no_bfu(
+; CHECK-NOT:     call
+; CHECK:         ret i32 %x8
+define i32 @crc_no_bfu(i32 %x) {
+  %a0 = and i32 %x, 1
+  %m0 = sub i32 0, %a0
+  %p0 = and i32 %m0, -2097792136
+  %s0 = lshr i32 %x, 1
+  %x1 = xor i32 %s0, %p0
+  %a1 = and i32 %x1, 1
+  %m1 = sub i32 0, %a1
+  %p1 = and i32 %m1, -2097792136
+  %s1 = lshr i32 %x1, 1
+  %x2 = xor i32 %s1, %p1
+  %a2 = and i32 %x2, 1
+  %m2 = sub i32 0, %a2
+  %p2 = and i32 %m2, -2097792136
+  %s2 = lshr i32 %x2, 1
+  %x3 = xor i32 %s2, %p2
+  %a3 = and i32 %x3, 1
+  %m3 = sub i32 0, %a3
+  %p3 = and i32 %m3, -2097792136
+  %s3 = lshr i32 %x3, 1
+  %x4 = xor i32 %s3, %p3
+  %a4 = and i32 %x4, 1
+  %m4 = sub i32 0, %a4
+  %p4 = and i32 %m4, -2097792136
+  %s4 = lshr i32 %x4, 1
+  %x5 = xor i32 %s4, %p4
+  %a5 = and i32 %x5, 1
+  %m5 = sub i32 0, %a5
+  %p5 = and i32 %m5, -2097792136
+  %s5 = lshr i32 %x5, 1
+  %x6 = xor i32 %s5, %p5
+  %a6 = and i32 %x6, 1
+  %m6 = sub i32 0, %a6
+  %p6 = and i32 %m6, -2097792136
+  %s6 = lshr i32 %x6, 1
+  %x7 = xor i32 %s6, %p6
+  %a7 = and i32 %x7, 1
+  %m7 = sub i32 0, %a7
+  %p7 = and i32 %m7, -2097792136
+  %s7 = lshr i32 %x7, 1
+  %x8 = xor i32 %s7, %p7
+  ret i32 %x8
+}
+
+; The RFC 1071 fold loop is at its fixed point after two folds.
+; CHECK-LABEL: @csum_fold(
+; CHECK:         %csum.fold = add i32
+; CHECK:         %csum.fold1 = add i32
+; CHECK-NOT:     br i1
+; CHECK:         %r = phi i32 [ %csum.fold1, %entry ]
+; CHECK-NEXT:    ret i32 %r
+define i32 @csum_fold(i32 %s0) {
+entry:
+  br label %loop
+
+loop:
+  %s = phi i32 [ %s0, %entry ], [ %next, %loop ]
+  %lo = and i32 %s, 65535
+  %hi = lshr i32 %s, 16
+  %next = add i32 %lo, %hi
+  %more = icmp ugt i32 %next, 65535
+  br i1 %more, label %loop, label %exit
+
+exit:
+  %r = phi i32 [ %next, %loop ]
+  ret i32 %r
+}
+
+!0 = !{!"blue", !"crc_edb88320", i64 1, i64 1}
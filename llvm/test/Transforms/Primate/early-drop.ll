@@ -0,0 +1,103 @@
+; RUN: rm -rf %t && split-file %s %t
+; RUN: opt -passes=primate-early-drop -S %t/tail.ll | FileCheck %s
+; RUN: opt -passes=primate-early-drop -S %t/output.ll \
+; RUN:   | FileCheck --check-prefix=OUTPUT %s
+; RUN: opt -passes=primate-early-drop -S %t/merge.ll \
+; RUN:   | FileCheck --check-prefix=MERGE %s
+
+; A branch taken before any output into a tail that only releases the packet
+; drops instead. The tail stays for the paths that wrote the output.
+; CHECK-LABEL: define void @primate_main(
+; CHECK:       br i1 %bad, label %primate.drop, label %fwd
+; CHECK:       exit:
+; CHECK-NEXT:    call void @llvm.primate.input.done()
+; CHECK-NEXT:    call void @llvm.primate.output.done()
+; CHECK-NEXT:    ret void
+; CHECK:       primate.drop:
+; CHECK-NEXT:    call void @llvm.primate.drop()
+; CHECK-NEXT:    unreachable
+
+; A reject path that writes its own output is not a drop.
+; OUTPUT-LABEL: define void @primate_main(
+; OUTPUT:       br i1 %bad, label %reject, label %fwd
+; OUTPUT-NOT:   @llvm.primate.drop
+
+; Neither is a branch into an exit that does more than release the packet.
+; MERGE-LABEL: define void @primate_main(
+; MERGE:       br i1 %bad, label %exit, label %fwd
+; MERGE-NOT:   @llvm.primate.drop
+
+;--- tail.ll
+declare i32 @llvm.primate.input.i32.i32(i32)
+declare void @llvm.primate.output.i32.i32(i32, i32)
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.output.done()
+
+define void @primate_main() {
+entry:
+  %h = call i32 @llvm.primate.input.i32.i32(i32 4)
+  %bad = icmp eq i32 %h, 0
+  br i1 %bad, label %exit, label %fwd
+
+fwd:
+  call void @llvm.primate.output.i32.i32(i32 %h, i32 4)
+  br label %exit
+
+exit:
+  call void @llvm.primate.input.done()
+  call void @llvm.primate.output.done()
+  ret void
+}
+
+;--- output.ll
+declare i32 @llvm.primate.input.i32.i32(i32)
+declare void @llvm.primate.output.i32.i32(i32, i32)
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.output.done()
+
+define void @primate_main() {
+entry:
+  %h = call i32 @llvm.primate.input.i32.i32(i32 4)
+  %bad = icmp eq i32 %h, 0
+  br i1 %bad, label %reject, label %fwd
+
+reject:
+  call void @llvm.primate.output.i32.i32(i32 -1, i32 4)
+  br label %exit
+
+fwd:
+  call void @llvm.primate.output.i32.i32(i32 %h, i32 4)
+  br label %exit
+
+exit:
+  call void @llvm.primate.input.done()
+  call void @llvm.primate.output.done()
+  ret void
+}
+
+;--- merge.ll
+@seen = global i32 0
+
+declare i32 @llvm.primate.input.i32.i32(i32)
+declare void @llvm.primate.output.i32.i32(i32, i32)
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.output.done()
+
+define void @primate_main() {
+entry:
+  %h = call i32 @llvm.primate.input.i32.i32(i32 4)
+  %bad = icmp eq i32 %h, 0
+  br i1 %bad, label %exit, label %fwd
+
+fwd:
+  call void @llvm.primate.output.i32.i32(i32 %h, i32 4)
+  br label %exit
+
+exit:
+  %n = load i32, ptr @seen
+  %n.next = add i32 %n, 1
+  store i32 %n.next, ptr @seen
+  call void @llvm.primate.input.done()
+  call void @llvm.primate.output.done()
+  ret void
+}
@@ -0,0 +1,88 @@
+; RUN: rm -rf %t && split-file %s %t && cd %t
+; RUN: opt -passes=primate-arch-gen -primate-family=%t/fam \
+; RUN:   -primate-family-name=v1 -disable-output %t/v1.ll
+; RUN: opt -passes=primate-arch-gen -primate-family=%t/fam \
+; RUN:   -primate-family-name=v2 -disable-output %t/v2.ll 2>&1 \
+; RUN:   | FileCheck --check-prefix=REPORT %s
+; RUN: cat %t/fam %t/primate.cfg | FileCheck --check-prefix=MERGED %s
+; RUN: FileCheck --check-prefix=LD --input-file=%t/banks.ld %s
+
+; v3 puts @b in bank 0, where v1 has it in bank 1. The family is left as it
+; was until v3 is rerun with @b pinned.
+; RUN: not opt -passes=primate-arch-gen -primate-family=%t/fam \
+; RUN:   -primate-family-name=v3 -disable-output %t/v3.ll 2>&1 \
+; RUN:   | FileCheck --check-prefix=CONFLICT %s
+; RUN: FileCheck --check-prefix=UNCHANGED --input-file=%t/fam %s
+; RUN: opt -passes=primate-arch-gen -primate-family=%t/fam \
+; RUN:   -primate-family-name=v3 -primate-mem-bank=b:1 -disable-output \
+; RUN:   %t/v3.ll
+; RUN: FileCheck --check-prefix=PINNED --input-file=%t/primate.cfg %s
+
+; REPORT:      program family: 2 program(s)
+; REPORT-NEXT: v1: {{.*}} cycles per packet on the shared configuration, {{.*}} on its own, constrains {{.*}}NUM_LSUS
+; REPORT-NEXT: v2: {{.*}} cycles per packet on the shared configuration, {{.*}} on its own, constrains
+
+; Every knob is the largest any program needs. v1 only multiplies, so all of
+; its lanes and all of the family's have the multiplier (bit 1).
+; MERGED:      PROGRAM=v1
+; MERGED:      ALU_CAPS={{([0-9]*[13579] )*[0-9]*[13579]$}}
+; MERGED:      MEM_BANKS=a:0 b:1{{$}}
+; MERGED:      NUM_ALUS=[[#V1:]]
+; MERGED:      PROGRAM=v2
+; MERGED:      MEM_BANKS=c:0{{$}}
+; MERGED:      NUM_ALUS=[[#V2:]]
+; MERGED:      NUM_ALUS=[[#max(V1,V2)]]
+; MERGED-NEXT: ALU_CAPS={{([0-9]*[13579] )+$}}
+; MERGED:      NUM_LSUS=2
+; MERGED-NEXT: MEM_BANKS=a:0 c:0 b:1 {{$}}
+
+; LD:      .primate.bank1 0x01000000 : {
+; LD-NEXT:   *(.data.b .bss.b .sdata.b .sbss.b .rodata.b)
+; LD-NEXT: }
+; LD:      .primate.bank0 0x00000000 : {
+; LD-NEXT:   *(.data.a .bss.a .sdata.a .sbss.a .rodata.a)
+; LD-NEXT:   *(.data.c .bss.c .sdata.c .sbss.c .rodata.c)
+
+; CONFLICT: program family: b is in bank 0 of v3 but in bank 1 of v1; rerun archgen on v3 with -primate-mem-bank=b:1
+
+; UNCHANGED-NOT: PROGRAM=v3
+
+; PINNED: NUM_LSUS=2
+; PINNED-NEXT: MEM_BANKS=a:0 c:0 b:1 {{$}}
+
+;--- v1.ll
+@a = global [4 x i32] zeroinitializer
+@b = global [4 x i32] zeroinitializer
+
+define void @primate_main() {
+entry:
+  %x = load i32, ptr @a
+  %y = load i32, ptr @b
+  %m = mul i32 %x, %y
+  store i32 %m, ptr @a
+  ret void
+}
+
+;--- v2.ll
+@c = global i32 0
+
+define void @primate_main() {
+entry:
+  %x = load i32, ptr @c
+  %s = add i32 %x, 1
+  %t = shl i32 %s, 2
+  %u = xor i32 %t, %x
+  store i32 %u, ptr @c
+  ret void
+}
+
+;--- v3.ll
+@b = global [4 x i32] zeroinitializer
+
+define void @primate_main() {
+entry:
+  %x = load i32, ptr @b
+  %s = add i32 %x, 1
+  store i32 %s, ptr @b
+  ret void
+}
@@ -0,0 +1,112 @@
+; RUN: rm -rf %t && split-file %s %t
+; RUN: opt -passes=primate-input-sanitizer -S %t/host.ll | FileCheck %s
+; RUN: opt -passes=primate-input-sanitizer -primate-input-sanitizer=trap -S \
+; RUN:   %t/host.ll | FileCheck --check-prefix=TRAP %s
+; RUN: opt -passes=primate-input-sanitizer -primate-input-sanitizer=report -S \
+; RUN:   %t/host.ll | FileCheck --check-prefix=REPORT %s
+; RUN: opt -passes=primate-input-sanitizer -S %t/primate.ll \
+; RUN:   | FileCheck --check-prefix=PRIMATE %s
+
+;--- host.ll
+declare ptr @__primate_input(i32)
+declare i32 @__primate_input_seek(i32)
+
+; Fixed size reads from the top of the packet share one check of the bytes
+; they cover, placed before the first of them.
+; CHECK-LABEL: @primate_main(
+; CHECK:       %input.len = call i32 @__primate_input_len()
+; CHECK-NEXT:  %input.over = icmp ugt i32 14, %input.len, !primate.input.check
+; CHECK-NEXT:  br i1 %input.over
+; CHECK:       call void @__primate_drop()
+; CHECK-NEXT:  unreachable
+; CHECK:       %a = call ptr @__primate_input(i32 6)
+; CHECK-NEXT:  %b = call ptr @__primate_input(i32 6)
+; CHECK-NEXT:  %c = call ptr @__primate_input(i32 2)
+; CHECK-NEXT:  ret void
+
+; TRAP-LABEL: @primate_main(
+; TRAP:       call void @llvm.trap()
+; TRAP-NEXT:  unreachable
+
+; REPORT-LABEL: @primate_main(
+; REPORT:       call void @__primate_sanitizer_input_overflow(i32 14, i32 %input.len)
+; REPORT-NEXT:  unreachable
+define void @primate_main() {
+entry:
+  %a = call ptr @__primate_input(i32 6)
+  %b = call ptr @__primate_input(i32 6)
+  %c = call ptr @__primate_input(i32 2)
+  ret void
+}
+
+; Anything but primate_main asks where its caller left the cursor. A seek
+; by a length from the packet is checked before it runs, together with the
+; read after it.
+; CHECK-LABEL: @options(
+; CHECK:       %input.len = call i32 @__primate_input_len()
+; CHECK-NEXT:  [[START:%[0-9]+]] = call i32 @__primate_input_seek(i32 0)
+; CHECK-NEXT:  [[HDR:%[a-z0-9.]+]] = add i32 [[START]], 4
+; CHECK-NEXT:  %input.over = icmp ugt i32 [[HDR]], %input.len
+; CHECK:       call ptr @__primate_input(i32 4)
+; CHECK-NEXT:  [[POS:%[0-9]+]] = add i32 [[START]], 4
+; CHECK-NEXT:  [[END:%[a-z0-9.]+]] = add i32 [[POS]], %len
+; CHECK-NEXT:  [[OPT:%[a-z0-9.]+]] = add i32 [[END]], 2
+; CHECK-NEXT:  {{%[a-z0-9.]+}} = icmp ugt i32 [[OPT]], %input.len
+; CHECK-NOT:   icmp
+; CHECK:       call i32 @__primate_input_seek(i32 %len)
+; CHECK-NEXT:  call ptr @__primate_input(i32 2)
+; CHECK-NEXT:  ret void
+define void @options(i32 %len) {
+entry:
+  %h = call ptr @__primate_input(i32 4)
+  %s = call i32 @__primate_input_seek(i32 %len)
+  %o = call ptr @__primate_input(i32 2)
+  ret void
+}
+
+; A read that only runs on one side of a branch keeps its own check, which
+; is not hoisted over the branch into the packets that skip it.
+; CHECK-LABEL: @branchy(
+; CHECK:       [[START:%[0-9]+]] = call i32 @__primate_input_seek(i32 0)
+; CHECK-NEXT:  [[E8:%[a-z0-9.]+]] = add i32 [[START]], 8
+; CHECK-NEXT:  {{%[a-z0-9.]+}} = icmp ugt i32 [[E8]], %input.len
+; CHECK:       more:
+; CHECK-NEXT:  [[E12:%[a-z0-9.]+]] = add i32 [[START]], 12
+; CHECK-NEXT:  {{%[a-z0-9.]+}} = icmp ugt i32 [[E12]], %input.len
+; CHECK:       call ptr @__primate_input(i32 4)
+define void @branchy(i1 %c) {
+entry:
+  %h = call ptr @__primate_input(i32 8)
+  br i1 %c, label %more, label %done
+
+more:
+  %x = call ptr @__primate_input(i32 4)
+  br label %done
+
+done:
+  ret void
+}
+
+; Functions that do not read leave the IO unit alone.
+; CHECK-LABEL: @quiet(
+; CHECK-NOT:   @__primate_input_len
+; CHECK:       ret void
+define void @quiet() {
+  ret void
+}
+
+;--- primate.ll
+target triple = "primate32-unknown-elf"
+
+declare i32 @llvm.primate.input.i32.i32(i32)
+
+; On Primate the length and the drop are the IO unit's.
+; PRIMATE-LABEL: @primate_main(
+; PRIMATE:       %input.len = call i32 @llvm.primate.input.len()
+; PRIMATE-NEXT:  %input.over = icmp ugt i32 4, %input.len
+; PRIMATE:       call void @llvm.primate.drop()
+; PRIMATE-NEXT:  unreachable
+define void @primate_main() {
+  %a = call i32 @llvm.primate.input.i32.i32(i32 4)
+  ret void
+}
@@ -0,0 +1,71 @@
+; RUN: rm -rf %t && mkdir %t && cd %t
+; RUN: opt -passes=primate-arch-gen -disable-output %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=REPORT %s
+; RUN: FileCheck --check-prefix=CFG --input-file=%t/primate.cfg %s
+; RUN: FileCheck --check-prefix=LD --input-file=%t/banks.ld %s
+
+; RUN: opt -passes=primate-arch-gen -primate-max-lsus=2 -disable-output %s
+; RUN: FileCheck --check-prefix=MAX2 --input-file=%t/primate.cfg %s
+; RUN: opt -passes=primate-arch-gen -primate-bank-min-conflict=0.5 \
+; RUN:   -disable-output %s
+; RUN: FileCheck --check-prefix=ONE --input-file=%t/primate.cfg %s
+; RUN: not opt -passes=primate-arch-gen -primate-max-lsus=5 -disable-output \
+; RUN:   %s 2>&1 | FileCheck --check-prefix=FIVE %s
+
+; @a, @b and @slot are accessed in one block, @slot, @f and @d or @e in the
+; other. @f escapes through @slot and is also read through the pointer loaded
+; back from it, so it stays in bank 0. @d and @e share a pointer, so they share
+; a bank. Every other global goes in the bank it collides least with, or a new
+; one while the collision is above 5% of the 6 accesses per packet.
+; REPORT: LSU 0: 2 global(s), 2 accesses per packet
+; REPORT: LSU 1: 1 global(s), 2 accesses per packet
+; REPORT: LSU 2: 3 global(s), 2 accesses per packet
+; CFG: NUM_LSUS=3
+; CFG: MEM_BANKS=a:0 f:0 slot:1 b:2 {{d:2 e:2|e:2 d:2}} {{$}}
+
+; Bank 0 comes last and takes everything the others do not.
+; LD:      .primate.bank2 0x02000000 : {
+; LD-NEXT:   *(.data.b .bss.b .sdata.b .sbss.b .rodata.b)
+; LD:      .primate.bank1 0x01000000 : {
+; LD-NEXT:   *(.data.slot .bss.slot .sdata.slot .sbss.slot .rodata.slot)
+; LD-NEXT: }
+; LD:      .primate.bank0 0x00000000 : {
+; LD-NEXT:   *(.data.a .bss.a .sdata.a .sbss.a .rodata.a)
+; LD-NEXT:   *(.data.f .bss.f .sdata.f .sbss.f .rodata.f)
+; LD-NEXT:   *(.data .data.* .sdata .sdata.* .bss .bss.* .sbss .sbss.* .rodata .rodata.*)
+; LD-NEXT: }
+
+; With two LSUs @b and @d/@e stay in the bank they collide least with.
+; MAX2: NUM_LSUS=2
+; MAX2: MEM_BANKS=a:0 b:0 {{d:0 e:0|e:0 d:0}} f:0 slot:1 {{$}}
+
+; No pair collides on more than half of the traffic.
+; ONE: NUM_LSUS=1
+; ONE: MEM_BANKS=a:0 b:0 slot:0 {{d:0 e:0|e:0 d:0}} f:0 {{$}}
+
+; The backend tells at most 4 banks apart.
+; FIVE: error: -primate-max-lsus=5 is not between 1 and the 4 data memory banks the backend can tell apart
+
+@a = global [4 x i32] zeroinitializer
+@b = global [4 x i32] zeroinitializer
+@d = global i32 0
+@e = global i32 0
+@f = global i32 0
+@slot = global ptr null
+
+define void @primate_main(i1 %c) {
+entry:
+  %x = load i32, ptr @a
+  %y = load i32, ptr @b
+  %s = add i32 %x, %y
+  store ptr @f, ptr @slot
+  br label %next
+
+next:
+  %p = select i1 %c, ptr @d, ptr @e
+  store i32 %s, ptr %p
+  %q = load ptr, ptr @slot
+  %v = load i32, ptr %q
+  store i32 %v, ptr @f
+  ret void
+}
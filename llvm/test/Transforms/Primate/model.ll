@@ -0,0 +1,55 @@
+; RUN: rm -rf %t && mkdir %t && cd %t
+; RUN: opt -passes=primate-arch-gen -disable-output %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=REPORT %s
+; RUN: FileCheck --input-file=%t/model.cfg %s
+
+; Every object of the model class is an instance: the two elements of
+; @counters, the one inside @flow and the local in primate_main. The
+; unit is pipelined to its slowest operation.
+; REPORT: Model BFU counter: 4 instance(s), 2 operation(s)
+
+; CHECK:      NUM_MODELS=1
+; CHECK-NEXT: MODEL_0_NAME=counter
+; CHECK-NEXT: MODEL_0_STATE_WIDTH=32
+; CHECK-NEXT: MODEL_0_LATENCY=5
+; CHECK-NEXT: MODEL_0_NUM_INSTANCES=4
+; CHECK-NEXT: MODEL_0_NUM_OPS=2
+; CHECK-NEXT: MODEL_0_OP_0=add
+; CHECK-NEXT: MODEL_0_OP_1=get
+
+%class.Counter = type { i32 }
+%struct.Flow = type { i32, %class.Counter }
+
+@counters = global [2 x %class.Counter] zeroinitializer
+@flow = global %struct.Flow zeroinitializer
+
+define void @primate_main() {
+entry:
+  %c = alloca %class.Counter
+  %n = call i32 @_ZN7Counter3addEj(ptr %c, i32 1)
+  %v = call i32 @_ZNK7Counter3getEv(ptr %c)
+  ret void
+}
+
+define linkonce_odr i32 @_ZN7Counter3addEj(ptr %this, i32 %n) noinline !primate !1 !primate.model !2 {
+entry:
+  %count = load i32, ptr %this
+  %sum = add i32 %count, %n
+  store i32 %sum, ptr %this
+  ret i32 %sum
+}
+
+define linkonce_odr i32 @_ZNK7Counter3getEv(ptr %this) noinline !primate !3 !primate.model !4 {
+entry:
+  %count = load i32, ptr %this
+  ret i32 %count
+}
+
+!primate.model = !{!0}
+
+!0 = !{!"counter", %class.Counter poison, !5}
+!1 = !{!"blue", !"counter", i64 3, i64 2}
+!2 = !{!"counter", i64 0, !"add"}
+!3 = !{!"blue", !"counter", i64 5, i64 1}
+!4 = !{!"counter", i64 1, !"get"}
+!5 = !{!"count"}
@@ -0,0 +1,63 @@
+; RUN: rm -rf %t && mkdir %t && cd %t
+; RUN: opt -passes=primate-pipeline-partition -primate-pipeline-stages=2 \
+; RUN:   -disable-output %s 2>&1 | FileCheck --check-prefix=QUIET %s
+; RUN: FileCheck --check-prefix=STAGE0 --input-file=%t/stage0/primate_main.ll %s
+; RUN: FileCheck --check-prefix=STAGE1 --input-file=%t/stage1/primate_main.ll %s
+; RUN: FileCheck --check-prefix=TOPOLOGY --input-file=%t/topology.cfg %s
+
+; Input has to be read in front of the cut and output written behind it, so
+; the only place to cut is %mid. %b and %c cross it, each on its own
+; channel; %a does not.
+; QUIET-NOT: Stage boundary
+
+; STAGE0-LABEL: define void @primate_main()
+; STAGE0:       %c = mul i32 %b, %b
+; STAGE0:       call void @llvm.primate.input.done()
+; STAGE0-NEXT:  br label %stage.send
+; STAGE0:       stage.send:
+; STAGE0-NEXT:  call void @llvm.primate.fifo.send.i32(i32 %b, i32 0)
+; STAGE0-NEXT:  call void @llvm.primate.fifo.send.i32(i32 %c, i32 1)
+; STAGE0-NEXT:  ret void
+; STAGE0-NOT:   call void @llvm.primate.output
+
+; STAGE1-LABEL: define void @primate_main()
+; STAGE1-NEXT:  stage.recv:
+; STAGE1-NEXT:  [[B:%.*]] = call i32 @llvm.primate.fifo.recv.i32(i32 0)
+; STAGE1-NEXT:  [[C:%.*]] = call i32 @llvm.primate.fifo.recv.i32(i32 1)
+; STAGE1-NEXT:  br label %mid
+; STAGE1:       mid:
+; STAGE1-NEXT:  %d = mul i32 [[C]], 3
+; STAGE1-NEXT:  %e = add i32 %d, [[B]]
+; STAGE1-NEXT:  call void @llvm.primate.output.i32.i32(i32 %e, i32 4)
+; STAGE1-NOT:   call {{.*}}@llvm.primate.input
+
+; TOPOLOGY:      NUM_STAGES=2
+; TOPOLOGY-NEXT: STAGE_0_DIR=stage0/
+; TOPOLOGY-NEXT: STAGE_1_DIR=stage1/
+; TOPOLOGY-NEXT: LINK_0_SRC=0
+; TOPOLOGY-NEXT: LINK_0_DST=1
+; TOPOLOGY-NEXT: LINK_0_WIDTH=64
+; TOPOLOGY-NEXT: LINK_0_CHANNELS=2
+; TOPOLOGY-NEXT: LINK_0_CHANNEL_0_WIDTH=32
+; TOPOLOGY-NEXT: LINK_0_CHANNEL_1_WIDTH=32
+
+declare i32 @llvm.primate.input.i32.i32(i32)
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.output.i32.i32(i32, i32)
+declare void @llvm.primate.output.done()
+
+define void @primate_main() {
+entry:
+  %a = call i32 @llvm.primate.input.i32.i32(i32 4)
+  %b = add i32 %a, 1
+  %c = mul i32 %b, %b
+  call void @llvm.primate.input.done()
+  br label %mid
+
+mid:
+  %d = mul i32 %c, 3
+  %e = add i32 %d, %b
+  call void @llvm.primate.output.i32.i32(i32 %e, i32 4)
+  call void @llvm.primate.output.done()
+  ret void
+}
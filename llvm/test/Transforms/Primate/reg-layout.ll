@@ -0,0 +1,48 @@
+; RUN: rm -rf %t && mkdir %t && cd %t
+; RUN: opt -passes=primate-arch-gen -disable-output %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=LAYOUT %s
+; RUN: FileCheck --check-prefix=CFG --input-file=%t/primate.cfg %s
+
+; A #pragma primate reg struct gets register fields even though no BFU takes
+; it, and archgen reports where each of its fields sits. The bit-fields of
+; hdr share an i8 and get fields of their own; the padding of pad is named
+; as such and its pointer cannot be held in a register.
+; LAYOUT:      primate reg struct hdr: 56 bits in 1 register(s) of 64 bits
+; LAYOUT-NEXT:     a: bits [0, 32) i32
+; LAYOUT-NEXT:     flags,ver: bits [32, 40) i8
+; LAYOUT-NEXT:     len: bits [40, 56) i16
+; LAYOUT-NEXT:     bit-field flags: bits [32, 35)
+; LAYOUT-NEXT:     bit-field ver: bits [35, 40)
+; LAYOUT-NEXT: primate reg struct pad: 64 bits in 1 register(s) of 64 bits
+; LAYOUT-NEXT:     tag: bits [0, 8) i8
+; LAYOUT-NEXT:     <padding>: bits [8, 32) [3 x i8]
+; LAYOUT-NEXT:     val: bits [32, 64) i32
+; LAYOUT-NEXT:     next: not register resident (ptr)
+
+; CFG:      REG_WIDTH=64{{$}}
+; CFG:      SRC_POS={{.*}} 32 35 40{{ }}
+
+%struct.hdr = type { i32, i8, i16 }
+%struct.pad = type { i8, [3 x i8], i32, ptr }
+
+define void @primate_main() {
+entry:
+  %h = alloca %struct.hdr
+  %p = alloca %struct.pad
+  %a = getelementptr %struct.hdr, ptr %h, i32 0, i32 0
+  store i32 0, ptr %a
+  %v = getelementptr %struct.pad, ptr %p, i32 0, i32 2
+  store i32 0, ptr %v
+  ret void
+}
+
+!primate.reg = !{!0, !5}
+
+!0 = !{%struct.hdr poison, !"hdr", !1, !2}
+!1 = !{!"a", !"flags,ver", !"len"}
+!2 = !{!3, !4}
+!3 = !{!"flags", i32 1, i32 0, i32 3}
+!4 = !{!"ver", i32 1, i32 3, i32 5}
+!5 = !{%struct.pad poison, !"pad", !6, !7}
+!6 = !{!"tag", !"", !"val", !"next"}
+!7 = !{}
@@ -0,0 +1,79 @@
+; RUN: opt -passes=primate-specialize -S %s | FileCheck %s
+; RUN: opt -passes=primate-specialize -primate-specialize-min-prob=0.8 -S %s \
+; RUN:   | FileCheck --check-prefix=ONE %s
+; RUN: opt -passes=primate-specialize -primate-specialize-min-prob=0.95 -S %s \
+; RUN:   | FileCheck --check-prefix=NONE %s
+; RUN: opt -passes=primate-specialize -primate-specialize-max-fields=0 -S %s \
+; RUN:   | FileCheck --check-prefix=NONE %s
+
+%struct.hdr = type { i8, i8 }
+
+declare %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32)
+declare void @llvm.primate.output.s_struct.hdr.i32(%struct.hdr, i32)
+declare void @llvm.primate.input.done()
+declare void @llvm.primate.output.done()
+
+; Version 4 covers 90% of the packets and protocol 6 80% of those, so the
+; guard checks both fields and the copy behind it has no branches left.
+; CHECK-LABEL: @primate_main(
+; CHECK:       %proto = extractvalue %struct.hdr %h, 1
+; CHECK-NEXT:  %primate.hot = icmp eq i8 %ver, 4
+; CHECK-NEXT:  %primate.hot1 = icmp eq i8 %proto, 6
+; CHECK-NEXT:  [[GUARD:%.*]] = and i1 %primate.hot, %primate.hot1
+; CHECK-NEXT:  br i1 [[GUARD]], label %primate.generic.hot, label %primate.generic, !prof [[W:![0-9]+]], !primate.specialize
+; CHECK:       primate.generic:
+; CHECK-NEXT:  call void @llvm.primate.input.done()
+; CHECK-NEXT:  %is4 = icmp eq i8 %ver, 4
+; CHECK:       primate.generic.hot:
+; CHECK-NEXT:  call void @llvm.primate.input.done()
+; CHECK-NEXT:  br label %v4.hot
+; CHECK:       v4.hot:
+; CHECK-NEXT:  br label %tcp.hot
+; CHECK:       tcp.hot:
+; CHECK-NEXT:  call void @llvm.primate.output.s_struct.hdr.i32(%struct.hdr %h, i32 2)
+; CHECK-NEXT:  br label %done.hot
+; CHECK-NOT:   other.hot:
+; CHECK:       [[W]] = !{!"branch_weights", i32 754974, i32 293601}
+
+; Only the version is hot enough on its own, and the guard follows its read.
+; ONE-LABEL: @primate_main(
+; ONE:       %ver = extractvalue %struct.hdr %h, 0
+; ONE-NEXT:  %primate.hot = icmp eq i8 %ver, 4
+; ONE-NEXT:  br i1 %primate.hot, label %primate.generic.hot, label %primate.generic
+; ONE:       primate.generic.hot:
+; ONE-NEXT:  %proto.hot = extractvalue %struct.hdr %h, 1
+; ONE-NEXT:  call void @llvm.primate.input.done()
+; ONE-NEXT:  br label %v4.hot
+; ONE:       v4.hot:
+; ONE-NEXT:  %is6.hot = icmp eq i8 %proto.hot, 6
+
+; NONE-NOT: primate.hot
+; NONE-NOT: !primate.specialize
+
+define void @primate_main() {
+entry:
+  %h = call %struct.hdr @llvm.primate.input.s_struct.hdr.i32(i32 2)
+  %ver = extractvalue %struct.hdr %h, 0
+  %proto = extractvalue %struct.hdr %h, 1
+  call void @llvm.primate.input.done()
+  %is4 = icmp eq i8 %ver, 4
+  br i1 %is4, label %v4, label %other, !prof !0
+
+v4:
+  %is6 = icmp eq i8 %proto, 6
+  br i1 %is6, label %tcp, label %other, !prof !1
+
+tcp:
+  call void @llvm.primate.output.s_struct.hdr.i32(%struct.hdr %h, i32 2)
+  br label %done
+
+other:
+  br label %done
+
+done:
+  call void @llvm.primate.output.done()
+  ret void
+}
+
+!0 = !{!"branch_weights", i32 90, i32 10}
+!1 = !{!"branch_weights", i32 80, i32 20}
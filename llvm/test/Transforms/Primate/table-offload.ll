@@ -0,0 +1,99 @@
+; RUN: rm -rf %t && split-file %s %t && mkdir %t/a %t/b
+; RUN: opt -passes=primate-table-offload -S %t/a.ll \
+; RUN:   | FileCheck --check-prefix=OFFLOAD %s
+
+; The ROMs are numbered by table name, so a module that declares and reads
+; the same tables in another order gets the same rom.cfg.
+; RUN: cd %t/a && opt -passes=primate-table-offload,primate-arch-gen \
+; RUN:   -disable-output %t/a.ll 2>&1 | FileCheck --check-prefix=REPORT %s
+; RUN: cd %t/b && opt -passes=primate-table-offload,primate-arch-gen \
+; RUN:   -disable-output %t/b.ll
+; RUN: FileCheck --check-prefix=ROM --input-file=%t/a/rom.cfg %s
+; RUN: diff %t/a/rom.cfg %t/b/rom.cfg
+; RUN: FileCheck --check-prefix=MEM --input-file=%t/a/ROM_proto.mem %s
+; RUN: diff %t/a/ROM_proto.mem %t/b/ROM_proto.mem
+
+; Lookups with a computed index become calls to the table's ROM BFU; the
+; index is truncated to i32. A read at a constant index stays a load.
+; OFFLOAD-NOT:  @proto =
+; OFFLOAD-NOT:  @sbox =
+; OFFLOAD:      @ports = internal constant
+; OFFLOAD-LABEL: define void @primate_main()
+; OFFLOAD:      %s = call i16 @primate_rom_sbox(i32 %i), !primate ![[SBOX:[0-9]+]]
+; OFFLOAD:      [[IDX:%.*]] = trunc i64 %j to i32
+; OFFLOAD-NEXT: %p = call i16 @primate_rom_proto(i32 [[IDX]]), !primate ![[PROTO:[0-9]+]]
+; OFFLOAD:      load i16, ptr getelementptr
+; OFFLOAD:      declare i16 @primate_rom_proto(i32) #{{[0-9]+}} {{.*}}!primate.rom ![[PROTO_ROM:[0-9]+]]
+; OFFLOAD:      declare i16 @primate_rom_sbox(i32) #{{[0-9]+}} {{.*}}!primate.rom ![[SBOX_ROM:[0-9]+]]
+; OFFLOAD:      attributes #{{[0-9]+}} = { nounwind }
+; OFFLOAD-DAG:  ![[SBOX]] = !{!"blue", !"ROM_sbox", i64 1, i64 1}
+; OFFLOAD-DAG:  ![[PROTO]] = !{!"blue", !"ROM_proto", i64 1, i64 1}
+; OFFLOAD-DAG:  ![[PROTO_ROM]] = !{[4 x i16] [i16 1, i16 6, i16 17, i16 47], i32 0}
+; OFFLOAD-DAG:  ![[SBOX_ROM]] = !{[8 x i16] [i16 7, i16 3, i16 5, i16 1, i16 0, i16 2, i16 6, i16 4], i32 1}
+
+; REPORT-DAG: ROM BFU ROM_proto: 4 x 16 bits
+; REPORT-DAG: ROM BFU ROM_sbox: 8 x 16 bits
+
+; ROM:      NUM_ROMS=2
+; ROM-NEXT: ROM_0_NAME=ROM_proto
+; ROM-NEXT: ROM_0_DEPTH=4
+; ROM-NEXT: ROM_0_WIDTH=16
+; ROM-NEXT: ROM_0_LATENCY=1
+; ROM-NEXT: ROM_0_INIT=ROM_proto.mem
+; ROM-NEXT: ROM_1_NAME=ROM_sbox
+; ROM-NEXT: ROM_1_DEPTH=8
+
+; MEM:      0001
+; MEM-NEXT: 0006
+; MEM-NEXT: 0011
+; MEM-NEXT: 002f
+
+;--- a.ll
+@sbox = internal constant [8 x i16] [i16 7, i16 3, i16 5, i16 1, i16 0, i16 2, i16 6, i16 4]
+@proto = internal constant [4 x i16] [i16 1, i16 6, i16 17, i16 47]
+@ports = internal constant [2 x i16] [i16 80, i16 443]
+@in = global i32 0
+@in.wide = global i64 0
+@out = global [3 x i16] zeroinitializer
+
+define void @primate_main() {
+entry:
+  %i = load i32, ptr @in
+  %j = load i64, ptr @in.wide
+  %sp = getelementptr [8 x i16], ptr @sbox, i32 0, i32 %i
+  %s = load i16, ptr %sp
+  %pp = getelementptr i16, ptr @proto, i64 %j
+  %p = load i16, ptr %pp
+  %port = load i16, ptr getelementptr inbounds ([2 x i16], ptr @ports, i32 0, i32 1)
+  store i16 %s, ptr @out
+  %o1 = getelementptr [3 x i16], ptr @out, i32 0, i32 1
+  store i16 %p, ptr %o1
+  %o2 = getelementptr [3 x i16], ptr @out, i32 0, i32 2
+  store i16 %port, ptr %o2
+  ret void
+}
+
+;--- b.ll
+@in = global i32 0
+@in.wide = global i64 0
+@out = global [3 x i16] zeroinitializer
+@proto = internal constant [4 x i16] [i16 1, i16 6, i16 17, i16 47]
+@ports = internal constant [2 x i16] [i16 80, i16 443]
+@sbox = internal constant [8 x i16] [i16 7, i16 3, i16 5, i16 1, i16 0, i16 2, i16 6, i16 4]
+
+define void @primate_main() {
+entry:
+  %i = load i32, ptr @in
+  %j = load i64, ptr @in.wide
+  %pp = getelementptr i16, ptr @proto, i64 %j
+  %p = load i16, ptr %pp
+  %sp = getelementptr [8 x i16], ptr @sbox, i32 0, i32 %i
+  %s = load i16, ptr %sp
+  %port = load i16, ptr getelementptr inbounds ([2 x i16], ptr @ports, i32 0, i32 1)
+  store i16 %s, ptr @out
+  %o1 = getelementptr [3 x i16], ptr @out, i32 0, i32 1
+  store i16 %p, ptr %o1
+  %o2 = getelementptr [3 x i16], ptr @out, i32 0, i32 2
+  store i16 %port, ptr %o2
+  ret void
+}
@@ -0,0 +1,66 @@
+; REQUIRES: asserts
+; RUN: rm -rf %t && mkdir %t && cd %t
+; RUN: opt -passes=primate-arch-gen -debug-only=primate-arch-gen \
+; RUN:   -disable-output %s 2>&1 | FileCheck %s
+; RUN: opt -passes=primate-arch-gen -debug-only=primate-arch-gen \
+; RUN:   -primate-default-trip-count=3 -disable-output %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=DEFAULT %s
+
+; Archgen weights each loop body by its expected trip count: the exact SCEV
+; count, then the profile weights, then llvm.loop.primate.trip_count, then
+; -primate-default-trip-count. The latter three loops walk the packet until
+; a volatile flag says stop, so SCEV knows nothing about them.
+; CHECK-DAG: loop exact: expected trip count 10{{$}}
+; CHECK-DAG: loop weighted: expected trip count 16{{$}}
+; CHECK-DAG: loop annotated: expected trip count 12{{$}}
+; CHECK-DAG: loop unknown: expected trip count 8{{$}}
+
+; An iteration of exact cannot start before the mul and add feeding %acc
+; have finished.
+; CHECK-DAG: loop exact: RecMII 2{{$}}
+
+; DEFAULT-DAG: loop exact: expected trip count 10{{$}}
+; DEFAULT-DAG: loop weighted: expected trip count 16{{$}}
+; DEFAULT-DAG: loop annotated: expected trip count 12{{$}}
+; DEFAULT-DAG: loop unknown: expected trip count 3{{$}}
+
+@more = global i32 0
+@out = global i32 0
+
+define void @primate_main() {
+entry:
+  br label %exact
+
+exact:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %exact ]
+  %acc = phi i32 [ 1, %entry ], [ %acc.next, %exact ]
+  %m = mul i32 %acc, 3
+  %acc.next = add i32 %m, %i
+  %i.next = add nuw nsw i32 %i, 1
+  %exact.done = icmp eq i32 %i.next, 10
+  br i1 %exact.done, label %weighted, label %exact
+
+weighted:
+  %w = load volatile i32, ptr @more
+  %weighted.more = icmp ne i32 %w, 0
+  br i1 %weighted.more, label %weighted, label %annotated, !prof !0
+
+annotated:
+  %a = load volatile i32, ptr @more
+  %annotated.more = icmp ne i32 %a, 0
+  br i1 %annotated.more, label %annotated, label %unknown, !llvm.loop !1
+
+unknown:
+  %u = load volatile i32, ptr @more
+  %unknown.more = icmp ne i32 %u, 0
+  br i1 %unknown.more, label %unknown, label %exit
+
+exit:
+  store i32 %acc.next, ptr @out
+  ret void
+}
+
+; 15 trips around the backedge for each exit
+!0 = !{!"branch_weights", i32 15, i32 1}
+!1 = distinct !{!1, !2}
+!2 = !{!"llvm.loop.primate.trip_count", i32 12}
@@ -369,14 +369,8 @@ bool SourcePrinter::cacheSource(const DILineInfo &LineInfo) {
   return true;
 }
 
-void SourcePrinter::printSourceLine(formatted_raw_ostream &OS,
-                                    object::SectionedAddress Address,
-                                    StringRef ObjectFilename,
-                                    LiveVariablePrinter &LVP,
-                                    StringRef Delimiter) {
-  if (!Symbolizer)
-    return;
-
+DILineInfo SourcePrinter::getLineInfo(object::SectionedAddress Address,
+                                      StringRef ObjectFilename) {
   DILineInfo LineInfo = DILineInfo();
   Expected<DILineInfo> ExpectedLineInfo =
       Symbolizer->symbolizeCode(*Obj, Address);
@@ -419,7 +413,18 @@ void SourcePrinter::printSourceLine(formatted_raw_ostream &OS,
 
     LineInfo.FileName = std::string(FilePath);
   }
+  return LineInfo;
+}
+
+void SourcePrinter::printSourceLine(formatted_raw_ostream &OS,
+                                    object::SectionedAddress Address,
+                                    StringRef ObjectFilename,
+                                    LiveVariablePrinter &LVP,
+                                    StringRef Delimiter) {
+  if (!Symbolizer)
+    return;
 
+  DILineInfo LineInfo = getLineInfo(Address, ObjectFilename);
   if (PrintLines)
     printLines(OS, LineInfo, Delimiter, LVP);
   if (PrintSource)
@@ -427,6 +432,33 @@ void SourcePrinter::printSourceLine(formatted_raw_ostream &OS,
   OldLineInfo = LineInfo;
 }
 
+void SourcePrinter::printPacketSourceLines(
+    formatted_raw_ostream &OS, ArrayRef<object::SectionedAddress> Slots,
+    StringRef ObjectFilename, LiveVariablePrinter &LVP, StringRef Delimiter) {
+  if (!Symbolizer)
+    return;
+
+  // Every distinct line is printed once per packet, in slot order, even if
+  // the previous packet ended on the same line.
+  std::vector<DILineInfo> Seen;
+  OldLineInfo.Line = 0;
+  for (object::SectionedAddress Address : Slots) {
+    DILineInfo LineInfo = getLineInfo(Address, ObjectFilename);
+    if (LineInfo.Line == 0 ||
+        llvm::any_of(Seen, [&](const DILineInfo &Other) {
+          return Other.Line == LineInfo.Line &&
+                 Other.FileName == LineInfo.FileName;
+        }))
+      continue;
+    Seen.push_back(LineInfo);
+    if (PrintLines)
+      printLines(OS, LineInfo, Delimiter, LVP);
+    if (PrintSource)
+      printSources(OS, LineInfo, ObjectFilename, Delimiter, LVP);
+    OldLineInfo = LineInfo;
+  }
+}
+
 void SourcePrinter::printLines(formatted_raw_ostream &OS,
                                const DILineInfo &LineInfo, StringRef Delimiter,
                                LiveVariablePrinter &LVP) {
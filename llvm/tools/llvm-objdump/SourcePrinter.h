@@ -144,6 +144,9 @@ protected:
 private:
   bool cacheSource(const DILineInfo &LineInfoFile);
 
+  DILineInfo getLineInfo(object::SectionedAddress Address,
+                         StringRef ObjectFilename);
+
   void printLines(formatted_raw_ostream &OS, const DILineInfo &LineInfo,
                   StringRef Delimiter, LiveVariablePrinter &LVP);
 
@@ -164,6 +167,12 @@ public:
                                StringRef ObjectFilename,
                                LiveVariablePrinter &LVP,
                                StringRef Delimiter = "; ");
+  // Prints the source lines of all slots of a VLIW packet at once.
+  void printPacketSourceLines(formatted_raw_ostream &OS,
+                              ArrayRef<object::SectionedAddress> Slots,
+                              StringRef ObjectFilename,
+                              LiveVariablePrinter &LVP,
+                              StringRef Delimiter = "; ");
 };
 
 } // namespace objdump
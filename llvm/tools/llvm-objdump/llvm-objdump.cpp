@@ -73,6 +73,8 @@
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/LLVMDriver.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrimateAttributeParser.h"
+#include "llvm/Support/PrimateAttributes.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetSelect.h"
@@ -232,6 +234,7 @@ bool objdump::UnwindInfo;
 static bool Wide;
 std::string objdump::Prefix;
 uint32_t objdump::PrefixStrip;
+static std::string PrimateConfig;
 
 DebugVarsFormat objdump::DbgVariables = DVDisabled;
 
@@ -853,11 +856,18 @@ public:
     if((printed_instrs % numSlots) == 0) {
       OS << printed_instrs / numSlots << " ";
       OS << "--------\n";
+
+      // the line table has a row per slot, show all lines the packet executes
+      if (SP && (PrintSource || PrintLines)) {
+        SmallVector<object::SectionedAddress, 16> Slots;
+        for (unsigned i = 0; i < numSlots; i++)
+          Slots.push_back({Address.Address + i * Bytes.size(),
+                           Address.SectionIndex});
+        SP->printPacketSourceLines(OS, Slots, ObjectFilename, LVP);
+      }
     }
     printed_instrs++;
     
-    if (SP && (PrintSource || PrintLines))
-      SP->printSourceLine(OS, Address, ObjectFilename, LVP);
     LVP.printBetweenInsts(OS, false);
 
     size_t start = OS.tell();
@@ -3172,6 +3182,52 @@ static void checkForInvalidStartStopAddress(ObjectFile *Obj,
                   Obj->getFileName());
 }
 
+// Primate objects record the fingerprint of the primate.cfg they were
+// compiled for. Print it, so image tools reading the dump can check it too,
+// and refuse objects made for another configuration than --primate-config.
+static void checkPrimateConfig(const ObjectFile *O) {
+  const auto *Elf = dyn_cast<ELFObjectFileBase>(O);
+  if (!Elf || Elf->getEMachine() != ELF::EM_PRIMATE)
+    return;
+  PrimateAttributeParser Attributes;
+  if (Error E = Elf->getBuildAttributes(Attributes)) {
+    reportWarning(toString(std::move(E)), O->getFileName());
+    return;
+  }
+  std::optional<StringRef> Hash =
+      Attributes.getAttributeString(PrimateAttrs::CONFIG_HASH);
+  std::optional<StringRef> Summary =
+      Attributes.getAttributeString(PrimateAttrs::CONFIG);
+  // Compilers built from the stock tablegen files record no fingerprint,
+  // which is only worth a warning when a check was asked for.
+  if (!Hash) {
+    if (!PrimateConfig.empty())
+      reportWarning("no primate.cfg fingerprint, the configuration it was "
+                    "compiled for cannot be checked",
+                    O->getFileName());
+    return;
+  }
+  outs() << "primate config " << *Hash << " " << Summary.value_or("") << "\n";
+
+  StringRef ConfigFile = PrimateConfig.empty() ? "primate.cfg" : PrimateConfig;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Config =
+      MemoryBuffer::getFile(ConfigFile, /*IsText=*/true);
+  if (!Config) {
+    if (!PrimateConfig.empty())
+      reportError(errorCodeToError(Config.getError()), PrimateConfig);
+    return;
+  }
+  std::string Expected =
+      PrimateAttrs::getConfigFingerprint((*Config)->getBuffer());
+  if (*Hash != Expected)
+    reportError(O->getFileName(),
+                "compiled for primate config " + *Hash + " (" +
+                    Summary.value_or("") + ") but " + ConfigFile + " is " +
+                    Expected + " (" +
+                    PrimateAttrs::getConfigSummary((*Config)->getBuffer()) +
+                    ")");
+}
+
 static void dumpObject(ObjectFile *O, const Archive *A = nullptr,
                        const Archive::Child *C = nullptr) {
   Expected<std::unique_ptr<Dumper>> DumperOrErr = createDumper(*O);
@@ -3190,6 +3246,7 @@ static void dumpObject(ObjectFile *O, const Archive *A = nullptr,
     else
       outs() << O->getFileName();
     outs() << ":\tfile format " << O->getFileFormatName().lower() << "\n";
+    checkPrimateConfig(O);
   }
 
   if (HasStartAddressFlag || HasStopAddressFlag)
@@ -3461,6 +3518,7 @@ static void parseObjdumpOptions(const llvm::opt::InputArgList &InputArgs) {
   TripleName = InputArgs.getLastArgValue(OBJDUMP_triple_EQ).str();
   UnwindInfo = InputArgs.hasArg(OBJDUMP_unwind_info);
   Wide = InputArgs.hasArg(OBJDUMP_wide);
+  PrimateConfig = InputArgs.getLastArgValue(OBJDUMP_primate_config).str();
   Prefix = InputArgs.getLastArgValue(OBJDUMP_prefix).str();
   parseIntArg(InputArgs, OBJDUMP_prefix_strip, PrefixStrip);
   if (const opt::Arg *A = InputArgs.getLastArg(OBJDUMP_debug_vars_EQ)) {
@@ -0,0 +1,720 @@
+#! /bin/python3
+# gdb-remote stub for Primate programs, backed by a packet level simulator.
+#
+# The simulator runs the VLIW packets llvm-objdump shows for the program:
+# every slot of a packet reads the registers as they were before the packet
+# and all results land together, the branch unit decides the next packet.
+# Each barrel thread (NUM_THREADS in primate.cfg) is a gdb thread running
+# primate_main on its own input packets, and threads take turns a packet at a
+# time like the hardware does.
+#
+# Only what the functional units compute is simulated: the RV32IM or RV64IM
+# base (without the *w instructions of RV64), the input/output unit, FIFOs (looped back on the same core) and
+# extract/insert. Custom BFU instructions stop the thread with SIGILL.
+#
+# Registers shown to lldb:
+#   x0-x31, pc     the scalar registers, low XLEN bits of the wide registers
+#   p0-p31         the wide registers (WIDEREG), REG_WIDTH bits
+#   p<n>_b<k>      block k of p<n>, one per REG_BLOCK_WIDTH entry
+# All views of a register invalidate each other. h<n> is not listed, it is
+# the low 128 bits of p<n>.
+#
+# Input packets are one per line, in hex. Output packets are written the
+# same way, dropped packets as an empty line.
+
+import argparse
+import math
+import re
+import socket
+import subprocess
+import sys
+
+SIGILL = 4
+SIGTRAP = 5
+SIGSEGV = 11
+
+parser = argparse.ArgumentParser(description="gdb-remote stub simulating a Primate program")
+parser.add_argument("program", help="linked Primate ELF")
+parser.add_argument("config", help="primate.cfg the program was compiled for")
+parser.add_argument("input", help="input packets, one per line in hex")
+parser.add_argument("--output", default="sim_output.txt", help="where output packets go")
+parser.add_argument("--port", type=int, default=1234)
+parser.add_argument("--objdump", default="llvm-objdump")
+parser.add_argument("--stack-top", type=lambda v: int(v, 0), default=0x10000,
+                    help="stack of thread 0, the others follow below it")
+parser.add_argument("--stack-size", type=lambda v: int(v, 0), default=0x1000)
+parser.add_argument("--xlen", type=int, choices=(32, 64),
+                    help="primate32 or primate64, by default the ELF class of the program")
+args = parser.parse_args()
+
+# EI_CLASS is 1 for ELFCLASS32 and 2 for ELFCLASS64
+if args.xlen is None:
+    with open(args.program, "rb") as f:
+        args.xlen = 64 if f.read(5)[4:] == b"\x02" else 32
+XLEN = args.xlen
+XMASK = (1 << XLEN) - 1
+XBYTES = XLEN // 8
+
+#############################################################################
+# configuration
+
+cfg = {}
+with open(args.config) as f:
+    for line in f:
+        if "=" in line:
+            name, value = line.strip().split("=", 1)
+            cfg[name] = value
+
+NUM_THREADS = int(cfg.get("NUM_THREADS", 1))
+NUM_REGS = int(cfg.get("NUM_REGS", 32))
+REG_WIDTH = int(cfg.get("REG_WIDTH", XLEN))
+REG_MASK = (1 << REG_WIDTH) - 1
+REG_BYTES = (REG_WIDTH + 7) // 8
+REG_BITS = int(math.ceil(math.log2(NUM_REGS)))
+SRC_POS = [int(v) for v in cfg.get("SRC_POS", "0").split()]
+SRC_MODE = [int(v) for v in cfg.get("SRC_MODE", str(XLEN)).split()]
+BLOCKS = []
+pos = 0
+for width in cfg.get("REG_BLOCK_WIDTH", str(REG_WIDTH)).split():
+    BLOCKS.append((pos, int(width)))
+    pos += int(width)
+
+# Same as PrimateTargetLowering::decodeFieldSpec.
+def decode_field_spec(spec):
+    pos_bits = len(SRC_POS).bit_length()
+    pos_idx = spec & ((1 << pos_bits) - 1)
+    size_idx = spec >> pos_bits
+    if pos_idx >= len(SRC_POS) or size_idx >= len(SRC_MODE):
+        return None
+    return SRC_POS[pos_idx], SRC_MODE[size_idx]
+
+def sext(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value >> (bits - 1) else value
+
+#############################################################################
+# program
+
+def objdump(*opts):
+    cmd = [args.objdump, *opts, f"--primate-config={args.config}", args.program]
+    return subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+
+insnPat = re.compile(r"^\s*([0-9a-f]+):\s+((?:[0-9a-f]{2} )+)\s*(\S+)\s*(.*)$")
+pktBrk = re.compile(r"[0-9]+ --------$")
+symPat = re.compile(r"^([0-9a-f]+) .* ([^ ]+)$")
+
+# packet start -> [(address, encoding, mnemonic, operands)]
+packets = {}
+packet_of = {}  # slot address -> packet start
+current = None
+for line in objdump("-d").split("\n"):
+    if pktBrk.match(line.strip()):
+        current = None
+        continue
+    m = insnPat.match(line)
+    if not m:
+        continue
+    addr = int(m.group(1), 16)
+    raw = bytes(int(b, 16) for b in m.group(2).split())
+    if current is None:
+        current = addr
+        packets[current] = []
+    text = m.group(4).split("<")[0].split("#")[0]
+    ops = [o.strip() for o in text.split(",") if o.strip()]
+    packets[current].append((addr, int.from_bytes(raw, "little"), m.group(3), ops))
+    packet_of[addr] = current
+if not packets:
+    print(f"no packets in {args.program}, was it compiled for primate?")
+    exit(-1)
+PACKET_BYTES = min(b - a for a, b in zip(sorted(packets), sorted(packets)[1:])) \
+    if len(packets) > 1 else 4
+
+entry = None
+for line in objdump("-t").split("\n"):
+    m = symPat.match(line.strip())
+    if m and m.group(2) == "primate_main":
+        entry = int(m.group(1), 16)
+if entry is None:
+    print(f"no primate_main in {args.program}")
+    exit(-1)
+
+# memory is sparse, one entry per byte
+memory = {}
+dumpPat = re.compile(r"^ ([0-9a-f]+) ")
+for line in objdump("-s").split("\n"):
+    m = dumpPat.match(line)
+    if not m:
+        continue
+    # four words of hex, padded to full width, then the ASCII column
+    addr = int(m.group(1), 16)
+    for word in line[m.end():m.end() + 36].split():
+        for i in range(0, len(word), 2):
+            memory[addr] = int(word[i:i + 2], 16)
+            addr += 1
+
+def load(addr, size):
+    return int.from_bytes(bytes(memory.get(addr + i, 0) for i in range(size)), "little")
+
+def store(addr, size, value):
+    for i in range(size):
+        memory[addr + i] = (value >> (8 * i)) & 0xff
+
+with open(args.input) as f:
+    inputs = [bytes.fromhex(line.strip()) for line in f if line.strip()]
+outputs = open(args.output, "w")
+# FIFO channel -> values sent and not received yet
+fifos = {}
+
+#############################################################################
+# threads
+
+RETURN_ADDR = XMASK & ~3  # primate_main returns here when a packet is done
+
+class Thread:
+    def __init__(self, tid):
+        self.tid = tid
+        self.exited = False
+        self.signal = SIGTRAP
+        self.reason = "signal"
+        self.next_packet()
+
+    # Start primate_main on the next input packet, or exit without one.
+    def next_packet(self):
+        if not inputs:
+            self.exited = True
+            return
+        self.input = inputs.pop(0)
+        self.in_pos = 0
+        self.output = bytearray()
+        self.out_pos = 0
+        self.regs = [0] * NUM_REGS
+        self.regs[2] = args.stack_top - (self.tid - 1) * args.stack_size
+        self.regs[1] = RETURN_ADDR
+        self.pc = entry
+
+    def read_input(self, count):
+        data = self.input[self.in_pos:self.in_pos + count]
+        self.in_pos += count
+        return int.from_bytes(data.ljust(count, b"\0"), "little")
+
+    def write_output(self, value, count):
+        data = value.to_bytes(REG_BYTES, "little")[:count].ljust(count, b"\0")
+        self.output[self.out_pos:self.out_pos + count] = data
+        self.out_pos += count
+
+NUM_INPUTS = len(inputs)
+threads = [Thread(tid) for tid in range(1, NUM_THREADS + 1)]
+
+class Stop(Exception):
+    def __init__(self, signal):
+        self.signal = signal
+
+def reg_index(name):
+    if not re.fullmatch(r"[xhp][0-9]+", name):
+        raise Stop(SIGILL)
+    return int(name[1:])
+
+def mem_operand(op):
+    m = re.fullmatch(r"(-?[0-9]+)\((\w+)\)", op)
+    if not m:
+        raise Stop(SIGILL)
+    return int(m.group(1)), reg_index(m.group(2))
+
+# imm12 of an I format instruction, for the inserts that do not print it
+def imm12_of(encoding):
+    return sext(encoding >> (10 + 2 * REG_BITS), 12)
+
+# Branch and jump offsets count packets, see adjustFixupValue.
+def branch_offset(encoding):
+    d = 3 * (REG_BITS - 5)
+    v = ((encoding >> 8) & 0xf) | (((encoding >> (25 + d)) & 0x3f) << 4) | \
+        (((encoding >> 7) & 1) << 10) | (((encoding >> (31 + d)) & 1) << 11)
+    return sext(v, 12)
+
+def jal_offset(encoding):
+    f = encoding >> (12 + REG_BITS - 5)
+    v = ((f >> 9) & 0x3ff) | (((f >> 8) & 1) << 10) | ((f & 0xff) << 11) | \
+        (((f >> 19) & 1) << 19)
+    return sext(v, 20)
+
+ALU_R = {
+    "add": lambda a, b: a + b,
+    "sub": lambda a, b: a - b,
+    "and": lambda a, b: a & b,
+    "or": lambda a, b: a | b,
+    "xor": lambda a, b: a ^ b,
+    "sll": lambda a, b: a << (b & (XLEN - 1)),
+    "srl": lambda a, b: a >> (b & (XLEN - 1)),
+    "sra": lambda a, b: sext(a, XLEN) >> (b & (XLEN - 1)),
+    "slt": lambda a, b: int(sext(a, XLEN) < sext(b, XLEN)),
+    "sltu": lambda a, b: int(a < b),
+    "mul": lambda a, b: a * b,
+    "mulh": lambda a, b: (sext(a, XLEN) * sext(b, XLEN)) >> XLEN,
+    "mulhu": lambda a, b: (a * b) >> XLEN,
+    "mulhsu": lambda a, b: (sext(a, XLEN) * b) >> XLEN,
+    "div": lambda a, b: int(sext(a, XLEN) / sext(b, XLEN)) if b else XMASK,
+    "divu": lambda a, b: a // b if b else XMASK,
+    "rem": lambda a, b: int(math.fmod(sext(a, XLEN), sext(b, XLEN))) if b else a,
+    "remu": lambda a, b: a % b if b else a,
+}
+ALU_I = {"addi": "add", "andi": "and", "ori": "or", "xori": "xor", "slli": "sll",
+         "srli": "srl", "srai": "sra", "slti": "slt", "sltiu": "sltu"}
+BRANCH = {
+    "beq": lambda a, b: a == b,
+    "bne": lambda a, b: a != b,
+    "blt": lambda a, b: sext(a, XLEN) < sext(b, XLEN),
+    "bge": lambda a, b: sext(a, XLEN) >= sext(b, XLEN),
+    "bltu": lambda a, b: a < b,
+    "bgeu": lambda a, b: a >= b,
+}
+# aliases llvm-objdump prints: mnemonic -> (branch, swap operands)
+BRANCH_ALIAS = {"bgt": ("blt", True), "ble": ("bge", True),
+                "bgtu": ("bltu", True), "bleu": ("bgeu", True)}
+BRANCH_ZERO = {"beqz": ("beq", False), "bnez": ("bne", False),
+               "bltz": ("blt", False), "bgez": ("bge", False),
+               "blez": ("bge", True), "bgtz": ("blt", True)}
+LOADS = {"lb": (1, True), "lh": (2, True), "lw": (4, True),
+         "lbu": (1, False), "lhu": (2, False)}
+STORES = {"sb": 1, "sh": 2, "sw": 4}
+if XLEN == 64:
+    LOADS.update({"ld": (8, True), "lwu": (4, False)})
+    STORES["sd"] = 8
+
+# Run one packet of thread t. Returns False once the thread is done with its
+# input packet.
+def step_packet(t):
+    if t.pc not in packets:
+        raise Stop(SIGSEGV)
+    start = t.pc
+    regs = t.regs
+    x = lambda name: regs[reg_index(name)] & XMASK
+    # every slot reads the state from before the packet: register writes
+    # and stores land at the end of it
+    writes = {}
+    stores = []
+    next_pc = start + PACKET_BYTES
+
+    def set_x(name, value):
+        writes[reg_index(name)] = value & XMASK
+
+    def jump(target):
+        nonlocal next_pc
+        next_pc = target
+
+    for addr, enc, op, ops in packets[start]:
+        if op == "nop":
+            continue
+        if op in ALU_R and len(ops) == 3:
+            set_x(ops[0], ALU_R[op](x(ops[1]), x(ops[2])))
+        elif op in ALU_I:
+            set_x(ops[0], ALU_R[ALU_I[op]](x(ops[1]), int(ops[2], 0) & XMASK))
+        elif op == "li":
+            set_x(ops[0], int(ops[1], 0))
+        elif op in ("lui", "auipc"):
+            # the upper immediate is sign extended from bit 31 on RV64
+            v = sext((int(ops[1], 0) << 12) & 0xffffffff, 32)
+            set_x(ops[0], v + (addr if op == "auipc" else 0))
+        elif op == "mv":
+            set_x(ops[0], x(ops[1]))
+        elif op == "not":
+            set_x(ops[0], ~x(ops[1]))
+        elif op == "neg":
+            set_x(ops[0], -x(ops[1]))
+        elif op in ("seqz", "snez", "sltz", "sgtz"):
+            v = sext(x(ops[1]), XLEN)
+            set_x(ops[0], {"seqz": v == 0, "snez": v != 0, "sltz": v < 0, "sgtz": v > 0}[op])
+        elif op in LOADS:
+            size, signed = LOADS[op]
+            off, base = mem_operand(ops[1])
+            v = load((regs[base] + off) & XMASK, size)
+            set_x(ops[0], sext(v, size * 8) if signed else v)
+        elif op in STORES:
+            off, base = mem_operand(ops[1])
+            stores.append(((regs[base] + off) & XMASK, STORES[op], x(ops[0])))
+        elif op in BRANCH or op in BRANCH_ALIAS or op in BRANCH_ZERO:
+            if op in BRANCH_ZERO:
+                op, swap = BRANCH_ZERO[op]
+                a, b = x(ops[0]), 0
+            else:
+                op, swap = BRANCH_ALIAS.get(op, (op, False))
+                a, b = x(ops[0]), x(ops[1])
+            if swap:
+                a, b = b, a
+            if BRANCH[op](a, b):
+                jump(start + branch_offset(enc) * PACKET_BYTES)
+        elif op in ("j", "jal"):
+            if op == "jal" and len(ops) == 2:
+                set_x(ops[0], start + PACKET_BYTES)
+            elif op == "jal":
+                set_x("x1", start + PACKET_BYTES)
+            jump(start + jal_offset(enc) * PACKET_BYTES)
+        elif op in ("jr", "jalr", "ret"):
+            if op == "ret":
+                target = regs[1]
+            elif len(ops) == 1:
+                target = x(ops[0])
+                if op == "jalr":
+                    set_x("x1", start + PACKET_BYTES)
+            else:
+                off, base = mem_operand(ops[1]) if "(" in ops[1] else (int(ops[2], 0), reg_index(ops[1]))
+                target = regs[base] + off
+                set_x(ops[0], start + PACKET_BYTES)
+            jump(target & XMASK & ~1)
+        elif op == "end":
+            jump(RETURN_ADDR)
+        elif op == "ebreak":
+            raise Stop(SIGTRAP)
+        elif op in ("extract", "extractbs", "extracth"):
+            field = decode_field_spec(int(ops[2], 0))
+            if not field:
+                raise Stop(SIGILL)
+            fpos, fsize = field
+            v = (regs[reg_index(ops[1])] >> fpos) & ((1 << fsize) - 1)
+            if op == "extractbs":
+                v = int.from_bytes(v.to_bytes((fsize + 7) // 8, "little"), "big")
+            writes[reg_index(ops[0])] = v if op == "extracth" else v & XMASK
+        elif op in ("insert", "insertbs", "inserth"):
+            field = decode_field_spec(int(ops[3], 0) if len(ops) > 3 else imm12_of(enc))
+            if not field:
+                raise Stop(SIGILL)
+            fpos, fsize = field
+            fmask = ((1 << fsize) - 1) << fpos
+            v = regs[reg_index(ops[2])] & ((1 << fsize) - 1)
+            if op == "insertbs":
+                v = int.from_bytes(v.to_bytes((fsize + 7) // 8, "little"), "big")
+            rd = reg_index(ops[0])
+            base = writes.get(rd, regs[reg_index(ops[1])])
+            writes[rd] = (base & ~fmask & REG_MASK) | (v << fpos)
+        elif op == "inputread":
+            writes[reg_index(ops[0])] = t.read_input(x(ops[1]) + int(ops[2], 0))
+        elif op == "inputseekread":
+            t.in_pos += x(ops[1])
+            writes[reg_index(ops[0])] = t.read_input(int(ops[2], 0))
+        elif op == "inputseek":
+            t.in_pos += x(ops[1]) + int(ops[2], 0)
+            set_x(ops[0], t.in_pos)
+        elif op == "inputlen":
+            set_x(ops[0], len(t.input))
+        elif op == "inputdone":
+            pass
+        elif op == "outputwrite":
+            t.write_output(regs[reg_index(ops[0])], int(ops[1], 0))
+        elif op == "outputseek":
+            t.out_pos += x(ops[1]) + int(ops[2], 0)
+            set_x(ops[0], t.out_pos)
+        elif op == "outputdone":
+            outputs.write(t.output.hex() + "\n")
+            outputs.flush()
+            t.output = bytearray()
+        elif op == "drop":
+            outputs.write("\n")
+            outputs.flush()
+            jump(RETURN_ADDR)
+        elif op == "fifosend":
+            fifos.setdefault(int(ops[1], 0), []).append(regs[reg_index(ops[0])])
+        elif op == "fiforecv":
+            queue = fifos.get(int(ops[1], 0))
+            if not queue:
+                raise Stop(SIGILL)
+            writes[reg_index(ops[0])] = queue.pop(0)
+        else:
+            raise Stop(SIGILL)
+
+    for idx, value in writes.items():
+        if idx:
+            regs[idx] = value & REG_MASK
+    for addr, size, value in stores:
+        store(addr, size, value)
+    t.pc = next_pc & XMASK
+    if t.pc == RETURN_ADDR:
+        t.next_packet()
+        return False
+    return True
+
+#############################################################################
+# registers as lldb sees them
+
+# (name, bitsize, group, read(t), write(t, value))
+registers = []
+for n in range(NUM_REGS):
+    def rd(t, n=n): return t.regs[n] & XMASK
+    def wr(t, v, n=n): t.regs[n] = (t.regs[n] & ~XMASK) | (v & XMASK) if n else 0
+    registers.append((f"x{n}", XLEN, "general", rd, wr))
+def rd_pc(t): return t.pc
+def wr_pc(t, v): t.pc = v
+registers.append(("pc", XLEN, "general", rd_pc, wr_pc))
+FIRST_WIDE = len(registers)
+for n in range(NUM_REGS):
+    def rd(t, n=n): return t.regs[n]
+    def wr(t, v, n=n): t.regs[n] = v & REG_MASK if n else 0
+    registers.append((f"p{n}", REG_WIDTH, "wide", rd, wr))
+FIRST_BLOCK = len(registers)
+for n in range(NUM_REGS):
+    for k, (bpos, bwidth) in enumerate(BLOCKS):
+        mask = (1 << bwidth) - 1
+        def rd(t, n=n, bpos=bpos, mask=mask): return (t.regs[n] >> bpos) & mask
+        def wr(t, v, n=n, bpos=bpos, mask=mask):
+            if n:
+                t.regs[n] = (t.regs[n] & ~(mask << bpos)) | ((v & mask) << bpos)
+        registers.append((f"p{n}_b{k}", bwidth, "fields", rd, wr))
+
+def views_of(n):
+    first = FIRST_BLOCK + n * len(BLOCKS)
+    return [n, FIRST_WIDE + n] + list(range(first, first + len(BLOCKS)))
+
+def reg_bytes(regnum):
+    return (registers[regnum][1] + 7) // 8
+
+def target_xml():
+    out = ['<?xml version="1.0"?>', '<!DOCTYPE target SYSTEM "gdb-target.dtd">',
+           "<target>", "<architecture>primate</architecture>",
+           '<feature name="org.primate.cpu">']
+    for regnum, (name, bits, group, _, _) in enumerate(registers):
+        attrs = f'name="{name}" bitsize="{bits}" regnum="{regnum}" group="{group}"'
+        if bits > 64:
+            attrs += ' encoding="vector" format="vector-uint8"'
+        else:
+            attrs += ' type="int" encoding="uint" format="hex"'
+        if name == "pc":
+            attrs += ' generic="pc"'
+        else:
+            n = int(re.match(r"[xp]([0-9]+)", name).group(1))
+            others = [str(r) for r in views_of(n) if r != regnum]
+            attrs += f' invalidate_regnums="{",".join(others)}"'
+            if regnum < NUM_REGS:
+                attrs += f' dwarf_regnum="{n}"'
+        out.append(f"  <reg {attrs}/>")
+    out += ["</feature>", "</target>"]
+    return "\n".join(out)
+
+#############################################################################
+# gdb remote protocol
+
+def checksum(data):
+    return sum(data.encode()) & 0xff
+
+class Connection:
+    def __init__(self, sock):
+        self.sock = sock
+        self.buf = b""
+        self.ack = True
+
+    def send(self, data):
+        self.sock.sendall(f"${data}#{checksum(data):02x}".encode())
+
+    def interrupted(self):
+        self.sock.setblocking(False)
+        try:
+            chunk = self.sock.recv(4096)
+        except BlockingIOError:
+            chunk = b""
+        finally:
+            self.sock.setblocking(True)
+        self.buf += chunk
+        if b"\x03" in self.buf:
+            self.buf = self.buf.replace(b"\x03", b"")
+            return True
+        return False
+
+    def receive(self):
+        while True:
+            start = self.buf.find(b"$")
+            end = self.buf.find(b"#", start)
+            if start >= 0 and end >= 0 and len(self.buf) >= end + 3:
+                data = self.buf[start + 1:end].decode()
+                self.buf = self.buf[end + 3:]
+                if self.ack:
+                    self.sock.sendall(b"+")
+                return data
+            if b"\x03" in self.buf:
+                self.buf = self.buf.replace(b"\x03", b"")
+                return "\x03"
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                return None
+            self.buf += chunk
+
+breakpoints = set()
+cur_g = 1  # thread for register and memory access
+cur_c = 1  # thread to step
+last_stop = 1
+
+def thread(tid):
+    live = [t for t in threads if not t.exited]
+    for t in live:
+        if t.tid == tid:
+            return t
+    return live[0] if live else None
+
+def stop_reply(t):
+    live = [t for t in threads if not t.exited]
+    if t is None or not live:
+        return "W00"
+    reply = f"T{t.signal:02x}thread:{t.tid:x};"
+    reply += "threads:" + ",".join(f"{x.tid:x}" for x in live) + ";"
+    reply += f"{FIRST_WIDE - 1:02x}:{hex_le(t.pc, XBYTES)};"
+    if t.reason != "signal":
+        reply += f"reason:{t.reason};"
+    return reply
+
+def stopped(t, signal, reason):
+    global last_stop
+    for other in threads:
+        other.signal, other.reason = 0, "signal"
+    t.signal, t.reason = signal, reason
+    last_stop = t.tid
+    return stop_reply(t)
+
+def run_one(t):
+    try:
+        step_packet(t)
+    except Stop as e:
+        return stopped(t, e.signal, "signal")
+    return None
+
+def do_step(tid):
+    t = thread(tid)
+    if t is None:
+        return "W00"
+    reply = run_one(t)
+    if reply:
+        return reply
+    if t.exited:
+        t = thread(tid)
+        return stopped(t, SIGTRAP, "trace") if t else "W00"
+    return stopped(t, SIGTRAP, "trace")
+
+# Barrel threads take turns a packet at a time until one of them reaches a
+# breakpoint or faults.
+def do_continue(conn):
+    first = {t.tid: t.pc for t in threads}
+    count = 0
+    while True:
+        live = [t for t in threads if not t.exited]
+        if not live:
+            outputs.flush()
+            return "W00"
+        for t in live:
+            if t.pc in breakpoints and first.get(t.tid) != t.pc:
+                return stopped(t, SIGTRAP, "breakpoint")
+            first.pop(t.tid, None)
+            reply = run_one(t)
+            if reply:
+                return reply
+        count += 1
+        if count % 4096 == 0 and conn.interrupted():
+            return stopped(thread(last_stop), 2, "signal")
+
+def hex_le(value, nbytes):
+    return value.to_bytes(nbytes, "little").hex()
+
+def handle(conn, pkt):
+    global cur_g, cur_c
+    if pkt == "\x03":
+        return stopped(thread(last_stop), 2, "signal")
+    if pkt.startswith("qSupported"):
+        return "PacketSize=4000;qXfer:features:read+;QStartNoAckMode+;swbreak+;vContSupported+"
+    if pkt == "QStartNoAckMode":
+        conn.send("OK")
+        conn.ack = False
+        return None
+    if pkt == "QListThreadsInStopReply":
+        return "OK"
+    if pkt == "qHostInfo" or pkt == "qProcessInfo":
+        triple = f"primate{XLEN}-unknown-unknown-elf".encode().hex()
+        info = f"triple:{triple};endian:little;ptrsize:{XBYTES};"
+        return info + ("pid:1;" if pkt == "qProcessInfo" else "")
+    if pkt.startswith("qXfer:features:read:target.xml:"):
+        off, length = (int(v, 16) for v in pkt.split(":")[-1].split(","))
+        xml = target_xml()
+        chunk = xml[off:off + length]
+        return ("l" if off + length >= len(xml) else "m") + chunk
+    if pkt == "qfThreadInfo":
+        return "m" + ",".join(f"{t.tid:x}" for t in threads if not t.exited)
+    if pkt == "qsThreadInfo":
+        return "l"
+    if pkt == "qC":
+        return f"QC{last_stop:x}"
+    if pkt == "qAttached":
+        return "1"
+    if pkt.startswith("qThreadStopInfo"):
+        return stop_reply(thread(int(pkt[len("qThreadStopInfo"):], 16)))
+    if pkt == "?":
+        return stop_reply(thread(last_stop))
+    if pkt[0] == "H":
+        tid = int(pkt[2:], 16) if pkt[2:] not in ("0", "-1") else last_stop
+        if pkt[1] == "g":
+            cur_g = tid
+        else:
+            cur_c = tid
+        return "OK"
+    if pkt[0] == "g":
+        t = thread(cur_g)
+        if t is None:
+            return "E01"
+        return "".join(hex_le(reg[3](t), reg_bytes(i)) for i, reg in enumerate(registers))
+    if pkt[0] == "p":
+        regnum = int(pkt[1:].split(";")[0], 16)
+        if regnum >= len(registers):
+            return "E01"
+        return hex_le(registers[regnum][3](thread(cur_g)), reg_bytes(regnum))
+    if pkt[0] == "P":
+        regnum, value = pkt[1:].split(";")[0].split("=")
+        regnum = int(regnum, 16)
+        if regnum >= len(registers):
+            return "E01"
+        registers[regnum][4](thread(cur_g), int.from_bytes(bytes.fromhex(value), "little"))
+        return "OK"
+    if pkt[0] == "m":
+        addr, length = (int(v, 16) for v in pkt[1:].split(","))
+        return bytes(memory.get(addr + i, 0) for i in range(length)).hex()
+    if pkt[0] == "M":
+        where, data = pkt[1:].split(":")
+        addr = int(where.split(",")[0], 16)
+        for i, b in enumerate(bytes.fromhex(data)):
+            memory[addr + i] = b
+        return "OK"
+    if pkt[0] in "Zz" and pkt[1] == "0":
+        addr = int(pkt.split(",")[1], 16)
+        # only a packet start is a place a thread can stop
+        addr = packet_of.get(addr, addr)
+        if pkt[0] == "Z":
+            breakpoints.add(addr)
+        else:
+            breakpoints.discard(addr)
+        return "OK"
+    if pkt == "vCont?":
+        return "vCont;c;C;s;S"
+    if pkt.startswith("vCont;"):
+        for action in pkt.split(";")[1:]:
+            kind, _, tid = action.partition(":")
+            if kind[0] in "sS":
+                return do_step(int(tid, 16) if tid else cur_c)
+        return do_continue(conn)
+    if pkt[0] in "sS":
+        return do_step(cur_c)
+    if pkt[0] in "cC":
+        return do_continue(conn)
+    return ""
+
+server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+server.bind(("localhost", args.port))
+server.listen(1)
+print(f"{len(packets)} packets of {PACKET_BYTES} bytes, {NUM_THREADS} thread(s), "
+      f"{NUM_INPUTS} input packet(s)")
+# with --port 0 the system picks one
+port = server.getsockname()[1]
+print(f"listening on localhost:{port} (lldb: gdb-remote {port})", flush=True)
+sock, _ = server.accept()
+conn = Connection(sock)
+while True:
+    pkt = conn.receive()
+    if pkt is None or pkt in ("k", "D"):
+        if pkt == "D":
+            conn.send("OK")
+        break
+    reply = handle(conn, pkt)
+    if reply is not None:
+        conn.send(reply)
+outputs.close()